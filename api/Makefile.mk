@@ -7,6 +7,13 @@ EXTRA_DIST +=\
 	api/dir_contents\
 	api/Makefile
 
+# internaltest and perftest use the edit distance code directly, so they link
+# with this rather than us exporting the symbols from the library.
+noinst_LTLIBRARIES += libeditdistance.la
+
+libeditdistance_la_SOURCES =\
+	api/editdistance.cc
+
 lib_src +=\
 	api/decvalwtsource.cc\
 	api/documentvaluelist.cc\
@@ -15,6 +22,7 @@ lib_src +=\
 	api/error.cc\
 	api/errorhandler.cc\
 	api/expanddecider.cc\
+	api/expandwildcard.cc\
 	api/keymaker.cc\
 	api/leafpostlist.cc\
 	api/matchspy.cc\
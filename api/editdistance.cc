@@ -35,6 +35,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
@@ -213,3 +214,89 @@ edit_distance_unsigned(const unsigned * ptr1, int len1,
 {
     return seqcmp_editdist<unsigned>(ptr1, len1, ptr2, len2, max_distance);
 }
+
+EditDistanceCalculator::EditDistanceCalculator(const unsigned * ptr, int len)
+    : target(ptr, ptr + len)
+{
+    if (len > 64) return;
+    memset(peq_ascii, 0, sizeof(peq_ascii));
+    for (int i = 0; i != len; ++i) {
+	uint8 bit = uint8(1) << i;
+	unsigned ch = ptr[i];
+	if (ch < 128) {
+	    peq_ascii[ch] |= bit;
+	    continue;
+	}
+	vector<pair<unsigned, uint8> >::iterator j;
+	for (j = peq_other.begin(); j != peq_other.end(); ++j) {
+	    if (j->first == ch) break;
+	}
+	if (j == peq_other.end()) {
+	    peq_other.push_back(make_pair(ch, bit));
+	} else {
+	    j->second |= bit;
+	}
+    }
+    sort(peq_other.begin(), peq_other.end());
+}
+
+uint8
+EditDistanceCalculator::get_peq(unsigned ch) const
+{
+    if (ch < 128) return peq_ascii[ch];
+    vector<pair<unsigned, uint8> >::const_iterator i;
+    i = lower_bound(peq_other.begin(), peq_other.end(),
+		    make_pair(ch, uint8(0)));
+    if (i == peq_other.end() || i->first != ch) return 0;
+    return i->second;
+}
+
+int
+EditDistanceCalculator::operator()(const unsigned * ptr, int len,
+				   int max_distance) const
+{
+    int m = int(target.size());
+    if (m > 64) {
+	return edit_distance_unsigned(&target[0], m, ptr, len, max_distance);
+    }
+
+    // The edit distance is at least the difference in lengths.
+    int lendiff = abs(m - len);
+    if (lendiff > max_distance || m == 0 || len == 0) return lendiff;
+
+    // Bit i of VP (VN) is set if the distance in row i + 1 of the current
+    // column of the dynamic programming matrix is one more (less) than in
+    // row i.  D0 has bit i set if the diagonal step into row i + 1 didn't
+    // increase the distance.  See "A Bit-Vector Algorithm for Computing
+    // Levenshtein and Damerau Edit Distances" by Heikki Hyyrö.
+    const uint8 top = uint8(1) << (m - 1);
+    uint8 VP = ~uint8(0);
+    uint8 VN = 0;
+    uint8 D0 = 0;
+    uint8 PM_prev = 0;
+    int score = m;
+    for (int j = 0; j != len; ++j) {
+	uint8 PM = get_peq(ptr[j]);
+	// Transpositions of the previous and current characters.
+	uint8 TR = (((~D0) & PM) << 1) & PM_prev;
+	D0 = (((PM & VP) + VP) ^ VP) | PM | VN | TR;
+	uint8 HP = VN | ~(D0 | VP);
+	uint8 HN = D0 & VP;
+	if (HP & top) {
+	    ++score;
+	} else if (HN & top) {
+	    --score;
+	}
+	HP = (HP << 1) | 1;
+	HN <<= 1;
+	VP = HN | ~(D0 | HP);
+	VN = HP & D0;
+	PM_prev = PM;
+
+	// Each remaining character can reduce the distance by at most 1, so
+	// give up once that can't bring it down to max_distance.
+	int remaining = len - j - 1;
+	if (score - remaining > max_distance) return score - remaining;
+    }
+    return score;
+}
@@ -22,6 +22,11 @@
 #ifndef XAPIAN_INCLUDED_EDITDISTANCE_H
 #define XAPIAN_INCLUDED_EDITDISTANCE_H
 
+#include "internaltypes.h"
+
+#include <utility>
+#include <vector>
+
 /** Calculate the edit distance between two sequences.
  *
  *  Edit distance is defined as the minimum number of edit operations
@@ -49,4 +54,57 @@ int edit_distance_unsigned(const unsigned* ptr1, int len1,
 			   const unsigned* ptr2, int len2,
 			   int max_distance);
 
+/** Calculate the edit distance from a fixed sequence to other sequences.
+ *
+ *  The edit distance is as defined for edit_distance_unsigned(), but for a
+ *  sequence of up to 64 characters it is calculated using the bit-parallel
+ *  algorithm of Myers, with Hyyrö's extension to handle transpositions.
+ *  This takes time linear in the length of the other sequence, and the
+ *  bitmaps describing the fixed sequence are only built once, so checking
+ *  many candidate words against the same word is cheap.  For longer
+ *  sequences, we fall back to edit_distance_unsigned().
+ */
+class EditDistanceCalculator {
+    /// Don't allow assignment.
+    void operator=(const EditDistanceCalculator &);
+
+    /// Don't allow copying.
+    EditDistanceCalculator(const EditDistanceCalculator &);
+
+    /// The fixed sequence.
+    std::vector<unsigned> target;
+
+    /** Bitmaps of the positions of each ASCII character in target.
+     *
+     *  Only used if target has at most 64 characters.
+     */
+    uint8 peq_ascii[128];
+
+    /// Bitmaps for the non-ASCII characters in target, sorted by character.
+    std::vector<std::pair<unsigned, uint8> > peq_other;
+
+    /// Return the bitmap of positions of @a ch in target.
+    uint8 get_peq(unsigned ch) const;
+
+  public:
+    /** Construct for a fixed sequence.
+     *
+     *  @param ptr	A pointer to the start of the sequence.
+     *  @param len	The length of the sequence.
+     */
+    EditDistanceCalculator(const unsigned * ptr, int len);
+
+    /** Calculate the edit distance from the fixed sequence to another.
+     *
+     *  @param ptr	A pointer to the start of the other sequence.
+     *  @param len	The length of the other sequence.
+     *  @param max_distance	The greatest edit distance that's interesting to
+     *			us.  If the true edit distance is > max_distance,
+     *			any value > max_distance may be returned instead.
+     *
+     *  @return The edit distance between the two sequences.
+     */
+    int operator()(const unsigned * ptr, int len, int max_distance) const;
+};
+
 #endif // XAPIAN_INCLUDED_EDITDISTANCE_H
@@ -0,0 +1,107 @@
+/** @file expandwildcard.cc
+ * @brief Expand a wildcard pattern into a bounded list of terms.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "expandwildcard.h"
+
+#include <xapian/error.h>
+#include <xapian/query.h>
+
+#include "omassert.h"
+#include "omdebug.h"
+#include "utils.h"
+
+#include <algorithm>
+
+using namespace std;
+
+typedef pair<Xapian::doccount, string> FreqAndTerm;
+
+/** Comparison functor which puts the least useful term at the top of a heap.
+ *
+ *  Higher term frequencies are more useful, and for equal frequencies the
+ *  term which sorts first is more useful.
+ */
+struct MoreFrequentTerm {
+    bool operator()(const FreqAndTerm & a, const FreqAndTerm & b) const {
+	if (a.first != b.first) return a.first > b.first;
+	return a.second < b.second;
+    }
+};
+
+/// Order by term, for putting the most frequent terms back in term order.
+struct LessByTerm {
+    bool operator()(const FreqAndTerm & a, const FreqAndTerm & b) const {
+	return a.second < b.second;
+    }
+};
+
+void
+expand_wildcard(Xapian::TermIterator t, const string & pattern,
+		Xapian::termcount max_expansion, int max_type,
+		vector<string> & terms, vector<Xapian::doccount> * termfreqs)
+{
+    DEBUGCALL_STATIC(MATCH, void, "expand_wildcard",
+		     "[t], " << pattern << ", " << max_expansion << ", " <<
+		     max_type << ", [terms], [termfreqs]");
+    Xapian::TermIterator end(NULL);
+
+    if (max_expansion == 0 ||
+	max_type != Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT) {
+	Xapian::termcount count = 0;
+	for ( ; t != end; ++t) {
+	    if (max_expansion && count == max_expansion) {
+		if (max_type == Xapian::Query::WILDCARD_LIMIT_FIRST) break;
+		throw Xapian::WildcardError("Wildcard " + pattern +
+					    "* expands to more than " +
+					    om_tostring(max_expansion) +
+					    " terms");
+	    }
+	    terms.push_back(*t);
+	    if (termfreqs) termfreqs->push_back(t.get_termfreq());
+	    ++count;
+	}
+	return;
+    }
+
+    // Keep the max_expansion most frequent terms seen so far in a heap with
+    // the least frequent of them at the top.  The terms arrive in ascending
+    // order, so a later term with the same frequency as the top of the heap
+    // never displaces it.
+    vector<FreqAndTerm> heap;
+    for ( ; t != end; ++t) {
+	Xapian::doccount tf = t.get_termfreq();
+	if (heap.size() < max_expansion) {
+	    heap.push_back(FreqAndTerm(tf, *t));
+	    push_heap(heap.begin(), heap.end(), MoreFrequentTerm());
+	} else if (tf > heap.front().first) {
+	    pop_heap(heap.begin(), heap.end(), MoreFrequentTerm());
+	    heap.back().first = tf;
+	    heap.back().second = *t;
+	    push_heap(heap.begin(), heap.end(), MoreFrequentTerm());
+	}
+    }
+
+    sort(heap.begin(), heap.end(), LessByTerm());
+    vector<FreqAndTerm>::const_iterator i;
+    for (i = heap.begin(); i != heap.end(); ++i) {
+	terms.push_back(i->second);
+	if (termfreqs) termfreqs->push_back(i->first);
+    }
+}
@@ -97,6 +97,32 @@ MultiValueKeyMaker::operator()(const Xapian::Document & doc) const
     return result;
 }
 
+string
+FixedWidthKeyMaker::operator()(const Xapian::Document & doc) const
+{
+    string result;
+    result.reserve(key_width);
+
+    vector<Column>::const_iterator i;
+    for (i = columns.begin(); i != columns.end(); ++i) {
+	string v = doc.get_value(i->valno);
+	if (v.size() > i->width) v.resize(i->width);
+	if (i->reverse) {
+	    // For a reverse ordered value, we subtract each byte from '\xff',
+	    // and pad with '\xff' so a shorter value sorts after a longer one
+	    // which starts with it.
+	    for (string::const_iterator j = v.begin(); j != v.end(); ++j) {
+		result += char(255 - static_cast<unsigned char>(*j));
+	    }
+	    result.append(i->width - v.size(), '\xff');
+	} else {
+	    result += v;
+	    result.append(i->width - v.size(), '\0');
+	}
+    }
+    return result;
+}
+
 string
 MultiValueSorter::operator()(const Xapian::Document & doc) const
 {
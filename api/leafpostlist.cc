@@ -59,6 +59,13 @@ LeafPostList::set_termweight(const Xapian::Weight * weight_)
     Assert(!weight);
     weight = weight_;
     need_doclength = weight->get_sumpart_needs_doclength_();
+    approx_doclength_ok = weight->get_sumpart_accepts_approx_doclength_();
+}
+
+Xapian::termcount
+LeafPostList::get_approx_doclength() const
+{
+    return get_doclength();
 }
 
 Xapian::weight
@@ -74,7 +81,9 @@ LeafPostList::get_weight() const
     Xapian::termcount doclen = 0;
     // Fetching the document length is work we can avoid if the weighting
     // scheme doesn't use it.
-    if (need_doclength) doclen = get_doclength();
+    if (need_doclength) {
+	doclen = approx_doclength_ok ? get_approx_doclength() : get_doclength();
+    }
     return weight->get_sumpart(get_wdf(), doclen);
 }
 
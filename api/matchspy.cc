@@ -28,12 +28,14 @@
 #include <xapian/queryparser.h>
 #include <xapian/registry.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
 
 #include "autoptr.h"
 #include "debuglog.h"
+#include "document.h"
 #include "omassert.h"
 #include "serialise.h"
 #include "stringutils.h"
@@ -276,25 +278,153 @@ get_most_frequent_items(vector<StringAndFrequency> & result,
     }
 }
 
+/** Compare two ordinals of a ValueCountMatchSpy.
+ *
+ *  Orders them in the same way as StringAndFreqCmpByFreq orders the
+ *  corresponding values.
+ */
+class OrdinalCmpByFreq {
+    const vector<string> & values;
+    const vector<doccount> & counts;
+
+  public:
+    OrdinalCmpByFreq(const vector<string> & values_,
+		     const vector<doccount> & counts_)
+	: values(values_), counts(counts_) { }
+
+    bool operator()(doccount a, doccount b) const {
+	if (counts[a] != counts[b]) return counts[a] > counts[b];
+	return values[a] < values[b];
+    }
+};
+
+void
+ValueCountMatchSpy::Internal::count(const string & value)
+{
+    Assert(!value.empty());
+    // Keep the hash table at most half full.
+    if (ordinal_values.size() * 2 >= ordinal_table.size()) {
+	size_t size = ordinal_table.empty() ? 64 : ordinal_table.size() * 2;
+	vector<doccount> table(size);
+	for (size_t i = 0; i != ordinal_values.size(); ++i) {
+	    size_t j = hash_string(ordinal_values[i]) & (size - 1);
+	    while (table[j]) j = (j + 1) & (size - 1);
+	    table[j] = i + 1;
+	}
+	swap(ordinal_table, table);
+    }
+
+    size_t mask = ordinal_table.size() - 1;
+    size_t j = hash_string(value) & mask;
+    while (ordinal_table[j]) {
+	doccount ordinal = ordinal_table[j] - 1;
+	if (ordinal_values[ordinal] == value) {
+	    ++ordinal_counts[ordinal];
+	    return;
+	}
+	j = (j + 1) & mask;
+    }
+
+    // A value we haven't seen before.
+    ordinal_values.push_back(value);
+    ordinal_counts.push_back(1);
+    ordinal_table[j] = ordinal_values.size();
+}
+
+void
+ValueCountMatchSpy::Internal::flush_ordinals()
+{
+    for (size_t i = 0; i != ordinal_values.size(); ++i) {
+	values[ordinal_values[i]] += ordinal_counts[i];
+    }
+    ordinal_values.clear();
+    ordinal_counts.clear();
+    ordinal_table.clear();
+}
+
 void
 ValueCountMatchSpy::operator()(const Document &doc, weight) {
     ++(internal->total);
     string val(doc.get_value(internal->slot));
-    if (!val.empty()) ++(internal->values[val]);
+    if (!val.empty()) internal->count(val);
 }
 
 TermIterator
 ValueCountMatchSpy::values_begin() const
 {
+    internal->flush_ordinals();
     AutoPtr<ValueCountTermList> termlist(new ValueCountTermList(internal.get()));
     return Xapian::TermIterator(termlist.release());
 }
 
+/** Get the most frequent values counted by a ValueCountMatchSpy::Internal.
+ *
+ *  @param result	Filled with the most frequent values, as for
+ *			get_most_frequent_items().
+ *  @param counts	The counts.
+ *  @param maxvalues	The maximum number of values to return.
+ */
+static void
+get_top_values(vector<StringAndFrequency> & result,
+	       ValueCountMatchSpy::Internal & counts, size_t maxvalues)
+{
+    if (!counts.values.empty()) {
+	counts.flush_ordinals();
+	get_most_frequent_items(result, counts.values, maxvalues);
+	return;
+    }
+
+    // Nothing has been merged in, so we can pick the most frequent values
+    // from the ordinal counts directly, and only copy those values.
+    const vector<string> & values = counts.ordinal_values;
+    const vector<doccount> & freqs = counts.ordinal_counts;
+    vector<doccount> ordinals(values.size());
+    for (size_t i = 0; i != ordinals.size(); ++i) ordinals[i] = i;
+    size_t n = min(maxvalues, ordinals.size());
+    partial_sort(ordinals.begin(), ordinals.begin() + n, ordinals.end(),
+		 OrdinalCmpByFreq(values, freqs));
+    result.clear();
+    result.reserve(n);
+    for (size_t i = 0; i != n; ++i) {
+	doccount ordinal = ordinals[i];
+	result.push_back(StringAndFrequency(values[ordinal], freqs[ordinal]));
+    }
+}
+
+/// Append the values and frequencies in @a values to @a result.
+static void
+serialise_value_counts(string & result, const map<string, doccount> & values)
+{
+    result += encode_length(values.size());
+    map<string, doccount>::const_iterator i;
+    for (i = values.begin(); i != values.end(); ++i) {
+	result += encode_length(i->first.size());
+	result += i->first;
+	result += encode_length(i->second);
+    }
+}
+
+/// Decode values and frequencies encoded by serialise_value_counts().
+static void
+unserialise_value_counts(const char ** p, const char * end,
+			 map<string, doccount> & values)
+{
+    map<string, doccount>::size_type items = decode_length(p, end, false);
+    while (items != 0) {
+	size_t vallen = decode_length(p, end, true);
+	string val(*p, vallen);
+	*p += vallen;
+	doccount freq = decode_length(p, end, false);
+	values[val] += freq;
+	--items;
+    }
+}
+
 TermIterator
 ValueCountMatchSpy::top_values_begin(size_t maxvalues) const
 {
     AutoPtr<StringAndFreqTermList> termlist(new StringAndFreqTermList);
-    get_most_frequent_items(termlist->values, internal->values, maxvalues);
+    get_top_values(termlist->values, *internal, maxvalues);
     termlist->init();
     return Xapian::TermIterator(termlist.release());
 }
@@ -333,15 +463,10 @@ ValueCountMatchSpy::unserialise(const string & s, const Registry &) const
 string
 ValueCountMatchSpy::serialise_results() const {
     LOGCALL(REMOTE, string, "ValueCountMatchSpy::serialise_results", NO_ARGS);
+    internal->flush_ordinals();
     string result;
     result += encode_length(internal->total);
-    result += encode_length(internal->values.size());
-    for (map<string, doccount>::const_iterator i = internal->values.begin();
-	 i != internal->values.end(); ++i) {
-	result += encode_length(i->first.size());
-	result += i->first;
-	result += encode_length(i->second);
-    }
+    serialise_value_counts(result, internal->values);
     RETURN(result);
 }
 
@@ -352,22 +477,182 @@ ValueCountMatchSpy::merge_results(const string & s) {
     const char * end = p + s.size();
 
     internal->total += decode_length(&p, end, false);
-
-    map<string, doccount>::size_type items = decode_length(&p, end, false);
-    while (p != end) {
-	while (items != 0) {
-	    size_t vallen = decode_length(&p, end, true);
-	    string val(p, vallen);
-	    p += vallen;
-	    doccount freq = decode_length(&p, end, false);
-	    internal->values[val] += freq;
-	    --items;
-	}
+    unserialise_value_counts(&p, end, internal->values);
+    if (p != end) {
+	throw NetworkError("Junk at end of serialised ValueCountMatchSpy results");
     }
 }
 
 string
 ValueCountMatchSpy::get_description() const {
+    internal->flush_ordinals();
     return "Xapian::ValueCountMatchSpy(" + str(internal->total) +
 	    " docs seen, looking in " + str(internal->values.size()) + " slots)";
 }
+
+ValueCountMatchSpy::Internal &
+MultiValueCountMatchSpy::get_counts(valueno slot) const
+{
+    for (size_t i = 0; i != internal->slots.size(); ++i) {
+	if (internal->slots[i] == slot) return *(internal->counts[i]);
+    }
+    throw InvalidArgumentError("Slot " + str(slot) + " isn't being counted by this MultiValueCountMatchSpy");
+}
+
+doccount
+MultiValueCountMatchSpy::scale(doccount freq) const
+{
+    if (internal->counted == internal->total) return freq;
+    double scaled = double(freq) * internal->total / internal->counted;
+    return doccount(scaled + 0.5);
+}
+
+void
+MultiValueCountMatchSpy::add_slot(valueno slot)
+{
+    for (size_t i = 0; i != internal->slots.size(); ++i) {
+	if (internal->slots[i] == slot) return;
+    }
+    internal->slots.push_back(slot);
+    internal->counts.push_back(new ValueCountMatchSpy::Internal(slot));
+}
+
+void
+MultiValueCountMatchSpy::set_sample_size(doccount sample_size)
+{
+    internal->sample_size = sample_size;
+}
+
+void
+MultiValueCountMatchSpy::operator()(const Document &doc, weight) {
+    ++(internal->total);
+    if (internal->sample_size && internal->counted >= internal->sample_size)
+	return;
+    ++(internal->counted);
+    vector<string> & values = internal->doc_values;
+    doc.internal->get_values(internal->slots, values);
+    for (size_t i = 0; i != values.size(); ++i) {
+	if (!values[i].empty()) internal->counts[i]->count(values[i]);
+    }
+}
+
+TermIterator
+MultiValueCountMatchSpy::values_begin(valueno slot) const
+{
+    ValueCountMatchSpy::Internal & counts = get_counts(slot);
+    counts.flush_ordinals();
+    if (internal->counted == internal->total) {
+	AutoPtr<ValueCountTermList> termlist(new ValueCountTermList(&counts));
+	return Xapian::TermIterator(termlist.release());
+    }
+
+    AutoPtr<StringAndFreqTermList> termlist(new StringAndFreqTermList);
+    termlist->values.reserve(counts.values.size());
+    map<string, doccount>::const_iterator i;
+    for (i = counts.values.begin(); i != counts.values.end(); ++i) {
+	termlist->values.push_back(StringAndFrequency(i->first,
+						      scale(i->second)));
+    }
+    termlist->init();
+    return Xapian::TermIterator(termlist.release());
+}
+
+TermIterator
+MultiValueCountMatchSpy::top_values_begin(valueno slot,
+					  size_t maxvalues) const
+{
+    AutoPtr<StringAndFreqTermList> termlist(new StringAndFreqTermList);
+    get_top_values(termlist->values, get_counts(slot), maxvalues);
+    if (internal->counted != internal->total) {
+	vector<StringAndFrequency>::iterator i;
+	for (i = termlist->values.begin(); i != termlist->values.end(); ++i) {
+	    *i = StringAndFrequency(i->get_string(),
+				    scale(i->get_frequency()));
+	}
+    }
+    termlist->init();
+    return Xapian::TermIterator(termlist.release());
+}
+
+MatchSpy *
+MultiValueCountMatchSpy::clone() const {
+    AutoPtr<MultiValueCountMatchSpy> spy(
+	new MultiValueCountMatchSpy(internal->slots.begin(),
+				    internal->slots.end()));
+    spy->set_sample_size(internal->sample_size);
+    return spy.release();
+}
+
+string
+MultiValueCountMatchSpy::name() const {
+    return "Xapian::MultiValueCountMatchSpy";
+}
+
+string
+MultiValueCountMatchSpy::serialise() const {
+    string result;
+    result += encode_length(internal->sample_size);
+    result += encode_length(internal->slots.size());
+    for (size_t i = 0; i != internal->slots.size(); ++i) {
+	result += encode_length(internal->slots[i]);
+    }
+    return result;
+}
+
+MatchSpy *
+MultiValueCountMatchSpy::unserialise(const string & s, const Registry &) const
+{
+    const char * p = s.data();
+    const char * end = p + s.size();
+
+    AutoPtr<MultiValueCountMatchSpy> spy(new MultiValueCountMatchSpy);
+    spy->set_sample_size(decode_length(&p, end, false));
+    size_t n = decode_length(&p, end, false);
+    while (n--) {
+	spy->add_slot(decode_length(&p, end, false));
+    }
+    if (p != end) {
+	throw NetworkError("Junk at end of serialised MultiValueCountMatchSpy");
+    }
+
+    return spy.release();
+}
+
+string
+MultiValueCountMatchSpy::serialise_results() const {
+    LOGCALL(REMOTE, string, "MultiValueCountMatchSpy::serialise_results", NO_ARGS);
+    string result;
+    result += encode_length(internal->total);
+    result += encode_length(internal->counted);
+    for (size_t i = 0; i != internal->counts.size(); ++i) {
+	internal->counts[i]->flush_ordinals();
+	serialise_value_counts(result, internal->counts[i]->values);
+    }
+    RETURN(result);
+}
+
+void
+MultiValueCountMatchSpy::merge_results(const string & s) {
+    LOGCALL_VOID(REMOTE, "MultiValueCountMatchSpy::merge_results", s);
+    const char * p = s.data();
+    const char * end = p + s.size();
+
+    internal->total += decode_length(&p, end, false);
+    internal->counted += decode_length(&p, end, false);
+    for (size_t i = 0; i != internal->counts.size(); ++i) {
+	unserialise_value_counts(&p, end, internal->counts[i]->values);
+    }
+    if (p != end) {
+	throw NetworkError("Junk at end of serialised MultiValueCountMatchSpy results");
+    }
+}
+
+string
+MultiValueCountMatchSpy::get_description() const {
+    string desc = "Xapian::MultiValueCountMatchSpy(" + str(internal->total) +
+	    " docs seen";
+    if (internal->counted != internal->total)
+	desc += ", " + str(internal->counted) + " counted";
+    desc += ", looking in " + str(internal->slots.size()) + " slots)";
+    return desc;
+}
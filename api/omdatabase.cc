@@ -545,14 +545,37 @@ Database::get_spelling_suggestion(const string &word,
 		 word << ", " << max_edit_distance);
     if (word.size() <= 1) return string();
     AutoPtr<TermList> merger;
+
+    // If every sub-database has an index which can supply the candidates
+    // within max_edit_distance directly, use those.  We can't mix them with
+    // trigram lists, since the trigram scores wouldn't be comparable.
+    bool exact_candidates = true;
     for (size_t i = 0; i < internal.size(); ++i) {
-	TermList * tl = internal[i]->open_spelling_termlist(word);
-	LOGLINE(SPELLING, "Sub db " << i << " tl = " << (void*)tl);
-	if (tl) {
-	    if (merger.get()) {
-		merger.reset(new OrTermList(merger.release(), tl));
-	    } else {
-		merger.reset(tl);
+	TermList * tl = internal[i]->open_spelling_candidates(word,
+							      max_edit_distance);
+	LOGLINE(SPELLING, "Sub db " << i << " candidates = " << (void*)tl);
+	if (!tl) {
+	    exact_candidates = false;
+	    merger.reset();
+	    break;
+	}
+	if (merger.get()) {
+	    merger.reset(new OrTermList(merger.release(), tl));
+	} else {
+	    merger.reset(tl);
+	}
+    }
+
+    if (!exact_candidates) {
+	for (size_t i = 0; i < internal.size(); ++i) {
+	    TermList * tl = internal[i]->open_spelling_termlist(word);
+	    LOGLINE(SPELLING, "Sub db " << i << " tl = " << (void*)tl);
+	    if (tl) {
+		if (merger.get()) {
+		    merger.reset(new OrTermList(merger.release(), tl));
+		} else {
+		    merger.reset(tl);
+		}
 	    }
 	}
     }
@@ -570,6 +593,11 @@ Database::get_spelling_suggestion(const string &word,
     vector<unsigned> utf32_word((Utf8Iterator(word)), Utf8Iterator());
 #endif
 
+    // Build the state for computing edit distances from word once, rather
+    // than for every candidate.
+    EditDistanceCalculator edit_distance(&utf32_word[0],
+					 int(utf32_word.size()));
+
     vector<unsigned> utf32_term;
 
     Xapian::termcount best = 1;
@@ -586,7 +614,7 @@ Database::get_spelling_suggestion(const string &word,
 	Xapian::termcount score = merger->get_wdf();
 
 	LOGLINE(SPELLING, "Term \"" << term << "\" ngram score " << score);
-	if (score + TRIGRAM_SCORE_THRESHOLD >= best) {
+	if (exact_candidates || score + TRIGRAM_SCORE_THRESHOLD >= best) {
 	    if (score > best) best = score;
 
 	    // There's no point considering a word where the difference
@@ -615,11 +643,8 @@ Database::get_spelling_suggestion(const string &word,
 		continue;
 	    }
 
-	    int edist = edit_distance_unsigned(&utf32_term[0],
-					       int(utf32_term.size()),
-					       &utf32_word[0],
-					       int(utf32_word.size()),
-					       edist_best);
+	    int edist = edit_distance(&utf32_term[0], int(utf32_term.size()),
+				      edist_best);
 	    LOGLINE(SPELLING, "Edit distance " << edist);
 	    // If we have an exact match, return an empty string since there's
 	    // no correction required.
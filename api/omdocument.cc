@@ -37,6 +37,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -284,6 +285,30 @@ Xapian::Document::Internal::get_value(Xapian::valueno valueid) const
     return do_get_value(valueid);
 }
 	
+void
+Xapian::Document::Internal::get_values(const vector<Xapian::valueno> & slots,
+				       vector<string> & values_) const
+{
+    if (values_here || !database.get()) {
+	values_.resize(slots.size());
+	for (size_t i = 0; i != slots.size(); ++i) {
+	    values_[i] = get_value(slots[i]);
+	}
+	return;
+    }
+    do_get_values(slots, values_);
+}
+
+void
+Xapian::Document::Internal::do_get_values(const vector<Xapian::valueno> & slots,
+					  vector<string> & values_) const
+{
+    values_.resize(slots.size());
+    for (size_t i = 0; i != slots.size(); ++i) {
+	values_[i] = do_get_value(slots[i]);
+    }
+}
+
 string
 Xapian::Document::Internal::get_data() const
 {
@@ -304,7 +329,8 @@ TermList *
 Xapian::Document::Internal::open_term_list() const
 {
     DEBUGCALL(MATCH, TermList *, "Document::Internal::open_term_list", "");
-    if (terms_here) {
+    if (terms_modified()) {
+	need_terms();
 	RETURN(new MapTermList(terms.begin(), terms.end()));
     }
     if (!database.get()) RETURN(NULL);
@@ -413,13 +439,15 @@ void
 Xapian::Document::Internal::clear_terms()
 {
     terms.clear();
+    pending.clear();
+    pending_names.resize(0);
     terms_here = true;
 }
 
 Xapian::termcount
 Xapian::Document::Internal::termlist_count() const
 {
-    if (!terms_here) {
+    if (!terms_here || !pending.empty()) {
 	// How equivalent is this line to the rest?
 	// return database.get() ? database->open_term_list(did)->get_approx_size() : 0;
 	need_terms();
@@ -428,10 +456,84 @@ Xapian::Document::Internal::termlist_count() const
     return terms.size();
 }
 
+namespace {
+
+/// Order queued postings by term name.
+class PendingPostingLess {
+    const string & names;
+
+  public:
+    PendingPostingLess(const string & names_) : names(names_) { }
+
+    bool operator()(const Xapian::Document::Internal::PendingPosting & a,
+		    const Xapian::Document::Internal::PendingPosting & b) const {
+	return names.compare(a.offset, a.length,
+			     names, b.offset, b.length) < 0;
+    }
+};
+
+}
+
+void
+Xapian::Document::Internal::merge_pending() const
+{
+    Assert(terms_here);
+    sort(pending.begin(), pending.end(), PendingPostingLess(pending_names));
+
+    // The queued postings are now in term order, so if there weren't any
+    // terms already (the usual case) each new term can just be appended.
+    bool append = terms.empty();
+    string tname;
+    OmDocumentTerm::term_positions positions;
+    vector<PendingPosting>::const_iterator i = pending.begin();
+    while (i != pending.end()) {
+	tname.assign(pending_names, i->offset, i->length);
+	Xapian::termcount wdfinc = 0;
+	positions.clear();
+	do {
+	    wdfinc += i->wdfinc;
+	    if (i->tpos) positions.push_back(i->tpos);
+	    ++i;
+	} while (i != pending.end() &&
+		 pending_names.compare(i->offset, i->length, tname) == 0);
+
+	document_terms::iterator t;
+	if (append) {
+	    t = terms.insert(terms.end(),
+			     make_pair(tname, OmDocumentTerm(tname, 0)));
+	} else {
+	    t = terms.lower_bound(tname);
+	    if (t == terms.end() || t->first != tname) {
+		t = terms.insert(t, make_pair(tname, OmDocumentTerm(tname, 0)));
+	    }
+	}
+	t->second.inc_wdf(wdfinc);
+
+	if (positions.empty()) continue;
+	sort(positions.begin(), positions.end());
+	positions.erase(unique(positions.begin(), positions.end()),
+			positions.end());
+	if (t->second.positions.empty()) {
+	    swap(t->second.positions, positions);
+	} else {
+	    OmDocumentTerm::term_positions::const_iterator p;
+	    for (p = positions.begin(); p != positions.end(); ++p) {
+		t->second.add_position(*p);
+	    }
+	}
+    }
+
+    pending.clear();
+    pending_names.resize(0);
+}
+
 void
 Xapian::Document::Internal::need_terms() const
 {
-    if (terms_here) return;
+    if (terms_here) {
+	if (!pending.empty()) merge_pending();
+	return;
+    }
     if (database.get()) {
 	Xapian::TermIterator t(database->open_term_list(did));
 	Xapian::TermIterator tend(NULL);
@@ -446,6 +548,7 @@ Xapian::Document::Internal::need_terms() const
 	}
     }
     terms_here = true;
+    if (!pending.empty()) merge_pending();
 }
 
 Xapian::valueno
@@ -460,6 +563,8 @@ Xapian::Document::Internal::values_count() const
 string
 Xapian::Document::Internal::get_description() const
 {
+    if (!pending.empty()) need_terms();
+
     string description = "Xapian::Document::Internal(";
 
     if (data_here) description += "data=`" + data + "'";
@@ -55,6 +55,12 @@ using Xapian::Internal::ExpandWeight;
 
 namespace Xapian {
 
+const ValueSetMatchDecider *
+MatchDecider::get_value_set_filter() const
+{
+    return NULL;
+}
+
 MatchDecider::~MatchDecider() { }
 
 // Methods for Xapian::RSet
@@ -158,6 +158,16 @@ Query::Query(Query::op op_, Xapian::valueno valno, const std::string &value)
 		 op_ << ", " << valno << ", " << value);
 }
 
+Query::Query(Query::op op_, const std::string & pattern,
+	     Xapian::termcount max_expansion, wildcard_limit max_type,
+	     Xapian::termpos pos)
+    : internal(new Query::Internal(op_, pattern, max_expansion, max_type, pos))
+{
+    DEBUGAPICALL(void, "Xapian::Query::Query",
+		 op_ << ", " << pattern << ", " << max_expansion << ", " <<
+		 max_type << ", " << pos);
+}
+
 Query::Query(PostingSource * external_source)
 	: internal(NULL)
 {
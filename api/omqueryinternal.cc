@@ -65,6 +65,7 @@ get_min_subqs(Xapian::Query::Internal::op_t op)
 	case Xapian::Query::OP_VALUE_GE:
 	case Xapian::Query::OP_VALUE_LE:
 	case Xapian::Query::OP_SYNONYM:
+	case Xapian::Query::OP_WILDCARD:
 	    return 0;
 	case Xapian::Query::OP_SCALE_WEIGHT:
 	    return 1;
@@ -87,6 +88,7 @@ get_max_subqs(Xapian::Query::Internal::op_t op)
 	case Xapian::Query::OP_VALUE_RANGE:
 	case Xapian::Query::OP_VALUE_GE:
 	case Xapian::Query::OP_VALUE_LE:
+	case Xapian::Query::OP_WILDCARD:
 	    return 0;
 	case Xapian::Query::OP_SCALE_WEIGHT:
 	    return 1;
@@ -139,6 +141,9 @@ is_distributable(Xapian::Query::Internal::op_t op)
  *	<wqf> is the decimal within query frequency (1 if omitted),
  *	<termpos> is the decimal term position (index of term if omitted).
  *
+ *  A wildcard query becomes `?<encodedpattern><limit><policy><termpos>',
+ *  where the last three are encoded with encode_length().
+ *
  *  A compound query becomes `(<subqueries><op>', where:
  *	<subqueries> is the list of subqueries
  *	<op> is one of: &|%+-^
@@ -172,6 +177,13 @@ Xapian::Query::Internal::serialise(Xapian::termpos & curpos) const
 	string sourcedata = external_source->serialise();
 	result += encode_length(sourcedata.length());
 	result += sourcedata;
+    } else if (op == Xapian::Query::OP_WILDCARD) {
+	result += '?';
+	result += encode_length(tname.length());
+	result += tname;
+	result += encode_length(parameter);
+	result += encode_length(get_wildcard_limit());
+	result += encode_length(term_pos);
     } else {
 	result += "(";
 	for (subquery_list::const_iterator i = subqs.begin();
@@ -184,6 +196,7 @@ Xapian::Query::Internal::serialise(Xapian::termpos & curpos) const
 		Assert(false);
 		break;
 	    case Xapian::Query::Internal::OP_EXTERNAL_SOURCE:
+	    case Xapian::Query::OP_WILDCARD:
 		Assert(false);
 		break;
 	    case Xapian::Query::OP_AND:
@@ -271,6 +284,7 @@ Xapian::Query::Internal::get_op_name(Xapian::Query::Internal::op_t op)
 	case Xapian::Query::OP_VALUE_LE:        name = "VALUE_LE"; break;
 	case Xapian::Query::OP_SCALE_WEIGHT:    name = "SCALE_WEIGHT"; break;
 	case Xapian::Query::OP_SYNONYM:         name = "SYNONYM"; break;
+	case Xapian::Query::OP_WILDCARD:        name = "WILDCARD"; break;
     }
     return name;
 }
@@ -317,6 +331,31 @@ Xapian::Query::Internal::get_description() const
 	    opstr += " * ";
 	    opstr += subqs[0]->get_description();
 	    return opstr;
+	case Xapian::Query::OP_WILDCARD:
+	    opstr = get_op_name(op);
+	    if (parameter) {
+		opstr += ' ';
+		opstr += om_tostring(parameter);
+		switch (get_wildcard_limit()) {
+		    case Xapian::Query::WILDCARD_LIMIT_FIRST:
+			opstr += " FIRST";
+			break;
+		    case Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT:
+			opstr += " MOST_FREQUENT";
+			break;
+		    default:
+			opstr += " ERROR";
+			break;
+		}
+	    }
+	    opstr += ' ';
+	    opstr += tname;
+	    if (term_pos != 0) {
+		opstr += ":(pos=";
+		opstr += om_tostring(term_pos);
+		opstr += ')';
+	    }
+	    return opstr;
 	case Xapian::Query::Internal::OP_EXTERNAL_SOURCE:
 	    opstr = "PostingSource(";
 	    opstr += external_source->get_description();
@@ -347,6 +386,9 @@ Xapian::Query::Internal::get_length() const
 	// parameter is wqf.
 	return parameter;
     }
+    // The terms a wildcard expands to are treated as a single "virtual"
+    // term, as for OP_SYNONYM.
+    if (op == Xapian::Query::OP_WILDCARD) return 1;
     Xapian::termcount len = 0;
     subquery_list::const_iterator i;
     for (i = subqs.begin(); i != subqs.end(); ++i) {
@@ -422,6 +464,7 @@ class QUnserial {
 
     Xapian::Query::Internal * readquery();
     Xapian::Query::Internal * readexternal();
+    Xapian::Query::Internal * readwildcard();
     Xapian::Query::Internal * readcompound();
 
   public:
@@ -465,6 +508,8 @@ QUnserial::readquery() {
 	}
 	case '!':
 	    return readexternal();
+	case '?':
+	    return readwildcard();
 	case '(':
 	    return readcompound();
 	default:
@@ -495,6 +540,19 @@ QUnserial::readexternal()
     return new Xapian::Query::Internal(source->unserialise(sourcedata), true);
 }
 
+Xapian::Query::Internal *
+QUnserial::readwildcard()
+{
+    size_t length = decode_length(&p, end, true);
+    string pattern(p, length);
+    p += length;
+    Xapian::termcount max_expansion(decode_length(&p, end, false));
+    int max_type(decode_length(&p, end, false));
+    Xapian::termpos term_pos(decode_length(&p, end, false));
+    return new Xapian::Query::Internal(Xapian::Query::OP_WILDCARD, pattern,
+				       max_expansion, max_type, term_pos);
+}
+
 static Xapian::Query::Internal *
 qint_from_vector(Xapian::Query::op op,
 		 const vector<Xapian::Query::Internal *> & vec,
@@ -546,6 +604,9 @@ QUnserial::readcompound() {
 		case '!':
 		    subqs.push_back(readexternal());
 		    break;
+		case '?':
+		    subqs.push_back(readwildcard());
+		    break;
 	        case '(': {
 		    subqs.push_back(readcompound());
 		    break;
@@ -695,6 +756,8 @@ Xapian::Query::Internal::Internal(op_t op_, Xapian::termcount parameter_)
 {
     if (parameter != 0 && op != OP_PHRASE && op != OP_NEAR && op != OP_ELITE_SET)
 	throw Xapian::InvalidArgumentError("parameter is only meaningful for OP_NEAR, OP_PHRASE, or OP_ELITE_SET");
+    if (op == OP_WILDCARD)
+	throw Xapian::InvalidArgumentError("OP_WILDCARD requires a pattern");
 }
 
 Xapian::Query::Internal::Internal(op_t op_, Xapian::valueno valno,
@@ -730,6 +793,25 @@ Xapian::Query::Internal::Internal(op_t op_, Xapian::valueno valno,
     validate_query();
 }
 
+Xapian::Query::Internal::Internal(op_t op_, const string & pattern,
+				  Xapian::termcount max_expansion,
+				  int max_type, Xapian::termpos term_pos_)
+	: op(op_),
+	  parameter(max_expansion),
+	  tname(pattern),
+	  str_parameter(1, char(max_type)),
+	  term_pos(term_pos_),
+	  external_source(NULL),
+	  external_source_owned(false)
+{
+    if (op != OP_WILDCARD)
+	throw Xapian::InvalidArgumentError("This constructor is only meaningful for OP_WILDCARD");
+    if (max_type < Xapian::Query::WILDCARD_LIMIT_ERROR ||
+	max_type > Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT)
+	throw Xapian::InvalidArgumentError("Unknown OP_WILDCARD limit policy");
+    validate_query();
+}
+
 Xapian::Query::Internal::Internal(PostingSource * external_source_, bool owned)
 	: op(OP_EXTERNAL_SOURCE), external_source(external_source_),
 	  external_source_owned(owned)
@@ -778,11 +860,12 @@ Xapian::Query::Internal::validate_query() const
     }
 
     // Check that the termname is null in a branch query, unless the op
-    // is OP_VALUE_RANGE or OP_VALUE_GE or OP_VALUE_LE.
+    // is OP_VALUE_RANGE or OP_VALUE_GE or OP_VALUE_LE or OP_WILDCARD.
     Assert(is_leaf(op) ||
 	   op == OP_VALUE_RANGE ||
 	   op == OP_VALUE_GE ||
 	   op == OP_VALUE_LE ||
+	   op == OP_WILDCARD ||
 	   tname.empty());
 }
 
@@ -846,6 +929,7 @@ Xapian::Query::Internal::simplify_matchnothing()
 	    Assert(subqs[0]);
 	    break;
         case OP_LEAF:
+        case OP_WILDCARD:
             // Do nothing.
             break;
     }
@@ -873,6 +957,7 @@ Xapian::Query::Internal::simplify_query()
 	    return this;
 	case OP_VALUE_GE:
 	case OP_VALUE_LE:
+	case OP_WILDCARD:
 	    return this;
 	case OP_SCALE_WEIGHT:
 	    if (fabs(get_dbl_parameter() - 1.0) > DBL_EPSILON) return this;
@@ -988,6 +1073,10 @@ Xapian::Query::Internal::flatten_subqs()
 
     if (sq == subqs.end()) return this;
 
+    if ((*sq)->op == Xapian::Query::OP_WILDCARD) {
+	throw Xapian::UnimplementedError("Can't use NEAR/PHRASE with OP_WILDCARD");
+    }
+
     if ((*sq)->op == Xapian::Query::OP_NEAR ||
 	(*sq)->op == Xapian::Query::OP_PHRASE) {
 	// FIXME: A PHRASE (B PHRASE C) -> (A PHRASE B) AND (B PHRASE C)?
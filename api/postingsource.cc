@@ -38,6 +38,8 @@
 #include "serialise.h"
 #include "serialise-double.h"
 #include "str.h"
+#include "stringutils.h"
+#include "valuelist.h"
 
 #include <cfloat>
 
@@ -78,6 +80,28 @@ PostingSource::check(Xapian::docid did, Xapian::weight min_wt)
     return true;
 }
 
+Xapian::doccount
+PostingSource::get_batch_size() const
+{
+    return 0;
+}
+
+Xapian::doccount
+PostingSource::next_batch(Xapian::weight min_wt,
+			  Xapian::docid * docids, Xapian::weight * weights,
+			  Xapian::doccount n)
+{
+    Xapian::doccount i = 0;
+    while (i != n) {
+	next(min_wt);
+	if (at_end()) break;
+	docids[i] = get_docid();
+	weights[i] = get_weight();
+	++i;
+    }
+    return i;
+}
+
 PostingSource *
 PostingSource::clone() const
 {
@@ -221,12 +245,59 @@ ValueWeightPostingSource::ValueWeightPostingSource(Xapian::valueno slot_)
 {
 }
 
+void
+ValueWeightPostingSource::skip_low_blocks(Xapian::weight min_wt)
+{
+    while (value_it != db.valuestream_end(slot)) {
+	Xapian::docid block_end;
+	double block_max, rest_max;
+	if (!value_it.internal->get_value_upper_bounds(value_it.get_docid(),
+							block_end,
+							block_max, rest_max))
+	    return;
+	if (rest_max < min_wt) {
+	    value_it = db.valuestream_end(slot);
+	    return;
+	}
+	if (rest_max < get_maxweight()) set_maxweight(rest_max);
+	if (block_max >= min_wt) return;
+	value_it.skip_to(block_end + 1);
+    }
+}
+
+void
+ValueWeightPostingSource::next(Xapian::weight min_wt)
+{
+    ValuePostingSource::next(min_wt);
+    skip_low_blocks(min_wt);
+}
+
+void
+ValueWeightPostingSource::skip_to(Xapian::docid min_docid,
+				  Xapian::weight min_wt)
+{
+    ValuePostingSource::skip_to(min_docid, min_wt);
+    skip_low_blocks(min_wt);
+}
+
+bool
+ValueWeightPostingSource::check(Xapian::docid min_docid,
+				Xapian::weight min_wt)
+{
+    // If check() returns false, the position isn't valid, so we can only
+    // skip blocks when it returns true.
+    if (!ValuePostingSource::check(min_docid, min_wt)) return false;
+    skip_low_blocks(min_wt);
+    return true;
+}
+
 Xapian::weight
 ValueWeightPostingSource::get_weight() const
 {
     Assert(!at_end());
     Assert(started);
-    return sortable_unserialise(*value_it);
+    // Let the backend avoid decoding the value if it stores doubles.
+    return value_it.internal->get_value_as_double();
 }
 
 ValueWeightPostingSource *
@@ -304,6 +375,8 @@ ValueMapPostingSource::add_mapping(const string & key, double weight)
 {
     weight_map[key] = weight;
     max_weight_in_map = max(weight, max_weight_in_map);
+    hash_keys.clear();
+    hash_weights.clear();
 }
 
 void
@@ -311,6 +384,29 @@ ValueMapPostingSource::clear_mappings()
 {
     weight_map.clear();
     max_weight_in_map = 0.0;
+    hash_keys.clear();
+    hash_weights.clear();
+}
+
+void
+ValueMapPostingSource::freeze()
+{
+    // Keep the table at most half full so that probe sequences are short.
+    size_t size = 2;
+    while (size < weight_map.size() * 2) size <<= 1;
+    vector<string> keys(size);
+    vector<double> weights(size);
+    map<string, double>::const_iterator i;
+    for (i = weight_map.begin(); i != weight_map.end(); ++i) {
+	// The empty string marks an empty slot, so isn't put in the table.
+	if (i->first.empty()) continue;
+	size_t j = hash_string(i->first) & (size - 1);
+	while (!keys[j].empty()) j = (j + 1) & (size - 1);
+	keys[j] = i->first;
+	weights[j] = i->second;
+    }
+    swap(hash_keys, keys);
+    swap(hash_weights, weights);
 }
 
 void
@@ -322,7 +418,17 @@ ValueMapPostingSource::set_default_weight(double wt)
 Xapian::weight
 ValueMapPostingSource::get_weight() const
 {
-    map<string, double>::const_iterator wit = weight_map.find(*value_it);
+    string value = *value_it;
+    if (!hash_keys.empty() && !value.empty()) {
+	size_t mask = hash_keys.size() - 1;
+	size_t j = hash_string(value) & mask;
+	while (!hash_keys[j].empty()) {
+	    if (hash_keys[j] == value) return hash_weights[j];
+	    j = (j + 1) & mask;
+	}
+	return default_weight;
+    }
+    map<string, double>::const_iterator wit = weight_map.find(value);
     if (wit == weight_map.end()) {
 	return default_weight;
     }
@@ -338,6 +444,7 @@ ValueMapPostingSource::clone() const
 	res->add_mapping(i->first, i->second);
     }
     res->set_default_weight(default_weight);
+    if (!hash_keys.empty()) res->freeze();
     return res.release();
 }
 
@@ -378,6 +485,9 @@ ValueMapPostingSource::unserialise(const string &s) const
 	p += keylen;
 	res->add_mapping(key, unserialise_double(&p, end));
     }
+    // The unserialised object is only used for matching, so it won't be
+    // modified.
+    res->freeze();
     return res.release();
 }
 
@@ -194,6 +194,8 @@ Registry::Internal::add_defaults()
     Xapian::MatchSpy * spy;
     spy = new Xapian::ValueCountMatchSpy();
     matchspies[spy->name()] = spy;
+    spy = new Xapian::MultiValueCountMatchSpy();
+    matchspies[spy->name()] = spy;
 }
 
 void
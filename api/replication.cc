@@ -28,6 +28,7 @@
 #include "xapian/error.h"
 #include "xapian/version.h"
 
+#include "changesetcompress.h"
 #include "database.h"
 #include "databasereplicator.h"
 #include "fileutils.h"
@@ -38,8 +39,10 @@
 #include "omdebug.h"
 #include "omtime.h"
 #include "remoteconnection.h"
+#include "replicationdelta.h"
 #include "replicationprotocol.h"
 #include "safeerrno.h"
+#include "safefcntl.h"
 #include "safesysstat.h"
 #include "safeunistd.h"
 #include "serialise.h"
@@ -65,6 +68,18 @@ DatabaseMaster::write_changesets_to_fd(int fd,
 {
     DEBUGAPICALL(void, "Xapian::DatabaseMaster::write_changesets_to_fd",
 		 fd << ", " << start_revision << ", " << info);
+    write_changesets_to_fd(fd, start_revision, info, string());
+}
+
+/** Write changesets for the database at @a path to @a fd.
+ *
+ *  @param checksums	Source of the replica's block checksums, or NULL.
+ */
+static void
+write_changesets(const string & path, int fd, const string & start_revision,
+		 ReplicationInfo * info, BlockChecksumsSource * checksums,
+		 bool compress_changesets)
+{
     if (info != NULL)
 	info->clear();
     Database db;
@@ -100,7 +115,40 @@ DatabaseMaster::write_changesets_to_fd(int fd,
 	revision.assign(ptr, end - ptr);
     }
 
-    db.internal[0]->write_changesets_to_fd(fd, revision, need_whole_db, info);
+    OmTime start_time = OmTime::now();
+    db.internal[0]->write_changesets_to_fd(fd, revision, need_whole_db, info,
+					   checksums, compress_changesets);
+    if (info != NULL)
+	info->transfer_seconds = (OmTime::now() - start_time).as_double();
+}
+
+void
+DatabaseMaster::write_changesets_to_fd(int fd,
+				       const string & start_revision,
+				       ReplicationInfo * info,
+				       const string & block_checksums,
+				       bool compress_changesets) const
+{
+    DEBUGAPICALL(void, "Xapian::DatabaseMaster::write_changesets_to_fd",
+		 fd << ", " << start_revision << ", " << info << ", " <<
+		 block_checksums.size() << ", " << compress_changesets);
+    StoredBlockChecksums checksums(block_checksums);
+    write_changesets(path, fd, start_revision, info, &checksums,
+		     compress_changesets);
+}
+
+void
+DatabaseMaster::write_changesets_to_socket(int fd,
+					   const string & start_revision,
+					   ReplicationInfo * info,
+					   bool compress_changesets) const
+{
+    DEBUGAPICALL(void, "Xapian::DatabaseMaster::write_changesets_to_socket",
+		 fd << ", " << start_revision << ", " << info << ", " <<
+		 compress_changesets);
+    RequestedBlockChecksums checksums(fd);
+    write_changesets(path, fd, start_revision, info, &checksums,
+		     compress_changesets);
 }
 
 string
@@ -153,6 +201,13 @@ class DatabaseReplica::Internal : public Xapian::Internal::RefCntBase {
     /// The remote connection we're using.
     RemoteConnection * conn;
 
+    /** The revision of the live database when block checksums were last
+     *  calculated by get_block_checksums().
+     *
+     *  Empty if no checksums have been calculated.
+     */
+    string checksums_revision;
+
     /** Update the stub database which points to a single database.
      *
      *  The stub database file is created at a separate path, and then
@@ -168,6 +223,18 @@ class DatabaseReplica::Internal : public Xapian::Internal::RefCntBase {
      */
     void apply_db_copy(const OmTime & end_time);
 
+    /** Apply a changeset read from connection @a from.
+     *
+     *  @a from is either the connection to the master, or a connection
+     *  reading a decompressed changeset from a file.
+     */
+    void apply_changeset(RemoteConnection & from, ReplicationInfo * info,
+			 const OmTime & end_time);
+
+    /** Receive a compressed changeset from the master and apply it. */
+    void apply_compressed_changeset(ReplicationInfo * info,
+				    const OmTime & end_time);
+
     /** Check that a message type is as expected.
      *
      *  Throws a NetworkError if the type is not the expected one.
@@ -205,6 +272,14 @@ class DatabaseReplica::Internal : public Xapian::Internal::RefCntBase {
     /// Read and apply the next changeset.
     bool apply_next_changeset(ReplicationInfo * info);
 
+    /// Calculate block checksums for the live database.
+    string get_block_checksums();
+
+    /// Get the number of bytes read so far from the changeset fd.
+    off_t get_bytes_transferred() const {
+	return conn ? conn->get_bytes_transferred() : 0;
+    }
+
     /// Return a string describing this object.
     string get_description() const { return path; }
 };
@@ -267,7 +342,23 @@ DatabaseReplica::apply_next_changeset(ReplicationInfo * info)
 	info->clear();
     if (internal.get() == NULL)
 	throw Xapian::InvalidOperationError("Attempt to call DatabaseReplica::apply_next_changeset on a closed replica.");
-    RETURN(internal->apply_next_changeset(info));
+    OmTime start_time = OmTime::now();
+    off_t start_bytes = internal->get_bytes_transferred();
+    bool more = internal->apply_next_changeset(info);
+    if (info != NULL) {
+	info->bytes_transferred = internal->get_bytes_transferred() - start_bytes;
+	info->transfer_seconds = (OmTime::now() - start_time).as_double();
+    }
+    RETURN(more);
+}
+
+string
+DatabaseReplica::get_block_checksums() const
+{
+    DEBUGAPICALL(string, "Xapian::DatabaseReplica::get_block_checksums", "");
+    if (internal.get() == NULL)
+	throw Xapian::InvalidOperationError("Attempt to call DatabaseReplica::get_block_checksums on a closed replica.");
+    RETURN(internal->get_block_checksums());
 }
 
 void
@@ -318,7 +409,7 @@ DatabaseReplica::Internal::update_stub_database() const
 DatabaseReplica::Internal::Internal(const string & path_)
 	: path(path_), live_id(0), live_db(), have_offline_db(false),
 	  need_copy_next(false), offline_revision(), offline_needed_revision(),
-	  conn(NULL)
+	  conn(NULL), checksums_revision()
 {
     DEBUGCALL(API, void, "DatabaseReplica::Internal::Internal", path_);
 #if ! defined XAPIAN_HAS_FLINT_BACKEND && ! defined XAPIAN_HAS_CHERT_BACKEND
@@ -371,6 +462,18 @@ DatabaseReplica::Internal::get_revision_info() const
     RETURN(buf);
 }
 
+string
+DatabaseReplica::Internal::get_block_checksums()
+{
+    DEBUGCALL(API, string, "DatabaseReplica::Internal::get_block_checksums", "");
+    // Remember which revision the checksums are for, so we can check the
+    // live database hasn't changed under them before we use them.
+    checksums_revision = get_revision_info();
+    BlockChecksums checksums;
+    checksums.calculate(get_replica_path(live_id));
+    RETURN(checksums.serialise());
+}
+
 void
 DatabaseReplica::Internal::remove_offline_db()
 {
@@ -429,6 +532,17 @@ DatabaseReplica::Internal::apply_db_copy(const OmTime & end_time)
 	    return;
 
 	string filepath = offline_path + "/" + filename;
+	if (type == REPL_REPLY_DB_FILEDELTA) {
+	    // The master has sent the file as a delta against our live copy,
+	    // which must still be the version the checksums were made from.
+	    if (checksums_revision.empty() ||
+		checksums_revision != get_revision_info()) {
+		throw NetworkError("Received file delta, but live database has changed since block checksums were calculated");
+	    }
+	    receive_file_delta(*conn, get_replica_path(live_id) + "/" + filename,
+			       filepath, end_time);
+	    continue;
+	}
 	type = conn->receive_file(filepath, end_time);
 	check_message_type(type, REPL_REPLY_DB_FILEDATA);
     }
@@ -447,6 +561,81 @@ DatabaseReplica::Internal::check_message_type(char type, char expected) const
     }
 }
 
+void
+DatabaseReplica::Internal::apply_changeset(RemoteConnection & from,
+					   ReplicationInfo * info,
+					   const OmTime & end_time)
+{
+    if (need_copy_next) {
+	throw NetworkError("Needed a database copy next");
+    }
+    if (!have_offline_db) {
+	// Close the live db.
+	live_db = WritableDatabase();
+	string replica_path(get_replica_path(live_id));
+
+	// Open a replicator for the live path, and apply the changeset.
+	{
+	    AutoPtr<DatabaseReplicator> replicator(
+		    DatabaseReplicator::open(replica_path));
+	    offline_needed_revision = replicator->
+		    apply_changeset_from_conn(from, end_time, true);
+	}
+
+	// Close the replicator and open the live db again.
+	if (info != NULL) {
+	    ++(info->changeset_count);
+	    info->changed = true;
+	}
+	live_db = WritableDatabase(replica_path, Xapian::DB_OPEN);
+	return;
+    }
+
+    {
+	AutoPtr<DatabaseReplicator> replicator(
+		DatabaseReplicator::open(get_replica_path(live_id ^ 1)));
+	offline_needed_revision = replicator->
+		apply_changeset_from_conn(from, end_time, false);
+    }
+    if (possibly_make_offline_live()) {
+	if (info != NULL)
+	    info->changed = true;
+    }
+}
+
+void
+DatabaseReplica::Internal::apply_compressed_changeset(ReplicationInfo * info,
+						      const OmTime & end_time)
+{
+    string compressed_path = path + "/changeset.z";
+    string changeset_path = path + "/changeset";
+    try {
+	char type = conn->receive_file(compressed_path, end_time);
+	check_message_type(type, REPL_REPLY_CHANGESET_COMPRESSED);
+	decompress_changeset(compressed_path, changeset_path);
+	(void)unlink(compressed_path);
+
+	int fd;
+#ifdef __WIN32__
+	fd = msvc_posix_open(changeset_path.c_str(), O_RDONLY | O_BINARY);
+#else
+	fd = open(changeset_path.c_str(), O_RDONLY | O_BINARY);
+#endif
+	if (fd == -1) {
+	    throw Xapian::DatabaseError("Couldn't open " + changeset_path,
+					errno);
+	}
+	fdcloser closer(fd);
+	RemoteConnection file_conn(fd, -1, "");
+	apply_changeset(file_conn, info, OmTime());
+    } catch (...) {
+	(void)unlink(compressed_path);
+	(void)unlink(changeset_path);
+	throw;
+    }
+    (void)unlink(changeset_path);
+}
+
 bool
 DatabaseReplica::Internal::possibly_make_offline_live()
 {
@@ -485,7 +674,9 @@ DatabaseReplica::Internal::set_read_fd(int fd)
 {
     delete conn;
     conn = NULL;
-    conn = new RemoteConnection(fd, -1, "");
+    // We write block checksums back to the master on fd if it asks for
+    // them.
+    conn = new RemoteConnection(fd, fd, "");
 }
 
 bool
@@ -535,43 +726,20 @@ DatabaseReplica::Internal::apply_next_changeset(ReplicationInfo * info)
 		}
 		break;
 	    case REPL_REPLY_CHANGESET:
-		if (need_copy_next) {
-		    throw NetworkError("Needed a database copy next");
-		}
-		if (!have_offline_db) {
-		    // Close the live db.
-		    live_db = WritableDatabase();
-		    string replica_path(get_replica_path(live_id));
-
-		    // Open a replicator for the live path, and apply the
-		    // changeset.
-		    {
-			AutoPtr<DatabaseReplicator> replicator(
-				DatabaseReplicator::open(replica_path));
-			offline_needed_revision = replicator->
-				apply_changeset_from_conn(*conn, end_time, true);
-		    }
-
-		    // Close the replicator and open the live db again.
-		    if (info != NULL) {
-			++(info->changeset_count);
-			info->changed = true;
-		    }
-		    live_db = WritableDatabase(replica_path, Xapian::DB_OPEN);
-		    RETURN(true);
-		}
-
-		{
-		    AutoPtr<DatabaseReplicator> replicator(
-			    DatabaseReplicator::open(get_replica_path(live_id ^ 1)));
-		    offline_needed_revision = replicator->
-			    apply_changeset_from_conn(*conn, end_time, false);
-		}
-		if (possibly_make_offline_live()) {
-		    if (info != NULL)
-			info->changed = true;
-		}
+		apply_changeset(*conn, info, end_time);
 		RETURN(true);
+	    case REPL_REPLY_CHANGESET_COMPRESSED:
+		apply_compressed_changeset(info, end_time);
+		RETURN(true);
+	    case REPL_REPLY_NEED_CHECKSUMS: {
+		// The master is about to send a full copy, and wants
+		// checksums of our live database so it only needs to send the
+		// blocks which differ.
+		string buf;
+		(void)conn->get_message(buf, end_time);
+		conn->send_message('C', get_block_checksums(), end_time);
+		break;
+	    }
 	    case REPL_REPLY_FAIL: {
 		string buf;
 		(void)conn->get_message(buf, end_time);
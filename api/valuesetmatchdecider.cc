@@ -26,19 +26,56 @@
 
 #include "xapian/document.h"
 
+#include "stringutils.h"
+
 using namespace std;
 
 namespace Xapian {
 
+void
+ValueSetMatchDecider::freeze()
+{
+    // Keep the table at most half full so that probe sequences are short.
+    size_t size = 2;
+    while (size < testset.size() * 2) size <<= 1;
+    vector<string> table(size);
+    set<string>::const_iterator i;
+    for (i = testset.begin(); i != testset.end(); ++i) {
+	// The empty string marks an empty slot, so isn't put in the table.
+	if (i->empty()) continue;
+	size_t j = hash_string(*i) & (size - 1);
+	while (!table[j].empty()) j = (j + 1) & (size - 1);
+	table[j] = *i;
+    }
+    swap(hash_table, table);
+}
+
+bool
+ValueSetMatchDecider::contains(const string & value) const
+{
+    if (hash_table.empty() || value.empty())
+	return testset.find(value) != testset.end();
+    size_t mask = hash_table.size() - 1;
+    size_t j = hash_string(value) & mask;
+    while (!hash_table[j].empty()) {
+	if (hash_table[j] == value) return true;
+	j = (j + 1) & mask;
+    }
+    return false;
+}
+
 bool 
 ValueSetMatchDecider::operator()(const Xapian::Document& doc) const
 {
-    string value = doc.get_value(valuenum);
-    set<string>::const_iterator it = testset.find(value);
-    if (inclusive)
-        return it != testset.end();
-    else
-        return it == testset.end();
+    return contains(doc.get_value(valuenum)) == inclusive;
+}
+
+const ValueSetMatchDecider *
+ValueSetMatchDecider::get_value_set_filter() const
+{
+    // Subclasses may override operator(), so we only let the matcher bypass
+    // it if asked to.
+    return filterable ? this : NULL;
 }
 
 }
@@ -12,11 +12,13 @@ noinst_HEADERS +=\
 	backends/brass/brass_database.h\
 	backends/brass/brass_databasereplicator.h\
 	backends/brass/brass_dbstats.h\
+	backends/brass/brass_doclencache.h\
 	backends/brass/brass_document.h\
 	backends/brass/brass_inverter.h\
 	backends/brass/brass_io.h\
 	backends/brass/brass_lazytable.h\
 	backends/brass/brass_metadata.h\
+	backends/brass/brass_numericcolumn.h\
 	backends/brass/brass_positionlist.h\
 	backends/brass/brass_postlist.h\
 	backends/brass/brass_record.h\
@@ -25,9 +27,11 @@ noinst_HEADERS +=\
 	backends/brass/brass_spellingwordslist.h\
 	backends/brass/brass_synonym.h\
 	backends/brass/brass_table.h\
+	backends/brass/brass_termdict.h\
 	backends/brass/brass_termlist.h\
 	backends/brass/brass_termlisttable.h\
 	backends/brass/brass_types.h\
+	backends/brass/brass_valueindexpostlist.h\
 	backends/brass/brass_valuelist.h\
 	backends/brass/brass_values.h\
 	backends/brass/brass_version.h
@@ -40,10 +44,12 @@ lib_src +=\
 	backends/brass/brass_database.cc\
 	backends/brass/brass_databasereplicator.cc\
 	backends/brass/brass_dbstats.cc\
+	backends/brass/brass_doclencache.cc\
 	backends/brass/brass_document.cc\
 	backends/brass/brass_inverter.cc\
 	backends/brass/brass_io.cc\
 	backends/brass/brass_metadata.cc\
+	backends/brass/brass_numericcolumn.cc\
 	backends/brass/brass_positionlist.cc\
 	backends/brass/brass_postlist.cc\
 	backends/brass/brass_record.cc\
@@ -51,8 +57,10 @@ lib_src +=\
 	backends/brass/brass_spellingwordslist.cc\
 	backends/brass/brass_synonym.cc\
 	backends/brass/brass_table.cc\
+	backends/brass/brass_termdict.cc\
 	backends/brass/brass_termlist.cc\
 	backends/brass/brass_termlisttable.cc\
+	backends/brass/brass_valueindexpostlist.cc\
 	backends/brass/brass_valuelist.cc\
 	backends/brass/brass_values.cc\
 	backends/brass/brass_version.cc
@@ -31,6 +31,8 @@
 #include <xapian/error.h>
 #include <xapian/valueiterator.h>
 
+#include "changesetcompress.h"
+#include "changesetlinks.h"
 #include "contiguousalldocspostlist.h"
 #include "brass_alldocspostlist.h"
 #include "brass_alltermslist.h"
@@ -44,6 +46,7 @@
 #include "brass_record.h"
 #include "brass_spellingwordslist.h"
 #include "brass_termlist.h"
+#include "brass_valueindexpostlist.h"
 #include "brass_valuelist.h"
 #include "brass_values.h"
 #include "omdebug.h"
@@ -51,6 +54,7 @@
 #include "pack.h"
 #include "remoteconnection.h"
 #include "replication.h"
+#include "replicationdelta.h"
 #include "replicationprotocol.h"
 #include "serialise.h"
 #include "stringutils.h"
@@ -61,13 +65,16 @@
 # include "msvc_posix_wrapper.h"
 #endif
 
+#include "safedirent.h"
 #include "safeerrno.h"
 #include "safesysstat.h"
 #include <sys/types.h>
 
 #include <algorithm>
+#include <cstring> // For strcmp().
 #include "autoptr.h"
 #include <string>
+#include <vector>
 
 using namespace std;
 using namespace Xapian;
@@ -118,9 +125,11 @@ BrassDatabase::BrassDatabase(const string &brass_dir, int action,
 	  value_manager(&postlist_table, &termlist_table),
 	  synonym_table(db_dir, readonly),
 	  spelling_table(db_dir, readonly),
+	  spelling_index(db_dir, true),
 	  record_table(db_dir, readonly),
 	  lock(db_dir),
-	  max_changesets(0)
+	  max_changesets(0),
+	  doclen_cache_mode(DOCLEN_CACHE_NONE)
 {
     DEBUGCALL(DB, void, "BrassDatabase", brass_dir << ", " << action <<
 	      ", " << block_size);
@@ -298,6 +307,35 @@ BrassDatabase::open_tables_consistent()
     }
 
     stats.read(postlist_table);
+
+    // A term dictionary is only valid for the revision it was built from,
+    // and a writable database is about to move on from that anyway.
+    if (readonly) {
+	termdict = BrassTermDictionary::open(db_dir, revision, get_uuid());
+	// Numeric columns are loaded when first needed.
+	numeric_columns.clear();
+	// Likewise the spelling index, which is only opened if it was
+	// committed at this revision of this database.
+	(void)spelling_index.open(revision, get_uuid());
+
+	const char *p = getenv("XAPIAN_CACHE_SYNONYMS");
+	if (p && atoi(p)) {
+	    synonym_cache = BrassSynonymCache::load(synonym_table);
+	} else {
+	    synonym_cache = NULL;
+	}
+
+	// Document lengths are loaded when first needed.
+	doclen_cache = NULL;
+	p = getenv("XAPIAN_CACHE_DOCLENGTHS");
+	if (p && strcmp(p, "quantised") == 0) {
+	    doclen_cache_mode = DOCLEN_CACHE_QUANTISED;
+	} else if (p && atoi(p)) {
+	    doclen_cache_mode = DOCLEN_CACHE_EXACT;
+	} else {
+	    doclen_cache_mode = DOCLEN_CACHE_NONE;
+	}
+    }
 }
 
 void
@@ -491,6 +529,10 @@ void
 BrassDatabase::close()
 {
     DEBUGCALL(DB, void, "BrassDatabase::close", "");
+    termdict = NULL;
+    synonym_cache = NULL;
+    numeric_columns.clear();
+    spelling_index.close(true);
     postlist_table.close(true);
     position_table.close(true);
     termlist_table.close(true);
@@ -519,7 +561,8 @@ BrassDatabase::get_database_write_lock(bool creating)
 
 void
 BrassDatabase::send_whole_database(RemoteConnection & conn,
-				   const OmTime & end_time)
+				   const OmTime & end_time,
+				   const BlockChecksums * checksums)
 {
     DEBUGCALL(DB, void, "BrassDatabase::send_whole_database",
 	      "conn" << ", " << "end_time");
@@ -533,25 +576,60 @@ BrassDatabase::send_whole_database(RemoteConnection & conn,
     conn.send_message(REPL_REPLY_DB_HEADER, buf, end_time);
 
     // Send all the tables.  The tables which we want to be cached best after
-    // the copy finished are sent last.
+    // the copy finished are sent last.  The spelling index, term dictionary
+    // and numeric columns which xapian-compact may have written are tagged
+    // with our UUID and revision, so they're valid for the copy too.
     static const char filenames[] =
 	"\x0b""termlist.DB""\x0e""termlist.baseA\x0e""termlist.baseB"
 	"\x0a""synonym.DB""\x0d""synonym.baseA\x0d""synonym.baseB"
 	"\x0b""spelling.DB""\x0e""spelling.baseA\x0e""spelling.baseB"
+	"\x0b""spelldel.DB""\x0e""spelldel.baseA\x0e""spelldel.baseB"
 	"\x09""record.DB""\x0c""record.baseA\x0c""record.baseB"
 	"\x0b""position.DB""\x0e""position.baseA\x0e""position.baseB"
+	"\x08""termdict"
 	"\x0b""postlist.DB""\x0e""postlist.baseA\x0e""postlist.baseB"
 	"\x08""iambrass";
+    vector<string> leaves;
+    for (const char * p = filenames; *p; p += *p + 1) {
+	leaves.push_back(string(p + 1, size_t(static_cast<unsigned char>(*p))));
+    }
+
+    // The numeric columns are named "column" followed by the slot number,
+    // and are sent with the term dictionary.
+    vector<string> columns;
+    DIR * dir = opendir(db_dir.c_str());
+    if (dir) {
+	while (true) {
+	    struct dirent * entry = readdir(dir);
+	    if (entry == NULL) break;
+	    const char * leaf = entry->d_name;
+	    if (strncmp(leaf, "column", CONST_STRLEN("column")) != 0) continue;
+	    const char * q = leaf + CONST_STRLEN("column");
+	    if (!C_isdigit(*q)) continue;
+	    while (C_isdigit(*q)) ++q;
+	    if (*q == '\0') columns.push_back(leaf);
+	}
+	closedir(dir);
+    }
+    sort(columns.begin(), columns.end());
+    leaves.insert(find(leaves.begin(), leaves.end(), "termdict"),
+		  columns.begin(), columns.end());
+
     string filepath = db_dir;
     filepath += '/';
-    for (const char * p = filenames; *p; p += *p + 1) {
-	string leaf(p + 1, size_t(static_cast<unsigned char>(*p)));
+    vector<string>::const_iterator i;
+    for (i = leaves.begin(); i != leaves.end(); ++i) {
+	const string & leaf = *i;
         filepath.replace(db_dir.size() + 1, string::npos, leaf);
 	if (file_exists(filepath)) {
 	    // FIXME - there is a race condition here - the file might get
 	    // deleted between the file_exists() test and the access to send it.
 	    conn.send_message(REPL_REPLY_DB_FILENAME, leaf, end_time);
-	    conn.send_file(REPL_REPLY_DB_FILEDATA, filepath, end_time);
+	    if (checksums && checksums->has_file(leaf)) {
+		send_file_delta(conn, *checksums, leaf, filepath, end_time);
+	    } else {
+		conn.send_file(REPL_REPLY_DB_FILEDATA, filepath, end_time);
+	    }
 	}
     }
 }
@@ -560,10 +638,13 @@ void
 BrassDatabase::write_changesets_to_fd(int fd,
 				      const string & revision,
 				      bool need_whole_db,
-				      ReplicationInfo * info)
+				      ReplicationInfo * info,
+				      BlockChecksumsSource * checksums,
+				      bool compress_changesets)
 {
     DEBUGCALL(DB, void, "BrassDatabase::write_changesets_to_fd",
-	      fd << ", " << revision << ", " << need_whole_db << ", " << info);
+	      fd << ", " << revision << ", " << need_whole_db << ", " << info <<
+	      ", " << checksums << ", " << compress_changesets);
 
     int whole_db_copies_left = MAX_DB_COPIES_PER_CONVERSATION;
     brass_revision_number_t start_rev_num = 0;
@@ -577,15 +658,41 @@ BrassDatabase::write_changesets_to_fd(int fd,
 	need_whole_db = true;
     }
 
+    if (info != NULL) {
+	if (need_whole_db || start_rev_num > get_revision_number()) {
+	    info->revision_lag = -1;
+	} else {
+	    info->revision_lag = int(get_revision_number() - start_rev_num);
+	}
+    }
+
     RemoteConnection conn(-1, fd, string());
     OmTime end_time;
 
+    // Make hardlinks for all the changesets we're likely to need first, so
+    // that there's no risk of them disappearing while we're sending earlier
+    // ones.  Any which are written while we're sending get linked when we
+    // reach them.
+    ChangesetLinks links(db_dir);
+    if (!need_whole_db) {
+	brass_revision_number_t rev = start_rev_num;
+	while (rev < get_revision_number()) {
+	    string changes_name = links.pin(rev);
+	    if (changes_name.empty()) break;
+	    brass_revision_number_t changeset_start_rev_num;
+	    brass_revision_number_t changeset_end_rev_num;
+	    get_changeset_revisions(changes_name,
+				    &changeset_start_rev_num,
+				    &changeset_end_rev_num);
+	    // Leave reporting any problems to the main loop below.
+	    if (changeset_start_rev_num != rev ||
+		changeset_start_rev_num >= changeset_end_rev_num) break;
+	    rev = changeset_end_rev_num;
+	}
+    }
+
     // While the starting revision number is less than the latest revision
     // number, look for a changeset, and write it.
-    //
-    // FIXME - perhaps we should make hardlinks for all the changesets we're
-    // likely to need, first, and then start sending them, so that there's no
-    // risk of them disappearing while we're sending earlier ones.
     while (true) {
 	if (need_whole_db) {
 	    // Decrease the counter of copies left to be sent, and fail
@@ -595,6 +702,8 @@ BrassDatabase::write_changesets_to_fd(int fd,
 		conn.send_message(REPL_REPLY_FAIL,
 				  "Database changing too fast",
 				  end_time);
+		if (info != NULL)
+		    info->bytes_transferred = conn.get_bytes_transferred();
 		return;
 	    }
 	    whole_db_copies_left--;
@@ -603,7 +712,11 @@ BrassDatabase::write_changesets_to_fd(int fd,
 	    start_rev_num = get_revision_number();
 	    start_uuid = get_uuid();
 
-	    send_whole_database(conn, end_time);
+	    // Only ask the replica for checksums now we know we need them.
+	    // They're only valid until it has applied something we've sent.
+	    send_whole_database(conn, end_time,
+				checksums ? checksums->get(conn, end_time) : NULL);
+	    checksums = NULL;
 	    if (info != NULL)
 		++(info->fullcopy_count);
 
@@ -649,8 +762,8 @@ BrassDatabase::write_changesets_to_fd(int fd,
 	    }
 
 	    // Look for the changeset for revision start_rev_num.
-	    string changes_name = db_dir + "/changes" + om_tostring(start_rev_num);
-	    if (file_exists(changes_name)) {
+	    string changes_name = links.pin(start_rev_num);
+	    if (!changes_name.empty()) {
 		// Send it, and also update start_rev_num to the new value
 		// specified in the changeset.
 		brass_revision_number_t changeset_start_rev_num;
@@ -664,10 +777,12 @@ BrassDatabase::write_changesets_to_fd(int fd,
 		if (changeset_start_rev_num >= changeset_end_rev_num) {
 		    throw Xapian::DatabaseError("Changeset start revision is not less than end revision");
 		}
-		// FIXME - there is a race condition here - the file might get
-		// deleted between the file_exists() test and the access to
-		// send it.
-		conn.send_file(REPL_REPLY_CHANGESET, changes_name, end_time);
+		if (compress_changesets) {
+		    send_compressed_changeset(conn, changes_name, end_time);
+		} else {
+		    conn.send_file(REPL_REPLY_CHANGESET, changes_name, end_time);
+		}
+		checksums = NULL;
 		start_rev_num = changeset_end_rev_num;
 		if (info != NULL) {
 		    ++(info->changeset_count);
@@ -682,6 +797,8 @@ BrassDatabase::write_changesets_to_fd(int fd,
 	}
     }
     conn.send_message(REPL_REPLY_END_OF_CHANGES, string(), end_time);
+    if (info != NULL)
+	info->bytes_transferred = conn.get_bytes_transferred();
 }
 
 void
@@ -791,15 +908,58 @@ BrassDatabase::get_doclength(Xapian::docid did) const
 {
     DEBUGCALL(DB, Xapian::termcount, "BrassDatabase::get_doclength", did);
     Assert(did != 0);
+    if (doclen_cache_mode == DOCLEN_CACHE_EXACT) {
+	Xapian::termcount doclen;
+	if (!get_doclen_cache()->get_doclength(did, doclen))
+	    throw Xapian::DocNotFoundError("Document " + om_tostring(did) + " not found");
+	RETURN(doclen);
+    }
     Xapian::Internal::RefCntPtr<const BrassDatabase> ptrtothis(this);
     RETURN(postlist_table.get_doclength(did, ptrtothis));
 }
 
+Xapian::termcount
+BrassDatabase::get_approx_doclength(Xapian::docid did) const
+{
+    DEBUGCALL(DB, Xapian::termcount, "BrassDatabase::get_approx_doclength", did);
+    Assert(did != 0);
+    if (doclen_cache_mode == DOCLEN_CACHE_QUANTISED) {
+	Xapian::termcount doclen;
+	if (!get_doclen_cache()->get_doclength(did, doclen))
+	    throw Xapian::DocNotFoundError("Document " + om_tostring(did) + " not found");
+	RETURN(doclen);
+    }
+    // This is a virtual method, so BrassWritableDatabase's version is used
+    // for a writable database.
+    RETURN(get_doclength(did));
+}
+
+const BrassDocLengthCache *
+BrassDatabase::get_doclen_cache() const
+{
+    DEBUGCALL(DB, const BrassDocLengthCache *, "BrassDatabase::get_doclen_cache", "");
+    if (doclen_cache_mode == DOCLEN_CACHE_NONE) RETURN(NULL);
+    if (!doclen_cache.get()) {
+	Xapian::Internal::RefCntPtr<const BrassDatabase> ptrtothis(this);
+	BrassPostList doclens(ptrtothis, string(), true);
+	doclen_cache = BrassDocLengthCache::load(
+		doclens, get_lastdocid(),
+		doclen_cache_mode == DOCLEN_CACHE_QUANTISED);
+    }
+    RETURN(doclen_cache.get());
+}
+
 Xapian::doccount
 BrassDatabase::get_termfreq(const string & term) const
 {
     DEBUGCALL(DB, Xapian::doccount, "BrassDatabase::get_termfreq", term);
     Assert(!term.empty());
+    if (termdict.get()) {
+	Xapian::doccount termfreq;
+	Xapian::termcount collfreq;
+	if (!termdict->lookup(term, termfreq, collfreq)) RETURN(0);
+	RETURN(termfreq);
+    }
     RETURN(postlist_table.get_termfreq(term));
 }
 
@@ -808,6 +968,12 @@ BrassDatabase::get_collection_freq(const string & term) const
 {
     DEBUGCALL(DB, Xapian::termcount, "BrassDatabase::get_collection_freq", term);
     Assert(!term.empty());
+    if (termdict.get()) {
+	Xapian::doccount termfreq;
+	Xapian::termcount collfreq;
+	if (!termdict->lookup(term, termfreq, collfreq)) RETURN(0);
+	RETURN(collfreq);
+    }
     RETURN(postlist_table.get_collection_freq(term));
 }
 
@@ -855,6 +1021,11 @@ BrassDatabase::term_exists(const string & term) const
 {
     DEBUGCALL(DB, bool, "BrassDatabase::term_exists", term);
     Assert(!term.empty());
+    if (termdict.get()) {
+	Xapian::doccount termfreq;
+	Xapian::termcount collfreq;
+	return termdict->lookup(term, termfreq, collfreq);
+    }
     return postlist_table.term_exists(term);
 }
 
@@ -881,14 +1052,57 @@ BrassDatabase::open_post_list(const string& term) const
     RETURN(new BrassPostList(ptrtothis, term, true));
 }
 
+const BrassNumericColumn *
+BrassDatabase::get_numeric_column(Xapian::valueno slot) const
+{
+    DEBUGCALL(DB, const BrassNumericColumn *, "BrassDatabase::get_numeric_column", slot);
+    // A numeric column is only valid for the revision it was built from.
+    if (!readonly) RETURN(NULL);
+    map<Xapian::valueno,
+	Xapian::Internal::RefCntPtr<const BrassNumericColumn> >::iterator i;
+    i = numeric_columns.find(slot);
+    if (i == numeric_columns.end()) {
+	Xapian::Internal::RefCntPtr<const BrassNumericColumn> column(
+	    BrassNumericColumn::open(db_dir, slot, get_revision_number(),
+				     get_uuid()));
+	i = numeric_columns.insert(make_pair(slot, column)).first;
+    }
+    RETURN(i->second.get());
+}
+
 ValueList *
 BrassDatabase::open_value_list(Xapian::valueno slot) const
 {
     DEBUGCALL(DB, ValueList *, "BrassDatabase::open_value_list", slot);
+    const BrassNumericColumn * column = get_numeric_column(slot);
+    if (column) {
+	RETURN(new BrassNumericColumnValueList(
+		Xapian::Internal::RefCntPtr<const BrassNumericColumn>(column)));
+    }
     Xapian::Internal::RefCntPtr<const BrassDatabase> ptrtothis(this);
     RETURN(new BrassValueList(slot, ptrtothis));
 }
 
+bool
+BrassDatabase::has_value_index(Xapian::valueno slot) const
+{
+    DEBUGCALL(DB, bool, "BrassDatabase::has_value_index", slot);
+    RETURN(value_manager.has_value_index(slot));
+}
+
+PostList *
+BrassDatabase::open_value_index_post_list(Xapian::valueno slot,
+					  const string & begin,
+					  const string & end) const
+{
+    DEBUGCALL(DB, PostList *, "BrassDatabase::open_value_index_post_list",
+	      slot << ", " << begin << ", " << end);
+    vector<Xapian::docid> docids;
+    value_manager.get_value_index_docids(slot, begin, end, docids);
+    RETURN(new BrassValueIndexPostList(slot, begin, end, get_doccount(),
+				       docids));
+}
+
 TermList *
 BrassDatabase::open_term_list(Xapian::docid did) const
 {
@@ -935,6 +1149,9 @@ TermList *
 BrassDatabase::open_allterms(const string & prefix) const
 {
     DEBUGCALL(DB, TermList *, "BrassDatabase::open_allterms", "");
+    if (termdict.get()) {
+	RETURN(new BrassTermDictAllTermsList(termdict, prefix));
+    }
     RETURN(new BrassAllTermsList(Xapian::Internal::RefCntPtr<const BrassDatabase>(this),
 				 prefix));
 }
@@ -945,6 +1162,14 @@ BrassDatabase::open_spelling_termlist(const string & word) const
     return spelling_table.open_termlist(word);
 }
 
+TermList *
+BrassDatabase::open_spelling_candidates(const string & word,
+					unsigned max_edit_distance) const
+{
+    if (!spelling_index.get_max_distance()) return NULL;
+    return spelling_index.open_termlist(word, max_edit_distance);
+}
+
 TermList *
 BrassDatabase::open_spelling_wordlist() const
 {
@@ -963,12 +1188,16 @@ BrassDatabase::get_spelling_frequency(const string & word) const
 TermList *
 BrassDatabase::open_synonym_termlist(const string & term) const
 {
+    if (synonym_cache.get()) return synonym_cache->open_termlist(term);
     return synonym_table.open_termlist(term);
 }
 
 TermList *
 BrassDatabase::open_synonym_keylist(const string & prefix) const
 {
+    if (synonym_cache.get()) {
+	return new BrassSynonymCacheTermList(synonym_cache, prefix);
+    }
     BrassCursor * cursor = synonym_table.cursor_get();
     if (!cursor) return NULL;
     return new BrassSynonymTermList(Xapian::Internal::RefCntPtr<const BrassDatabase>(this),
@@ -1030,6 +1259,22 @@ BrassWritableDatabase::BrassWritableDatabase(const string &dir, int action,
 	flush_threshold = atoi(p);
     if (flush_threshold == 0)
 	flush_threshold = 10000;
+
+    // Create a value index for each slot listed which doesn't have one yet.
+    // Once created, an index is kept up to date whether or not its slot is
+    // listed.
+    p = getenv("XAPIAN_VALUE_INDEXES");
+    if (p) {
+	while (*p) {
+	    char * q;
+	    Xapian::valueno slot = strtoul(p, &q, 10);
+	    if (q == p) break;
+	    if (!value_manager.has_value_index(slot))
+		value_manager.build_value_index(slot);
+	    p = q;
+	    if (*p == ',') ++p;
+	}
+    }
 }
 
 BrassWritableDatabase::~BrassWritableDatabase()
@@ -1307,6 +1552,7 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 	    BrassTermList termlist(ptrtothis, did);
 	    Xapian::TermIterator term = document.termlist_begin();
 	    brass_doclen_t new_doclen = termlist.get_doclength();
+	    brass_doclen_t old_doclen = new_doclen;
 	    string old_tname, new_tname;
 
 	    stats.delete_document(new_doclen);
@@ -1362,6 +1608,19 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 	    }
 	    LOGLINE(DB, "Calculated doclen for replacement document " << did << " as " << new_doclen);
 
+	    // If the postlists store quantised document lengths and the
+	    // quantised length has changed, the entries for the terms whose wdf
+	    // hasn't changed need rewriting too.
+	    const BrassDocLengthQuantiser * codes =
+		postlist_table.get_doclen_codes();
+	    if (codes && codes->encode(new_doclen) != codes->encode(old_doclen)) {
+		for (term = document.termlist_begin();
+		     term != document.termlist_end(); ++term) {
+		    termcount wdf = term.get_wdf();
+		    inverter.update_posting(did, *term, wdf, wdf);
+		}
+	    }
+
 	    // Set the termlist.
 	    if (termlist_table.is_open())
 		termlist_table.set_termlist(did, document, new_doclen);
@@ -1503,6 +1762,19 @@ BrassWritableDatabase::open_value_list(Xapian::valueno slot) const
     RETURN(BrassDatabase::open_value_list(slot));
 }
 
+PostList *
+BrassWritableDatabase::open_value_index_post_list(Xapian::valueno slot,
+						  const string & begin,
+						  const string & end) const
+{
+    DEBUGCALL(DB, PostList *,
+	      "BrassWritableDatabase::open_value_index_post_list",
+	      slot << ", " << begin << ", " << end);
+    // The value index is updated when the changes are merged.
+    if (change_count) value_manager.merge_changes();
+    RETURN(BrassDatabase::open_value_index_post_list(slot, begin, end));
+}
+
 TermList *
 BrassWritableDatabase::open_allterms(const string & prefix) const
 {
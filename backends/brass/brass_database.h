@@ -26,12 +26,15 @@
 
 #include "database.h"
 #include "brass_dbstats.h"
+#include "brass_doclencache.h"
 #include "brass_inverter.h"
+#include "brass_numericcolumn.h"
 #include "brass_positionlist.h"
 #include "brass_postlist.h"
 #include "brass_record.h"
 #include "brass_spelling.h"
 #include "brass_synonym.h"
+#include "brass_termdict.h"
 #include "brass_termlisttable.h"
 #include "brass_values.h"
 #include "brass_version.h"
@@ -44,6 +47,8 @@
 class BrassTermList;
 class BrassAllDocsPostList;
 class RemoteConnection;
+class BlockChecksums;
+class BlockChecksumsSource;
 class OmTime;
 
 /** A backend designed for efficient indexing and retrieval, using
@@ -97,6 +102,13 @@ class BrassDatabase : public Xapian::Database::Internal {
 	 */
 	mutable BrassSpellingTable spelling_table;
 
+	/** Index of spelling words by deletion variants.
+	 *
+	 *  Only opened if the database is read-only and the index is
+	 *  available for the open revision.
+	 */
+	BrassSpellingIndex spelling_index;
+
 	/** Table storing records.
 	 *
 	 *  Whenever an update is performed, this table is the last to be
@@ -117,6 +129,49 @@ class BrassDatabase : public Xapian::Database::Internal {
 	/// Database statistics.
 	BrassDatabaseStats stats;
 
+	/** The term dictionary, if the database is read-only and has one
+	 *  for the open revision.
+	 */
+	Xapian::Internal::RefCntPtr<const BrassTermDictionary> termdict;
+
+	/** In-memory copy of the synonym table, if the database is read-only
+	 *  and XAPIAN_CACHE_SYNONYMS is set.
+	 */
+	Xapian::Internal::RefCntPtr<const BrassSynonymCache> synonym_cache;
+
+	/// How XAPIAN_CACHE_DOCLENGTHS asked for document lengths to be cached.
+	enum {
+	    DOCLEN_CACHE_NONE,
+	    DOCLEN_CACHE_EXACT,
+	    DOCLEN_CACHE_QUANTISED
+	} doclen_cache_mode;
+
+	/** In-memory array of document lengths, if the database is read-only,
+	 *  XAPIAN_CACHE_DOCLENGTHS is set, and a length has been needed.
+	 */
+	mutable Xapian::Internal::RefCntPtr<const BrassDocLengthCache>
+		doclen_cache;
+
+	/** Return doclen_cache, loading it if it hasn't been yet.
+	 *
+	 *  Returns NULL if document lengths aren't being cached.
+	 */
+	const BrassDocLengthCache * get_doclen_cache() const;
+
+	/** The numeric columns loaded so far, if the database is read-only.
+	 *
+	 *  A slot maps to NULL if it has no column for the open revision.
+	 */
+	mutable std::map<Xapian::valueno,
+			 Xapian::Internal::RefCntPtr<const BrassNumericColumn> >
+		numeric_columns;
+
+	/** Return the numeric column for @a slot, or NULL if there isn't one.
+	 *
+	 *  The column is loaded the first time this is called for @a slot.
+	 */
+	const BrassNumericColumn * get_numeric_column(Xapian::valueno slot) const;
+
 	/** Return true if a database exists at the path specified for this
 	 *  database.
 	 */
@@ -209,9 +264,13 @@ class BrassDatabase : public Xapian::Database::Internal {
 	void cancel();
 
 	/** Send a set of messages which transfer the whole database.
+	 *
+	 *  If @a checksums is non-NULL, files which the replica has checksums
+	 *  for are sent as deltas against the replica's copy.
 	 */
 	void send_whole_database(RemoteConnection & conn,
-				 const OmTime & end_time);
+				 const OmTime & end_time,
+				 const BlockChecksums * checksums);
 
 	/** Get the revision stored in a changeset.
 	 */
@@ -248,6 +307,15 @@ class BrassDatabase : public Xapian::Database::Internal {
 	    return postlist_table.cursor_get();
 	}
 
+	/** Return the length of document @a did for weighting.
+	 *
+	 *  This is the same as get_doclength(), except that it returns the
+	 *  quantised length (which is never less than the actual length) if
+	 *  XAPIAN_CACHE_DOCLENGTHS asks for them (used by
+	 *  BrassPostList::get_approx_doclength()).
+	 */
+	Xapian::termcount get_approx_doclength(Xapian::docid did) const;
+
 	/** Virtual methods of Database::Internal. */
 	//@{
 	Xapian::doccount  get_doccount() const;
@@ -268,6 +336,10 @@ class BrassDatabase : public Xapian::Database::Internal {
 
 	LeafPostList * open_post_list(const string & tname) const;
 	ValueList * open_value_list(Xapian::valueno slot) const;
+	bool has_value_index(Xapian::valueno slot) const;
+	PostList * open_value_index_post_list(Xapian::valueno slot,
+					      const string & begin,
+					      const string & end) const;
 	Xapian::Document::Internal * open_document(Xapian::docid did, bool lazy) const;
 
 	PositionList * open_position_list(Xapian::docid did, const string & term) const;
@@ -275,6 +347,8 @@ class BrassDatabase : public Xapian::Database::Internal {
 	TermList * open_allterms(const string & prefix) const;
 
 	TermList * open_spelling_termlist(const string & word) const;
+	TermList * open_spelling_candidates(const string & word,
+					    unsigned max_edit_distance) const;
 	TermList * open_spelling_wordlist() const;
 	Xapian::doccount get_spelling_frequency(const string & word) const;
 
@@ -286,7 +360,9 @@ class BrassDatabase : public Xapian::Database::Internal {
 	void write_changesets_to_fd(int fd,
 				    const string & start_revision,
 				    bool need_whole_db,
-				    Xapian::ReplicationInfo * info);
+				    Xapian::ReplicationInfo * info,
+				    BlockChecksumsSource * checksums,
+				    bool compress_changesets);
 	string get_revision_info() const;
 	string get_uuid() const;
 	//@}
@@ -385,6 +461,9 @@ class BrassWritableDatabase : public BrassDatabase {
 
 	LeafPostList * open_post_list(const string & tname) const;
 	ValueList * open_value_list(Xapian::valueno slot) const;
+	PostList * open_value_index_post_list(Xapian::valueno slot,
+					      const string & begin,
+					      const string & end) const;
 	TermList * open_allterms(const string & prefix) const;
 
 	void add_spelling(const string & word, Xapian::termcount freqinc) const;
@@ -0,0 +1,136 @@
+/** @file brass_doclencache.cc
+ * @brief In-memory array of document lengths for read-only brass databases.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "brass_doclencache.h"
+
+#include <xapian/error.h>
+
+#include "autoptr.h"
+#include "brass_postlist.h"
+#include "omassert.h"
+#include "omdebug.h"
+#include "pack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+BrassDocLengthQuantiser::BrassDocLengthQuantiser(Xapian::termcount max_len)
+{
+    lengths[LONG_CODE] = Xapian::termcount(-1);
+    if (max_len < LONG_CODE) {
+	// Every length fits in a byte as it is.
+	for (unsigned c = 0; c != LONG_CODE; ++c) lengths[c] = c;
+	return;
+    }
+    for (unsigned c = 0; c != QUANT_EXACT; ++c) lengths[c] = c;
+    // Space the rest of the codes geometrically from QUANT_EXACT to max_len.
+    double steps = LONG_CODE - 1 - QUANT_EXACT;
+    double ratio = double(max_len) / QUANT_EXACT;
+    for (unsigned c = QUANT_EXACT; c != LONG_CODE - 1; ++c) {
+	double len = QUANT_EXACT * pow(ratio, (c - QUANT_EXACT) / steps);
+	lengths[c] = Xapian::termcount(len + 0.5);
+    }
+    lengths[LONG_CODE - 1] = max_len;
+}
+
+unsigned char
+BrassDocLengthQuantiser::encode(Xapian::termcount len) const
+{
+    // lengths is in ascending order, so this finds the first code which
+    // stands for at least len, or LONG_CODE if there isn't one.
+    size_t c = lower_bound(lengths, lengths + LONG_CODE, len) - lengths;
+    return static_cast<unsigned char>(c);
+}
+
+string
+BrassDocLengthQuantiser::serialise() const
+{
+    string result;
+    Xapian::termcount prev = 0;
+    // The length for LONG_CODE is implicit.
+    for (unsigned c = 0; c != LONG_CODE; ++c) {
+	pack_uint(result, lengths[c] - prev);
+	prev = lengths[c];
+    }
+    return result;
+}
+
+void
+BrassDocLengthQuantiser::unserialise(const string & s)
+{
+    const char * p = s.data();
+    const char * end = p + s.size();
+    Xapian::termcount prev = 0;
+    for (unsigned c = 0; c != LONG_CODE; ++c) {
+	Xapian::termcount inc;
+	if (!unpack_uint(&p, end, &inc))
+	    throw Xapian::DatabaseCorruptError("Bad document length codes");
+	prev += inc;
+	lengths[c] = prev;
+    }
+    if (p != end || lengths[0] != 0 || prev == Xapian::termcount(-1))
+	throw Xapian::DatabaseCorruptError("Bad document length codes");
+    lengths[LONG_CODE] = Xapian::termcount(-1);
+}
+
+BrassDocLengthCache *
+BrassDocLengthCache::load(BrassPostList & doclens, Xapian::docid last_did,
+			  bool quantise)
+{
+    DEBUGCALL_STATIC(DB, BrassDocLengthCache *, "BrassDocLengthCache::load",
+		     "[doclens], " << last_did << ", " << quantise);
+    AutoPtr<BrassDocLengthCache> cache(new BrassDocLengthCache(quantise));
+    cache->present.resize(last_did);
+    if (!quantise) {
+	cache->lengths.resize(last_did);
+	doclens.next(0);
+	while (!doclens.at_end()) {
+	    Xapian::docid did = doclens.get_docid();
+	    Assert(did <= last_did);
+	    cache->lengths[did - 1] = doclens.get_wdf();
+	    cache->present[did - 1] = true;
+	    doclens.next(0);
+	}
+	RETURN(cache.release());
+    }
+
+    // We need the longest length to quantise, so read the lengths first.
+    vector<pair<Xapian::docid, Xapian::termcount> > entries;
+    Xapian::termcount max_len = 0;
+    doclens.next(0);
+    while (!doclens.at_end()) {
+	Xapian::termcount len = doclens.get_wdf();
+	entries.push_back(make_pair(doclens.get_docid(), len));
+	if (len > max_len) max_len = len;
+	doclens.next(0);
+    }
+    cache->quantiser = BrassDocLengthQuantiser(max_len);
+    cache->codes.resize(last_did);
+    vector<pair<Xapian::docid, Xapian::termcount> >::const_iterator i;
+    for (i = entries.begin(); i != entries.end(); ++i) {
+	Assert(i->first <= last_did);
+	cache->codes[i->first - 1] = cache->quantiser.encode(i->second);
+	cache->present[i->first - 1] = true;
+    }
+    RETURN(cache.release());
+}
@@ -0,0 +1,149 @@
+/** @file brass_doclencache.h
+ * @brief In-memory array of document lengths for read-only brass databases.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_DOCLENCACHE_H
+#define XAPIAN_INCLUDED_BRASS_DOCLENCACHE_H
+
+#include <xapian/base.h>
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+#include "omassert.h"
+
+#include <string>
+#include <vector>
+
+class BrassPostList;
+
+/** Quantise document lengths to a byte.
+ *
+ *  Lengths below QUANT_EXACT are stored exactly, and longer ones are rounded
+ *  up to the next of the remaining codes, which are spaced geometrically up
+ *  to the longest document.  So a decoded length is never less than the
+ *  actual length, and is within 5% if the longest document has fewer than a
+ *  million terms.  Weighting schemes whose contribution falls as the
+ *  document length rises can therefore use the decoded lengths without
+ *  exceeding their upper bounds.
+ *
+ *  A document longer than the longest one the codes were set up for (which
+ *  can be added to a database after the codes are) gets LONG_CODE, which
+ *  means its exact length must be looked up instead.
+ */
+class XAPIAN_VISIBILITY_DEFAULT BrassDocLengthQuantiser : public Xapian::Internal::RefCntBase {
+    /** The length each code stands for, in ascending order.
+     *
+     *  The entry for LONG_CODE is the highest termcount.
+     */
+    Xapian::termcount lengths[256];
+
+  public:
+    /// Lengths below this are stored exactly.
+    static const Xapian::termcount QUANT_EXACT = 32;
+
+    /// The code for lengths longer than any other code stands for.
+    static const unsigned char LONG_CODE = 255;
+
+    /// Set up the codes for documents up to @a max_len long.
+    explicit BrassDocLengthQuantiser(Xapian::termcount max_len = 0);
+
+    /// Return the code for the shortest length which is at least @a len.
+    unsigned char encode(Xapian::termcount len) const;
+
+    /** Return the length which @a code stands for.
+     *
+     *  @a code mustn't be LONG_CODE.
+     */
+    Xapian::termcount decode(unsigned char code) const {
+	Assert(code != LONG_CODE);
+	return lengths[code];
+    }
+
+    /// Serialise the lengths the codes stand for.
+    std::string serialise() const;
+
+    /** Unserialise the lengths the codes stand for.
+     *
+     *  @exception Xapian::DatabaseCorruptError if @a s isn't valid.
+     */
+    void unserialise(const std::string & s);
+};
+
+/** The length of each document in a brass database, indexed by docid.
+ *
+ *  If the environment variable XAPIAN_CACHE_DOCLENGTHS is set to a non-zero
+ *  value, a read-only BrassDatabase loads the document lengths into one of
+ *  these the first time it needs one (and again after reopen() moves to a new
+ *  revision), so that each lookup is an array access rather than a search of
+ *  the doclength list.  All the postlists of the database share it.
+ *
+ *  If XAPIAN_CACHE_DOCLENGTHS is set to "quantised", each length is instead
+ *  stored in a byte by a BrassDocLengthQuantiser.  The quantised lengths are
+ *  only used for weighting, and only by weighting schemes which say they
+ *  don't need exact lengths - see BrassPostList::get_approx_doclength().
+ */
+class BrassDocLengthCache : public Xapian::Internal::RefCntBase {
+    /// Don't allow assignment.
+    void operator=(const BrassDocLengthCache &);
+
+    /// Don't allow copying.
+    BrassDocLengthCache(const BrassDocLengthCache &);
+
+    /// Are the lengths quantised?
+    bool quantised;
+
+    /// The lengths, indexed by docid - 1 (empty if quantised).
+    std::vector<Xapian::termcount> lengths;
+
+    /// The quantised lengths, indexed by docid - 1 (empty if not quantised).
+    std::vector<unsigned char> codes;
+
+    /// The quantiser the codes were made with.
+    BrassDocLengthQuantiser quantiser;
+
+    /// Which documents exist, indexed by docid - 1.
+    std::vector<bool> present;
+
+    /// Private constructor - use load() to create.
+    explicit BrassDocLengthCache(bool quantised_) : quantised(quantised_) { }
+
+  public:
+    /** Load the document lengths.
+     *
+     *  @param doclens	The doclength list, which must not have been started.
+     *  @param last_did	The highest docid in use.
+     *  @param quantise	Store the lengths in a byte each.
+     */
+    static BrassDocLengthCache * load(BrassPostList & doclens,
+				      Xapian::docid last_did,
+				      bool quantise);
+
+    /// Are the lengths quantised?
+    bool is_quantised() const { return quantised; }
+
+    /** Look up the length of document @a did.
+     *
+     *  @return false if document @a did doesn't exist.
+     */
+    bool get_doclength(Xapian::docid did, Xapian::termcount & len) const {
+	if (did - 1 >= present.size() || !present[did - 1]) return false;
+	len = quantised ? quantiser.decode(codes[did - 1]) : lengths[did - 1];
+	return true;
+    }
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_DOCLENCACHE_H
@@ -44,7 +44,7 @@ Inverter::flush_post_list(BrassPostListTable & table, const string & term)
     if (i == postlist_changes.end()) return;
 
     // Flush buffered changes for just this term's postlist.
-    table.merge_changes(term, i->second);
+    table.merge_changes(term, i->second, doclen_changes);
     postlist_changes.erase(i);
 }
 
@@ -53,7 +53,7 @@ Inverter::flush_all_post_lists(BrassPostListTable & table)
 {
     map<string, PostingChanges>::const_iterator i;
     for (i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
-	table.merge_changes(i->first, i->second);
+	table.merge_changes(i->first, i->second, doclen_changes);
     }
     postlist_changes.clear();
 }
@@ -69,7 +69,7 @@ Inverter::flush_post_lists(BrassPostListTable & table, const string & pfx)
     end = postlist_changes.upper_bound(pfx);
 
     for (i = begin; i != end; ++i) {
-	table.merge_changes(i->first, i->second);
+	table.merge_changes(i->first, i->second, doclen_changes);
     }
 
     // Erase all the entries in one go, as that's:
@@ -80,6 +80,9 @@ Inverter::flush_post_lists(BrassPostListTable & table, const string & pfx)
 void
 Inverter::flush(BrassPostListTable & table)
 {
-    flush_doclengths(table);
+    // Flush the postlists first, as if they store quantised document lengths
+    // they can then use the pending document length changes rather than
+    // looking each one up.
     flush_all_post_lists(table);
+    flush_doclengths(table);
 }
@@ -0,0 +1,376 @@
+/** @file brass_numericcolumn.cc
+ * @brief Fixed-width numeric columns of values for read-only brass databases.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "brass_numericcolumn.h"
+
+#include "safeerrno.h"
+
+#include <xapian/error.h>
+#include <xapian/queryparser.h> // For sortable_serialise().
+
+#include "autoptr.h"
+#include "brass_cursor.h"
+#include "brass_io.h"
+#include "brass_table.h"
+#include "brass_values.h"
+#include "internaltypes.h"
+#include "omassert.h"
+#include "omdebug.h"
+#include "pack.h"
+#include "stringutils.h"
+#include "utils.h"
+
+#ifdef __WIN32__
+# include "msvc_posix_wrapper.h"
+#endif
+
+#include <algorithm>
+#include <cmath> // For HUGE_VAL.
+#include <cstdio> // For rename().
+#include <cstring> // For memcmp() and memcpy().
+#include <utility>
+
+using namespace std;
+
+#define MAGIC_STRING "IAmBrassNumCol"
+
+#define MAGIC_LEN CONST_STRLEN(MAGIC_STRING)
+
+/// Return the filename of the column for @a slot.
+static string
+column_filename(const string & db_dir, Xapian::valueno slot)
+{
+    string filename = db_dir;
+    filename += "/column";
+    filename += om_tostring(slot);
+    return filename;
+}
+
+BrassNumericColumn *
+BrassNumericColumn::open(const string & db_dir, Xapian::valueno slot,
+			 brass_revision_number_t revision, const string & uuid)
+{
+    DEBUGCALL_STATIC(DB, BrassNumericColumn *, "BrassNumericColumn::open",
+		     db_dir << ", " << slot << ", " << revision << ", " <<
+		     uuid);
+    string filename = column_filename(db_dir, slot);
+    int fd = ::open(filename.c_str(), O_RDONLY|O_BINARY);
+    if (fd < 0) {
+	if (errno == ENOENT) RETURN(NULL);
+	string msg = filename;
+	msg += ": Failed to open numeric column for reading";
+	throw Xapian::DatabaseOpeningError(msg, errno);
+    }
+
+    string data;
+    brass_revision_number_t column_revision;
+    Xapian::docid last_did;
+    const char * p;
+    const char * end;
+    try {
+	// Read and check the header first, so we don't read the rest of an out
+	// of date column.  The UUID is stored as a string of 36 characters,
+	// and the three packed numbers take at most 5 bytes each.
+	char buf[65536];
+	size_t n = brass_io_read(fd, buf, MAGIC_LEN + 1 + 36 + 15, 0);
+	p = buf;
+	end = p + n;
+	if (n < MAGIC_LEN || memcmp(p, MAGIC_STRING, MAGIC_LEN) != 0) {
+	    throw Xapian::DatabaseCorruptError(filename + ": Numeric column doesn't contain the right magic string");
+	}
+	p += MAGIC_LEN;
+	string column_uuid;
+	Xapian::valueno column_slot;
+	if (!unpack_string(&p, end, column_uuid) ||
+	    !unpack_uint(&p, end, &column_revision) ||
+	    !unpack_uint(&p, end, &column_slot) ||
+	    !unpack_uint(&p, end, &last_did) ||
+	    column_slot != slot) {
+	    throw Xapian::DatabaseCorruptError(filename + ": Bad numeric column header");
+	}
+
+	if (column_uuid != uuid || column_revision != revision) {
+	    // The column is for a different database (e.g. one which was
+	    // compacted into the same directory) or revision, so is out of
+	    // date.
+	    (void)close(fd);
+	    RETURN(NULL);
+	}
+
+	data.assign(p, end - p);
+	while ((n = brass_io_read(fd, buf, sizeof(buf), 0)) != 0) {
+	    data.append(buf, n);
+	}
+    } catch (...) {
+	(void)close(fd);
+	throw;
+    }
+    (void)close(fd);
+
+    // We store doubles by copying their bytes, so rely on them being 8 bytes
+    // (which IEEE doubles are).
+    CompileTimeAssert(sizeof(double) == sizeof(uint8));
+    size_t bitmap_len = (last_did + 7) / 8;
+    if (data.size() < bitmap_len) {
+	throw Xapian::DatabaseCorruptError(filename + ": Numeric column truncated");
+    }
+    AutoPtr<BrassNumericColumn> column(new BrassNumericColumn(slot));
+    column->values.resize(last_did);
+    column->present.resize(last_did);
+    p = data.data() + bitmap_len;
+    end = data.data() + data.size();
+    for (Xapian::docid i = 0; i != last_did; ++i) {
+	if (!(data[i / 8] & (1 << (i % 8)))) continue;
+	if (end - p < 8) {
+	    throw Xapian::DatabaseCorruptError(filename + ": Numeric column truncated");
+	}
+	uint8 bits = 0;
+	for (int j = 0; j != 8; ++j) {
+	    bits = (bits << 8) | static_cast<unsigned char>(*p++);
+	}
+	memcpy(&column->values[i], &bits, sizeof(double));
+	column->present[i] = true;
+    }
+    if (p != end) {
+	throw Xapian::DatabaseCorruptError(filename + ": Junk at end of numeric column");
+    }
+
+    column->calc_block_maxima();
+    RETURN(column.release());
+}
+
+void
+BrassNumericColumn::calc_block_maxima()
+{
+    size_t n_blocks = (values.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    block_max.assign(n_blocks, -HUGE_VAL);
+    for (Xapian::docid i = 0; i != values.size(); ++i) {
+	if (present[i]) {
+	    double & m = block_max[i / BLOCK_SIZE];
+	    if (values[i] > m) m = values[i];
+	}
+    }
+    rest_max.resize(n_blocks);
+    double m = -HUGE_VAL;
+    for (size_t b = n_blocks; b != 0; --b) {
+	m = max(m, block_max[b - 1]);
+	rest_max[b - 1] = m;
+    }
+}
+
+void
+BrassNumericColumn::get_upper_bounds(Xapian::docid did,
+				     Xapian::docid & block_end,
+				     double & block_max_out,
+				     double & rest_max_out) const
+{
+    Assert(did);
+    size_t b = (did - 1) / BLOCK_SIZE;
+    block_end = (b + 1) * BLOCK_SIZE;
+    if (b >= block_max.size()) {
+	// There are no values this far on.
+	block_max_out = rest_max_out = -HUGE_VAL;
+	return;
+    }
+    block_max_out = block_max[b];
+    rest_max_out = rest_max[b];
+}
+
+void
+BrassNumericColumn::build(const string & db_dir,
+			  const BrassTable & postlist_table,
+			  Xapian::valueno slot, const string & uuid)
+{
+    DEBUGCALL_STATIC(DB, void, "BrassNumericColumn::build", db_dir << ", " <<
+		     "[postlist_table], " << slot << ", " << uuid);
+    vector<pair<Xapian::docid, double> > entries;
+
+    AutoPtr<BrassCursor> cursor(postlist_table.cursor_get());
+    Assert(cursor.get()); // The postlist table isn't optional.
+    cursor->find_entry_ge(Brass::make_valuechunk_key(slot, 1));
+    while (!cursor->after_end()) {
+	Xapian::docid first_did = Brass::docid_from_key(slot,
+							cursor->current_key);
+	if (!first_did) break;
+	cursor->read_tag();
+	const string & tag = cursor->current_tag;
+	Brass::ValueChunkReader reader(tag.data(), tag.size(), first_did);
+	while (!reader.at_end()) {
+	    const string & value = reader.get_value();
+	    double d = Xapian::sortable_unserialise(value);
+	    if (Xapian::sortable_serialise(d) != value) {
+		string msg = "Value slot ";
+		msg += om_tostring(slot);
+		msg += " contains a value which isn't a number encoded by "
+		       "sortable_serialise()";
+		throw Xapian::InvalidArgumentError(msg);
+	    }
+	    entries.push_back(make_pair(reader.get_docid(), d));
+	    reader.next();
+	}
+	cursor->next();
+    }
+
+    CompileTimeAssert(sizeof(double) == sizeof(uint8));
+    Xapian::docid last_did = entries.empty() ? 0 : entries.back().first;
+    string data(MAGIC_STRING);
+    pack_string(data, uuid);
+    pack_uint(data, postlist_table.get_open_revision_number());
+    pack_uint(data, slot);
+    pack_uint(data, last_did);
+    size_t bitmap_start = data.size();
+    data.append((last_did + 7) / 8, '\0');
+    vector<pair<Xapian::docid, double> >::const_iterator i;
+    for (i = entries.begin(); i != entries.end(); ++i) {
+	Xapian::docid bit = i->first - 1;
+	data[bitmap_start + bit / 8] |= char(1 << (bit % 8));
+	uint8 bits;
+	memcpy(&bits, &i->second, sizeof(double));
+	for (int j = 56; j >= 0; j -= 8) {
+	    data += char(bits >> j);
+	}
+    }
+
+    // Write to a temporary file and rename it into place, so a reader never
+    // sees a partial column.
+    string filename = column_filename(db_dir, slot);
+    string tmp = filename;
+    tmp += ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+    if (fd < 0) {
+	throw Xapian::DatabaseError("Failed to create numeric column: " + tmp,
+				    errno);
+    }
+    try {
+	brass_io_write(fd, data.data(), data.size());
+    } catch (...) {
+	(void)close(fd);
+	(void)unlink(tmp);
+	throw;
+    }
+    if (!brass_io_sync(fd) || close(fd) != 0) {
+	int saved_errno = errno;
+	(void)unlink(tmp);
+	throw Xapian::DatabaseError("Failed to write numeric column: " + tmp,
+				    saved_errno);
+    }
+    if (rename(tmp.c_str(), filename.c_str()) < 0) {
+	int saved_errno = errno;
+	(void)unlink(tmp);
+	throw Xapian::DatabaseError("Failed to rename numeric column into place",
+				    saved_errno);
+    }
+}
+
+void
+BrassNumericColumnValueList::move_to(Xapian::docid target)
+{
+    Xapian::docid last = column->get_last_docid();
+    for (did = target; did <= last; ++did) {
+	if (column->has_value(did)) return;
+    }
+}
+
+Xapian::docid
+BrassNumericColumnValueList::get_docid() const
+{
+    Assert(!at_end());
+    return did;
+}
+
+Xapian::valueno
+BrassNumericColumnValueList::get_valueno() const
+{
+    return column->get_slot();
+}
+
+string
+BrassNumericColumnValueList::get_value() const
+{
+    Assert(!at_end());
+    return Xapian::sortable_serialise(column->get_value(did));
+}
+
+double
+BrassNumericColumnValueList::get_value_as_double() const
+{
+    Assert(!at_end());
+    return column->get_value(did);
+}
+
+bool
+BrassNumericColumnValueList::stores_doubles() const
+{
+    return true;
+}
+
+bool
+BrassNumericColumnValueList::get_value_upper_bounds(Xapian::docid target,
+						    Xapian::docid & block_end,
+						    double & block_max,
+						    double & rest_max) const
+{
+    column->get_upper_bounds(target, block_end, block_max, rest_max);
+    return true;
+}
+
+bool
+BrassNumericColumnValueList::at_end() const
+{
+    return did > column->get_last_docid();
+}
+
+void
+BrassNumericColumnValueList::next()
+{
+    Assert(!at_end());
+    move_to(did + 1);
+}
+
+void
+BrassNumericColumnValueList::skip_to(Xapian::docid target)
+{
+    if (target > did) move_to(target);
+}
+
+bool
+BrassNumericColumnValueList::check(Xapian::docid target)
+{
+    // A failed check() leaves did on a document without a value, so we
+    // can't just assume we're on a valid entry if target == did.
+    if (target < did) return true;
+    if (target > column->get_last_docid()) {
+	did = target;
+	return true;
+    }
+    // If there's no value for target, we leave did there so that next()
+    // moves to the first document after it with a value.
+    did = target;
+    return column->has_value(target);
+}
+
+string
+BrassNumericColumnValueList::get_description() const
+{
+    string desc("BrassNumericColumnValueList(slot=");
+    desc += om_tostring(column->get_slot());
+    desc += ')';
+    return desc;
+}
@@ -0,0 +1,185 @@
+/** @file brass_numericcolumn.h
+ * @brief Fixed-width numeric columns of values for read-only brass databases.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_NUMERICCOLUMN_H
+#define XAPIAN_INCLUDED_BRASS_NUMERICCOLUMN_H
+
+#include "brass_types.h"
+#include "valuelist.h"
+
+#include <xapian/base.h>
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+#include <string>
+#include <vector>
+
+class BrassTable;
+
+/** The values in a slot of a brass database, decoded to doubles.
+ *
+ *  This is stored in the file "column<slot>" in the database directory,
+ *  which xapian-compact writes if asked to for slots whose values are all
+ *  numbers encoded by Xapian::sortable_serialise().  It holds a bitmap of
+ *  the documents which have a value in the slot, followed by each value as
+ *  an 8 byte IEEE double, most significant byte first.
+ *
+ *  A read-only BrassDatabase loads the file into an array indexed by docid
+ *  the first time the slot's values are iterated, if it was written for the
+ *  database and revision being opened, and then iterates the array instead of the value
+ *  chunks.  This means the values don't need to be decoded by
+ *  sortable_unserialise() - see ValueList::get_value_as_double().
+ *
+ *  When it's loaded, the maximum value in each block of BLOCK_SIZE documents
+ *  is calculated, so that ValueWeightPostingSource can skip blocks which
+ *  can't reach the weight the matcher needs.
+ */
+class BrassNumericColumn : public Xapian::Internal::RefCntBase {
+    /// Don't allow assignment.
+    void operator=(const BrassNumericColumn &);
+
+    /// Don't allow copying.
+    BrassNumericColumn(const BrassNumericColumn &);
+
+    /// The value slot.
+    Xapian::valueno slot;
+
+    /// The values, indexed by docid - 1.
+    std::vector<double> values;
+
+    /// Which documents have a value, indexed by docid - 1.
+    std::vector<bool> present;
+
+    /** The maximum value in each block of BLOCK_SIZE documents.
+     *
+     *  Blocks without any values have -HUGE_VAL.
+     */
+    std::vector<double> block_max;
+
+    /// The maximum value in each block and all the blocks after it.
+    std::vector<double> rest_max;
+
+    /// Calculate block_max and rest_max from the values.
+    void calc_block_maxima();
+
+    /// Private constructor - use open() to load a column.
+    explicit BrassNumericColumn(Xapian::valueno slot_) : slot(slot_) { }
+
+  public:
+    /// The number of documents in each block we keep the maximum value for.
+    static const Xapian::docid BLOCK_SIZE = 128;
+
+    /** Load the column for a value slot.
+     *
+     *  @param db_dir	The database directory.
+     *  @param slot	The value slot.
+     *  @param revision	The revision of the database which is open.
+     *  @param uuid	The UUID of the database which is open.
+     *
+     *  @return The column, or NULL if there isn't one for @a uuid and
+     *		@a revision.
+     */
+    static BrassNumericColumn * open(const std::string & db_dir,
+				     Xapian::valueno slot,
+				     brass_revision_number_t revision,
+				     const std::string & uuid);
+
+    /** Write a column of the values in a slot.
+     *
+     *  The column is tagged with @a uuid and the revision the table is open
+     *  at.  This is exported for xapian-compact.
+     *
+     *  @param db_dir		The database directory.
+     *  @param postlist_table	The postlist table to read the values from.
+     *  @param slot		The value slot.
+     *  @param uuid		The UUID of the database.
+     *
+     *  @exception Xapian::InvalidArgumentError is thrown if a value in the
+     *		   slot isn't a number encoded by sortable_serialise().
+     */
+    XAPIAN_VISIBILITY_DEFAULT
+    static void build(const std::string & db_dir,
+		      const BrassTable & postlist_table,
+		      Xapian::valueno slot, const std::string & uuid);
+
+    /// The value slot.
+    Xapian::valueno get_slot() const { return slot; }
+
+    /// The highest docid the column covers.
+    Xapian::docid get_last_docid() const { return values.size(); }
+
+    /// Return true if document @a did has a value in the slot.
+    bool has_value(Xapian::docid did) const {
+	return did - 1 < present.size() && present[did - 1];
+    }
+
+    /// Return the value for document @a did, which must have one.
+    double get_value(Xapian::docid did) const { return values[did - 1]; }
+
+    /// Get upper bounds on the values - see ValueList::get_value_upper_bounds().
+    void get_upper_bounds(Xapian::docid did, Xapian::docid & block_end,
+			  double & block_max_out, double & rest_max_out) const;
+};
+
+/// Iterate the values in a BrassNumericColumn.
+class BrassNumericColumnValueList : public ValueList {
+    /// Don't allow assignment.
+    void operator=(const BrassNumericColumnValueList &);
+
+    /// Don't allow copying.
+    BrassNumericColumnValueList(const BrassNumericColumnValueList &);
+
+    /// Keep a reference to the column to stop it being deleted.
+    Xapian::Internal::RefCntPtr<const BrassNumericColumn> column;
+
+    /// The current docid (0 before we start, and past the end at the end).
+    Xapian::docid did;
+
+    /// Move to the first document with a value at or after @a target.
+    void move_to(Xapian::docid target);
+
+  public:
+    explicit BrassNumericColumnValueList(
+	    Xapian::Internal::RefCntPtr<const BrassNumericColumn> column_)
+	: column(column_), did(0) { }
+
+    Xapian::docid get_docid() const;
+
+    Xapian::valueno get_valueno() const;
+
+    std::string get_value() const;
+
+    double get_value_as_double() const;
+
+    bool stores_doubles() const;
+
+    bool get_value_upper_bounds(Xapian::docid did, Xapian::docid & block_end,
+				double & block_max, double & rest_max) const;
+
+    bool at_end() const;
+
+    void next();
+
+    void skip_to(Xapian::docid);
+
+    bool check(Xapian::docid did);
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_NUMERICCOLUMN_H
@@ -31,6 +31,8 @@
 #include "pack.h"
 #include "utils.h"
 
+#include <algorithm>
+
 Xapian::doccount
 BrassPostListTable::get_termfreq(const string & term) const
 {
@@ -82,6 +84,21 @@ BrassPostListTable::document_exists(Xapian::docid did,
     return (doclen_pl->jump_to(did));
 }
 
+bool
+BrassPostListTable::open(brass_revision_number_t revno)
+{
+    doclen_pl.reset(0);
+    doclen_codes = NULL;
+    if (!BrassTable::open(revno)) return false;
+    string tag;
+    if (get_exact_entry(make_doclen_codes_key(), tag)) {
+	AutoPtr<BrassDocLengthQuantiser> codes(new BrassDocLengthQuantiser);
+	codes->unserialise(tag);
+	doclen_codes = codes.release();
+    }
+    return true;
+}
+
 // How big should chunks in the posting list be?  (They
 // will grow slightly bigger than this, but not more than a
 // few bytes extra) - FIXME: tune this value to try to
@@ -100,11 +117,16 @@ class Brass::PostlistChunkWriter {
 	PostlistChunkWriter(const string &orig_key_,
 			    bool is_first_chunk_,
 			    const string &tname_,
-			    bool is_last_chunk_);
+			    bool is_last_chunk_,
+			    bool has_codes_);
 
-	/// Append an entry to this chunk.
+	/** Append an entry to this chunk.
+	 *
+	 *  @param code	The quantised document length, which is only stored
+	 *		if the chunk has them.
+	 */
 	void append(BrassTable * table, Xapian::docid did,
-		    Xapian::termcount wdf);
+		    Xapian::termcount wdf, unsigned char code);
 
 	/// Append a block of raw entries to this chunk.
 	void raw_append(Xapian::docid first_did_, Xapian::docid current_did_,
@@ -129,6 +151,7 @@ class Brass::PostlistChunkWriter {
 	string tname;
 	bool is_first_chunk;
 	bool is_last_chunk;
+	bool has_codes;
 	bool started;
 
 	Xapian::docid first_did;
@@ -229,6 +252,15 @@ read_wdf(const char ** posptr, const char * end, Xapian::termcount * wdf_ptr)
     if (!unpack_uint(posptr, end, wdf_ptr)) report_read_error(*posptr);
 }
 
+/// Read the quantised document length for an entry.
+static inline void
+read_doclen_code(const char ** posptr, const char * end,
+		 unsigned char * code_ptr)
+{
+    if (*posptr == end) report_read_error(0);
+    *code_ptr = static_cast<unsigned char>(*(*posptr)++);
+}
+
 /// Read the start of a chunk.
 static Xapian::docid
 read_start_of_chunk(const char ** posptr,
@@ -269,19 +301,31 @@ class Brass::PostlistChunkReader {
 
     bool at_end;
 
+    bool has_codes;
+
     Xapian::docid did;
     Xapian::termcount wdf;
+    unsigned char code;
+
+    /// Read the wdf (and document length code if any) for an entry.
+    void read_entry() {
+	read_wdf(&pos, end, &wdf);
+	if (has_codes) read_doclen_code(&pos, end, &code);
+    }
 
   public:
     /** Initialise the postlist chunk reader.
      *
      *  @param first_did  First document id in this chunk.
      *  @param data       The tag string with the header removed.
+     *  @param has_codes_ Does each entry have a quantised document length?
      */
-    PostlistChunkReader(Xapian::docid first_did, const string & data_)
-	: data(data_), pos(data.data()), end(pos + data.length()), at_end(data.empty()), did(first_did)
+    PostlistChunkReader(Xapian::docid first_did, const string & data_,
+			bool has_codes_)
+	: data(data_), pos(data.data()), end(pos + data.length()),
+	  at_end(data.empty()), has_codes(has_codes_), did(first_did), code(0)
     {
-	if (!at_end) read_wdf(&pos, end, &wdf);
+	if (!at_end) read_entry();
     }
 
     Xapian::docid get_docid() const {
@@ -290,6 +334,9 @@ class Brass::PostlistChunkReader {
     Xapian::termcount get_wdf() const {
 	return wdf;
     }
+    unsigned char get_doclen_code() const {
+	return code;
+    }
 
     bool is_at_end() const {
 	return at_end;
@@ -307,27 +354,28 @@ PostlistChunkReader::next()
 	at_end = true;
     } else {
 	read_did_increase(&pos, end, &did);
-	read_wdf(&pos, end, &wdf);
+	read_entry();
     }
 }
 
 PostlistChunkWriter::PostlistChunkWriter(const string &orig_key_,
 					 bool is_first_chunk_,
 					 const string &tname_,
-					 bool is_last_chunk_)
+					 bool is_last_chunk_,
+					 bool has_codes_)
 	: orig_key(orig_key_),
 	  tname(tname_), is_first_chunk(is_first_chunk_),
-	  is_last_chunk(is_last_chunk_),
+	  is_last_chunk(is_last_chunk_), has_codes(has_codes_),
 	  started(false)
 {
     DEBUGCALL(DB, void, "PostlistChunkWriter::PostlistChunkWriter",
 	      orig_key_ << ", " << is_first_chunk_ << ", " << tname_ << ", " <<
-	      is_last_chunk_);
+	      is_last_chunk_ << ", " << has_codes_);
 }
 
 void
 PostlistChunkWriter::append(BrassTable * table, Xapian::docid did,
-			    Xapian::termcount wdf)
+			    Xapian::termcount wdf, unsigned char code)
 {
     if (!started) {
 	started = true;
@@ -350,6 +398,7 @@ PostlistChunkWriter::append(BrassTable * table, Xapian::docid did,
     }
     current_did = did;
     pack_uint(chunk, wdf);
+    if (has_codes) chunk += char(code);
 }
 
 /** Make the data to go at the start of the very first chunk.
@@ -676,6 +725,10 @@ void BrassPostList::read_number_of_entries(const char ** posptr,
  *  The first chunk begins with the number of entries, the collection
  *  frequency, then the docid of the first document, then has the header of a
  *  standard chunk.
+ *
+ *  If the postlist table has a document length quantiser (which is stored
+ *  under the key make_doclen_codes_key()), each wdf in the postlist of a term
+ *  is followed by a byte holding the quantised length of the document.
  */
 BrassPostList::BrassPostList(Xapian::Internal::RefCntPtr<const BrassDatabase> this_db_,
 			     const string & term_,
@@ -684,6 +737,9 @@ BrassPostList::BrassPostList(Xapian::Internal::RefCntPtr<const BrassDatabase> th
 	  this_db(keep_reference ? this_db_ : NULL),
 	  have_started(false),
 	  cursor(this_db_->postlist_table.cursor_get()),
+	  doclen_codes(term_.empty() ? NULL :
+		       this_db_->postlist_table.get_doclen_codes()),
+	  doclen_code(0),
 	  is_at_end(false)
 {
     DEBUGCALL(DB, void, "BrassPostList::BrassPostList",
@@ -708,7 +764,7 @@ BrassPostList::BrassPostList(Xapian::Internal::RefCntPtr<const BrassDatabase> th
     first_did_in_chunk = did;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
-    read_wdf(&pos, end, &wdf);
+    read_entry();
     LOGLINE(DB, "Initial docid " << did);
 }
 
@@ -726,6 +782,28 @@ BrassPostList::get_doclength() const
     RETURN(this_db->get_doclength(did));
 }
 
+Xapian::termcount
+BrassPostList::get_approx_doclength() const
+{
+    DEBUGCALL(DB, Xapian::termcount, "BrassPostList::get_approx_doclength", "");
+    Assert(have_started);
+    if (doclen_codes.get() &&
+	doclen_code != BrassDocLengthQuantiser::LONG_CODE) {
+	RETURN(doclen_codes->decode(doclen_code));
+    }
+    // The document is longer than the codes stand for (it must have been
+    // added since they were set up), so we need to look up its length.
+    Assert(this_db.get());
+    RETURN(this_db->get_approx_doclength(did));
+}
+
+void
+BrassPostList::read_entry()
+{
+    read_wdf(&pos, end, &wdf);
+    if (doclen_codes.get()) read_doclen_code(&pos, end, &doclen_code);
+}
+
 bool
 BrassPostList::next_in_chunk()
 {
@@ -733,7 +811,7 @@ BrassPostList::next_in_chunk()
     if (pos == end) RETURN(false);
 
     read_did_increase(&pos, end, &did);
-    read_wdf(&pos, end, &wdf);
+    read_entry();
 
     // Either not at last doc in chunk, or pos == end, but not both.
     Assert(did <= last_did_in_chunk);
@@ -786,7 +864,7 @@ BrassPostList::next_chunk()
     first_did_in_chunk = did;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
-    read_wdf(&pos, end, &wdf);
+    read_entry();
 }
 
 PositionList *
@@ -880,7 +958,7 @@ BrassPostList::move_to_chunk_containing(Xapian::docid desired_did)
     first_did_in_chunk = did;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
-    read_wdf(&pos, end, &wdf);
+    read_entry();
 
     // Possible, since desired_did might be after end of this chunk and before
     // the next.
@@ -899,11 +977,12 @@ BrassPostList::move_forward_in_chunk_to_at_least(Xapian::docid desired_did)
 	while (pos != end) {
 	    read_did_increase(&pos, end, &did);
 	    if (did >= desired_did) {
-		read_wdf(&pos, end, &wdf);
+		read_entry();
 		RETURN(true);
 	    }
 	    // It's faster to just skip over the wdf than to decode it.
 	    read_wdf(&pos, end, NULL);
+	    if (doclen_codes.get()) read_doclen_code(&pos, end, &doclen_code);
 	}
 
 	// If we hit the end of the chunk then last_did_in_chunk must be wrong.
@@ -985,6 +1064,90 @@ BrassPostList::get_description() const
     return term + ":" + om_tostring(number_of_entries);
 }
 
+/** Look up document lengths in the doclength list of a BrassPostListTable.
+ *
+ *  The chunk a length is found in is kept, so looking up the lengths of
+ *  several documents in ascending docid order only reads each chunk once.
+ *  A new cursor is used to read each chunk, so the table can be modified
+ *  between lookups, except for the doclength list itself.
+ */
+class DocLengthReader {
+    /// Don't allow assignment.
+    void operator=(const DocLengthReader &);
+
+    /// Don't allow copying.
+    DocLengthReader(const DocLengthReader &);
+
+    /// The table to read the doclength list from.
+    const BrassPostListTable & table;
+
+    /// The current chunk (NULL until we read one).
+    AutoPtr<PostlistChunkReader> reader;
+
+    /// The last docid which can be in the current chunk.
+    Xapian::docid last_did_in_chunk;
+
+    /// Read the chunk which document @a did would be in.
+    void read_chunk(Xapian::docid did);
+
+  public:
+    explicit DocLengthReader(const BrassPostListTable & table_)
+	: table(table_), last_did_in_chunk(0) { }
+
+    /** Return the length of document @a did.
+     *
+     *  @exception Xapian::DocNotFoundError if the document doesn't exist.
+     */
+    Xapian::termcount get(Xapian::docid did);
+};
+
+void
+DocLengthReader::read_chunk(Xapian::docid did)
+{
+    DEBUGCALL(DB, void, "DocLengthReader::read_chunk", did);
+    reader.reset(0);
+    AutoPtr<BrassCursor> cursor(table.cursor_get());
+    (void)cursor->find_entry(BrassPostListTable::make_key(string(), did));
+    const string & key = cursor->current_key;
+    if (key.size() < 2 || key[0] != '\0' || key[1] != '\xe0')
+	throw Xapian::DocNotFoundError("Document " + om_tostring(did) + " not found");
+
+    cursor->read_tag();
+    const char * pos = cursor->current_tag.data();
+    const char * end = pos + cursor->current_tag.size();
+    Xapian::docid first_did_in_chunk;
+    if (key.size() == 2) {
+	first_did_in_chunk = read_start_of_first_chunk(&pos, end, NULL, NULL);
+    } else {
+	const char * keypos = key.data() + 2;
+	if (!unpack_uint_preserving_sort(&keypos, key.data() + key.size(),
+					 &first_did_in_chunk)) {
+	    report_read_error(keypos);
+	}
+    }
+    bool is_last_chunk;
+    last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
+					    &is_last_chunk);
+    reader.reset(new PostlistChunkReader(first_did_in_chunk,
+					 string(pos, end - pos), false));
+}
+
+Xapian::termcount
+DocLengthReader::get(Xapian::docid did)
+{
+    DEBUGCALL(DB, Xapian::termcount, "DocLengthReader::get", did);
+    if (!reader.get() || did < reader->get_docid() ||
+	did > last_did_in_chunk) {
+	read_chunk(did);
+    }
+    while (!reader->is_at_end() && reader->get_docid() < did) {
+	reader->next();
+    }
+    if (reader->is_at_end() || reader->get_docid() != did)
+	throw Xapian::DocNotFoundError("Document " + om_tostring(did) + " not found");
+    RETURN(reader->get_wdf());
+}
+
 // Returns the last did to allow in this chunk.
 Xapian::docid
 BrassPostListTable::get_chunk(const string &tname,
@@ -1013,7 +1176,8 @@ BrassPostListTable::get_chunk(const string &tname,
 	    throw Xapian::DatabaseCorruptError("Attempted to delete or modify an entry in a non-existent posting list for " + tname);
 
 	*from = NULL;
-	*to = new PostlistChunkWriter(string(), true, tname, true);
+	*to = new PostlistChunkWriter(string(), true, tname, true,
+				      doclen_codes.get() && !tname.empty());
 	RETURN(Xapian::docid(-1));
     }
 
@@ -1021,6 +1185,7 @@ BrassPostListTable::get_chunk(const string &tname,
     // the data part of the chunk wholesale.
     bool is_first_chunk = (keypos == keyend);
     LOGVALUE(DB, is_first_chunk);
+    bool has_codes = doclen_codes.get() && !tname.empty();
 
     cursor->read_tag();
     const char * pos = cursor->current_tag.data();
@@ -1038,7 +1203,7 @@ BrassPostListTable::get_chunk(const string &tname,
     Xapian::docid last_did_in_chunk;
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk, &is_last_chunk);
     *to = new PostlistChunkWriter(cursor->current_key, is_first_chunk, tname,
-				  is_last_chunk);
+				  is_last_chunk, has_codes);
     if (did > last_did_in_chunk) {
 	// This is the shortcut.  Not very pretty, but I'll leave refactoring
 	// until I've a clearer picture of everything which needs to be done.
@@ -1047,7 +1212,8 @@ BrassPostListTable::get_chunk(const string &tname,
 	(*to)->raw_append(first_did_in_chunk, last_did_in_chunk,
 			  string(pos, end));
     } else {
-	*from = new PostlistChunkReader(first_did_in_chunk, string(pos, end));
+	*from = new PostlistChunkReader(first_did_in_chunk, string(pos, end),
+					has_codes);
     }
     if (is_last_chunk) RETURN(Xapian::docid(-1));
 
@@ -1110,7 +1276,7 @@ next_doclen_chunk:
 		if (copy_did == did) from->next();
 		break;
 	    }
-	    to->append(this, copy_did, from->get_wdf());
+	    to->append(this, copy_did, from->get_wdf(), 0);
 	    from->next();
 	}
 	if ((!from || from->is_at_end()) && did > max_did) {
@@ -1123,13 +1289,14 @@ next_doclen_chunk:
 
 	Xapian::termcount new_doclen = j->second;
 	if (new_doclen != static_cast<Xapian::termcount>(-1)) {
-	    to->append(this, did, new_doclen);
+	    to->append(this, did, new_doclen, 0);
 	}
     }
 
     if (from) {
 	while (!from->is_at_end()) {
-	    to->append(this, from->get_docid(), from->get_wdf());
+	    to->append(this, from->get_docid(), from->get_wdf(),
+		       from->get_doclen_code());
 	    from->next();
 	}
 	delete from;
@@ -1140,7 +1307,8 @@ next_doclen_chunk:
 
 void
 BrassPostListTable::merge_changes(const string &term,
-				  const Inverter::PostingChanges & changes)
+				  const Inverter::PostingChanges & changes,
+				  const map<Xapian::docid, Xapian::termcount> & doclens)
 {
     {
 	// Rewrite the first chunk of this posting list with the updated
@@ -1206,6 +1374,10 @@ BrassPostListTable::merge_changes(const string &term,
     j = changes.pl_changes.begin();
     Assert(j != changes.pl_changes.end()); // This case is caught above.
 
+    // The changes are in ascending docid order, so we can read the lengths
+    // of any documents which aren't in doclens in one pass.
+    DocLengthReader doclen_reader(*this);
+
     Xapian::docid max_did;
     PostlistChunkReader *from;
     PostlistChunkWriter *to;
@@ -1223,7 +1395,8 @@ next_chunk:
 		}
 		break;
 	    }
-	    to->append(this, copy_did, from->get_wdf());
+	    to->append(this, copy_did, from->get_wdf(),
+		       from->get_doclen_code());
 	    from->next();
 	}
 	if ((!from || from->is_at_end()) && did > max_did) {
@@ -1236,13 +1409,27 @@ next_chunk:
 
 	Xapian::termcount new_wdf = j->second;
 	if (new_wdf != Xapian::termcount(-1)) {
-	    to->append(this, did, new_wdf);
+	    unsigned char code = 0;
+	    if (doclen_codes.get()) {
+		// Use the new length if it hasn't been merged yet.
+		Xapian::termcount doclen;
+		map<Xapian::docid, Xapian::termcount>::const_iterator k;
+		k = doclens.find(did);
+		if (k != doclens.end() && k->second != Xapian::termcount(-1)) {
+		    doclen = k->second;
+		} else {
+		    doclen = doclen_reader.get(did);
+		}
+		code = doclen_codes->encode(doclen);
+	    }
+	    to->append(this, did, new_wdf, code);
 	}
     }
 
     if (from) {
 	while (!from->is_at_end()) {
-	    to->append(this, from->get_docid(), from->get_wdf());
+	    to->append(this, from->get_docid(), from->get_wdf(),
+		       from->get_doclen_code());
 	    from->next();
 	}
 	delete from;
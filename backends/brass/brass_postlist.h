@@ -26,6 +26,7 @@
 
 #include <xapian/database.h>
 
+#include "brass_doclencache.h"
 #include "brass_inverter.h"
 #include "brass_types.h"
 #include "brass_positionlist.h"
@@ -55,6 +56,13 @@ class BrassPostListTable : public BrassTable {
 	/// PostList for looking up document lengths.
 	mutable AutoPtr<BrassPostList> doclen_pl;
 
+	/** The quantiser for document lengths stored in the postlists.
+	 *
+	 *  NULL unless xapian-compact was asked to store a quantised document
+	 *  length with each posting.
+	 */
+	Xapian::Internal::RefCntPtr<const BrassDocLengthQuantiser> doclen_codes;
+
     public:
 	/** Create a new table object.
 	 *
@@ -70,16 +78,35 @@ class BrassPostListTable : public BrassTable {
 	 */
 	BrassPostListTable(const string & path_, bool readonly_)
 	    : BrassTable("postlist", path_ + "/postlist.", readonly_),
-	      doclen_pl()
+	      doclen_pl(), doclen_codes()
 	{ }
 
-	bool open(brass_revision_number_t revno) {
-	    doclen_pl.reset(0);
-	    return BrassTable::open(revno);
+	bool open(brass_revision_number_t revno);
+
+	/** The key the quantiser for document lengths in the postlists is
+	 *  stored under.
+	 */
+	static string make_doclen_codes_key() {
+	    return string("\0\xe8", 2);
 	}
 
-	/// Merge changes for a term.
-	void merge_changes(const string &term, const Inverter::PostingChanges & changes);
+	/** Return the quantiser for document lengths stored in the postlists.
+	 *
+	 *  @return NULL if the postlists don't store document lengths.
+	 */
+	const BrassDocLengthQuantiser * get_doclen_codes() const {
+	    return doclen_codes.get();
+	}
+
+	/** Merge changes for a term.
+	 *
+	 *  @param doclens	Document length changes which haven't been merged
+	 *			yet, which are used if the postlists store
+	 *			document lengths.
+	 */
+	void merge_changes(const string &term,
+			   const Inverter::PostingChanges & changes,
+			   const map<Xapian::docid, Xapian::termcount> & doclens);
 
 	/// Merge document length changes.
 	void merge_doclen_changes(const map<Xapian::docid, Xapian::termcount> & doclens);
@@ -164,6 +191,18 @@ class BrassPostList : public LeafPostList {
 	/// The wdf of the current document.
 	Xapian::termcount wdf;
 
+	/** The quantiser for the document lengths stored with each entry.
+	 *
+	 *  NULL if the entries don't have document lengths.
+	 */
+	Xapian::Internal::RefCntPtr<const BrassDocLengthQuantiser> doclen_codes;
+
+	/// The quantised length of the current document, if doclen_codes.
+	unsigned char doclen_code;
+
+	/// Read the wdf (and document length code if any) for an entry.
+	void read_entry();
+
 	/// Whether we've run off the end of the list yet.
 	bool is_at_end;
 
@@ -248,6 +287,14 @@ class BrassPostList : public LeafPostList {
 	/// Returns the length of current document.
 	Xapian::termcount get_doclength() const;
 
+	/** Returns an upper bound on the length of current document.
+	 *
+	 *  If the postlist stores quantised document lengths, this decodes
+	 *  the current one, which saves looking up the length for weighting
+	 *  schemes which only need an approximation.
+	 */
+	Xapian::termcount get_approx_doclength() const;
+
 	/** Returns the Within Document Frequency of the term in the current
 	 *  document.
 	 */
@@ -23,11 +23,14 @@
 #include <xapian/error.h>
 #include <xapian/types.h>
 
+#include "autoptr.h"
 #include "expandweight.h"
+#include "brass_cursor.h"
 #include "brass_spelling.h"
 #include "omassert.h"
 #include "ortermlist.h"
 #include "pack.h"
+#include "vectortermlist.h"
 
 #include <algorithm>
 #include <map>
@@ -500,6 +503,167 @@ BrassSpellingTable::get_word_frequency(const string & word) const
 
 ///////////////////////////////////////////////////////////////////////////
 
+/** Add the strings formed by deleting up to @a n characters from @a word.
+ *
+ *  Characters are deleted whole, rather than byte by byte, so that the
+ *  variants are valid UTF-8 and the edit distances match those which
+ *  Database::get_spelling_suggestion() calculates.  @a word itself is
+ *  included, but the empty string isn't as it would link every short word
+ *  to every other.
+ */
+static void
+add_deletion_variants(const string & word, unsigned n, set<string> & variants)
+{
+    // A variant with a particular length is always reached after the same
+    // number of deletions, so if we've already seen it, we've also already
+    // added all its variants.
+    if (word.empty() || !variants.insert(word).second || n == 0) return;
+
+    string variant;
+    size_t i = 0;
+    while (i != word.size()) {
+	// Find the end of the UTF-8 character starting at i.
+	size_t j = i + 1;
+	while (j != word.size() && (byte(word[j]) & 0xc0) == 0x80) ++j;
+	variant.assign(word, 0, i);
+	variant.append(word, j, string::npos);
+	add_deletion_variants(variant, n - 1, variants);
+	i = j;
+    }
+}
+
+/// Add the pending deletion variant lists to @a index.
+static void
+flush_deletion_variants(BrassTable & index,
+			map<string, vector<string> > & pending)
+{
+    map<string, vector<string> >::const_iterator i;
+    for (i = pending.begin(); i != pending.end(); ++i) {
+	string key("D", 1);
+	key += i->first;
+	string updated;
+	PrefixCompressedStringWriter out(updated);
+	string current;
+	if (index.get_exact_entry(key, current)) {
+	    // The words are added in sorted order, so any already listed come
+	    // before those in this batch.
+	    for (PrefixCompressedStringItor in(current); !in.at_end(); ++in) {
+		out.append(*in);
+	    }
+	}
+	vector<string>::const_iterator w;
+	for (w = i->second.begin(); w != i->second.end(); ++w) {
+	    out.append(*w);
+	}
+	index.add(key, updated);
+    }
+    pending.clear();
+}
+
+bool
+BrassSpellingIndex::open(brass_revision_number_t revision, const string & uuid)
+{
+    max_distance = 0;
+    if (!exists() || !BrassTable::open(revision)) return false;
+
+    string tag;
+    const char * p;
+    const char * end;
+    string index_uuid;
+    unsigned index_max_distance;
+    if (!get_exact_entry(string("I", 1), tag) ||
+	(p = tag.data(), end = p + tag.size(),
+	 !unpack_string(&p, end, index_uuid)) ||
+	!unpack_uint_last(&p, end, &index_max_distance) ||
+	index_max_distance == 0) {
+	throw Xapian::DatabaseCorruptError("Bad spelling index header");
+    }
+    // An index for a different database (e.g. one which was compacted into
+    // the same directory) may have a matching revision, but is out of date.
+    if (index_uuid != uuid) {
+	close();
+	return false;
+    }
+    max_distance = index_max_distance;
+    return true;
+}
+
+void
+BrassSpellingIndex::build(const string & db_dir,
+			  const BrassTable & spelling_table,
+			  unsigned max_distance_, unsigned block_size,
+			  const string & uuid)
+{
+    Assert(max_distance_ > 0);
+    BrassSpellingIndex index(db_dir, false);
+    index.create_and_open(block_size);
+
+    string tag;
+    pack_string(tag, uuid);
+    pack_uint_last(tag, max_distance_);
+    index.add(string("I", 1), tag);
+
+    AutoPtr<BrassCursor> cursor(spelling_table.cursor_get());
+    if (cursor.get()) {
+	// Build up the lists in memory, but write them out periodically so
+	// that a large word list doesn't need a huge amount of memory.
+	const size_t FLUSH_THRESHOLD = 1000000;
+	map<string, vector<string> > pending;
+	size_t pending_count = 0;
+	set<string> variants;
+	cursor->find_entry_ge(string("W", 1));
+	while (!cursor->after_end()) {
+	    const string & key = cursor->current_key;
+	    if (key.empty() || key[0] != 'W') break;
+	    string word(key, 1);
+	    variants.clear();
+	    add_deletion_variants(word, max_distance_, variants);
+	    set<string>::const_iterator v;
+	    for (v = variants.begin(); v != variants.end(); ++v) {
+		pending[*v].push_back(word);
+	    }
+	    pending_count += variants.size();
+	    if (pending_count >= FLUSH_THRESHOLD) {
+		flush_deletion_variants(index, pending);
+		pending_count = 0;
+	    }
+	    cursor->next();
+	}
+	flush_deletion_variants(index, pending);
+    }
+
+    index.flush_db();
+    index.commit(spelling_table.get_open_revision_number());
+}
+
+TermList *
+BrassSpellingIndex::open_termlist(const string & word,
+				  unsigned max_edit_distance) const
+{
+    if (max_edit_distance > max_distance) return NULL;
+
+    set<string> variants;
+    add_deletion_variants(word, max_edit_distance, variants);
+
+    set<string> candidates;
+    string key("D", 1);
+    string tag;
+    set<string>::const_iterator v;
+    for (v = variants.begin(); v != variants.end(); ++v) {
+	key.resize(1);
+	key += *v;
+	if (!get_exact_entry(key, tag)) continue;
+	for (PrefixCompressedStringItor i(tag); !i.at_end(); ++i) {
+	    candidates.insert(*i);
+	}
+    }
+
+    vector<string> terms(candidates.begin(), candidates.end());
+    return new VectorTermList(terms.begin(), terms.end());
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 Xapian::termcount
 BrassSpellingTermList::get_approx_size() const
 {
@@ -22,6 +22,7 @@
 #define XAPIAN_INCLUDED_BRASS_SPELLING_H
 
 #include <xapian/types.h>
+#include <xapian/visibility.h>
 
 #include "brass_lazytable.h"
 #include "termlist.h"
@@ -112,6 +113,76 @@ class BrassSpellingTable : public BrassLazyTable {
     // @}
 };
 
+/** An index of the spelling words by their symmetric deletion variants.
+ *
+ *  For each word in the spelling table, every string which can be formed
+ *  by deleting up to get_max_distance() characters from it is used as a key
+ *  (prefixed with 'D'), with the tag listing the words which produce that
+ *  variant.  Any two words within that edit distance of each other share a
+ *  variant, so the candidate corrections for a word are exactly the words
+ *  listed under its own deletion variants, which needs no scoring or
+ *  threshold like the trigram lists in BrassSpellingTable.
+ *
+ *  The index is written by xapian-compact if asked to, and committed at
+ *  the same revision as the other tables.  A read-only BrassDatabase only
+ *  uses it if it can be opened at the revision of the database and was
+ *  built for the same database, so once the database is modified (or
+ *  another database is compacted into the same directory) it is ignored.
+ */
+class XAPIAN_VISIBILITY_DEFAULT BrassSpellingIndex : public BrassTable {
+    /// The maximum edit distance the index covers, or 0 if not open.
+    unsigned max_distance;
+
+  public:
+    /** Create a new BrassSpellingIndex object.
+     *
+     *  @param dbdir		The directory the brass database is stored in.
+     *  @param readonly		true if we're opening read-only, else false.
+     */
+    BrassSpellingIndex(const std::string & dbdir, bool readonly)
+	: BrassTable("spelldel", dbdir + "/spelldel.", readonly,
+		     Z_DEFAULT_STRATEGY),
+	  max_distance(0) { }
+
+    /** Open the index at @a revision.
+     *
+     *  @param revision	The revision of the database which is open.
+     *  @param uuid	The UUID of the database which is open.
+     *
+     *  @return false if the index doesn't exist, isn't available at
+     *		@a revision, or was built for a different database.
+     */
+    bool open(brass_revision_number_t revision, const std::string & uuid);
+
+    /** Build an index of the words in a spelling table.
+     *
+     *  The index is committed at the revision the spelling table is open
+     *  at, and tagged with the database's UUID.
+     *
+     *  @param db_dir		The database directory.
+     *  @param spelling_table	The spelling table to read the words from.
+     *  @param max_distance_	The maximum edit distance to index for.
+     *  @param block_size	The block size to use for the index table.
+     *  @param uuid		The UUID of the database.
+     */
+    static void build(const std::string & db_dir,
+		      const BrassTable & spelling_table,
+		      unsigned max_distance_, unsigned block_size,
+		      const std::string & uuid);
+
+    /// Return the maximum edit distance the index covers.
+    unsigned get_max_distance() const { return max_distance; }
+
+    /** Return the candidate corrections for @a word.
+     *
+     *  @return A termlist of the words within @a max_edit_distance deletion
+     *		variants of @a word, or NULL if @a max_edit_distance is
+     *		greater than the index covers.
+     */
+    TermList * open_termlist(const std::string & word,
+			     unsigned max_edit_distance) const;
+};
+
 /** The list of words containing a particular trigram. */
 class BrassSpellingTermList : public TermList {
     /// The encoded data.
@@ -22,6 +22,7 @@
 
 #include <xapian/error.h>
 
+#include "autoptr.h"
 #include "brass_cursor.h"
 #include "brass_synonym.h"
 #include "stringutils.h"
@@ -38,6 +39,23 @@ using namespace std;
 // that zlib should do a better job of compressing tag values.
 #define MAGIC_XOR_VALUE 96
 
+/// Decode the list of synonyms in @a tag, appending them to @a synonyms.
+static void
+decode_synonyms(const string & tag, vector<string> & synonyms)
+{
+    const char * p = tag.data();
+    const char * end = p + tag.size();
+    while (p != end) {
+	size_t len;
+	if (p == end ||
+	    (len = byte(*p) ^ MAGIC_XOR_VALUE) >= size_t(end - p))
+	    throw Xapian::DatabaseCorruptError("Bad synonym data");
+	++p;
+	synonyms.push_back(string(p, len));
+	p += len;
+    }
+}
+
 void
 BrassSynonymTable::merge_changes()
 {
@@ -146,17 +164,7 @@ BrassSynonymTable::open_termlist(const string & term)
 	string tag;
 	if (!get_exact_entry(term, tag)) return NULL;
 
-	const char * p = tag.data();
-	const char * end = p + tag.size();
-	while (p != end) {
-	    size_t len;
-	    if (p == end ||
-		(len = byte(*p) ^ MAGIC_XOR_VALUE) >= size_t(end - p))
-		throw Xapian::DatabaseCorruptError("Bad synonym data");
-	    ++p;
-	    synonyms.push_back(string(p, len));
-	    p += len;
-	}
+	decode_synonyms(tag, synonyms);
     }
 
     return new VectorTermList(synonyms.begin(), synonyms.end());
@@ -164,6 +172,115 @@ BrassSynonymTable::open_termlist(const string & term)
 
 ///////////////////////////////////////////////////////////////////////////
 
+BrassSynonymCache *
+BrassSynonymCache::load(const BrassTable & table)
+{
+    DEBUGCALL_STATIC(DB, BrassSynonymCache *, "BrassSynonymCache::load",
+		     "[table]");
+    AutoPtr<BrassSynonymCache> cache(new BrassSynonymCache);
+    AutoPtr<BrassCursor> cursor(table.cursor_get());
+    // The table is lazy, so may not exist.
+    if (cursor.get()) {
+	cursor->find_entry(string());
+	while (cursor->next()) {
+	    cursor->read_tag();
+	    decode_synonyms(cursor->current_tag,
+			    cache->synonyms[cursor->current_key]);
+	}
+    }
+    RETURN(cache.release());
+}
+
+TermList *
+BrassSynonymCache::open_termlist(const string & term) const
+{
+    synonym_map::const_iterator i = synonyms.find(term);
+    if (i == synonyms.end()) return NULL;
+    return new VectorTermList(i->second.begin(), i->second.end());
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+BrassSynonymCacheTermList::BrassSynonymCacheTermList(
+	Xapian::Internal::RefCntPtr<const BrassSynonymCache> cache_,
+	const string & prefix_)
+    : cache(cache_), prefix(prefix_), started(false)
+{
+    const BrassSynonymCache::synonym_map & synonyms = cache->synonyms;
+    it = synonyms.lower_bound(prefix);
+    // The terms with the prefix are followed by those which are at least the
+    // prefix with any trailing '\xff' bytes removed and the last remaining
+    // byte incremented.  If every byte is '\xff' (or there's no prefix),
+    // they run to the end.
+    string::size_type n = prefix.find_last_not_of('\xff');
+    if (n == string::npos) {
+	end = synonyms.end();
+    } else {
+	string prefix_end(prefix, 0, n + 1);
+	prefix_end[n] = char(static_cast<unsigned char>(prefix_end[n]) + 1);
+	end = synonyms.lower_bound(prefix_end);
+    }
+}
+
+string
+BrassSynonymCacheTermList::get_termname() const
+{
+    DEBUGCALL(DB, string, "BrassSynonymCacheTermList::get_termname", "");
+    Assert(started);
+    Assert(!at_end());
+    RETURN(it->first);
+}
+
+Xapian::doccount
+BrassSynonymCacheTermList::get_termfreq() const
+{
+    throw Xapian::InvalidOperationError("BrassSynonymCacheTermList::get_termfreq() not meaningful");
+}
+
+Xapian::termcount
+BrassSynonymCacheTermList::get_collection_freq() const
+{
+    throw Xapian::InvalidOperationError("BrassSynonymCacheTermList::get_collection_freq() not meaningful");
+}
+
+TermList *
+BrassSynonymCacheTermList::next()
+{
+    DEBUGCALL(DB, TermList *, "BrassSynonymCacheTermList::next", "");
+    Assert(!at_end());
+    if (started) {
+	++it;
+    } else {
+	started = true;
+    }
+    RETURN(NULL);
+}
+
+TermList *
+BrassSynonymCacheTermList::skip_to(const string &tname)
+{
+    DEBUGCALL(DB, TermList *, "BrassSynonymCacheTermList::skip_to", tname);
+    Assert(!at_end());
+    started = true;
+    if (it == end || !(it->first < tname)) RETURN(NULL);
+    if (end != cache->synonyms.end() && !(tname < end->first)) {
+	// All the terms with the prefix are before tname.
+	it = end;
+    } else {
+	it = cache->synonyms.lower_bound(tname);
+    }
+    RETURN(NULL);
+}
+
+bool
+BrassSynonymCacheTermList::at_end() const
+{
+    DEBUGCALL(DB, bool, "BrassSynonymCacheTermList::at_end", "");
+    RETURN(started && it == end);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 BrassSynonymTermList::~BrassSynonymTermList()
 {
     DEBUGCALL(DB, void, "~BrassSynonymTermList", "");
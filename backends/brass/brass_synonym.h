@@ -29,8 +29,10 @@
 #include "omdebug.h"
 #include "termlist.h"
 
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 class BrassSynonymTable : public BrassLazyTable {
     /// The last term which was updated.
@@ -109,6 +111,42 @@ class BrassSynonymTable : public BrassLazyTable {
     // @}
 };
 
+/** An immutable in-memory copy of a synonym table.
+ *
+ *  If the environment variable XAPIAN_CACHE_SYNONYMS is set to a non-zero
+ *  value, a read-only BrassDatabase loads its synonym table into one of
+ *  these (and loads it again if reopen() moves to a new revision) so that
+ *  synonym lookups don't need to read the table.
+ */
+class BrassSynonymCache : public Xapian::Internal::RefCntBase {
+    /// Don't allow assignment.
+    void operator=(const BrassSynonymCache &);
+
+    /// Don't allow copying.
+    BrassSynonymCache(const BrassSynonymCache &);
+
+    /// Private constructor - use load() to create.
+    BrassSynonymCache() { }
+
+  public:
+    typedef std::map<std::string, std::vector<std::string> > synonym_map;
+
+    /// The synonyms for each term which has any.
+    synonym_map synonyms;
+
+    /** Load the contents of a synonym table.
+     *
+     *  @param table	The table to load, which should be open.
+     */
+    static BrassSynonymCache * load(const BrassTable & table);
+
+    /** Open synonym termlist for a term.
+     *
+     *  If @a term has no synonyms, NULL is returned.
+     */
+    TermList * open_termlist(const std::string & term) const;
+};
+
 class BrassCursor;
 
 class BrassSynonymTermList : public AllTermsList {
@@ -172,4 +210,44 @@ class BrassSynonymTermList : public AllTermsList {
     bool at_end() const;
 };
 
+/// Iterate the terms with synonyms in a BrassSynonymCache.
+class BrassSynonymCacheTermList : public AllTermsList {
+    /// Copying is not allowed.
+    BrassSynonymCacheTermList(const BrassSynonymCacheTermList &);
+
+    /// Assignment is not allowed.
+    void operator=(const BrassSynonymCacheTermList &);
+
+    /// Keep a reference to the cache to stop it being deleted.
+    Xapian::Internal::RefCntPtr<const BrassSynonymCache> cache;
+
+    /// The current position.
+    BrassSynonymCache::synonym_map::const_iterator it;
+
+    /// The end of the terms with the prefix.
+    BrassSynonymCache::synonym_map::const_iterator end;
+
+    /// The prefix to restrict the terms to.
+    string prefix;
+
+    /// Has next() or skip_to() been called yet?
+    bool started;
+
+  public:
+    BrassSynonymCacheTermList(Xapian::Internal::RefCntPtr<const BrassSynonymCache> cache_,
+			      const string & prefix_);
+
+    string get_termname() const;
+
+    Xapian::doccount get_termfreq() const;
+
+    Xapian::termcount get_collection_freq() const;
+
+    TermList * next();
+
+    TermList * skip_to(const string &tname);
+
+    bool at_end() const;
+};
+
 #endif // XAPIAN_INCLUDED_BRASS_SYNONYM_H
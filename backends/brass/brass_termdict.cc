@@ -0,0 +1,376 @@
+/** @file brass_termdict.cc
+ * @brief In-memory front-coded term dictionary for read-only brass databases.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "brass_termdict.h"
+
+#include "safeerrno.h"
+
+#include <xapian/error.h>
+
+#include "autoptr.h"
+#include "brass_cursor.h"
+#include "brass_io.h"
+#include "brass_postlist.h"
+#include "brass_table.h"
+#include "omassert.h"
+#include "omdebug.h"
+#include "pack.h"
+#include "stringutils.h"
+#include "utils.h"
+
+#ifdef __WIN32__
+# include "msvc_posix_wrapper.h"
+#endif
+
+#include <cstdio> // For rename().
+#include <cstring> // For memcmp().
+
+using namespace std;
+
+#define MAGIC_STRING "IAmBrassTermDict"
+
+#define MAGIC_LEN CONST_STRLEN(MAGIC_STRING)
+
+/// Append an entry for @a term to @a out, front-coded against @a prev.
+static void
+append_entry(string & out, const string & prev, const string & term,
+	     Xapian::doccount termfreq, Xapian::termcount collfreq)
+{
+    size_t reuse = common_prefix_length(prev, term);
+    pack_uint(out, reuse);
+    pack_uint(out, term.size() - reuse);
+    out.append(term, reuse, string::npos);
+    pack_uint(out, termfreq);
+    // The collection frequency is always at least the term frequency.
+    pack_uint(out, collfreq - termfreq);
+}
+
+BrassTermDictionary *
+BrassTermDictionary::open(const string & db_dir,
+			  brass_revision_number_t revision,
+			  const string & uuid)
+{
+    DEBUGCALL_STATIC(DB, BrassTermDictionary *, "BrassTermDictionary::open",
+		     db_dir << ", " << revision << ", " << uuid);
+    string filename = db_dir;
+    filename += "/termdict";
+    int fd = ::open(filename.c_str(), O_RDONLY|O_BINARY);
+    if (fd < 0) {
+	if (errno == ENOENT) RETURN(NULL);
+	string msg = filename;
+	msg += ": Failed to open term dictionary for reading";
+	throw Xapian::DatabaseOpeningError(msg, errno);
+    }
+
+    AutoPtr<BrassTermDictionary> dict;
+    Xapian::termcount num_entries;
+    try {
+	// Read and check the header first, so we don't read the rest of an out
+	// of date dictionary.  The UUID is stored as a string of 36
+	// characters, and the two packed numbers take at most 5 bytes each.
+	char buf[65536];
+	size_t n = brass_io_read(fd, buf, MAGIC_LEN + 1 + 36 + 10, 0);
+	const char * p = buf;
+	const char * end = p + n;
+	if (n < MAGIC_LEN || memcmp(p, MAGIC_STRING, MAGIC_LEN) != 0) {
+	    throw Xapian::DatabaseCorruptError(filename + ": Term dictionary doesn't contain the right magic string");
+	}
+	p += MAGIC_LEN;
+	string dict_uuid;
+	brass_revision_number_t dict_revision;
+	if (!unpack_string(&p, end, dict_uuid) ||
+	    !unpack_uint(&p, end, &dict_revision) ||
+	    !unpack_uint(&p, end, &num_entries)) {
+	    throw Xapian::DatabaseCorruptError(filename + ": Bad term dictionary header");
+	}
+
+	if (dict_uuid != uuid || dict_revision != revision) {
+	    // The dictionary is for a different database (e.g. one which was
+	    // compacted into the same directory) or revision, so is out of
+	    // date.
+	    (void)close(fd);
+	    RETURN(NULL);
+	}
+
+	dict.reset(new BrassTermDictionary);
+	dict->data.assign(p, end - p);
+	while ((n = brass_io_read(fd, buf, sizeof(buf), 0)) != 0) {
+	    dict->data.append(buf, n);
+	}
+    } catch (...) {
+	(void)close(fd);
+	throw;
+    }
+    (void)close(fd);
+
+    // Check every entry decodes, and note where each block starts.
+    dict->block_offsets.reserve(num_entries / BLOCK_SIZE + 1);
+    string term, prev;
+    Xapian::doccount termfreq;
+    Xapian::termcount collfreq;
+    const char * p = dict->begin();
+    const char * end = dict->end();
+    Xapian::termcount i = 0;
+    while (p != end) {
+	if (i % BLOCK_SIZE == 0) {
+	    dict->block_offsets.push_back(p - dict->begin());
+	    // Blocks must start with a term stored in full.
+	    if (*p != '\0') {
+		throw Xapian::DatabaseCorruptError(filename + ": Term dictionary block doesn't start with a full term");
+	    }
+	}
+	prev = term;
+	dict->read_entry(&p, term, termfreq, collfreq);
+	if (i != 0 && term <= prev) {
+	    throw Xapian::DatabaseCorruptError(filename + ": Term dictionary terms out of order");
+	}
+	++i;
+    }
+    if (i != num_entries) {
+	throw Xapian::DatabaseCorruptError(filename + ": Term dictionary has the wrong number of entries");
+    }
+
+    RETURN(dict.release());
+}
+
+void
+BrassTermDictionary::build(const string & db_dir,
+			   const BrassTable & postlist_table,
+			   const string & uuid)
+{
+    DEBUGCALL_STATIC(DB, void, "BrassTermDictionary::build", db_dir << ", " <<
+		     "[postlist_table], " << uuid);
+    string entries;
+    Xapian::termcount num_entries = 0;
+    string term, prev;
+
+    AutoPtr<BrassCursor> cursor(postlist_table.cursor_get());
+    Assert(cursor.get()); // The postlist table isn't optional.
+    // Skip the metainfo, doclen and value keys, which all sort before the
+    // first term.
+    cursor->find_entry_lt(string("\x00\xff", 2));
+    while (cursor->next()) {
+	const char * p = cursor->current_key.data();
+	const char * pend = p + cursor->current_key.size();
+	if (!unpack_string_preserving_sort(&p, pend, term)) {
+	    throw Xapian::DatabaseCorruptError("PostList table key has unexpected format");
+	}
+	// Skip continuation chunks.
+	if (p != pend) continue;
+
+	cursor->read_tag();
+	p = cursor->current_tag.data();
+	pend = p + cursor->current_tag.size();
+	Xapian::doccount termfreq;
+	Xapian::termcount collfreq;
+	BrassPostList::read_number_of_entries(&p, pend, &termfreq, &collfreq);
+
+	if (num_entries % BLOCK_SIZE == 0) prev.resize(0);
+	append_entry(entries, prev, term, termfreq, collfreq);
+	swap(prev, term);
+	++num_entries;
+    }
+
+    string header(MAGIC_STRING);
+    pack_string(header, uuid);
+    pack_uint(header, postlist_table.get_open_revision_number());
+    pack_uint(header, num_entries);
+
+    // Write to a temporary file and rename it into place, so a reader never
+    // sees a partial dictionary.
+    string filename = db_dir;
+    filename += "/termdict";
+    string tmp = filename;
+    tmp += ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+    if (fd < 0) {
+	throw Xapian::DatabaseError("Failed to create term dictionary: " + tmp,
+				    errno);
+    }
+    try {
+	brass_io_write(fd, header.data(), header.size());
+	brass_io_write(fd, entries.data(), entries.size());
+    } catch (...) {
+	(void)close(fd);
+	(void)unlink(tmp);
+	throw;
+    }
+    if (!brass_io_sync(fd) || close(fd) != 0) {
+	int saved_errno = errno;
+	(void)unlink(tmp);
+	throw Xapian::DatabaseError("Failed to write term dictionary: " + tmp,
+				    saved_errno);
+    }
+    if (rename(tmp.c_str(), filename.c_str()) < 0) {
+	int saved_errno = errno;
+	(void)unlink(tmp);
+	throw Xapian::DatabaseError("Failed to rename term dictionary into place",
+				    saved_errno);
+    }
+}
+
+void
+BrassTermDictionary::read_entry(const char ** p, string & term,
+				Xapian::doccount & termfreq,
+				Xapian::termcount & collfreq) const
+{
+    const char * e = end();
+    size_t reuse, len;
+    Xapian::termcount collfreq_delta;
+    if (!unpack_uint(p, e, &reuse) || reuse > term.size() ||
+	!unpack_uint(p, e, &len) || len > size_t(e - *p)) {
+	throw Xapian::DatabaseCorruptError("Bad term dictionary entry");
+    }
+    term.resize(reuse);
+    term.append(*p, len);
+    *p += len;
+    if (!unpack_uint(p, e, &termfreq) ||
+	!unpack_uint(p, e, &collfreq_delta)) {
+	throw Xapian::DatabaseCorruptError("Bad term dictionary entry");
+    }
+    collfreq = termfreq + collfreq_delta;
+}
+
+bool
+BrassTermDictionary::seek(const string & term, const char ** p,
+			  string & found, Xapian::doccount & termfreq,
+			  Xapian::termcount & collfreq) const
+{
+    if (block_offsets.empty()) return false;
+
+    // Binary search for the last block starting with a term <= term.  The
+    // first entry of each block is stored in full, so we can compare against
+    // it directly in the encoded data.
+    size_t lo = 0, hi = block_offsets.size();
+    while (hi - lo > 1) {
+	size_t mid = lo + (hi - lo) / 2;
+	const char * q = begin() + block_offsets[mid] + 1;
+	size_t len;
+	if (!unpack_uint(&q, end(), &len) || len > size_t(end() - q)) {
+	    throw Xapian::DatabaseCorruptError("Bad term dictionary entry");
+	}
+	if (term.compare(0, string::npos, q, len) < 0) {
+	    hi = mid;
+	} else {
+	    lo = mid;
+	}
+    }
+
+    // Scan forward through the block (and into the next one if term is
+    // after the last entry in this block).
+    *p = begin() + block_offsets[lo];
+    found.resize(0);
+    while (*p != end()) {
+	read_entry(p, found, termfreq, collfreq);
+	if (found >= term) return true;
+    }
+    found.resize(0);
+    return false;
+}
+
+bool
+BrassTermDictionary::lookup(const string & term, Xapian::doccount & termfreq,
+			    Xapian::termcount & collfreq) const
+{
+    const char * p;
+    string found;
+    return seek(term, &p, found, termfreq, collfreq) && found == term;
+}
+
+void
+BrassTermDictAllTermsList::check_prefix()
+{
+    if (!startswith(current_term, prefix)) {
+	// We've reached the end of the prefixed terms.
+	pos = dict->end();
+	current_term.resize(0);
+    }
+}
+
+string
+BrassTermDictAllTermsList::get_termname() const
+{
+    DEBUGCALL(DB, string, "BrassTermDictAllTermsList::get_termname", "");
+    Assert(pos);
+    Assert(!at_end());
+    RETURN(current_term);
+}
+
+Xapian::doccount
+BrassTermDictAllTermsList::get_termfreq() const
+{
+    DEBUGCALL(DB, Xapian::doccount, "BrassTermDictAllTermsList::get_termfreq", "");
+    Assert(pos);
+    Assert(!at_end());
+    RETURN(termfreq);
+}
+
+Xapian::termcount
+BrassTermDictAllTermsList::get_collection_freq() const
+{
+    DEBUGCALL(DB, Xapian::termcount, "BrassTermDictAllTermsList::get_collection_freq", "");
+    Assert(pos);
+    Assert(!at_end());
+    RETURN(collfreq);
+}
+
+TermList *
+BrassTermDictAllTermsList::next()
+{
+    DEBUGCALL(DB, TermList *, "BrassTermDictAllTermsList::next", "");
+    if (pos == NULL) {
+	// The first call positions us on the first term with the prefix.
+	if (!dict->seek(prefix, &pos, current_term, termfreq, collfreq)) {
+	    pos = dict->end();
+	    RETURN(NULL);
+	}
+    } else {
+	Assert(!at_end());
+	if (pos == dict->end()) {
+	    current_term.resize(0);
+	    RETURN(NULL);
+	}
+	dict->read_entry(&pos, current_term, termfreq, collfreq);
+    }
+    check_prefix();
+    RETURN(NULL);
+}
+
+TermList *
+BrassTermDictAllTermsList::skip_to(const string & term)
+{
+    DEBUGCALL(DB, TermList *, "BrassTermDictAllTermsList::skip_to", term);
+    if (pos && at_end()) RETURN(NULL);
+    if (pos && term <= current_term) RETURN(NULL);
+    const string & target = (term < prefix) ? prefix : term;
+    if (!dict->seek(target, &pos, current_term, termfreq, collfreq)) {
+	pos = dict->end();
+	RETURN(NULL);
+    }
+    check_prefix();
+    RETURN(NULL);
+}
+
+bool
+BrassTermDictAllTermsList::at_end() const
+{
+    DEBUGCALL(DB, bool, "BrassTermDictAllTermsList::at_end", "");
+    RETURN(current_term.empty());
+}
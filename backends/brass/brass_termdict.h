@@ -0,0 +1,190 @@
+/** @file brass_termdict.h
+ * @brief In-memory front-coded term dictionary for read-only brass databases.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_TERMDICT_H
+#define XAPIAN_INCLUDED_BRASS_TERMDICT_H
+
+#include "alltermslist.h"
+#include "brass_types.h"
+
+#include <xapian/base.h>
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+#include <string>
+#include <vector>
+
+class BrassTable;
+
+/** An immutable dictionary of the terms in a brass database.
+ *
+ *  This is stored in the file "termdict" in the database directory, which
+ *  xapian-compact writes if asked to.  It lists every term with its term
+ *  frequency and collection frequency in sorted order, front-coded in
+ *  blocks of BLOCK_SIZE entries (the first term in each block is stored in
+ *  full, and the rest as the length of the prefix shared with the previous
+ *  term plus the remaining suffix).
+ *
+ *  A read-only BrassDatabase loads the whole file into memory if it was
+ *  written for the database and revision being opened, and then uses it for term
+ *  lookups and iterating all terms instead of the postlist table.  Once
+ *  the database is modified, the revision no longer matches and the file
+ *  is ignored.
+ */
+class XAPIAN_VISIBILITY_DEFAULT BrassTermDictionary : public Xapian::Internal::RefCntBase {
+    /// Don't allow assignment.
+    void operator=(const BrassTermDictionary &);
+
+    /// Don't allow copying.
+    BrassTermDictionary(const BrassTermDictionary &);
+
+    /// The encoded entries.
+    std::string data;
+
+    /// The offset in data of the start of each block.
+    std::vector<size_t> block_offsets;
+
+    /// Private constructor - use open() to load a dictionary.
+    BrassTermDictionary() { }
+
+  public:
+    /// The number of entries in each front-coded block.
+    static const unsigned BLOCK_SIZE = 16;
+
+    /** Load the dictionary for a database.
+     *
+     *  @param db_dir	The database directory.
+     *  @param revision	The revision of the database which is open.
+     *  @param uuid	The UUID of the database which is open.
+     *
+     *  @return The dictionary, or NULL if there isn't one for @a revision
+     *		of this database.
+     */
+    static BrassTermDictionary * open(const std::string & db_dir,
+				      brass_revision_number_t revision,
+				      const std::string & uuid);
+
+    /** Write a dictionary of the terms in a postlist table.
+     *
+     *  The dictionary is tagged with the revision the table is open at,
+     *  and with the database's UUID.
+     *
+     *  @param db_dir		The database directory.
+     *  @param postlist_table	The postlist table to read the terms from.
+     *  @param uuid		The UUID of the database.
+     */
+    static void build(const std::string & db_dir,
+		      const BrassTable & postlist_table,
+		      const std::string & uuid);
+
+    /** Decode the entry at @a p.
+     *
+     *  @param p	The entry to decode.  Updated to point to the next
+     *			entry.
+     *  @param term	Holds the previous term in the block (which shares
+     *			a prefix with this one) and is updated to the term.
+     *  @param termfreq	Set to the term frequency.
+     *  @param collfreq	Set to the collection frequency.
+     */
+    void read_entry(const char ** p, std::string & term,
+		    Xapian::doccount & termfreq,
+		    Xapian::termcount & collfreq) const;
+
+    /** Find the first entry with a term >= @a term.
+     *
+     *  @param term	The term to look for.
+     *  @param p	Set to point to the entry after the one found.
+     *  @param found	Set to the term of the entry found.
+     *  @param termfreq	Set to the term frequency of the entry found.
+     *  @param collfreq	Set to the collection frequency of the entry found.
+     *
+     *  @return false if all the terms are < @a term.
+     */
+    bool seek(const std::string & term, const char ** p, std::string & found,
+	      Xapian::doccount & termfreq, Xapian::termcount & collfreq) const;
+
+    /** Look up the frequencies of a term.
+     *
+     *  @return false if @a term isn't in the dictionary.
+     */
+    bool lookup(const std::string & term, Xapian::doccount & termfreq,
+		Xapian::termcount & collfreq) const;
+
+    /// Return a pointer to the first entry.
+    const char * begin() const { return data.data(); }
+
+    /// Return a pointer to the end of the entries.
+    const char * end() const { return data.data() + data.size(); }
+};
+
+/** Iterate the terms in a BrassTermDictionary.
+ *
+ *  Used by BrassDatabase::open_allterms() when the database has a term
+ *  dictionary loaded.
+ */
+class BrassTermDictAllTermsList : public AllTermsList {
+    /// Don't allow copying.
+    BrassTermDictAllTermsList(const BrassTermDictAllTermsList &);
+
+    /// Don't allow assignment.
+    void operator=(const BrassTermDictAllTermsList &);
+
+    /// Keep a reference to the dictionary to stop it being deleted.
+    Xapian::Internal::RefCntPtr<const BrassTermDictionary> dict;
+
+    /// The prefix to restrict the terms to.
+    std::string prefix;
+
+    /** The entry after the current one.
+     *
+     *  NULL if next() or skip_to() hasn't been called yet.
+     */
+    const char * pos;
+
+    /// The current term, or empty if we're at the end.
+    std::string current_term;
+
+    /// The term frequency of the current term.
+    Xapian::doccount termfreq;
+
+    /// The collection frequency of the current term.
+    Xapian::termcount collfreq;
+
+    /// Move to the end if we've gone past the prefixed terms.
+    void check_prefix();
+
+  public:
+    BrassTermDictAllTermsList(
+	    Xapian::Internal::RefCntPtr<const BrassTermDictionary> dict_,
+	    const std::string & prefix_)
+	: dict(dict_), prefix(prefix_), pos(NULL), termfreq(0), collfreq(0) { }
+
+    std::string get_termname() const;
+
+    Xapian::doccount get_termfreq() const;
+
+    Xapian::termcount get_collection_freq() const;
+
+    TermList * next();
+
+    TermList * skip_to(const std::string & term);
+
+    bool at_end() const;
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_TERMDICT_H
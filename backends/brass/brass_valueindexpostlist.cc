@@ -0,0 +1,146 @@
+/** @file brass_valueindexpostlist.cc
+ * @brief Postlist of the documents with a value in a range, from a value index.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "brass_valueindexpostlist.h"
+
+#include "omassert.h"
+#include "omdebug.h"
+#include "utils.h"
+
+#include <algorithm>
+
+using namespace std;
+
+BrassValueIndexPostList::BrassValueIndexPostList(Xapian::valueno slot_,
+						 const string & begin_,
+						 const string & end_,
+						 Xapian::doccount db_size_,
+						 vector<Xapian::docid> & docids_)
+    : slot(slot_), begin(begin_), end(end_), db_size(db_size_),
+      started(false)
+{
+    swap(docids, docids_);
+    pos = docids.begin();
+}
+
+Xapian::doccount
+BrassValueIndexPostList::get_termfreq_min() const
+{
+    return docids.size();
+}
+
+Xapian::doccount
+BrassValueIndexPostList::get_termfreq_est() const
+{
+    return docids.size();
+}
+
+Xapian::doccount
+BrassValueIndexPostList::get_termfreq_max() const
+{
+    return docids.size();
+}
+
+TermFreqs
+BrassValueIndexPostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const
+{
+    LOGCALL(MATCH, TermFreqs,
+	    "BrassValueIndexPostList::get_termfreq_est_using_stats", stats);
+    if (db_size == 0) RETURN(TermFreqs());
+    // Assume the documents in range are spread evenly between databases and
+    // between relevant and non-relevant documents.
+    double ratio = double(docids.size()) / db_size;
+    RETURN(TermFreqs(Xapian::doccount(stats.collection_size * ratio + 0.5),
+		     Xapian::doccount(stats.rset_size * ratio + 0.5)));
+}
+
+Xapian::weight
+BrassValueIndexPostList::get_maxweight() const
+{
+    return 0;
+}
+
+Xapian::docid
+BrassValueIndexPostList::get_docid() const
+{
+    Assert(started);
+    Assert(!at_end());
+    return *pos;
+}
+
+Xapian::weight
+BrassValueIndexPostList::get_weight() const
+{
+    return 0;
+}
+
+Xapian::termcount
+BrassValueIndexPostList::get_doclength() const
+{
+    return 0;
+}
+
+Xapian::weight
+BrassValueIndexPostList::recalc_maxweight()
+{
+    return 0;
+}
+
+PostList *
+BrassValueIndexPostList::next(Xapian::weight)
+{
+    Assert(!at_end());
+    if (started) {
+	++pos;
+    } else {
+	started = true;
+    }
+    return NULL;
+}
+
+PostList *
+BrassValueIndexPostList::skip_to(Xapian::docid did, Xapian::weight)
+{
+    Assert(!at_end());
+    started = true;
+    vector<Xapian::docid>::const_iterator e = docids.end();
+    if (pos != e && *pos < did) pos = lower_bound(pos, e, did);
+    return NULL;
+}
+
+bool
+BrassValueIndexPostList::at_end() const
+{
+    return started && pos == docids.end();
+}
+
+string
+BrassValueIndexPostList::get_description() const
+{
+    string desc = "BrassValueIndexPostList(";
+    desc += om_tostring(slot);
+    desc += ", ";
+    desc += begin;
+    desc += ", ";
+    desc += end;
+    desc += ")";
+    return desc;
+}
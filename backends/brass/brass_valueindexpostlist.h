@@ -0,0 +1,97 @@
+/** @file brass_valueindexpostlist.h
+ * @brief Postlist of the documents with a value in a range, from a value index.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_VALUEINDEXPOSTLIST_H
+#define XAPIAN_INCLUDED_BRASS_VALUEINDEXPOSTLIST_H
+
+#include "postlist.h"
+
+#include <string>
+#include <vector>
+
+/** The documents with a value in a range, found using a value index.
+ *
+ *  The matching docids are all read from the index when the postlist is
+ *  created, so unlike ValueRangePostList the term frequency is exact.
+ */
+class BrassValueIndexPostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const BrassValueIndexPostList &);
+
+    /// Don't allow copying.
+    BrassValueIndexPostList(const BrassValueIndexPostList &);
+
+    /// The value slot.
+    Xapian::valueno slot;
+
+    /// The range (for get_description()).
+    std::string begin, end;
+
+    /// The number of documents in the database.
+    Xapian::doccount db_size;
+
+    /// The matching docids, in ascending order.
+    std::vector<Xapian::docid> docids;
+
+    /// The current position in docids.
+    std::vector<Xapian::docid>::const_iterator pos;
+
+    /// Has next() or skip_to() been called yet?
+    bool started;
+
+  public:
+    /** Construct.
+     *
+     *  @param docids_	The matching docids in ascending order, which are
+     *			swapped into the postlist.
+     */
+    BrassValueIndexPostList(Xapian::valueno slot_,
+			    const std::string & begin_,
+			    const std::string & end_,
+			    Xapian::doccount db_size_,
+			    std::vector<Xapian::docid> & docids_);
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const;
+
+    Xapian::weight get_maxweight() const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::weight get_weight() const;
+
+    Xapian::termcount get_doclength() const;
+
+    Xapian::weight recalc_maxweight();
+
+    PostList * next(Xapian::weight w_min);
+
+    PostList * skip_to(Xapian::docid did, Xapian::weight w_min);
+
+    bool at_end() const;
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_VALUEINDEXPOSTLIST_H
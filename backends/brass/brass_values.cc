@@ -29,6 +29,7 @@
 #include "document.h"
 #include "omdebug.h"
 #include "pack.h"
+#include "stringutils.h"
 
 #include "xapian/error.h"
 #include "xapian/valueiterator.h"
@@ -68,6 +69,44 @@ make_valuestats_key(Xapian::valueno slot)
     RETURN(key);
 }
 
+/** The most bytes of a value (once encoded) to store in a value index key.
+ *
+ *  Any more of the value is stored in the tag, which keeps the key within the
+ *  B-tree's limit on key length.
+ */
+static const size_t VALUEINDEX_MAX_PREFIX = 200;
+
+/// Return how much of @a value to store in a value index key.
+static size_t
+valueindex_prefix_length(const string & value)
+{
+    size_t encoded_len = 0;
+    for (size_t i = 0; i != value.size(); ++i) {
+	// Zero bytes get escaped, so take two bytes in the key.
+	encoded_len += (value[i] == '\0') ? 2 : 1;
+	if (encoded_len > VALUEINDEX_MAX_PREFIX) return i;
+    }
+    return value.size();
+}
+
+/** Generate the key and tag for an entry in a value index.
+ *
+ *  The key is the slot's value index key followed by the start of the value
+ *  and the docid, so entries sort by value and then docid (except that
+ *  entries whose values share the first VALUEINDEX_MAX_PREFIX bytes sort by
+ *  docid).  The tag is the rest of the value, which is usually empty.
+ */
+static void
+make_valueindex_entry(Xapian::valueno slot, const string & value,
+		      Xapian::docid did, string & key, string & tag)
+{
+    size_t len = valueindex_prefix_length(value);
+    key = make_valueindex_key(slot);
+    pack_string_preserving_sort(key, value.substr(0, len));
+    pack_uint_preserving_sort(key, did);
+    tag.assign(value, len, string::npos);
+}
+
 void
 ValueChunkReader::assign(const char * p_, size_t len, Xapian::docid did_)
 {
@@ -199,6 +238,9 @@ class ValueUpdater {
 
     Xapian::valueno slot;
 
+    /// Whether the slot has a value index to keep up to date.
+    bool indexed;
+
     string ctag;
 
     ValueChunkReader reader;
@@ -239,8 +281,10 @@ class ValueUpdater {
     }
 
   public:
-    ValueUpdater(BrassPostListTable * table_, Xapian::valueno slot_)
-       	: table(table_), slot(slot_), first_did(0), last_allowed_did(0) { }
+    ValueUpdater(BrassPostListTable * table_, Xapian::valueno slot_,
+		 bool indexed_)
+       	: table(table_), slot(slot_), indexed(indexed_), first_did(0),
+	  last_allowed_did(0) { }
 
     ~ValueUpdater() {
 	while (!reader.at_end()) {
@@ -311,10 +355,23 @@ class ValueUpdater {
 	    append_to_stream(reader.get_docid(), reader.get_value());
 	    reader.next();
 	}
-	if (!reader.at_end() && reader.get_docid() == did) reader.next();
+	string index_key, index_tag;
+	if (!reader.at_end() && reader.get_docid() == did) {
+	    if (indexed) {
+		// Remove the index entry for the old value.
+		make_valueindex_entry(slot, reader.get_value(), did,
+				      index_key, index_tag);
+		table->del(index_key);
+	    }
+	    reader.next();
+	}
 	if (!value.empty()) {
 	    // Add/update entry for did.
 	    append_to_stream(did, value);
+	    if (indexed) {
+		make_valueindex_entry(slot, value, did, index_key, index_tag);
+		table->add(index_key, index_tag);
+	    }
 	}
     }
 };
@@ -340,7 +397,7 @@ BrassValueManager::merge_changes()
 	map<Xapian::valueno, map<Xapian::docid, string> >::const_iterator i;
 	for (i = changes.begin(); i != changes.end(); ++i) {
 	    Xapian::valueno slot = i->first;
-	    ValueUpdater updater(postlist_table, slot);
+	    ValueUpdater updater(postlist_table, slot, has_value_index(slot));
 	    const map<Xapian::docid, string> & slot_changes = i->second;
 	    map<Xapian::docid, string>::const_iterator j;
 	    for (j = slot_changes.begin(); j != slot_changes.end(); ++j) {
@@ -482,6 +539,95 @@ BrassValueManager::get_value(Xapian::docid did, Xapian::valueno slot) const
     return reader.get_value();
 }
 
+bool
+BrassValueManager::has_value_index(Xapian::valueno slot) const
+{
+    map<Xapian::valueno, bool>::const_iterator i = indexed_slots.find(slot);
+    if (i != indexed_slots.end()) return i->second;
+    bool indexed = postlist_table->key_exists(make_valueindex_key(slot));
+    indexed_slots.insert(make_pair(slot, indexed));
+    return indexed;
+}
+
+void
+BrassValueManager::build_value_index(Xapian::valueno slot)
+{
+    DEBUGCALL(DB, void, "BrassValueManager::build_value_index", slot);
+    Assert(changes.find(slot) == changes.end());
+    string key, tag;
+    Xapian::docid did = 1;
+    while (true) {
+	// Adding entries may change the structure of the table, so we need a
+	// new cursor to find each chunk.
+	string chunk;
+	Xapian::docid first_did;
+	{
+	    AutoPtr<BrassCursor> cursor(postlist_table->cursor_get());
+	    cursor->find_entry_ge(make_valuechunk_key(slot, did));
+	    if (cursor->after_end()) break;
+	    first_did = docid_from_key(slot, cursor->current_key);
+	    if (!first_did) break;
+	    cursor->read_tag();
+	    swap(chunk, cursor->current_tag);
+	}
+
+	ValueChunkReader reader(chunk.data(), chunk.size(), first_did);
+	while (!reader.at_end()) {
+	    did = reader.get_docid();
+	    make_valueindex_entry(slot, reader.get_value(), did, key, tag);
+	    postlist_table->add(key, tag);
+	    reader.next();
+	}
+	if (did == MAX_DOCID) break;
+	++did;
+    }
+    postlist_table->add(make_valueindex_key(slot), string());
+    indexed_slots[slot] = true;
+}
+
+void
+BrassValueManager::get_value_index_docids(Xapian::valueno slot,
+					  const string & begin,
+					  const string & end,
+					  vector<Xapian::docid> & docids) const
+{
+    DEBUGCALL(DB, void, "BrassValueManager::get_value_index_docids",
+	      slot << ", " << begin << ", " << end << ", [docids]");
+    Assert(!begin.empty());
+    Assert(has_value_index(slot));
+    const string prefix = make_valueindex_key(slot);
+    AutoPtr<BrassCursor> cursor(postlist_table->cursor_get());
+    // The part of a value stored in the key is a prefix of it, and taking
+    // these prefixes preserves the order of values, so the first entry which
+    // can match is at or after the prefix of begin.
+    string key = prefix;
+    pack_string_preserving_sort(key,
+				begin.substr(0, valueindex_prefix_length(begin)));
+    cursor->find_entry_ge(key);
+
+    size_t first = docids.size();
+    string value;
+    while (!cursor->after_end() && startswith(cursor->current_key, prefix)) {
+	const char * p = cursor->current_key.data() + prefix.size();
+	const char * e = cursor->current_key.data() + cursor->current_key.size();
+	Xapian::docid did;
+	if (!unpack_string_preserving_sort(&p, e, value) ||
+	    !unpack_uint_preserving_sort(&p, e, &did) || p != e) {
+	    throw Xapian::DatabaseCorruptError("Bad value index key");
+	}
+	// Every value with this prefix is > end.
+	if (!end.empty() && value > end) break;
+	cursor->read_tag();
+	value += cursor->current_tag;
+	if (value >= begin && (end.empty() || value <= end))
+	    docids.push_back(did);
+	cursor->next();
+    }
+    // Entries whose values only differ after the part stored in the key are
+    // in docid order for each prefix, so we need to sort.
+    sort(docids.begin() + first, docids.end());
+}
+
 void
 BrassValueManager::get_all_values(map<Xapian::valueno, string> & values,
 				  Xapian::docid did) const
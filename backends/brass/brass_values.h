@@ -30,6 +30,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace Brass {
 
@@ -43,6 +44,18 @@ make_valuechunk_key(Xapian::valueno slot, Xapian::docid did)
     return key;
 }
 
+/** Generate the key which marks that a value slot has a value index.
+ *
+ *  The entries in the index have keys which start with this key.
+ */
+inline std::string
+make_valueindex_key(Xapian::valueno slot)
+{
+    std::string key("\0\xd4", 2);
+    pack_uint(key, slot);
+    return key;
+}
+
 inline Xapian::docid
 docid_from_key(Xapian::valueno required_slot, const std::string & key)
 {
@@ -90,6 +103,12 @@ class BrassValueManager {
 
     std::map<Xapian::valueno, std::map<Xapian::docid, std::string> > changes;
 
+    /** Cache of whether each slot we've looked at has a value index.
+     *
+     *  Cleared by reset() and cancel().
+     */
+    mutable std::map<Xapian::valueno, bool> indexed_slots;
+
     void add_value(Xapian::docid did, Xapian::valueno slot,
 		   const std::string & val);
 
@@ -126,6 +145,30 @@ class BrassValueManager {
 
     std::string get_value(Xapian::docid did, Xapian::valueno slot) const;
 
+    /// Return true if value slot @a slot has a value index.
+    bool has_value_index(Xapian::valueno slot) const;
+
+    /** Create a value index for value slot @a slot.
+     *
+     *  The index lists the documents with a value in the slot ordered by
+     *  value, and is kept up to date as documents are added, replaced and
+     *  deleted.  There must be no unmerged changes to the slot's values.
+     */
+    void build_value_index(Xapian::valueno slot);
+
+    /** Find the documents with a value in a range using the value index.
+     *
+     *  @param slot	The value slot, which must have a value index.
+     *  @param begin	The start of the range (must not be empty).
+     *  @param end	The end of the range, or empty for no upper bound.
+     *  @param docids	The matching docids are appended to this, in
+     *			ascending order.
+     */
+    void get_value_index_docids(Xapian::valueno slot,
+				const std::string & begin,
+				const std::string & end,
+				std::vector<Xapian::docid> & docids) const;
+
     void get_all_values(std::map<Xapian::valueno, std::string> & values,
 			Xapian::docid did) const;
 
@@ -156,6 +199,7 @@ class BrassValueManager {
     void reset() {
 	/// Ignore any old cached valuestats.
 	mru_valno = Xapian::BAD_VALUENO;
+	indexed_slots.clear();
     }
 
     bool is_modified() const {
@@ -166,6 +210,7 @@ class BrassValueManager {
 	// Discard batched-up changes.
 	slots.clear();
 	changes.clear();
+	indexed_slots.clear();
     }
 };
 
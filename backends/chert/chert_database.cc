@@ -31,6 +31,8 @@
 #include <xapian/error.h>
 #include <xapian/valueiterator.h>
 
+#include "changesetcompress.h"
+#include "changesetlinks.h"
 #include "contiguousalldocspostlist.h"
 #include "chert_alldocsmodifiedpostlist.h"
 #include "chert_alldocspostlist.h"
@@ -53,6 +55,7 @@
 #include "pack.h"
 #include "remoteconnection.h"
 #include "replication.h"
+#include "replicationdelta.h"
 #include "replicationprotocol.h"
 #include "serialise.h"
 #include "stringutils.h"
@@ -521,7 +524,8 @@ ChertDatabase::get_database_write_lock(bool creating)
 
 void
 ChertDatabase::send_whole_database(RemoteConnection & conn,
-				   const OmTime & end_time)
+				   const OmTime & end_time,
+				   const BlockChecksums * checksums)
 {
     DEBUGCALL(DB, void, "ChertDatabase::send_whole_database",
 	      "conn" << ", " << "end_time");
@@ -553,7 +557,11 @@ ChertDatabase::send_whole_database(RemoteConnection & conn,
 	    // FIXME - there is a race condition here - the file might get
 	    // deleted between the file_exists() test and the access to send it.
 	    conn.send_message(REPL_REPLY_DB_FILENAME, leaf, end_time);
-	    conn.send_file(REPL_REPLY_DB_FILEDATA, filepath, end_time);
+	    if (checksums && checksums->has_file(leaf)) {
+		send_file_delta(conn, *checksums, leaf, filepath, end_time);
+	    } else {
+		conn.send_file(REPL_REPLY_DB_FILEDATA, filepath, end_time);
+	    }
 	}
     }
 }
@@ -562,10 +570,13 @@ void
 ChertDatabase::write_changesets_to_fd(int fd,
 				      const string & revision,
 				      bool need_whole_db,
-				      ReplicationInfo * info)
+				      ReplicationInfo * info,
+				      BlockChecksumsSource * checksums,
+				      bool compress_changesets)
 {
     DEBUGCALL(DB, void, "ChertDatabase::write_changesets_to_fd",
-	      fd << ", " << revision << ", " << need_whole_db << ", " << info);
+	      fd << ", " << revision << ", " << need_whole_db << ", " << info <<
+	      ", " << checksums << ", " << compress_changesets);
 
     int whole_db_copies_left = MAX_DB_COPIES_PER_CONVERSATION;
     chert_revision_number_t start_rev_num = 0;
@@ -579,15 +590,41 @@ ChertDatabase::write_changesets_to_fd(int fd,
 	need_whole_db = true;
     }
 
+    if (info != NULL) {
+	if (need_whole_db || start_rev_num > get_revision_number()) {
+	    info->revision_lag = -1;
+	} else {
+	    info->revision_lag = int(get_revision_number() - start_rev_num);
+	}
+    }
+
     RemoteConnection conn(-1, fd, string());
     OmTime end_time;
 
+    // Make hardlinks for all the changesets we're likely to need first, so
+    // that there's no risk of them disappearing while we're sending earlier
+    // ones.  Any which are written while we're sending get linked when we
+    // reach them.
+    ChangesetLinks links(db_dir);
+    if (!need_whole_db) {
+	chert_revision_number_t rev = start_rev_num;
+	while (rev < get_revision_number()) {
+	    string changes_name = links.pin(rev);
+	    if (changes_name.empty()) break;
+	    chert_revision_number_t changeset_start_rev_num;
+	    chert_revision_number_t changeset_end_rev_num;
+	    get_changeset_revisions(changes_name,
+				    &changeset_start_rev_num,
+				    &changeset_end_rev_num);
+	    // Leave reporting any problems to the main loop below.
+	    if (changeset_start_rev_num != rev ||
+		changeset_start_rev_num >= changeset_end_rev_num) break;
+	    rev = changeset_end_rev_num;
+	}
+    }
+
     // While the starting revision number is less than the latest revision
     // number, look for a changeset, and write it.
-    //
-    // FIXME - perhaps we should make hardlinks for all the changesets we're
-    // likely to need, first, and then start sending them, so that there's no
-    // risk of them disappearing while we're sending earlier ones.
     while (true) {
 	if (need_whole_db) {
 	    // Decrease the counter of copies left to be sent, and fail
@@ -597,6 +634,8 @@ ChertDatabase::write_changesets_to_fd(int fd,
 		conn.send_message(REPL_REPLY_FAIL,
 				  "Database changing too fast",
 				  end_time);
+		if (info != NULL)
+		    info->bytes_transferred = conn.get_bytes_transferred();
 		return;
 	    }
 	    whole_db_copies_left--;
@@ -605,7 +644,11 @@ ChertDatabase::write_changesets_to_fd(int fd,
 	    start_rev_num = get_revision_number();
 	    start_uuid = get_uuid();
 
-	    send_whole_database(conn, end_time);
+	    // Only ask the replica for checksums now we know we need them.
+	    // They're only valid until it has applied something we've sent.
+	    send_whole_database(conn, end_time,
+				checksums ? checksums->get(conn, end_time) : NULL);
+	    checksums = NULL;
 	    if (info != NULL)
 		++(info->fullcopy_count);
 
@@ -651,8 +694,8 @@ ChertDatabase::write_changesets_to_fd(int fd,
 	    }
 
 	    // Look for the changeset for revision start_rev_num.
-	    string changes_name = db_dir + "/changes" + om_tostring(start_rev_num);
-	    if (file_exists(changes_name)) {
+	    string changes_name = links.pin(start_rev_num);
+	    if (!changes_name.empty()) {
 		// Send it, and also update start_rev_num to the new value
 		// specified in the changeset.
 		chert_revision_number_t changeset_start_rev_num;
@@ -666,10 +709,12 @@ ChertDatabase::write_changesets_to_fd(int fd,
 		if (changeset_start_rev_num >= changeset_end_rev_num) {
 		    throw Xapian::DatabaseError("Changeset start revision is not less than end revision");
 		}
-		// FIXME - there is a race condition here - the file might get
-		// deleted between the file_exists() test and the access to
-		// send it.
-		conn.send_file(REPL_REPLY_CHANGESET, changes_name, end_time);
+		if (compress_changesets) {
+		    send_compressed_changeset(conn, changes_name, end_time);
+		} else {
+		    conn.send_file(REPL_REPLY_CHANGESET, changes_name, end_time);
+		}
+		checksums = NULL;
 		start_rev_num = changeset_end_rev_num;
 		if (info != NULL) {
 		    ++(info->changeset_count);
@@ -684,6 +729,8 @@ ChertDatabase::write_changesets_to_fd(int fd,
 	}
     }
     conn.send_message(REPL_REPLY_END_OF_CHANGES, string(), end_time);
+    if (info != NULL)
+	info->bytes_transferred = conn.get_bytes_transferred();
 }
 
 void
@@ -223,6 +223,21 @@ Database::Internal::open_value_list(Xapian::valueno slot) const
     return new SlowValueList(Xapian::Database(const_cast<Database::Internal*>(this)), slot);
 }
 
+bool
+Database::Internal::has_value_index(Xapian::valueno) const
+{
+    // Only implemented for some database backends.
+    return false;
+}
+
+PostList *
+Database::Internal::open_value_index_post_list(Xapian::valueno,
+					       const string &,
+					       const string &) const
+{
+    throw Xapian::UnimplementedError("This backend doesn't support value indexes");
+}
+
 TermList *
 Database::Internal::open_spelling_termlist(const string &) const
 {
@@ -232,6 +247,14 @@ Database::Internal::open_spelling_termlist(const string &) const
     return NULL;
 }
 
+TermList *
+Database::Internal::open_spelling_candidates(const string &, unsigned) const
+{
+    // Only implemented for some database backends - others will use
+    // open_spelling_termlist() instead.
+    return NULL;
+}
+
 TermList *
 Database::Internal::open_spelling_wordlist() const
 {
@@ -340,7 +363,9 @@ Database::Internal::collect_document(Xapian::docid did) const
 }
 
 void
-Database::Internal::write_changesets_to_fd(int, const string &, bool, ReplicationInfo *)
+Database::Internal::write_changesets_to_fd(int, const string &, bool,
+					   ReplicationInfo *,
+					   BlockChecksumsSource *, bool)
 {
     throw Xapian::UnimplementedError("This backend doesn't provide changesets");
 }
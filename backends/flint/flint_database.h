@@ -42,6 +42,8 @@
 class FlintTermList;
 class FlintAllDocsPostList;
 class RemoteConnection;
+class BlockChecksums;
+class BlockChecksumsSource;
 class OmTime;
 
 /** A backend designed for efficient indexing and retrieval, using
@@ -214,9 +216,13 @@ class FlintDatabase : public Xapian::Database::Internal {
 	void cancel();
 
 	/** Send a set of messages which transfer the whole database.
+	 *
+	 *  If @a checksums is non-NULL, files which the replica has checksums
+	 *  for are sent as deltas against the replica's copy.
 	 */
 	void send_whole_database(RemoteConnection & conn,
-				 const OmTime & end_time);
+				 const OmTime & end_time,
+				 const BlockChecksums * checksums);
 
 	/** Get the revision stored in a changeset.
 	 */
@@ -279,7 +285,9 @@ class FlintDatabase : public Xapian::Database::Internal {
 	void write_changesets_to_fd(int fd,
 				    const string & start_revision,
 				    bool need_whole_db,
-				    Xapian::ReplicationInfo * info);
+				    Xapian::ReplicationInfo * info,
+				    BlockChecksumsSource * checksums,
+				    bool compress_changesets);
 	string get_revision_info() const;
 	string get_uuid() const;
 	//@}
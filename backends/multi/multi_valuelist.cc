@@ -57,6 +57,10 @@ struct SubValueList {
 
     std::string get_value() const { return valuelist->get_value(); }
 
+    double get_value_as_double() const {
+	return valuelist->get_value_as_double();
+    }
+
     void next() {
 	valuelist->next();
     }
@@ -120,6 +124,13 @@ MultiValueList::get_value() const
     return valuelists.front()->get_value();
 }
 
+double
+MultiValueList::get_value_as_double() const
+{
+    Assert(!at_end());
+    return valuelists.front()->get_value_as_double();
+}
+
 Xapian::valueno
 MultiValueList::get_valueno() const
 {
@@ -22,10 +22,31 @@
 
 #include "valuelist.h"
 
+#include <xapian/queryparser.h> // For sortable_unserialise().
+
 namespace Xapian {
 
 ValueIterator::Internal::~Internal() { }
 
+double
+ValueIterator::Internal::get_value_as_double() const
+{
+    return sortable_unserialise(get_value());
+}
+
+bool
+ValueIterator::Internal::stores_doubles() const
+{
+    return false;
+}
+
+bool
+ValueIterator::Internal::get_value_upper_bounds(Xapian::docid, Xapian::docid &,
+						double &, double &) const
+{
+    return false;
+}
+
 bool
 ValueIterator::Internal::check(Xapian::docid did)
 {
@@ -30,6 +30,7 @@
 
 #include "brass_check.h"
 #include "brass_cursor.h"
+#include "brass_doclencache.h"
 #include "brass_table.h"
 #include "brass_types.h"
 #include "pack.h"
@@ -82,6 +83,8 @@ check_brass_table(const char * tablename, string filename, int opts,
 	Xapian::termcount termfreq = 0, collfreq = 0;
 	Xapian::termcount tf = 0, cf = 0;
 	bool have_metainfo_key = false;
+	// Set if each posting for a term has a quantised document length.
+	AutoPtr<BrassDocLengthQuantiser> quantiser;
 
 	// The first key/tag pair should be the METAINFO - though this may be
 	// missing if the table only contains user-metadata.
@@ -256,6 +259,20 @@ check_brass_table(const char * tablename, string filename, int opts,
 		continue;
 	    }
 
+	    if (key.size() == 2 && key[0] == '\0' && key[1] == '\xe8') {
+		// Quantiser for the document lengths in the postlists.
+		cursor->read_tag();
+		quantiser.reset(new BrassDocLengthQuantiser);
+		try {
+		    quantiser->unserialise(cursor->current_tag);
+		} catch (const Xapian::DatabaseCorruptError &) {
+		    cout << "Document length quantiser is corrupt" << endl;
+		    ++errors;
+		    quantiser.reset(0);
+		}
+		continue;
+	    }
+
 	    if (key.size() >= 2 && key[0] == '\0' && key[1] == '\xd0') {
 		// Value stats.
 		const char * p = key.data();
@@ -301,6 +318,41 @@ check_brass_table(const char * tablename, string filename, int opts,
 		continue;
 	    }
 
+	    if (key.size() >= 2 && key[0] == '\0' && key[1] == '\xd4') {
+		// Value index entry.
+		const char * p = key.data();
+		const char * end = p + key.length();
+		p += 2;
+		Xapian::valueno slot;
+		if (!unpack_uint(&p, end, &slot)) {
+		    cout << "Bad value index key (no slot)" << endl;
+		    ++errors;
+		    continue;
+		}
+		// The key which marks the slot as indexed has nothing more.
+		if (p == end) continue;
+		string value;
+		Xapian::docid did;
+		if (!unpack_string_preserving_sort(&p, end, value) ||
+		    !unpack_uint_preserving_sort(&p, end, &did)) {
+		    cout << "Bad value index key" << endl;
+		    ++errors;
+		    continue;
+		}
+		if (p != end) {
+		    cout << "Bad value index key (trailing junk)" << endl;
+		    ++errors;
+		    continue;
+		}
+		if (did > db_last_docid) {
+		    cout << "document id " << did << " in value index "
+			 << "is larger that get_last_docid() "
+			 << db_last_docid << endl;
+		    ++errors;
+		}
+		continue;
+	    }
+
 	    if (key.size() >= 2 && key[0] == '\0' && key[1] == '\xd8') {
 		// Value stream chunk.
 		const char * p = key.data();
@@ -496,6 +548,27 @@ check_brass_table(const char * tablename, string filename, int opts,
 		++tf;
 		cf += wdf;
 
+		if (quantiser.get()) {
+		    if (pos == end) {
+			cout << "Failed to unpack document length code" << endl;
+			++errors;
+			bad = true;
+			break;
+		    }
+		    unsigned char code = static_cast<unsigned char>(*pos++);
+		    if (!doclens.empty()) {
+			Xapian::termcount doclen = 0;
+			if (did < doclens.size()) doclen = doclens[did];
+			if (code != quantiser->encode(doclen)) {
+			    cout << "Document length code " << int(code)
+				 << " for document " << did << " in postlist "
+				 "for term `" << term << "' doesn't match "
+				 "length " << doclen << endl;
+			    ++errors;
+			}
+		    }
+		}
+
 		if (pos == end) break;
 
 		Xapian::docid inc;
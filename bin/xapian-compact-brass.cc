@@ -35,6 +35,10 @@
 
 #include "brass_table.h"
 #include "brass_cursor.h"
+#include "brass_doclencache.h"
+#include "brass_numericcolumn.h"
+#include "brass_spelling.h"
+#include "brass_termdict.h"
 #include "internaltypes.h"
 #include "pack.h"
 #include "utils.h"
@@ -66,6 +70,12 @@ is_valuestats_key(const string & key)
     return key.size() > 1 && key[0] == '\0' && key[1] == '\xd0';
 }
 
+static inline bool
+is_valueindex_key(const string & key)
+{
+    return key.size() > 1 && key[0] == '\0' && key[1] == '\xd4';
+}
+
 static inline bool
 is_valuechunk_key(const string & key)
 {
@@ -78,16 +88,109 @@ is_doclenchunk_key(const string & key)
     return key.size() > 1 && key[0] == '\0' && key[1] == '\xe0';
 }
 
+static inline bool
+is_doclencodes_key(const string & key)
+{
+    return key.size() == 2 && key[0] == '\0' && key[1] == '\xe8';
+}
+
+/** Rewrite the entries of a postlist chunk in the non-initial form.
+ *
+ *  @param tag		The chunk.
+ *  @param did		The first docid in the chunk.
+ *  @param has_codes	Does each entry in @a tag have a quantised document
+ *			length after the wdf?  If so, they're removed.
+ *  @param codes	If not NULL, the quantised document length to add
+ *			after each wdf, indexed by docid.
+ */
+static string
+recode_postlist_chunk(const string & tag, Xapian::docid did, bool has_codes,
+		      const vector<unsigned char> * codes)
+{
+    const char * p = tag.data();
+    const char * end = p + tag.size();
+    // Skip the flag which says if this is the last chunk.
+    if (p == end)
+	throw Xapian::DatabaseCorruptError("Bad postlist chunk header");
+    ++p;
+    Xapian::docid increase_to_last;
+    if (!unpack_uint(&p, end, &increase_to_last))
+	throw Xapian::DatabaseCorruptError("Bad postlist chunk header");
+    string result(tag, 0, p - tag.data());
+    bool first = true;
+    while (p != end) {
+	if (!first) {
+	    Xapian::docid increase;
+	    if (!unpack_uint(&p, end, &increase))
+		throw Xapian::DatabaseCorruptError("Bad postlist chunk entry");
+	    pack_uint(result, increase);
+	    did += increase + 1;
+	}
+	first = false;
+	Xapian::termcount wdf;
+	if (!unpack_uint(&p, end, &wdf))
+	    throw Xapian::DatabaseCorruptError("Bad postlist chunk entry");
+	pack_uint(result, wdf);
+	if (has_codes) {
+	    if (p == end)
+		throw Xapian::DatabaseCorruptError("Bad postlist chunk entry");
+	    ++p;
+	}
+	if (codes) {
+	    if (did >= codes->size())
+		throw Xapian::DatabaseCorruptError("Document in postlist has no length");
+	    result += char((*codes)[did]);
+	}
+    }
+    return result;
+}
+
+/// Store the quantised lengths from a doclen chunk in the non-initial form.
+static void
+quantise_doclens(const string & tag, Xapian::docid did,
+		 const BrassDocLengthQuantiser & quantiser,
+		 vector<unsigned char> & codes)
+{
+    const char * p = tag.data();
+    const char * end = p + tag.size();
+    // Skip the flag which says if this is the last chunk.
+    if (p == end)
+	throw Xapian::DatabaseCorruptError("Bad doclen chunk header");
+    ++p;
+    Xapian::docid increase_to_last;
+    if (!unpack_uint(&p, end, &increase_to_last))
+	throw Xapian::DatabaseCorruptError("Bad doclen chunk header");
+    if (codes.size() <= did + increase_to_last)
+	codes.resize(did + increase_to_last + 1);
+    bool first = true;
+    while (p != end) {
+	if (!first) {
+	    Xapian::docid increase;
+	    if (!unpack_uint(&p, end, &increase))
+		throw Xapian::DatabaseCorruptError("Bad doclen chunk entry");
+	    did += increase + 1;
+	}
+	first = false;
+	Xapian::termcount doclen;
+	if (!unpack_uint(&p, end, &doclen) || did >= codes.size())
+	    throw Xapian::DatabaseCorruptError("Bad doclen chunk entry");
+	codes[did] = quantiser.encode(doclen);
+    }
+}
+
 class PostlistCursor : private BrassCursor {
     Xapian::docid offset;
 
+    /// Do the term postlists have quantised document lengths to remove?
+    bool has_codes;
+
   public:
     string key, tag;
     Xapian::docid firstdid;
     Xapian::termcount tf, cf;
 
     PostlistCursor(BrassTable *in, Xapian::docid offset_)
-	: BrassCursor(in), offset(offset_), firstdid(0)
+	: BrassCursor(in), offset(offset_), has_codes(false), firstdid(0)
     {
 	find_entry(string());
 	next();
@@ -109,6 +212,34 @@ class PostlistCursor : private BrassCursor {
 	if (is_metainfo_key(key)) return true;
 	if (is_user_metadata_key(key)) return true;
 	if (is_valuestats_key(key)) return true;
+	if (is_doclencodes_key(key)) {
+	    // The quantised lengths are recalculated for the merged database
+	    // if they're wanted, so remove them.
+	    has_codes = true;
+	    return next();
+	}
+	if (is_valueindex_key(key)) {
+	    const char * p = key.data();
+	    const char * end = p + key.length();
+	    p += 2;
+	    Xapian::valueno slot;
+	    if (!unpack_uint(&p, end, &slot))
+		throw Xapian::DatabaseCorruptError("bad value index key");
+	    // The key which marks the slot as indexed has no entry after it.
+	    if (p == end) return true;
+	    string value;
+	    Xapian::docid did;
+	    if (!unpack_string_preserving_sort(&p, end, value) ||
+		!unpack_uint_preserving_sort(&p, end, &did))
+		throw Xapian::DatabaseCorruptError("bad value index key");
+	    did += offset;
+
+	    key.assign("\0\xd4", 2);
+	    pack_uint(key, slot);
+	    pack_string_preserving_sort(key, value);
+	    pack_uint_preserving_sort(key, did);
+	    return true;
+	}
 	if (is_valuechunk_key(key)) {
 	    const char * p = key.data();
 	    const char * end = p + key.length();
@@ -162,6 +293,8 @@ class PostlistCursor : private BrassCursor {
 		key.erase(tmp - 1);
 	    }
 	}
+	if (has_codes && !is_doclenchunk_key(key))
+	    tag = recode_postlist_chunk(tag, firstdid, true, NULL);
 	firstdid += offset;
 	return true;
     }
@@ -195,8 +328,13 @@ encode_valuestats(Xapian::doccount freq,
 static void
 merge_postlists(BrassTable * out, vector<Xapian::docid>::const_iterator offset,
 		vector<string>::const_iterator b, vector<string>::const_iterator e,
-		Xapian::docid tot_off)
+		Xapian::docid tot_off, bool inline_doclens)
 {
+    // We only keep value indexes if there's a single source, since otherwise
+    // some of the sources might not have an index for a slot.  A value index
+    // can be recreated by setting XAPIAN_VALUE_INDEXES when opening the
+    // compacted database for writing.
+    bool keep_value_indexes = (e - b == 1);
     totlen_t tot_totlen = 0;
     Xapian::termcount doclen_lbound = static_cast<Xapian::termcount>(-1);
     Xapian::termcount wdf_ubound = 0;
@@ -364,6 +502,22 @@ merge_postlists(BrassTable * out, vector<Xapian::docid>::const_iterator offset,
 	}
     }
 
+    {
+	// Merge value indexes (if we're keeping them).
+	while (!pq.empty()) {
+	    PostlistCursor * cur = pq.top();
+	    const string & key = cur->key;
+	    if (!is_valueindex_key(key)) break;
+	    if (keep_value_indexes) out->add(key, cur->tag);
+	    pq.pop();
+	    if (cur->next()) {
+		pq.push(cur);
+	    } else {
+		delete cur;
+	    }
+	}
+    }
+
     // Merge valuestream chunks.
     while (!pq.empty()) {
 	PostlistCursor * cur = pq.top();
@@ -379,6 +533,13 @@ merge_postlists(BrassTable * out, vector<Xapian::docid>::const_iterator offset,
 	}
     }
 
+    // If asked to, store the quantised length of each document with each of
+    // its postings.  The doclen chunks come before the postlists for terms,
+    // so we can work out the codes from them as we write them.
+    BrassDocLengthQuantiser quantiser(doclen_ubound);
+    vector<unsigned char> codes;
+    bool have_codes = false;
+
     Xapian::termcount tf = 0, cf = 0; // Initialise to avoid warnings.
     vector<pair<Xapian::docid, string> > tags;
     while (true) {
@@ -389,6 +550,19 @@ merge_postlists(BrassTable * out, vector<Xapian::docid>::const_iterator offset,
 	}
 	Assert(cur == NULL || !is_user_metadata_key(cur->key));
 	if (cur == NULL || cur->key != last_key) {
+	    if (!tags.empty() && inline_doclens) {
+		vector<pair<Xapian::docid, string> >::iterator i;
+		if (is_doclenchunk_key(last_key)) {
+		    for (i = tags.begin(); i != tags.end(); ++i) {
+			quantise_doclens(i->second, i->first, quantiser, codes);
+		    }
+		} else if (have_codes) {
+		    for (i = tags.begin(); i != tags.end(); ++i) {
+			i->second = recode_postlist_chunk(i->second, i->first,
+							  false, &codes);
+		    }
+		}
+	    }
 	    if (!tags.empty()) {
 		string first_tag;
 	        pack_uint(first_tag, tf);
@@ -414,6 +588,13 @@ merge_postlists(BrassTable * out, vector<Xapian::docid>::const_iterator offset,
 		    tag[0] = (i + 1 == tags.end()) ? '1' : '0';
 		    out->add(pack_brass_postlist_key(term, i->first), tag);
 		}
+
+		if (inline_doclens && is_doclenchunk_key(last_key)) {
+		    // The quantiser sorts between the doclen chunks and the
+		    // postlists for terms.
+		    out->add(string("\0\xe8", 2), quantiser.serialise());
+		    have_codes = true;
+		}
 	    }
 	    tags.clear();
 	    if (cur == NULL) break;
@@ -797,7 +978,7 @@ merge_synonyms(BrassTable * out,
 
 static void
 multimerge_postlists(BrassTable * out, const char * tmpdir,
-		     Xapian::docid tot_off,
+		     Xapian::docid tot_off, bool inline_doclens,
 		     vector<string> tmp, vector<Xapian::docid> off)
 {
     unsigned int c = 0;
@@ -821,7 +1002,7 @@ multimerge_postlists(BrassTable * out, const char * tmpdir,
 	    // Use maximum blocksize for temporary tables.
 	    tmptab.create_and_open(65536);
 
-	    merge_postlists(&tmptab, off.begin() + i, tmp.begin() + i, tmp.begin() + j, 0);
+	    merge_postlists(&tmptab, off.begin() + i, tmp.begin() + i, tmp.begin() + j, 0, false);
 	    if (c > 0) {
 		for (unsigned int k = i; k < j; ++k) {
 		    unlink((tmp[k] + "DB").c_str());
@@ -837,7 +1018,8 @@ multimerge_postlists(BrassTable * out, const char * tmpdir,
 	swap(off, newoff);
 	++c;
     }
-    merge_postlists(out, off.begin(), tmp.begin(), tmp.end(), tot_off);
+    merge_postlists(out, off.begin(), tmp.begin(), tmp.end(), tot_off,
+		    inline_doclens);
     if (c > 0) {
 	for (size_t k = 0; k < tmp.size(); ++k) {
 	    unlink((tmp[k] + "DB").c_str());
@@ -898,7 +1080,10 @@ void
 compact_brass(const char * destdir, const vector<string> & sources,
 	      const vector<Xapian::docid> & offset, size_t block_size,
 	      compaction_level compaction, bool multipass,
-	      Xapian::docid tot_off) {
+	      Xapian::docid tot_off, bool term_dictionary,
+	      unsigned spelling_index,
+	      const vector<Xapian::valueno> & numeric_columns,
+	      bool inline_doclens, const string & uuid) {
     enum table_type {
 	POSTLIST, RECORD, TERMLIST, POSITION, VALUE, SPELLING, SYNONYM
     };
@@ -999,11 +1184,11 @@ compact_brass(const char * destdir, const vector<string> & sources,
 	    case POSTLIST:
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(&out, destdir, tot_off,
-					 inputs, offset);
+					 inline_doclens, inputs, offset);
 		} else {
 		    merge_postlists(&out, offset.begin(),
 				    inputs.begin(), inputs.end(),
-				    tot_off);
+				    tot_off, inline_doclens);
 		}
 		break;
 	    case SPELLING:
@@ -1022,6 +1207,20 @@ compact_brass(const char * destdir, const vector<string> & sources,
 	out.flush_db();
 	out.commit(1);
 
+	if (t->type == POSTLIST) {
+	    if (term_dictionary) BrassTermDictionary::build(destdir, out, uuid);
+	    // The values are stored in the postlist table.
+	    vector<Xapian::valueno>::const_iterator slot;
+	    for (slot = numeric_columns.begin(); slot != numeric_columns.end();
+		 ++slot) {
+		BrassNumericColumn::build(destdir, out, *slot, uuid);
+	    }
+	}
+	if (t->type == SPELLING && spelling_index) {
+	    BrassSpellingIndex::build(destdir, out, spelling_index,
+				      block_size, uuid);
+	}
+
 	cout << '\r' << t->name << ": ";
 	off_t out_size = 0;
 	if (!bad_stat) {
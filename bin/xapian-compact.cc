@@ -27,7 +27,10 @@
 
 #include <algorithm>
 #include <iostream>
+#include <utility>
+#include <vector>
 
+#include <cmath> // for HUGE_VAL
 #include <cstdio> // for rename()
 #include <cstdlib>
 #include <cstring>
@@ -56,6 +59,11 @@ using namespace std;
 #define OPT_HELP 1
 #define OPT_VERSION 2
 #define OPT_NO_RENUMBER 3
+#define OPT_TERM_DICTIONARY 4
+#define OPT_SPELLING_INDEX 5
+#define OPT_NUMERIC_COLUMN 6
+#define OPT_REORDER_BY_VALUE 7
+#define OPT_INLINE_DOCLENGTHS 8
 
 static void show_usage() {
     cout << "Usage: "PROG_NAME" [OPTIONS] SOURCE_DATABASE... DESTINATION_DATABASE\n\n"
@@ -73,6 +81,29 @@ static void show_usage() {
 "                    unique ids from an external source).  Currently this\n"
 "                    option is only supported when merging databases if they\n"
 "                    have disjoint ranges of used document ids\n"
+"      --term-dictionary\n"
+"                    Also write a dictionary of all the terms, which read-only\n"
+"                    opens load into memory to speed up term lookups and\n"
+"                    wildcard expansion (brass databases only)\n"
+"      --spelling-index[=DISTANCE]\n"
+"                    Also write an index of the spelling words, which read-only\n"
+"                    opens use to find spelling corrections up to DISTANCE\n"
+"                    edits away more quickly (default 2, brass databases only)\n"
+"      --numeric-column=SLOT\n"
+"                    Also write the values in SLOT, which must all be numbers\n"
+"                    encoded by sortable_serialise(), as a column of doubles\n"
+"                    which read-only opens use instead of the values (may be\n"
+"                    given more than once, brass databases only)\n"
+"      --reorder-by-value=SLOT\n"
+"                    Renumber the documents in descending order of the number\n"
+"                    encoded by sortable_serialise() in SLOT, so that a search\n"
+"                    weighted by it finds the best documents first (brass\n"
+"                    databases only, and not with --no-renumber)\n"
+"      --inline-doclengths\n"
+"                    Also store the length of the document, quantised to a\n"
+"                    byte, with each entry in each term's posting list, so\n"
+"                    that BM25Weight and TradWeight don't need to look it up\n"
+"                    (brass databases only)\n"
 "  --help            display this help and exit\n"
 "  --version         output version information and exit" << endl;
 }
@@ -169,6 +200,74 @@ class CmpByFirstUsed {
     }
 };
 
+/// Order documents by descending value, then by ascending docid.
+struct CmpByDescendingValue {
+    bool operator()(const pair<double, Xapian::docid> & a,
+		    const pair<double, Xapian::docid> & b) const {
+	if (a.first != b.first) return a.first > b.first;
+	return a.second < b.second;
+    }
+};
+
+/** Copy the documents from @a sources to a new brass database at @a tmpdir,
+ *  in descending order of the number in value slot @a slot.
+ *
+ *  Documents without a value in @a slot go last.  The spelling, synonym and
+ *  user metadata are copied too, so the new database can be compacted in
+ *  place of the sources.
+ */
+static void
+reorder_by_value(const vector<string> & sources, const string & tmpdir,
+		 Xapian::valueno slot)
+{
+    Xapian::Database db;
+    for (size_t i = 0; i != sources.size(); ++i) {
+	db.add_database(Xapian::Database(sources[i]));
+    }
+
+    vector<pair<double, Xapian::docid> > order;
+    order.reserve(db.get_doccount());
+    Xapian::ValueIterator v = db.valuestream_begin(slot);
+    Xapian::PostingIterator d;
+    for (d = db.postlist_begin(string()); d != db.postlist_end(string()); ++d) {
+	double key = -HUGE_VAL;
+	if (v != db.valuestream_end(slot)) {
+	    v.skip_to(*d);
+	    if (v != db.valuestream_end(slot) && v.get_docid() == *d)
+		key = Xapian::sortable_unserialise(*v);
+	}
+	order.push_back(make_pair(key, *d));
+    }
+    sort(order.begin(), order.end(), CmpByDescendingValue());
+
+    Xapian::WritableDatabase out =
+	Xapian::Brass::open(tmpdir, Xapian::DB_CREATE_OR_OVERWRITE);
+    vector<pair<double, Xapian::docid> >::const_iterator i;
+    for (i = order.begin(); i != order.end(); ++i) {
+	out.add_document(db.get_document(i->second));
+    }
+
+    for (size_t j = 0; j != sources.size(); ++j) {
+	Xapian::Database src(sources[j]);
+	Xapian::TermIterator t;
+	for (t = src.spellings_begin(); t != src.spellings_end(); ++t) {
+	    out.add_spelling(*t, t.get_termfreq());
+	}
+	for (t = src.synonym_keys_begin(); t != src.synonym_keys_end(); ++t) {
+	    string key = *t;
+	    Xapian::TermIterator syn;
+	    for (syn = src.synonyms_begin(key); syn != src.synonyms_end(key);
+		 ++syn) {
+		out.add_synonym(key, *syn);
+	    }
+	}
+	for (t = src.metadata_keys_begin(); t != src.metadata_keys_end(); ++t) {
+	    out.set_metadata(*t, src.get_metadata(*t));
+	}
+    }
+    out.commit();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -179,6 +278,11 @@ main(int argc, char **argv)
 	{"multipass",	no_argument, 0, 'm'},
 	{"blocksize",	required_argument, 0, 'b'},
 	{"no-renumber", no_argument, 0, OPT_NO_RENUMBER},
+	{"term-dictionary", no_argument, 0, OPT_TERM_DICTIONARY},
+	{"spelling-index", optional_argument, 0, OPT_SPELLING_INDEX},
+	{"numeric-column", required_argument, 0, OPT_NUMERIC_COLUMN},
+	{"reorder-by-value", required_argument, 0, OPT_REORDER_BY_VALUE},
+	{"inline-doclengths", no_argument, 0, OPT_INLINE_DOCLENGTHS},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
 	{NULL,		0, 0, 0}
@@ -188,6 +292,11 @@ main(int argc, char **argv)
     size_t block_size = 8192;
     bool multipass = false;
     bool renumber = true;
+    bool term_dictionary = false;
+    unsigned spelling_index = 0;
+    vector<Xapian::valueno> numeric_columns;
+    Xapian::valueno reorder_slot = Xapian::BAD_VALUENO;
+    bool inline_doclens = false;
 
     int c;
     while ((c = gnu_getopt_long(argc, argv, opts, long_opts, 0)) != -1) {
@@ -220,6 +329,49 @@ main(int argc, char **argv)
 	    case OPT_NO_RENUMBER:
 		renumber = false;
 		break;
+	    case OPT_TERM_DICTIONARY:
+		term_dictionary = true;
+		break;
+	    case OPT_SPELLING_INDEX:
+		spelling_index = 2;
+		if (optarg) {
+		    char *p;
+		    spelling_index = strtoul(optarg, &p, 10);
+		    if (*p || spelling_index < 1 || spelling_index > 4) {
+			cerr << PROG_NAME": Bad value '" << optarg
+			     << "' passed for spelling-index, must be between 1 and 4"
+			     << endl;
+			exit(1);
+		    }
+		}
+		break;
+	    case OPT_NUMERIC_COLUMN: {
+		char *p;
+		unsigned long slot = strtoul(optarg, &p, 10);
+		if (!*optarg || *p || slot >= Xapian::BAD_VALUENO) {
+		    cerr << PROG_NAME": Bad value '" << optarg
+			 << "' passed for numeric-column, must be a value slot"
+			 << endl;
+		    exit(1);
+		}
+		numeric_columns.push_back(slot);
+		break;
+	    }
+	    case OPT_REORDER_BY_VALUE: {
+		char *p;
+		unsigned long slot = strtoul(optarg, &p, 10);
+		if (!*optarg || *p || slot >= Xapian::BAD_VALUENO) {
+		    cerr << PROG_NAME": Bad value '" << optarg
+			 << "' passed for reorder-by-value, must be a value slot"
+			 << endl;
+		    exit(1);
+		}
+		reorder_slot = slot;
+		break;
+	    }
+	    case OPT_INLINE_DOCLENGTHS:
+		inline_doclens = true;
+		break;
 	    case OPT_HELP:
 		cout << PROG_NAME" - "PROG_DESC"\n\n";
 		show_usage();
@@ -241,6 +393,10 @@ main(int argc, char **argv)
     // Path to the database to create.
     const char *destdir = argv[argc - 1];
 
+    // Temporary databases we create inside destdir, which need removing
+    // whether or not we succeed.
+    string reorder_tmp, donor;
+
     try {
 	vector<string> sources;
 	vector<Xapian::docid> offset;
@@ -409,6 +565,43 @@ main(int argc, char **argv)
 	    swap(used_ranges, used_ranges_);
 	}
 
+	if (term_dictionary && backend != BRASS) {
+	    cerr << argv[0] << ": --term-dictionary is only supported for "
+		    "brass databases" << endl;
+	    exit(1);
+	}
+
+	if (spelling_index && backend != BRASS) {
+	    cerr << argv[0] << ": --spelling-index is only supported for "
+		    "brass databases" << endl;
+	    exit(1);
+	}
+
+	if (!numeric_columns.empty() && backend != BRASS) {
+	    cerr << argv[0] << ": --numeric-column is only supported for "
+		    "brass databases" << endl;
+	    exit(1);
+	}
+
+	if (inline_doclens && backend != BRASS) {
+	    cerr << argv[0] << ": --inline-doclengths is only supported for "
+		    "brass databases" << endl;
+	    exit(1);
+	}
+
+	if (reorder_slot != Xapian::BAD_VALUENO) {
+	    if (backend != BRASS) {
+		cerr << argv[0] << ": --reorder-by-value is only supported for "
+			"brass databases" << endl;
+		exit(1);
+	    }
+	    if (!renumber) {
+		cerr << argv[0] << ": --reorder-by-value can't be used with "
+			"--no-renumber" << endl;
+		exit(1);
+	    }
+	}
+
 	// If the destination database directory doesn't exist, create it.
 	if (mkdir(destdir, 0755) < 0) {
 	    // Check why mkdir failed.  It's ok if the directory already
@@ -428,15 +621,19 @@ main(int argc, char **argv)
 	    }
 	}
 
-	if (backend == FLINT) {
-	    compact_flint(destdir, sources, offset, block_size, compaction,
-			  multipass, tot_off);
-	} else if (backend == BRASS) {
-	    compact_brass(destdir, sources, offset, block_size, compaction,
-			  multipass, tot_off);
-	} else {
-	    compact_chert(destdir, sources, offset, block_size, compaction,
-			  multipass, tot_off);
+	// To reorder the documents, we copy them in the new order to a
+	// temporary database, and compact that instead of the sources.
+	if (reorder_slot != Xapian::BAD_VALUENO) {
+	    reorder_tmp = destdir;
+	    reorder_tmp += "/reorder.tmp";
+	    cout << "Reordering documents by value " << reorder_slot << "..."
+		 << flush;
+	    reorder_by_value(sources, reorder_tmp, reorder_slot);
+	    cout << " done." << endl;
+	    Xapian::Database reordered(reorder_tmp);
+	    sources.assign(1, reorder_tmp + '/');
+	    offset.assign(1, 0);
+	    tot_off = reordered.get_lastdocid();
 	}
 
 	// Create the version file ("iamchert", etc).
@@ -444,16 +641,37 @@ main(int argc, char **argv)
 	// This file contains a UUID, and we want the copy to have a fresh
 	// UUID since its revision counter is reset to 1.  Currently the
 	// easiest way to do this is to create a dummy "donor" database and
-	// harvest its version file.
-	string donor = destdir;
+	// harvest its version file.  We create it first, so that files
+	// tagged with the UUID can be written during compaction, but only
+	// move the version file into place once the tables are complete.
+	donor = destdir;
 	donor += "/donor.tmp";
 
+	string uuid;
 	if (backend == CHERT) {
-	    (void)Xapian::Chert::open(donor, Xapian::DB_CREATE_OR_OVERWRITE);
+	    uuid = Xapian::Chert::open(donor,
+				     Xapian::DB_CREATE_OR_OVERWRITE).get_uuid();
+	} else if (backend == BRASS) {
+	    uuid = Xapian::Brass::open(donor,
+				     Xapian::DB_CREATE_OR_OVERWRITE).get_uuid();
+	} else {
+	    uuid = Xapian::Flint::open(donor,
+				     Xapian::DB_CREATE_OR_OVERWRITE).get_uuid();
+	}
+
+	if (backend == FLINT) {
+	    compact_flint(destdir, sources, offset, block_size, compaction,
+			  multipass, tot_off);
 	} else if (backend == BRASS) {
-	    (void)Xapian::Brass::open(donor, Xapian::DB_CREATE_OR_OVERWRITE);
+	    compact_brass(destdir, sources, offset, block_size, compaction,
+			  multipass, tot_off, term_dictionary, spelling_index,
+			  numeric_columns, inline_doclens, uuid);
 	} else {
-	    (void)Xapian::Flint::open(donor, Xapian::DB_CREATE_OR_OVERWRITE);
+	    compact_chert(destdir, sources, offset, block_size, compaction,
+			  multipass, tot_off);
+	}
+
+	if (backend == FLINT) {
 	    string from = donor;
 	    from += "/uuid";
 	    string to(destdir);
@@ -461,6 +679,8 @@ main(int argc, char **argv)
 	    if (rename(from.c_str(), to.c_str()) == -1) {
 		cerr << argv[0] << ": cannot rename '" << from << "' to '"
 		     << to << "': " << strerror(errno) << endl;
+		rm_rf(donor);
+		rm_rf(reorder_tmp);
 		exit(1);
 	    }
 	}
@@ -471,15 +691,22 @@ main(int argc, char **argv)
 	if (rename(from.c_str(), to.c_str()) == -1) {
 	    cerr << argv[0] << ": cannot rename '" << from << "' to '"
 		 << to << "': " << strerror(errno) << endl;
+	    rm_rf(donor);
+	    rm_rf(reorder_tmp);
 	    exit(1);
 	}
 
 	rm_rf(donor);
+	rm_rf(reorder_tmp);
     } catch (const Xapian::Error &error) {
 	cerr << argv[0] << ": " << error.get_description() << endl;
+	rm_rf(donor);
+	rm_rf(reorder_tmp);
 	exit(1);
     } catch (const char * msg) {
 	cerr << argv[0] << ": " << msg << endl;
+	rm_rf(donor);
+	rm_rf(reorder_tmp);
 	exit(1);
     }
 }
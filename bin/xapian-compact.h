@@ -33,7 +33,10 @@ void
 compact_brass(const char * destdir, const std::vector<std::string> & sources,
 	      const std::vector<Xapian::docid> & offset, size_t block_size,
 	      compaction_level compaction, bool multipass,
-	      Xapian::docid tot_off);
+	      Xapian::docid tot_off, bool term_dictionary,
+	      unsigned spelling_index,
+	      const std::vector<Xapian::valueno> & numeric_columns,
+	      bool inline_doclens, const std::string & uuid);
 
 void
 compact_chert(const char * destdir, const std::vector<std::string> & sources,
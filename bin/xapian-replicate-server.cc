@@ -44,6 +44,7 @@ static void show_usage() {
 "  -I, --interface=ADDR  listen on interface ADDR\n"
 "  -p, --port=PORT   port to listen on\n"
 "  -o, --one-shot    serve a single connection and exit\n"
+"  -v, --verbose     report connections and replication lag for each replica\n"
 "  --help            display this help and exit\n"
 "  --version         output version information and exit" << endl;
 }
@@ -51,11 +52,12 @@ static void show_usage() {
 int
 main(int argc, char **argv)
 {
-    const char * opts = "I:p:o";
+    const char * opts = "I:p:ov";
     const struct option long_opts[] = {
 	{"interface",	required_argument,	0, 'I'},
 	{"port",	required_argument,	0, 'p'},
 	{"one-shot",	no_argument,		0, 'o'},
+	{"verbose",	no_argument,		0, 'v'},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
 	{NULL,		0, 0, 0}
@@ -65,6 +67,7 @@ main(int argc, char **argv)
     int port = 0;
 
     bool one_shot = false;
+    bool verbose = false;
 
     int c;
     while ((c = gnu_getopt_long(argc, argv, opts, long_opts, 0)) != -1) {
@@ -78,6 +81,9 @@ main(int argc, char **argv)
 	    case 'o':
 		one_shot = true;
 		break;
+	    case 'v':
+		verbose = true;
+		break;
 	    case OPT_HELP:
 		cout << PROG_NAME" - "PROG_DESC"\n\n";
 		show_usage();
@@ -100,7 +106,7 @@ main(int argc, char **argv)
     string dbpath(argv[optind]);
 
     try {
-	ReplicateTcpServer server(host, port, dbpath);
+	ReplicateTcpServer server(host, port, dbpath, verbose);
 	if (one_shot) {
 	    server.run_once();
 	} else {
@@ -51,6 +51,9 @@ static void show_usage() {
 "  -i, --interval=N  wait N seconds between each connection to the master\n"
 "                    (default: "STRINGIZE(DEFAULT_INTERVAL)")\n"
 "  -o, --one-shot    replicate only once and then exit\n"
+"  -c, --checksums   send block checksums so a full copy only transfers\n"
+"                    blocks which differ from the replica\n"
+"  -z, --compress    ask the master to send changesets compressed\n"
 "  -v, --verbose     be more verbose\n"
 "  --help            display this help and exit\n"
 "  --version         output version information and exit" << endl;
@@ -59,13 +62,15 @@ static void show_usage() {
 int
 main(int argc, char **argv)
 {
-    const char * opts = "h:p:m:i:ov";
+    const char * opts = "h:p:m:i:ocvz";
     const struct option long_opts[] = {
 	{"host",	required_argument,	0, 'h'},
 	{"port",	required_argument,	0, 'p'},
 	{"master",	required_argument,	0, 'm'},
 	{"interval",	required_argument,	0, 'i'},
 	{"one-shot",	no_argument,		0, 'o'},
+	{"checksums",	no_argument,		0, 'c'},
+	{"compress",	no_argument,		0, 'z'},
 	{"verbose",	no_argument,		0, 'v'},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
@@ -77,6 +82,8 @@ main(int argc, char **argv)
     string masterdb;
     int interval = DEFAULT_INTERVAL;
     bool one_shot = false;
+    bool send_checksums = false;
+    bool compress = false;
     bool verbose = false;
 
     int c;
@@ -97,6 +104,12 @@ main(int argc, char **argv)
 	    case 'o':
 		one_shot = true;
 		break;
+	    case 'c':
+		send_checksums = true;
+		break;
+	    case 'z':
+		compress = true;
+		break;
 	    case 'v':
 		verbose = true;
 		break;
@@ -132,13 +145,17 @@ main(int argc, char **argv)
 		     << masterdb << endl;
 	    }
 	    Xapian::ReplicationInfo info;
-	    client.update_from_master(dbpath, masterdb, info);
+	    client.update_from_master(dbpath, masterdb, info, send_checksums,
+				      compress);
 	    if (verbose) {
 		cout << "Update complete: " <<
 			info.fullcopy_count << " copies, " <<
 			info.changeset_count << " changesets, " <<
 			(info.changed ? "new live database" : "no changes to live database") <<
 			endl;
+		cout << "Transferred " << info.bytes_transferred <<
+			" bytes in " << info.transfer_seconds << " seconds (" <<
+			info.get_throughput() << " bytes/sec)" << endl;
 	    }
 	} catch (const Xapian::NetworkError &error) {
 	    // Don't stop running if there's a network error - just log to
@@ -2,6 +2,8 @@ noinst_HEADERS +=\
 	common/alltermslist.h\
 	common/autoptr.h\
 	common/bitstream.h\
+	common/changesetcompress.h\
+	common/changesetlinks.h\
 	common/const_database_wrapper.h\
 	common/contiguousalldocspostlist.h\
 	common/database.h\
@@ -12,12 +14,14 @@ noinst_HEADERS +=\
 	common/emptypostlist.h\
 	common/esetinternal.h\
 	common/expand.h\
+	common/expandwildcard.h\
 	common/expandweight.h\
 	common/fileutils.h\
 	common/gnu_getopt.h\
 	common/inmemory_positionlist.h\
 	common/internaltypes.h\
 	common/leafpostlist.h\
+	common/md5.h\
 	common/msvc_dirent.h\
 	common/msvc_posix_wrapper.h\
 	common/multialltermslist.h\
@@ -45,6 +49,7 @@ noinst_HEADERS +=\
 	common/replicatetcpclient.h\
 	common/replicatetcpserver.h\
 	common/replication.h\
+	common/replicationdelta.h\
 	common/replicationprotocol.h\
 	common/rset.h\
 	common/safedirent.h\
@@ -81,9 +86,11 @@ EXTRA_DIST +=\
 
 lib_src +=\
 	common/bitstream.cc\
+	common/changesetlinks.cc\
 	common/const_database_wrapper.cc\
 	common/debuglog.cc\
 	common/fileutils.cc\
+	common/md5.cc\
 	common/msvc_dirent.cc\
 	common/msvc_posix_wrapper.cc\
 	common/omdebug.cc\
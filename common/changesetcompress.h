@@ -0,0 +1,57 @@
+/** @file changesetcompress.h
+ *  @brief Compress changesets for sending to a replica.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_CHANGESETCOMPRESS_H
+#define XAPIAN_INCLUDED_CHANGESETCOMPRESS_H
+
+#include <string>
+
+class OmTime;
+class RemoteConnection;
+
+/** Send a changeset file compressed with zlib.
+ *
+ *  This sends a REPL_REPLY_CHANGESET_COMPRESSED message, which holds the
+ *  uncompressed size of the changeset (encoded with pack_uint()) followed by
+ *  a zlib stream of the changeset.  The compressed data is written to a
+ *  temporary file next to @a path so that it can be sent with
+ *  RemoteConnection::send_file().
+ *
+ *  @param conn		The connection to send on.
+ *  @param path		The path to the changeset file.
+ *  @param end_time	The time to timeout at.
+ */
+void send_compressed_changeset(RemoteConnection & conn,
+			       const std::string & path,
+			       const OmTime & end_time);
+
+/** Decompress a changeset received in a REPL_REPLY_CHANGESET_COMPRESSED
+ *  message.
+ *
+ *  The output file holds a complete REPL_REPLY_CHANGESET message, so a
+ *  RemoteConnection reading from it can be passed to
+ *  DatabaseReplicator::apply_changeset_from_conn().
+ *
+ *  @param in_path	The file holding the contents of the compressed
+ *			message.
+ *  @param out_path	The file to write the changeset message to.
+ */
+void decompress_changeset(const std::string & in_path,
+			  const std::string & out_path);
+
+#endif // XAPIAN_INCLUDED_CHANGESETCOMPRESS_H
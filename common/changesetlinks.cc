@@ -0,0 +1,147 @@
+/** @file changesetlinks.cc
+ * @brief Pin changesets with hard links while they're sent to a replica.
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "changesetlinks.h"
+
+#include "omdebug.h"
+#include "safedirent.h"
+#include "safeerrno.h"
+#include "safesysstat.h"
+#include "safeunistd.h"
+#include "stringutils.h"
+#include "utils.h"
+
+#include <sys/types.h>
+#ifdef HAVE_LINK
+# include <signal.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+/// Prefix of the leafname of each links directory.
+#define LINKS_DIR_PREFIX "replicate."
+
+ChangesetLinks::~ChangesetLinks()
+{
+    if (links_dir.empty()) return;
+    // We can be called from a destructor, so we can't throw an exception.
+    try {
+	removedir(links_dir);
+    } catch (...) {
+    }
+}
+
+void
+ChangesetLinks::remove_stale_links_dirs()
+{
+#ifdef HAVE_LINK
+    DIR * dir = opendir(db_dir.c_str());
+    if (dir == NULL) return;
+    while (true) {
+	struct dirent * entry = readdir(dir);
+	if (entry == NULL) break;
+	const char * leaf = entry->d_name;
+	size_t prefix_len = CONST_STRLEN(LINKS_DIR_PREFIX);
+	if (strncmp(leaf, LINKS_DIR_PREFIX, prefix_len) != 0) continue;
+	// The leafname is "replicate.<pid>.<unique suffix>".
+	char * end;
+	unsigned long pid = strtoul(leaf + prefix_len, &end, 10);
+	if (end == leaf + prefix_len || *end != '.') continue;
+	if (pid == 0 || pid == static_cast<unsigned long>(getpid())) continue;
+	if (kill(pid_t(pid), 0) == 0 || errno != ESRCH) continue;
+	// The process which created this directory no longer exists, so it
+	// must have been left behind when that process died.
+	LOGLINE(DB, "Removing stale changeset links directory " << leaf);
+	try {
+	    removedir(db_dir + '/' + leaf);
+	} catch (...) {
+	    // Another process may be removing it too - that's fine.
+	}
+    }
+    closedir(dir);
+#endif
+}
+
+bool
+ChangesetLinks::create_links_dir()
+{
+#ifdef HAVE_LINK
+    remove_stale_links_dirs();
+
+    // The pid lets stale directories be identified, and the suffix makes
+    // the name unique to this transfer, since a process may be sending
+    // changesets to several replicas at once.
+    string prefix = db_dir + "/" LINKS_DIR_PREFIX + om_tostring(getpid());
+# ifdef HAVE_MKDTEMP
+    string tmpl = prefix + ".XXXXXX";
+    if (mkdtemp(&tmpl[0]) == NULL) return false;
+    links_dir = tmpl;
+    return true;
+# else
+    static unsigned int counter = 0;
+    while (true) {
+	string dirname = prefix + '.' + om_tostring(++counter);
+	if (mkdir(dirname, 0700) == 0) {
+	    links_dir = dirname;
+	    return true;
+	}
+	if (errno != EEXIST) return false;
+    }
+# endif
+#else
+    return false;
+#endif
+}
+
+string
+ChangesetLinks::pin(uint4 rev)
+{
+    string changes_leaf = "/changes" + om_tostring(rev);
+    string changes_name = db_dir + changes_leaf;
+#ifdef HAVE_LINK
+    if (use_links && links_dir.empty()) {
+	if (!create_links_dir()) use_links = false;
+    }
+    if (use_links) {
+	string link_name = links_dir + changes_leaf;
+	// The directory is private to this transfer, so an existing link
+	// can only be left over from an earlier pin() of the same revision,
+	// which may since have been replaced - so link it afresh.
+	if (link(changes_name.c_str(), link_name.c_str()) == 0)
+	    return link_name;
+	if (errno == EEXIST) {
+	    if (unlink(link_name.c_str()) == 0 &&
+		link(changes_name.c_str(), link_name.c_str()) == 0)
+		return link_name;
+	}
+	if (errno == ENOENT) return string();
+	// Linking isn't supported here, so fall back to the original
+	// files.
+	use_links = false;
+    }
+#endif
+    if (!file_exists(changes_name)) return string();
+    return changes_name;
+}
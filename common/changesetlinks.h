@@ -0,0 +1,69 @@
+/** @file changesetlinks.h
+ * @brief Pin changesets with hard links while they're sent to a replica.
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_CHANGESETLINKS_H
+#define XAPIAN_INCLUDED_CHANGESETLINKS_H
+
+#include "internaltypes.h"
+
+#include <string>
+
+/** Hard links to the changesets being sent to a replica.
+ *
+ *  The changesets are linked into a private directory before we send them,
+ *  so that they can't be deleted under us if a writer removes old changesets
+ *  while a replica is being updated.  Each transfer gets its own uniquely
+ *  named directory, which is removed when this object is destroyed.  Any
+ *  directories left behind by processes which no longer exist are removed
+ *  when a new one is created.
+ *
+ *  If hard links aren't supported, the changesets are read from their
+ *  original location instead.
+ */
+class ChangesetLinks {
+    /// The database directory.
+    const std::string & db_dir;
+
+    /// The directory holding the links (empty until it is created).
+    std::string links_dir;
+
+    /// False if we've failed to create links, so shouldn't try again.
+    bool use_links;
+
+    /// Create links_dir, returning false if we can't.
+    bool create_links_dir();
+
+    /// Remove any links directories left behind by dead processes.
+    void remove_stale_links_dirs();
+
+  public:
+    ChangesetLinks(const std::string & db_dir_)
+	: db_dir(db_dir_), use_links(true) { }
+
+    ~ChangesetLinks();
+
+    /** Pin the changeset which starts at revision @a rev.
+     *
+     *  @return The path to read the changeset from, or an empty string if
+     *		there's no such changeset.
+     */
+    std::string pin(uint4 rev);
+};
+
+#endif // XAPIAN_INCLUDED_CHANGESETLINKS_H
@@ -332,7 +332,8 @@ ConstDatabaseWrapper::replace_document(const string &,
 
 void
 ConstDatabaseWrapper::write_changesets_to_fd(int, const std::string &, bool,
-					     Xapian::ReplicationInfo *)
+					     Xapian::ReplicationInfo *,
+					     BlockChecksumsSource *, bool)
 {
     nonconst_access();
 }
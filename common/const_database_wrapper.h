@@ -101,7 +101,8 @@ class ConstDatabaseWrapper : public Xapian::Database::Internal {
     void replace_document(Xapian::docid, const Xapian::Document &);
     Xapian::docid replace_document(const string &, const Xapian::Document &);
     void write_changesets_to_fd(int, const std::string &, bool,
-				Xapian::ReplicationInfo *);
+				Xapian::ReplicationInfo *,
+				BlockChecksumsSource *, bool);
     RemoteDatabase * as_remotedatabase();
 };
 
@@ -39,9 +39,11 @@
 
 using namespace std;
 
+class BlockChecksumsSource;
 class LeafPostList;
 class RemoteDatabase;
 
+typedef Xapian::PostingIterator::Internal PostList;
 typedef Xapian::TermIterator::Internal TermList;
 typedef Xapian::PositionIterator::Internal PositionList;
 typedef Xapian::ValueIterator::Internal ValueList;
@@ -241,6 +243,29 @@ class Database::Internal : public Xapian::Internal::RefCntBase {
 	 */
 	virtual ValueList * open_value_list(Xapian::valueno slot) const;
 
+	/** Return true if value slot @a slot has a value index.
+	 *
+	 *  If it does, open_value_index_post_list() can find the documents
+	 *  with a value in a range without looking at every value.
+	 */
+	virtual bool has_value_index(Xapian::valueno slot) const;
+
+	/** Open a posting list of the documents with a value in a range.
+	 *
+	 *  This is only implemented if has_value_index() returns true for
+	 *  @a slot.  The weights of the returned posting list are all 0.
+	 *
+	 *  @param slot	The value slot.
+	 *  @param begin	The start of the range (must not be empty).
+	 *  @param end	The end of the range, or empty for no upper bound.
+	 *
+	 *  @return	Pointer to a new PostList object which should be
+	 *		deleted by the caller once it is no longer needed.
+	 */
+	virtual PostList * open_value_index_post_list(Xapian::valueno slot,
+						      const string & begin,
+						      const string & end) const;
+
 	/** Open a term list.
 	 *
 	 *  This is a list of all the terms contained by a given document.
@@ -304,6 +329,18 @@ class Database::Internal : public Xapian::Internal::RefCntBase {
 	 */
 	virtual TermList * open_spelling_termlist(const string & word) const;
 
+	/** Return the candidate spelling corrections for @a word.
+	 *
+	 *  Unlike open_spelling_termlist(), this returns every spelling
+	 *  word within @a max_edit_distance of @a word (and possibly some
+	 *  others), so the candidates don't need scoring.
+	 *
+	 *  If the backend doesn't have an index which can do this for
+	 *  @a max_edit_distance, returns NULL.
+	 */
+	virtual TermList * open_spelling_candidates(const string & word,
+						    unsigned max_edit_distance) const;
+
 	/** Return a termlist which returns the words which are spelling
 	 *  correction targets.
 	 *
@@ -482,11 +519,23 @@ class Database::Internal : public Xapian::Internal::RefCntBase {
 	 *
 	 *  This call may reopen the database, leaving it pointing to a more
 	 *  recent version of the database.
+	 *
+	 *  If @a checksums is non-NULL, it can supply block checksums of the
+	 *  replica's current database files, and a full copy of the database
+	 *  may be sent as deltas against those files.  It should only be
+	 *  asked for them when a full copy is about to be sent.  Backends are
+	 *  free to ignore it.
+	 *
+	 *  If @a compress_changesets is true, the replica can decode
+	 *  REPL_REPLY_CHANGESET_COMPRESSED messages, so changesets may be
+	 *  sent compressed.
 	 */
 	virtual void write_changesets_to_fd(int fd,
 					    const std::string & start_revision,
 					    bool need_whole_db,
-					    Xapian::ReplicationInfo * info);
+					    Xapian::ReplicationInfo * info,
+					    BlockChecksumsSource * checksums,
+					    bool compress_changesets);
 
 	/// Get a string describing the current revision of the database.
 	virtual string get_revision_info() const;
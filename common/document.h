@@ -30,6 +30,7 @@
 #include "documentterm.h"
 #include <map>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -47,6 +48,21 @@ class Xapian::Document::Internal : public Xapian::Internal::RefCntBase {
 	/// Type to store terms in.
 	typedef map<string, OmDocumentTerm> document_terms;
 
+	/// A posting queued by queue_posting() but not yet merged into terms.
+	struct PendingPosting {
+	    /// Offset of the term name in pending_names.
+	    size_t offset;
+
+	    /// Length of the term name.
+	    size_t length;
+
+	    /// The position, or 0 for no position.
+	    Xapian::termpos tpos;
+
+	    /// The wdf increment.
+	    Xapian::termcount wdfinc;
+	};
+
     protected:
 	/// The database this document is in.
 	Xapian::Internal::RefCntPtr<const Xapian::Database::Internal> database;
@@ -69,6 +85,19 @@ class Xapian::Document::Internal : public Xapian::Internal::RefCntBase {
 	/// The terms (and their frequencies and positions) in this document.
 	mutable document_terms terms;
 
+	/** Postings queued by queue_posting().
+	 *
+	 *  These are sorted and merged into terms in a single pass the next
+	 *  time the terms are read or modified.
+	 */
+	mutable vector<PendingPosting> pending;
+
+	/// The names of the terms in pending, concatenated.
+	mutable string pending_names;
+
+	/// Merge any queued postings into terms.
+	void merge_pending() const;
+
     protected:
 	/** The document ID of the document in that database.
 	 *
@@ -80,6 +109,8 @@ class Xapian::Document::Internal : public Xapian::Internal::RefCntBase {
     private:
 	// Functions for backend to implement
 	virtual string do_get_value(Xapian::valueno /*valueno*/) const { return string(); }
+	virtual void do_get_values(const vector<Xapian::valueno> & slots,
+				   vector<string> & values_) const;
 	virtual void do_get_all_values(map<Xapian::valueno, string> & values_) const {
 	    values_.clear();
 	}
@@ -104,6 +135,18 @@ class Xapian::Document::Internal : public Xapian::Internal::RefCntBase {
 	 */
 	string get_value(Xapian::valueno valueid) const;
 
+	/** Get the values in several slots.
+	 *
+	 *  This gives the same results as calling get_value() for each slot,
+	 *  but allows backends to fetch the values together.
+	 *
+	 *  @param slots	The slots to get the values of.
+	 *  @param values_	Set to the value in each slot (empty for slots
+	 *			with no value).
+	 */
+	void get_values(const vector<Xapian::valueno> & slots,
+			vector<string> & values_) const;
+
 	/** Set all the values.
 	 *
 	 *  @param values_	The values to set - passed by non-const reference, and
@@ -126,6 +169,35 @@ class Xapian::Document::Internal : public Xapian::Internal::RefCntBase {
 	void clear_terms();
 	Xapian::termcount termlist_count() const;
 
+	/** Queue a posting to be added to the document.
+	 *
+	 *  This has the same effect as add_posting() (or add_term() if
+	 *  @a tpos is 0), but is much cheaper when adding many postings, as
+	 *  it just appends to a flat buffer which is sorted and merged into
+	 *  the terms in one go the next time they're needed.  It's used by
+	 *  TermGenerator.
+	 */
+	void queue_posting(const string & tname, Xapian::termpos tpos,
+			   Xapian::termcount wdfinc) {
+	    queue_posting(string(), tname, tpos, wdfinc);
+	}
+
+	/** Queue a posting for the term @a prefix + @a tname.
+	 *
+	 *  This avoids having to build the prefixed term in a temporary.
+	 */
+	void queue_posting(const string & prefix, const string & tname,
+			   Xapian::termpos tpos, Xapian::termcount wdfinc) {
+	    PendingPosting posting;
+	    posting.offset = pending_names.size();
+	    posting.length = prefix.size() + tname.size();
+	    posting.tpos = tpos;
+	    posting.wdfinc = wdfinc;
+	    pending_names += prefix;
+	    pending_names += tname;
+	    pending.push_back(posting);
+	}
+
 	/** Get data stored in document.
 	 *
 	 *  This is a general piece of data associated with a document, and
@@ -171,12 +243,12 @@ class Xapian::Document::Internal : public Xapian::Internal::RefCntBase {
 	/** Return true if the terms in the document may have been modified.
 	 */
 	bool terms_modified() const {
-	    return terms_here;
+	    return terms_here || !pending.empty();
 	}
 
 	/// Return true if the document may have been modified.
 	bool modified() const {
-	    return terms_here || values_here || data_here;
+	    return terms_modified() || values_here || data_here;
 	}
 
 	/** Get the docid which is associated with this document (if any).
@@ -0,0 +1,55 @@
+/** @file expandwildcard.h
+ * @brief Expand a wildcard pattern into a bounded list of terms.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_EXPANDWILDCARD_H
+#define XAPIAN_INCLUDED_EXPANDWILDCARD_H
+
+#include <xapian/termiterator.h>
+#include <xapian/types.h>
+
+#include <string>
+#include <vector>
+
+/** Expand a wildcard pattern.
+ *
+ *  @param t		A TermIterator over the terms starting with
+ *			@a pattern, in ascending byte order.  The iterator
+ *			must support get_termfreq() if @a max_type is
+ *			Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT.
+ *  @param pattern	The pattern being expanded (used in the message of
+ *			any exception thrown).
+ *  @param max_expansion The maximum number of terms to return, or 0 for no
+ *			limit.
+ *  @param max_type	A Xapian::Query::wildcard_limit value specifying
+ *			what to do if there are more than @a max_expansion
+ *			terms.
+ *  @param terms	The selected terms are appended to this vector, in
+ *			ascending byte order.
+ *  @param termfreqs	If not NULL, the term frequencies of the selected
+ *			terms are appended to this vector, in the same order
+ *			as @a terms.
+ *
+ *  @exception Xapian::WildcardError is thrown if @a max_type is
+ *	WILDCARD_LIMIT_ERROR and there are more than @a max_expansion terms.
+ */
+void expand_wildcard(Xapian::TermIterator t, const std::string & pattern,
+		     Xapian::termcount max_expansion, int max_type,
+		     std::vector<std::string> & terms,
+		     std::vector<Xapian::doccount> * termfreqs = NULL);
+
+#endif // XAPIAN_INCLUDED_EXPANDWILDCARD_H
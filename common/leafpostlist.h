@@ -47,12 +47,16 @@ class LeafPostList : public PostList {
 
     bool need_doclength;
 
+    /// Will a document length from get_approx_doclength() do for weighting?
+    bool approx_doclength_ok;
+
     /// The term name for this postlist ("" for an alldocs postlist).
     std::string term;
 
     /// Only constructable as a base class for derived classes.
     LeafPostList(const std::string & term_)
-	: weight(0), need_doclength(false), term(term_) { }
+	: weight(0), need_doclength(false), approx_doclength_ok(false),
+	  term(term_) { }
 
   public:
     ~LeafPostList();
@@ -68,6 +72,15 @@ class LeafPostList : public PostList {
      */
     void set_termweight(const Xapian::Weight * weight_);
 
+    /** Return an upper bound on the length of the current document.
+     *
+     *  This is used for weighting schemes which ask for DOC_LENGTH_APPROX.
+     *  It must never be less than the value get_doclength() returns, but
+     *  may be larger if a subclass can find it more cheaply.  The default
+     *  implementation just calls get_doclength().
+     */
+    virtual Xapian::termcount get_approx_doclength() const;
+
     /** Return the exact term frequency.
      *
      *  Leaf postlists have an exact termfreq, which get_termfreq_min(),
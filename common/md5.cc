@@ -0,0 +1,157 @@
+/** @file md5.cc
+ * @brief Calculate the MD5 digest of some data.
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "md5.h"
+
+#include <cstring>
+
+using namespace std;
+
+/// The per-round shift amounts.
+static const unsigned char shifts[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+/// The additive constants: floor(abs(sin(i + 1)) * 2^32).
+static const uint4 sines[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+MD5::MD5() : length(0)
+{
+    state[0] = 0x67452301;
+    state[1] = 0xefcdab89;
+    state[2] = 0x98badcfe;
+    state[3] = 0x10325476;
+}
+
+void
+MD5::transform(const unsigned char * block)
+{
+    uint4 x[16];
+    for (int i = 0; i < 16; ++i) {
+	x[i] = uint4(block[i * 4]) |
+	       (uint4(block[i * 4 + 1]) << 8) |
+	       (uint4(block[i * 4 + 2]) << 16) |
+	       (uint4(block[i * 4 + 3]) << 24);
+    }
+
+    uint4 a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; ++i) {
+	uint4 f;
+	int g;
+	switch (i >> 4) {
+	    case 0:
+		f = (b & c) | (~b & d);
+		g = i;
+		break;
+	    case 1:
+		f = (d & b) | (~d & c);
+		g = (5 * i + 1) & 15;
+		break;
+	    case 2:
+		f = b ^ c ^ d;
+		g = (3 * i + 5) & 15;
+		break;
+	    default:
+		f = c ^ (b | ~d);
+		g = (7 * i) & 15;
+		break;
+	}
+	uint4 t = (a + f + sines[i] + x[g]) & 0xffffffff;
+	a = d;
+	d = c;
+	c = b;
+	b = (b + ((t << shifts[i]) | (t >> (32 - shifts[i])))) & 0xffffffff;
+    }
+    state[0] = (state[0] + a) & 0xffffffff;
+    state[1] = (state[1] + b) & 0xffffffff;
+    state[2] = (state[2] + c) & 0xffffffff;
+    state[3] = (state[3] + d) & 0xffffffff;
+}
+
+void
+MD5::update(const char * p, size_t len)
+{
+    const unsigned char * data = reinterpret_cast<const unsigned char *>(p);
+    size_t used = size_t(length & 63);
+    length += len;
+    if (used) {
+	size_t n = 64 - used;
+	if (len < n) {
+	    memcpy(buf + used, data, len);
+	    return;
+	}
+	memcpy(buf + used, data, n);
+	transform(buf);
+	data += n;
+	len -= n;
+    }
+    while (len >= 64) {
+	transform(data);
+	data += 64;
+	len -= 64;
+    }
+    memcpy(buf, data, len);
+}
+
+string
+MD5::digest()
+{
+    uint8 bits = length * 8;
+    // Pad with a 1 bit and then zeros up to 56 bytes modulo 64, and then
+    // append the length in bits.
+    static const char padding[64] = { '\x80' };
+    size_t used = size_t(length & 63);
+    update(padding, (used < 56 ? 56 : 120) - used);
+    char len_bytes[8];
+    for (int i = 0; i < 8; ++i) {
+	len_bytes[i] = char((bits >> (i * 8)) & 0xff);
+    }
+    update(len_bytes, 8);
+
+    string result;
+    result.reserve(DIGEST_SIZE);
+    for (int i = 0; i < 4; ++i) {
+	for (int j = 0; j < 32; j += 8) {
+	    result += char((state[i] >> j) & 0xff);
+	}
+    }
+    return result;
+}
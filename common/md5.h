@@ -0,0 +1,62 @@
+/** @file md5.h
+ * @brief Calculate the MD5 digest of some data.
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MD5_H
+#define XAPIAN_INCLUDED_MD5_H
+
+#include "internaltypes.h"
+
+#include <cstddef>
+#include <string>
+
+/** Calculate the MD5 digest (RFC 1321) of a stream of data.
+ *
+ *  This is used to check that a file has been reproduced exactly, so
+ *  doesn't need to resist deliberate collisions.
+ */
+class MD5 {
+    /// The state (A, B, C, D).
+    uint4 state[4];
+
+    /// The number of bytes processed so far.
+    uint8 length;
+
+    /// Bytes which don't yet fill a 64 byte block.
+    unsigned char buf[64];
+
+    /// Process one 64 byte block.
+    void transform(const unsigned char * block);
+
+  public:
+    /// The size of the digest in bytes.
+    static const size_t DIGEST_SIZE = 16;
+
+    MD5();
+
+    /// Add @a len bytes at @a p to the data being digested.
+    void update(const char * p, size_t len);
+
+    /** Return the digest of the data added.
+     *
+     *  The object can't be updated further after this is called.
+     */
+    std::string digest();
+};
+
+#endif // XAPIAN_INCLUDED_MD5_H
@@ -79,6 +79,31 @@ class MultiMatch
 	 */
         Xapian::weight getorrecalc_maxweight(PostList *pl);
 
+	/// The state of the match, shared with the main match loop.
+	struct MatchState;
+
+	/** Run the main match loop, instantiated for the sort order in use.
+	 *
+	 *  @param s	The state of the match.
+	 */
+	void run_match_loop(MatchState & s);
+
+	/** The main match loop.
+	 *
+	 *  This is a template so that the MSet comparison function @a CMP can
+	 *  be inlined into the loop and the heap operations, and checks on
+	 *  the sort order @a SORT_BY are resolved at compile time.  If
+	 *  @a SIMPLE is true, there's no match decider, match spy or
+	 *  collapsing, and the code to handle them is left out.
+	 *
+	 *  @param s	The state of the match.
+	 */
+	template<bool (* CMP)(const Xapian::Internal::MSetItem &,
+			      const Xapian::Internal::MSetItem &),
+		 Xapian::Enquire::Internal::sort_setting SORT_BY,
+		 bool SIMPLE>
+	void match_loop(MatchState & s);
+
 	/// Copying is not permitted.
 	MultiMatch(const MultiMatch &);
 
@@ -63,6 +63,9 @@ class MultiValueList : public ValueList {
     /// Return the value at the current position.
     std::string get_value() const;
 
+    /// Return the value at the current position as a number.
+    double get_value_as_double() const;
+
     /// Return the value slot for the current position/this iterator.
     Xapian::valueno get_valueno() const;
 
@@ -30,6 +30,8 @@
 #include "xapian/query.h"
 #include "xapian/keymaker.h"
 
+#include "internaltypes.h"
+
 #include <algorithm>
 #include <cmath>
 #include <map>
@@ -55,30 +57,63 @@ namespace Internal {
 class MSetItem {
     public:
 	MSetItem(Xapian::weight wt_, Xapian::docid did_)
-		: wt(wt_), did(did_), collapse_count(0) {}
+		: wt(wt_), did(did_), collapse_entry(0), collapse_count(0),
+		  sort_key_head(0) {}
 
 	MSetItem(Xapian::weight wt_, Xapian::docid did_, const string &key_)
-		: wt(wt_), did(did_), collapse_key(key_), collapse_count(0) {}
+		: wt(wt_), did(did_), collapse_entry(0), collapse_key(key_),
+		  collapse_count(0), sort_key_head(0) {}
 
 	MSetItem(Xapian::weight wt_, Xapian::docid did_, const string &key_,
 		 Xapian::doccount collapse_count_)
-		: wt(wt_), did(did_), collapse_key(key_),
-		  collapse_count(collapse_count_) {}
+		: wt(wt_), did(did_), collapse_entry(0), collapse_key(key_),
+		  collapse_count(collapse_count_), sort_key_head(0) {}
 
 	void swap(MSetItem & o) {
 	    std::swap(wt, o.wt);
 	    std::swap(did, o.did);
+	    std::swap(collapse_entry, o.collapse_entry);
 	    std::swap(collapse_key, o.collapse_key);
 	    std::swap(collapse_count, o.collapse_count);
+	    std::swap(sort_key_head, o.sort_key_head);
 	    std::swap(sort_key, o.sort_key);
 	}
 
+	/** Set the key to sort by.
+	 *
+	 *  @param key	The key.  If it is longer than 7 bytes, it is swapped
+	 *		into sort_key, otherwise it is left untouched.
+	 */
+	void set_sort_key(string & key) {
+	    uint8 head = 0;
+	    size_t n = std::min(key.size(), size_t(7));
+	    for (size_t i = 0; i != 7; ++i) {
+		head <<= 8;
+		if (i < n) head |= static_cast<unsigned char>(key[i]);
+	    }
+	    head <<= 8;
+	    if (key.size() > 7) {
+		head |= 8;
+		sort_key.swap(key);
+	    } else {
+		head |= key.size();
+	    }
+	    sort_key_head = head;
+	}
+
 	/** Weight calculated. */
 	Xapian::weight wt;
 
 	/** Document id. */
 	Xapian::docid did;
 
+	/** The Collapser's entry for this item's collapse key, plus one.
+	 *
+	 *  This is 0 if the item has no collapse key.  It's only used during
+	 *  the match, so that Collapser::finalise() can find the key.
+	 */
+	Xapian::doccount collapse_entry;
+
 	/** Value which was used to collapse upon.
 	 *
 	 *  If the collapse option is not being used, this will always
@@ -100,7 +135,21 @@ class MSetItem {
 	 */
 	Xapian::doccount collapse_count;
 
-	/** Used when sorting by value. */
+	/** The start of the key used when sorting by value.
+	 *
+	 *  The first 7 bytes of the key (padded with zero bytes) are packed
+	 *  into the top 56 bits, most significant first, and the length of the
+	 *  key (or 8 if it is longer than 7 bytes) into the bottom 8 bits.  So
+	 *  comparing sort_key_head orders keys in the same way as comparing the
+	 *  keys themselves, except that keys longer than 7 bytes which share
+	 *  their first 7 bytes compare equal.
+	 */
+	uint8 sort_key_head;
+
+	/** Used when sorting by value, if the key is longer than 7 bytes.
+	 *
+	 *  Shorter keys are compared using just sort_key_head.
+	 */
 	/* FIXME: why not just cache the Xapian::Document here!?! */
 	string sort_key;
 
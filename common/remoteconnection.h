@@ -121,6 +121,9 @@ class RemoteConnection {
     /// Remaining bytes of message data still to come over fdin for a chunked read.
     off_t chunked_data_left;
 
+    /// Total number of bytes read from fdin and written to fdout.
+    off_t bytes_transferred;
+
     /** Read until there are at least min_len bytes in buffer.
      *
      *  If for some reason this isn't possible, throws NetworkError.
@@ -132,6 +135,35 @@ class RemoteConnection {
      */
     void read_at_least(size_t min_len, const OmTime & end_time);
 
+#ifndef __WIN32__
+    /** Wait until fdin is ready to read.
+     *
+     *  Throws NetworkTimeoutError if end_time is reached first.
+     *
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.  This must be set.
+     */
+    void wait_for_input(const OmTime & end_time);
+#endif
+
+#ifdef HAVE_SPLICE
+    /** Copy message data from fdin straight into a file using splice().
+     *
+     *  Any data already in buffer must have been written to fd first.
+     *
+     *  @param fd	File descriptor to write the data to.
+     *  @param len	Number of bytes of data to copy.
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.  If end_time == OmTime(),
+     *			then keep trying indefinitely.
+     *
+     *  @return		true if the data was copied; false if splice() isn't
+     *			usable for these file descriptors (in which case no
+     *			data has been consumed from fdin).
+     */
+    bool splice_to_file(int fd, off_t len, const OmTime & end_time);
+#endif
+
 #ifdef __WIN32__
     /** On Windows we use overlapped IO.  We share an overlapped structure
      *  for both reading and writing, as we know that we always wait for
@@ -270,6 +302,13 @@ class RemoteConnection {
      */
     void send_file(char type, const std::string &file, const OmTime & end_time);
 
+    /** Return the number of bytes transferred over this connection.
+     *
+     *  This counts bytes read from fdin and bytes written to fdout
+     *  (including message headers) since the connection was created.
+     */
+    off_t get_bytes_transferred() const { return bytes_transferred; }
+
     /** Shutdown the connection.
      *
      *  @param wait	If true, wait for the remote end to close the
@@ -43,8 +43,9 @@
 // 32: 1.1.1 Serialise termfreq and reltermfreqs together in serialise_stats.
 // 33: 1.1.3 Support for passing matchspies over the remote connection.
 // 34: 1.1.4 Support for metadata over with remote databases.
+// 34.1: Support for OP_WILDCARD in query serialisation.
 #define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 34
-#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 0
+#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 1
 
 /** Message types (client -> server).
  *
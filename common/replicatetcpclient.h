@@ -71,9 +71,19 @@ class XAPIAN_VISIBILITY_DEFAULT ReplicateTcpClient SOCKET_INITIALIZER_MIXIN {
     ReplicateTcpClient(const std::string & hostname, int port,
 		       int msecs_timeout_connect);
 
+    /** Update the replica at @a path from database @a remotedb on the server.
+     *
+     *  If @a send_checksums is true, the master is told it can ask for block
+     *  checksums of the replica, which it does if a full copy is needed, so
+     *  that only changed blocks are transferred.  If
+     *  @a compress is true, the server is asked to send changesets
+     *  compressed (which older servers don't understand).
+     */
     void update_from_master(const std::string & path,
 			    const std::string & remotedb,
-			    Xapian::ReplicationInfo & info);
+			    Xapian::ReplicationInfo & info,
+			    bool send_checksums = false,
+			    bool compress = false);
 
     /** Destructor. */
     ~ReplicateTcpClient();
@@ -38,9 +38,11 @@ class XAPIAN_VISIBILITY_DEFAULT ReplicateTcpServer : public TcpServer {
      *			(or "" to listen on all interfaces).
      *  @param port	The TCP port number to listen on.
      *  @param path_	The path to the parent directory of the databases.
+     *  @param verbose	Should we report on connections and on each
+     *			replication performed?
      */
     ReplicateTcpServer(const std::string & host, int port,
-		       const std::string & path_);
+		       const std::string & path_, bool verbose = false);
 
     /// Destructor.
     ~ReplicateTcpServer();
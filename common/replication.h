@@ -28,6 +28,8 @@
 
 #include <string>
 
+#include <sys/types.h>
+
 namespace Xapian {
 
 /** Information about the steps involved in performing a replication. */
@@ -45,16 +47,50 @@ struct XAPIAN_VISIBILITY_DEFAULT ReplicationInfo {
      */
     bool changed;
 
+    /** Number of bytes sent or received over the connection.
+     *
+     *  This includes protocol overhead as well as the contents of changesets
+     *  and database files.
+     */
+    off_t bytes_transferred;
+
+    /// Time taken to perform the replication (in seconds).
+    double transfer_seconds;
+
+    /** Number of revisions the replica was behind the master.
+     *
+     *  This is only set by DatabaseMaster::write_changesets_to_fd(), from the
+     *  revision which the replica reported.  It is -1 if the replica's
+     *  revision couldn't be compared with the master's (for example, because
+     *  a full copy of the database was needed).
+     */
+    int revision_lag;
+
     ReplicationInfo()
 	: changeset_count(0),
 	  fullcopy_count(0),
-	  changed(false)
+	  changed(false),
+	  bytes_transferred(0),
+	  transfer_seconds(0.0),
+	  revision_lag(0)
     {}
 
     void clear() {
 	changeset_count = 0;
 	fullcopy_count = 0;
 	changed = false;
+	bytes_transferred = 0;
+	transfer_seconds = 0.0;
+	revision_lag = 0;
+    }
+
+    /** Return the average throughput in bytes per second.
+     *
+     *  Returns 0 if no time was recorded.
+     */
+    double get_throughput() const {
+	if (transfer_seconds <= 0.0) return 0.0;
+	return double(bytes_transferred) / transfer_seconds;
     }
 };
 
@@ -103,6 +139,44 @@ class XAPIAN_VISIBILITY_DEFAULT DatabaseMaster {
 				const std::string & start_revision,
 				ReplicationInfo * info) const;
 
+    /** Write a set of changesets, using block checksums from the replica.
+     *
+     *  This is like the three argument form, except that if a full copy of
+     *  the database is needed, any table file which the replica already has
+     *  is sent as only those blocks which differ from the replica's copy.
+     *
+     *  @param block_checksums  The string returned by
+     *                  DatabaseReplica::get_block_checksums(), or an empty
+     *                  string to always send whole files.
+     *
+     *  @param compress_changesets  If true, send changesets compressed.
+     *                  Only set this if the replica is new enough to
+     *                  decode them (any DatabaseReplica from this version
+     *                  on can), which saves bandwidth at the cost of some
+     *                  CPU time on both sides.
+     */
+    void write_changesets_to_fd(int fd,
+				const std::string & start_revision,
+				ReplicationInfo * info,
+				const std::string & block_checksums,
+				bool compress_changesets = false) const;
+
+    /** Write a set of changesets to a socket connected to the replica.
+     *
+     *  This is like write_changesets_to_fd(), except that if a full copy of
+     *  the database is needed, the replica is first asked for block
+     *  checksums of its database files over @a fd, so only blocks which
+     *  differ need to be sent.  The replica must be reading with a
+     *  DatabaseReplica which has @a fd (or the other end of it) as its
+     *  read fd, and must have advertised that it can supply checksums.
+     *
+     *  @param fd       A socket connected to the replica.
+     */
+    void write_changesets_to_socket(int fd,
+				    const std::string & start_revision,
+				    ReplicationInfo * info,
+				    bool compress_changesets = false) const;
+
     /// Return a string describing this object.
     std::string get_description() const;
 };
@@ -160,10 +234,30 @@ class XAPIAN_VISIBILITY_DEFAULT DatabaseReplica {
      *  This will be remembered in the DatabaseReplica, but the caller is still
      *  responsible for closing it after it is finished with.
      *
+     *  If the master was told the replica can supply block checksums, they
+     *  are written back to @a fd when the master asks for them, so it must
+     *  then be a socket.
+     *
      *  @param fd The file descriptor to read the changeset from.
      */
     void set_read_fd(int fd);
 
+    /** Get checksums of the blocks of the replica's current database files.
+     *
+     *  These can be passed to the master, which will then only send the
+     *  blocks which have changed if a full copy of the database is needed.
+     *  This reads the whole database, so when replicating over a socket it
+     *  is better to let the master ask for them only when it needs them -
+     *  see DatabaseMaster::write_changesets_to_socket().
+     *  This is worthwhile when the master has been compacted or has run out
+     *  of changesets, but most of the data is unchanged.
+     *
+     *  The checksums are only used for a copy which is the first thing
+     *  applied after they were calculated - if the replica changes first,
+     *  apply_next_changeset() will throw NetworkError.
+     */
+    std::string get_block_checksums() const;
+
     /** Read and apply the next changeset.
      *
      *  If no changesets are found on the file descriptor, returns false
@@ -0,0 +1,192 @@
+/** @file replicationdelta.h
+ *  @brief Send database files to a replica as deltas against its own copy.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_REPLICATIONDELTA_H
+#define XAPIAN_INCLUDED_REPLICATIONDELTA_H
+
+#include <map>
+#include <string>
+
+#include "safeunistd.h"
+
+class OmTime;
+class RemoteConnection;
+
+/** Checksums for each block of the table files in a database.
+ *
+ *  A replica which needs a full copy of the database can send these to the
+ *  master, which then only needs to send the blocks which differ.  The
+ *  checksums are calculated on fixed size blocks of each file, so this works
+ *  for any backend which stores its tables in files with names ending ".DB".
+ */
+class BlockChecksums {
+    /// The size of the blocks which the checksums are for.
+    unsigned block_size;
+
+    /// Map from file leafname to the checksums of its blocks, concatenated.
+    std::map<std::string, std::string> files;
+
+  public:
+    /// The size of each block's checksum in bytes.
+    static const size_t CHECKSUM_SIZE = 8;
+
+    /** The default block size to use.
+     *
+     *  This is the default B-tree block size, so changed B-tree blocks map
+     *  directly to changed checksum blocks.
+     */
+    static const unsigned DEFAULT_BLOCK_SIZE = 8192;
+
+    BlockChecksums() : block_size(0) { }
+
+    /** Calculate the checksums for the tables in a database directory.
+     *
+     *  @param db_dir		The database directory.
+     *  @param block_size_	The block size to use.
+     */
+    void calculate(const std::string & db_dir,
+		   unsigned block_size_ = DEFAULT_BLOCK_SIZE);
+
+    /// Serialise the checksums to a string.
+    std::string serialise() const;
+
+    /** Unserialise checksums from a string.
+     *
+     *  Throws NetworkError if the string isn't valid.
+     */
+    void unserialise(const std::string & s);
+
+    /// Return true if we don't have checksums for any files.
+    bool empty() const { return files.empty(); }
+
+    /// Return true if we have checksums for file @a leaf.
+    bool has_file(const std::string & leaf) const {
+	return files.find(leaf) != files.end();
+    }
+
+    /// Return the block size the checksums are for.
+    unsigned get_block_size() const { return block_size; }
+
+    /** Check if a block of a file matches the checksum we have for it.
+     *
+     *  @param leaf	The leafname of the file.
+     *  @param n	The block number (counting from 0).
+     *  @param p	The data of the block.
+     *  @param len	The length of the block (which is less than the block
+     *			size for the last block of a file).
+     *
+     *  @return	true if we have a checksum for that block and it matches.
+     */
+    bool block_matches(const std::string & leaf, off_t n,
+		       const char * p, size_t len) const;
+};
+
+/** Supplies the replica's block checksums when a full copy is needed.
+ *
+ *  Calculating checksums means reading the replica's whole database, so
+ *  they're only worth having if a full copy is actually going to be sent.
+ */
+class BlockChecksumsSource {
+  public:
+    virtual ~BlockChecksumsSource();
+
+    /** Get the checksums.
+     *
+     *  This is called just before a full copy is sent, and only once per
+     *  conversation.
+     *
+     *  @param conn	The connection the copy is being sent on.
+     *  @param end_time	The time to timeout at.
+     *
+     *  @return	The checksums, or NULL if there aren't any.
+     */
+    virtual const BlockChecksums * get(RemoteConnection & conn,
+				       const OmTime & end_time) = 0;
+};
+
+/// Block checksums which were sent before the conversation started.
+class StoredBlockChecksums : public BlockChecksumsSource {
+    BlockChecksums checksums;
+
+  public:
+    /** Construct from the serialised checksums.
+     *
+     *  Throws NetworkError if @a s isn't valid.
+     */
+    StoredBlockChecksums(const std::string & s) {
+	if (!s.empty()) checksums.unserialise(s);
+    }
+
+    const BlockChecksums * get(RemoteConnection &, const OmTime &);
+};
+
+/** Block checksums requested from the replica when they're needed.
+ *
+ *  A REPL_REPLY_NEED_CHECKSUMS message is sent, and the replica replies
+ *  with a 'C' message on the same socket.
+ */
+class RequestedBlockChecksums : public BlockChecksumsSource {
+    /// The socket connected to the replica.
+    int fd;
+
+    BlockChecksums checksums;
+
+  public:
+    RequestedBlockChecksums(int fd_) : fd(fd_) { }
+
+    const BlockChecksums * get(RemoteConnection & conn,
+			       const OmTime & end_time);
+};
+
+/** Send a file to a replica, only including blocks which differ.
+ *
+ *  This sends a REPL_REPLY_DB_FILEDELTA message, followed by zero or more
+ *  REPL_REPLY_DB_BLOCKS messages holding the blocks which don't match the
+ *  replica's checksums, and then a REPL_REPLY_DB_FILEHASH message holding
+ *  the MD5 digest of the whole file.
+ *
+ *  @param conn		The connection to send on.
+ *  @param checksums	The checksums from the replica.
+ *  @param leaf		The leafname of the file.
+ *  @param path		The path to the file to send.
+ *  @param end_time	The time to timeout at.
+ */
+void send_file_delta(RemoteConnection & conn,
+		     const BlockChecksums & checksums,
+		     const std::string & leaf,
+		     const std::string & path,
+		     const OmTime & end_time);
+
+/** Receive a file sent by send_file_delta().
+ *
+ *  The file is reconstructed from the replica's existing copy of it and the
+ *  blocks received, and then checked against the master's digest of it.
+ *  NetworkError is thrown if they don't match.
+ *
+ *  @param conn		The connection to read from.
+ *  @param old_path	The path to the replica's existing copy of the file,
+ *			which the checksums were calculated from.
+ *  @param new_path	The path to write the new file to.
+ *  @param end_time	The time to timeout at.
+ */
+void receive_file_delta(RemoteConnection & conn,
+			const std::string & old_path,
+			const std::string & new_path,
+			const OmTime & end_time);
+
+#endif // XAPIAN_INCLUDED_REPLICATIONDELTA_H
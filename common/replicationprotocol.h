@@ -23,8 +23,12 @@
 
 // Versions:
 // 1: Initial support
+// 1.1: Add REPL_REPLY_DB_FILEDELTA and REPL_REPLY_DB_BLOCKS
+// 1.2: Add REPL_REPLY_CHANGESET_COMPRESSED
+// 1.3: Block checksums are requested with REPL_REPLY_NEED_CHECKSUMS from
+//      clients which advertise REPL_CAP_CHECKSUMS; add REPL_REPLY_DB_FILEHASH
 #define XAPIAN_REPLICATION_PROTOCOL_MAJOR_VERSION 1
-#define XAPIAN_REPLICATION_PROTOCOL_MINOR_VERSION 0
+#define XAPIAN_REPLICATION_PROTOCOL_MINOR_VERSION 3
 
 // Reply types (master -> slave)
 enum replicate_reply_type {
@@ -34,7 +38,20 @@ enum replicate_reply_type {
     REPL_REPLY_DB_FILENAME,	// The name of a file in a DB copy.
     REPL_REPLY_DB_FILEDATA,	// Contents of a file in a DB copy.
     REPL_REPLY_DB_FOOTER,	// End of a whole DB copy.
-    REPL_REPLY_CHANGESET	// A changeset file is being sent.
+    REPL_REPLY_CHANGESET,	// A changeset file is being sent.
+    REPL_REPLY_DB_FILEDELTA,	// A file in a DB copy is sent as a delta.
+    REPL_REPLY_DB_BLOCKS,	// Blocks of a file sent as a delta.
+    REPL_REPLY_CHANGESET_COMPRESSED, // A compressed changeset is being sent.
+    REPL_REPLY_DB_FILEHASH,	// MD5 digest of a file sent as a delta.
+    REPL_REPLY_NEED_CHECKSUMS	// Send block checksums for a full copy.
+};
+
+// Capabilities a client can advertise by appending them (with pack_uint())
+// to the revision in its 'R' message.  Masters which predate them only
+// decode the revision number, so ignore anything after it.
+enum replicate_capability {
+    // The client will reply to REPL_REPLY_NEED_CHECKSUMS with a 'C' message.
+    REPL_CAP_CHECKSUMS = 1
 };
 
 // The maximum number of copies of a database to send in a single conversation.
@@ -101,6 +101,28 @@ common_prefix_length(const std::string &a, const std::string &b)
     return common;
 }
 
+/** Hash a string using the FNV-1a algorithm.
+ *
+ *  This is quick to calculate and distributes short strings such as words
+ *  well, so is suitable for in-memory hash tables.
+ */
+inline unsigned
+hash_string(const char * p, size_t len)
+{
+    unsigned h = 2166136261u;
+    while (len--) {
+	h ^= static_cast<unsigned char>(*p++);
+	h *= 16777619u;
+    }
+    return h;
+}
+
+inline unsigned
+hash_string(const std::string & s)
+{
+    return hash_string(s.data(), s.size());
+}
+
 // Like C's isXXXXX() but:
 //  (a) always work in the C locale
 //  (b) handle signed char as well as unsigned char
@@ -51,6 +51,44 @@ class Xapian::ValueIterator::Internal : public Xapian::Internal::RefCntBase {
     /// Return the value at the current position.
     virtual std::string get_value() const = 0;
 
+    /** Return the value at the current position as a number.
+     *
+     *  This is the value decoded by Xapian::sortable_unserialise(), which
+     *  is what the default implementation does.  Subclasses which store the
+     *  values as numbers override this (and stores_doubles()) so that the
+     *  value doesn't need to be decoded.
+     */
+    virtual double get_value_as_double() const;
+
+    /** Return true if get_value_as_double() doesn't need to decode the value.
+     *
+     *  In this case, all the values are numbers encoded by
+     *  Xapian::sortable_serialise().  The default implementation returns
+     *  false.
+     */
+    virtual bool stores_doubles() const;
+
+    /** Get upper bounds on the values as returned by get_value_as_double().
+     *
+     *  Subclasses which keep the maximum value for each block of documents
+     *  override this so that callers can skip blocks whose values are all
+     *  too low.  The default implementation returns false.
+     *
+     *  @param did		A document id (which needn't have a value).
+     *  @param block_end	Set to the last document id in the block
+     *			containing @a did.
+     *  @param block_max	Set to an upper bound on the values for documents
+     *			@a did to @a block_end.
+     *  @param rest_max	Set to an upper bound on the values for documents
+     *			@a did onwards.
+     *
+     *  @return true if the bounds are available.
+     */
+    virtual bool get_value_upper_bounds(Xapian::docid did,
+					Xapian::docid & block_end,
+					double & block_max,
+					double & rest_max) const;
+
     /// Return the value slot for the current position/this iterator.
     virtual Xapian::valueno get_valueno() const = 0;
 
@@ -183,4 +183,8 @@ errorclass('RangeError', 'RuntimeError', <<'DOC');
  */
 DOC
 
+errorclass('WildcardError', 'RuntimeError', <<'DOC');
+/** WildcardError indicates an error expanding a wildcarded query. */
+DOC
+
 1;
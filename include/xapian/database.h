@@ -364,6 +364,11 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 	}
 
 	/** An iterator which returns all the synonyms for a given term.
+	 *
+	 *  If XAPIAN_CACHE_SYNONYMS is set to a non-zero value in the
+	 *  environment, read-only brass databases load all the synonyms into
+	 *  memory when opened (and again if reopen() finds a new revision),
+	 *  which avoids reading the synonym table for each lookup.
 	 *
 	 *  @param term	    The term to return synonyms for.
 	 */
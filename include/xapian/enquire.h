@@ -43,6 +43,7 @@ class ExpandDecider;
 class MatchSpy;
 class MSetIterator;
 class Query;
+class ValueSetMatchDecider;
 class Weight;
 
 /** A match set (MSet).
@@ -619,6 +620,16 @@ class XAPIAN_VISIBILITY_DEFAULT MatchDecider {
 	 */
 	virtual bool operator()(const Xapian::Document &doc) const = 0;
 
+	/** Return a ValueSetMatchDecider equivalent to this decider, if any.
+	 *
+	 *  If this returns non-NULL, the matcher may filter the candidate
+	 *  documents by iterating the values in the returned decider's slot
+	 *  instead of calling operator() on each of them.
+	 *
+	 *  The default implementation returns NULL.
+	 */
+	virtual const ValueSetMatchDecider * get_value_set_filter() const;
+
 	/// Destructor.
 	virtual ~MatchDecider();
 };
@@ -764,6 +764,36 @@ class XAPIAN_VISIBILITY_DEFAULT RangeError : public RuntimeError {
 	: RuntimeError(msg_, context_, type_, errno_) {}
 };
 
+/** WildcardError indicates an error expanding a wildcarded query. */
+class XAPIAN_VISIBILITY_DEFAULT WildcardError : public RuntimeError {
+  public:
+    /** @private @internal
+     *  @brief Private constructor for use by remote backend.
+     *
+     *  @param error_string_	Optional string describing error.  May be NULL.
+     */
+    WildcardError(const std::string &msg_, const std::string &context_, const char * error_string_)
+	: RuntimeError(msg_, context_, "WildcardError", error_string_) {}
+    /** General purpose constructor which allows setting errno. */
+    explicit WildcardError(const std::string &msg_, const std::string &context_ = std::string(), int errno_ = 0)
+	: RuntimeError(msg_, context_, "WildcardError", errno_) {}
+    /** Construct from message and errno value. */
+    WildcardError(const std::string &msg_, int errno_)
+	: RuntimeError(msg_, std::string(), "WildcardError", errno_) {}
+  protected:
+    /** @private @internal
+     *  @brief Constructor for use by constructors of derived classes.
+     */
+    WildcardError(const std::string &msg_, const std::string &context_, const char * type_, const char * error_string_)
+	: RuntimeError(msg_, context_, type_, error_string_) {}
+
+    /** @private @internal
+     *  @brief Constructor for use by constructors of derived classes.
+     */
+    WildcardError(const std::string &msg_, const std::string &context_, const char * type_, int errno_)
+	: RuntimeError(msg_, context_, type_, errno_) {}
+};
+
 }
 
 #endif /* XAPIAN_INCLUDED_ERROR_H */
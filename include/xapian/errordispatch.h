@@ -42,4 +42,5 @@ if (type == "NetworkTimeoutError") throw Xapian::NetworkTimeoutError(msg, contex
 if (type == "QueryParserError") throw Xapian::QueryParserError(msg, context, error_string);
 if (type == "SerialisationError") throw Xapian::SerialisationError(msg, context, error_string);
 if (type == "RangeError") throw Xapian::RangeError(msg, context, error_string);
+if (type == "WildcardError") throw Xapian::WildcardError(msg, context, error_string);
 #endif /* DOXYGEN */
@@ -78,6 +78,65 @@ class XAPIAN_VISIBILITY_DEFAULT MultiValueKeyMaker : public KeyMaker {
     }
 };
 
+/** KeyMaker subclass which builds fixed width keys from several values.
+ *
+ *  Each value is truncated or padded to a fixed width, so the keys built all
+ *  have the same length and no escaping is needed, which makes them cheap to
+ *  compare.  The intended use is to build a key for each of the sort orders
+ *  an application needs when indexing a document, and store it in a value
+ *  slot:
+ *
+ *    Xapian::FixedWidthKeyMaker by_date_then_price;
+ *    by_date_then_price.add_value(DATE_SLOT, 4);
+ *    by_date_then_price.add_value(PRICE_SLOT, 3, true);
+ *    doc.add_value(DATE_PRICE_KEY_SLOT, by_date_then_price(doc));
+ *
+ *  and then sort by that slot with Enquire::set_sort_by_value(), so the key
+ *  doesn't need to be built for each candidate document during the match.
+ *  The matcher compares keys of up to 7 bytes as integers.
+ *
+ *  Values longer than their width are truncated, so they should be of a
+ *  fixed length (e.g. a fixed number of bytes of a big-endian integer) or
+ *  at least differ within the width.  A value which is shorter than its
+ *  width is padded with zero bytes (or 0xff bytes for a reverse ordered
+ *  value), which means that values differing only by trailing zero bytes
+ *  sort together.
+ */
+class XAPIAN_VISIBILITY_DEFAULT FixedWidthKeyMaker : public KeyMaker {
+    struct Column {
+	Xapian::valueno valno;
+	size_t width;
+	bool reverse;
+    };
+
+    std::vector<Column> columns;
+
+    size_t key_width;
+
+  public:
+    FixedWidthKeyMaker() : key_width(0) { }
+
+    virtual std::string operator()(const Xapian::Document & doc) const;
+
+    /** Add a value to the key.
+     *
+     *  @param valno	The slot to use the value from.
+     *  @param width	The number of bytes of the key to use for the value.
+     *  @param reverse	If true, reverse the sort order for this value.
+     */
+    void add_value(Xapian::valueno valno, size_t width, bool reverse = false) {
+	Column c;
+	c.valno = valno;
+	c.width = width;
+	c.reverse = reverse;
+	columns.push_back(c);
+	key_width += width;
+    }
+
+    /// The length of the keys built.
+    size_t get_width() const { return key_width; }
+};
+
 /** Virtual base class for sorter functor. */
 class XAPIAN_VISIBILITY_DEFAULT XAPIAN_DEPRECATED() Sorter : public KeyMaker { };
 
@@ -179,11 +179,34 @@ class XAPIAN_VISIBILITY_DEFAULT ValueCountMatchSpy : public MatchSpy {
 	/// Total number of documents seen by the match spy.
 	Xapian::doccount total;
 
-	/// The values seen so far, together with their frequency.
+	/** The values seen so far, together with their frequency.
+	 *
+	 *  Counts for values seen during the match are accumulated in
+	 *  ordinal_counts, and only folded into this map by
+	 *  flush_ordinals().
+	 */
 	std::map<std::string, Xapian::doccount> values;
 
+	/// The distinct values counted since the last flush, by ordinal.
+	std::vector<std::string> ordinal_values;
+
+	/// The frequency of each value in ordinal_values.
+	std::vector<Xapian::doccount> ordinal_counts;
+
+	/** Open-addressed hash table mapping values to ordinals.
+	 *
+	 *  Each slot holds an ordinal plus one, or 0 if the slot is empty.
+	 */
+	std::vector<Xapian::doccount> ordinal_table;
+
 	Internal() : slot(Xapian::BAD_VALUENO), total(0) {}
 	Internal(Xapian::valueno slot_) : slot(slot_), total(0) {}
+
+	/// Count an occurrence of @a value (which must not be empty).
+	void count(const std::string & value);
+
+	/// Fold the counts accumulated by count() into values.
+	void flush_ordinals();
     };
 #endif
 
@@ -250,6 +273,150 @@ class XAPIAN_VISIBILITY_DEFAULT ValueCountMatchSpy : public MatchSpy {
     virtual std::string get_description() const;
 };
 
+/** Class for counting the frequencies of values in several slots.
+ *
+ *  This gives the same counts as using a ValueCountMatchSpy for each slot,
+ *  but fetches the values in all the slots for each document together,
+ *  which is more efficient when counting many slots.
+ *
+ *  It can also be told to only count the values in the first documents
+ *  seen, to bound the cost for queries which match a lot of documents - the
+ *  frequencies returned are then estimated by scaling up those counted.
+ *
+ *  Warning: this API is currently experimental, and is liable to change
+ *  between releases without warning.
+ */
+class XAPIAN_VISIBILITY_DEFAULT MultiValueCountMatchSpy : public MatchSpy {
+  public:
+    struct Internal;
+
+#ifndef SWIG // SWIG doesn't need to know about the internal class
+    struct XAPIAN_VISIBILITY_DEFAULT Internal
+	    : public Xapian::Internal::RefCntBase
+    {
+	/// The slots to count.
+	std::vector<Xapian::valueno> slots;
+
+	/// The counts for each slot in slots.
+	std::vector<Xapian::Internal::RefCntPtr<ValueCountMatchSpy::Internal> > counts;
+
+	/// The maximum number of documents to count (0 for no limit).
+	Xapian::doccount sample_size;
+
+	/// Total number of documents seen by the match spy.
+	Xapian::doccount total;
+
+	/// Number of documents whose values were counted.
+	Xapian::doccount counted;
+
+	/// The values of the document being counted.
+	std::vector<std::string> doc_values;
+
+	Internal() : sample_size(0), total(0), counted(0) {}
+    };
+#endif
+
+  protected:
+    Xapian::Internal::RefCntPtr<Internal> internal;
+
+    /** Get the counts for @a slot.
+     *
+     *  @exception InvalidArgumentError if @a slot isn't being counted.
+     */
+    ValueCountMatchSpy::Internal & get_counts(Xapian::valueno slot) const;
+
+    /// Return the frequency to report for a value counted @a freq times.
+    Xapian::doccount scale(Xapian::doccount freq) const;
+
+  public:
+    /// Construct a MatchSpy which doesn't count any slots yet.
+    MultiValueCountMatchSpy() : internal(new Internal) {}
+
+    /// Construct a MatchSpy which counts the slots in a range.
+    template <class Iterator>
+    MultiValueCountMatchSpy(Iterator begin, Iterator end)
+	    : internal(new Internal) {
+	while (begin != end) add_slot(*begin++);
+    }
+
+    /// Count the values in slot @a slot too.
+    void add_slot(Xapian::valueno slot);
+
+    /** Only count the values in the first @a sample_size documents seen.
+     *
+     *  The frequencies returned are then estimated by scaling up those
+     *  counted in proportion to the total number of documents seen.
+     *
+     *  @param sample_size  The number of documents to count, or 0 to count
+     *			    all documents (the default).
+     */
+    void set_sample_size(Xapian::doccount sample_size);
+
+    /** Return the total number of documents seen. */
+    Xapian::doccount get_total() const {
+	return internal->total;
+    }
+
+    /** Return the number of documents whose values were counted.
+     *
+     *  This is less than get_total() if the sample size was reached.
+     */
+    Xapian::doccount get_counted() const {
+	return internal->counted;
+    }
+
+    /** Get an iterator over the values seen in a slot.
+     *
+     *  Items will be returned in ascending alphabetical order.
+     *
+     *  During the iteration, the frequency of the current value can be
+     *  obtained with the get_termfreq() method on the iterator.
+     *
+     *  @param slot  The slot (which must have been added with add_slot()).
+     */
+    TermIterator values_begin(Xapian::valueno slot) const;
+
+    /** End iterator corresponding to values_begin() */
+    TermIterator values_end(Xapian::valueno) const {
+	return TermIterator(NULL);
+    }
+
+    /** Get an iterator over the most frequent values seen in a slot.
+     *
+     *  Items will be returned in descending order of frequency.  Values with
+     *  the same frequency will be returned in ascending alphabetical order.
+     *
+     *  During the iteration, the frequency of the current value can be
+     *  obtained with the get_termfreq() method on the iterator.
+     *
+     *  @param slot	 The slot (which must have been added with
+     *			 add_slot()).
+     *  @param maxvalues The maximum number of values to return.
+     */
+    TermIterator top_values_begin(Xapian::valueno slot,
+				  size_t maxvalues) const;
+
+    /** End iterator corresponding to top_values_begin() */
+    TermIterator top_values_end(Xapian::valueno, size_t) const {
+	return TermIterator(NULL);
+    }
+
+    /** Implementation of virtual operator().
+     *
+     *  This implementation tallies values for a matching document.
+     */
+    void operator()(const Xapian::Document &doc, Xapian::weight wt);
+
+    virtual MatchSpy * clone() const;
+    virtual std::string name() const;
+    virtual std::string serialise() const;
+    virtual MatchSpy * unserialise(const std::string & s,
+				   const Registry & context) const;
+    virtual std::string serialise_results() const;
+    virtual void merge_results(const std::string & s);
+    virtual std::string get_description() const;
+};
+
 }
 
 #endif // XAPIAN_INCLUDED_MATCHSPY_H
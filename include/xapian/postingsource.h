@@ -28,6 +28,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace Xapian {
 
@@ -218,6 +219,53 @@ class XAPIAN_VISIBILITY_DEFAULT PostingSource {
      */
     virtual bool check(Xapian::docid did, Xapian::weight min_wt);
 
+    /** The number of documents to ask next_batch() for at once.
+     *
+     *  If this returns a non-zero value, the matcher calls next_batch()
+     *  instead of next() and get_weight(), and answers skip_to() and check()
+     *  calls for documents in the batch itself.  skip_to() and check() are
+     *  still called on the PostingSource for documents after the batch.
+     *
+     *  The default implementation returns 0, which means the PostingSource
+     *  doesn't want to be called in batches.
+     *
+     *  Xapian will call this after init(), and will use the value returned
+     *  until init() is called again.
+     */
+    virtual Xapian::doccount get_batch_size() const;
+
+    /** Advance over the next batch of matching documents.
+     *
+     *  This should act like up to @a n calls to next(), storing the docid
+     *  and weight of each document moved to in @a docids and @a weights,
+     *  and return the number of documents stored.  This allows subclasses
+     *  which can score several documents at once more cheaply than one at a
+     *  time to do so.
+     *
+     *  The PostingSource should be left positioned on the last document
+     *  returned, so that a subsequent call to next_batch(), skip_to() or
+     *  check() continues after it.  If fewer than @a n documents are
+     *  returned, the PostingSource has run out of documents, and Xapian won't
+     *  call next_batch(), skip_to() or check() again until init() is called.
+     *
+     *  The weights returned must not exceed the upper bound set when the
+     *  batch is returned (but the upper bound may be reduced afterwards).
+     *
+     *  The default implementation calls next(), get_docid() and get_weight()
+     *  repeatedly.
+     *
+     *  @param min_wt	The minimum weight contribution that is needed (this is
+     *			just a hint which subclasses may ignore).
+     *  @param docids	Array of at least @a n entries to store the docids in.
+     *  @param weights	Array of at least @a n entries to store the weights in.
+     *  @param n	The maximum number of documents to return - this is the
+     *			value get_batch_size() returned.
+     */
+    virtual Xapian::doccount next_batch(Xapian::weight min_wt,
+					Xapian::docid * docids,
+					Xapian::weight * weights,
+					Xapian::doccount n);
+
     /** Return true if the current position is past the last entry in this list.
      *
      *  At least one of @a next(), @a skip_to() or @a check() will be called
@@ -405,9 +453,26 @@ class XAPIAN_VISIBILITY_DEFAULT ValuePostingSource : public PostingSource {
  *  stored values.  In particular, it doesn't ensure that the unserialised
  *  values are positive, which is a requirement for weights.  The behaviour if
  *  the slot contains values which unserialise to negative values is undefined.
+ *
+ *  If the database keeps the maximum value for each block of documents (as a
+ *  brass database compacted with "xapian-compact --numeric-column=SLOT"
+ *  does), this posting source skips blocks which can't reach the weight the
+ *  matcher needs, and lowers its upper bound as it reaches the blocks after
+ *  the one with the highest value.  Compacting with "--reorder-by-value=SLOT"
+ *  as well puts the documents with the highest values first, so the matcher
+ *  can often stop early.
  */
 class XAPIAN_VISIBILITY_DEFAULT ValueWeightPostingSource
 	: public ValuePostingSource {
+  protected:
+    /** Skip blocks of documents whose values are all less than @a min_wt.
+     *
+     *  Does nothing unless the database keeps the maximum value for each
+     *  block of documents.  Also lowers the upper bound on the weight to the
+     *  maximum value for the remaining documents.
+     */
+    void skip_low_blocks(Xapian::weight min_wt);
+
   public:
     /** Construct a ValueWeightPostingSource.
      *
@@ -415,6 +480,10 @@ class XAPIAN_VISIBILITY_DEFAULT ValueWeightPostingSource
      */
     ValueWeightPostingSource(Xapian::valueno slot_);
 
+    void next(Xapian::weight min_wt);
+    void skip_to(Xapian::docid min_docid, Xapian::weight min_wt);
+    bool check(Xapian::docid min_docid, Xapian::weight min_wt);
+
     Xapian::weight get_weight() const;
     ValueWeightPostingSource * clone() const;
     std::string name() const;
@@ -497,6 +566,16 @@ class XAPIAN_VISIBILITY_DEFAULT ValueMapPostingSource
     /// The value -> weight map
     std::map<std::string, double> weight_map;
 
+    /** Open-addressed hash table of the keys in weight_map, built by freeze().
+     *
+     *  Empty slots hold an empty string.  If this is empty, the posting
+     *  source isn't frozen and weight_map is searched instead.
+     */
+    std::vector<std::string> hash_keys;
+
+    /// The weight for each key in hash_keys.
+    std::vector<double> hash_weights;
+
   public:
     /** Construct a ValueWeightPostingSource.
      *
@@ -505,15 +584,30 @@ class XAPIAN_VISIBILITY_DEFAULT ValueMapPostingSource
     ValueMapPostingSource(Xapian::valueno slot_);
 
     /** Add a mapping.
+     *
+     *  If the posting source has been frozen, this unfreezes it.
      *
      *  @param key The key looked up from the value slot.
      *  @param weight The weight to give this key.
      */
     void add_mapping(const std::string &key, double weight);
 
-    /** Clear all mappings. */
+    /** Clear all mappings.
+     *
+     *  If the posting source has been frozen, this unfreezes it.
+     */
     void clear_mappings();
 
+    /** Build a hash table of the mappings to speed up lookups.
+     *
+     *  Looking up a value then usually takes a single string comparison,
+     *  rather than one for each level of a binary tree.  It's worth calling
+     *  this once all the mappings have been added if there are many of them.
+     *  Calling add_mapping() or clear_mappings() afterwards discards the hash
+     *  table, so you'll need to call freeze() again to get the benefit.
+     */
+    void freeze();
+
     /** Set a default weight for document values not in the map. */
     void set_default_weight(double wt);
 
@@ -138,9 +138,40 @@ class XAPIAN_VISIBILITY_DEFAULT Query {
 	     *
 	     *  Identical to OP_OR, except for the weightings returned.
 	     */
-	    OP_SYNONYM
+	    OP_SYNONYM,
+
+	    /** Match all terms starting with a given string.
+	     *
+	     *  The expansion is performed separately for each database
+	     *  being searched, when the match is run, and the matching terms
+	     *  are treated as synonyms (as OP_SYNONYM does).  The number of
+	     *  terms the pattern expands to can be limited - see
+	     *  wildcard_limit.
+	     *
+	     *  Queries using this operator are built with the
+	     *  Query(op, const std::string &, termcount, wildcard_limit,
+	     *  termpos) constructor.
+	     */
+	    OP_WILDCARD
 	} op;
 
+	/** What to do when an OP_WILDCARD query expands to more terms than
+	 *  the limit specified.
+	 */
+	typedef enum {
+	    /// Throw Xapian::WildcardError.
+	    WILDCARD_LIMIT_ERROR,
+
+	    /// Use the first terms in ascending byte order.
+	    WILDCARD_LIMIT_FIRST,
+
+	    /** Use the terms with the highest term frequency.
+	     *
+	     *  Ties are broken by preferring the term which sorts first.
+	     */
+	    WILDCARD_LIMIT_MOST_FREQUENT
+	} wildcard_limit;
+
 	/** Copy constructor. */
 	Query(const Query & copyme);
 
@@ -224,6 +255,27 @@ class XAPIAN_VISIBILITY_DEFAULT Query {
 	 */
 	Query(Query::op op_, Xapian::valueno valno, const std::string &value);
 
+	/** Construct a wildcard query.
+	 *
+	 *  This query matches documents containing any term which starts
+	 *  with @a pattern.  The expansion is deferred until the match is
+	 *  run, so this constructor doesn't need access to a database.
+	 *
+	 *  @param op_		The operator to use for the query.
+	 *			Currently, must be OP_WILDCARD.
+	 *  @param pattern	The string which matching terms start with.
+	 *  @param max_expansion	The maximum number of terms to expand
+	 *			to in each database (default: 0, meaning no
+	 *			limit).
+	 *  @param max_type	What to do if the limit is exceeded (default:
+	 *			WILDCARD_LIMIT_ERROR).
+	 *  @param pos		The query position (default: 0).
+	 */
+	Query(Query::op op_, const std::string & pattern,
+	      Xapian::termcount max_expansion = 0,
+	      wildcard_limit max_type = WILDCARD_LIMIT_ERROR,
+	      Xapian::termpos pos = 0);
+
 	/** Construct an external source query.
 	 *
 	 *  An attempt to clone the posting source will be made immediately, so
@@ -363,6 +415,9 @@ class XAPIAN_VISIBILITY_DEFAULT Query::Internal : public Xapian::Internal::RefCn
 	 *
 	 * For RANGE, the value number to apply the range test to.
 	 *
+	 * For WILDCARD, the maximum number of terms to expand to (0 for no
+	 * limit).
+	 *
 	 * For a leaf node, this is the within query frequency of the term.
 	 */
 	Xapian::termcount parameter;
@@ -371,14 +426,18 @@ class XAPIAN_VISIBILITY_DEFAULT Query::Internal : public Xapian::Internal::RefCn
 	 *
 	 *  For a leaf node, this holds the term name.  For an OP_VALUE_RANGE
 	 *  query this holds the start of the range.  For an OP_VALUE_GE or
-	 *  OP_VALUE_LE query this holds the value to compare against.
+	 *  OP_VALUE_LE query this holds the value to compare against.  For
+	 *  an OP_WILDCARD query this holds the pattern.
 	 */
 	std::string tname;
 
-	/** Used to store the end of a range query. */
+	/** Used to store the end of a range query.
+	 *
+	 *  For OP_WILDCARD, this holds the wildcard_limit policy.
+	 */
 	std::string str_parameter;
 
-	/// Position in query of this term - leaf node only
+	/// Position in query of this term - leaf node and OP_WILDCARD only
 	Xapian::termpos term_pos;
 
 	/// External posting source.
@@ -455,6 +514,11 @@ class XAPIAN_VISIBILITY_DEFAULT Query::Internal : public Xapian::Internal::RefCn
 	/// Construct an external source query.
 	explicit Internal(Xapian::PostingSource * external_source_, bool owned);
 
+	/// Construct a wildcard query.
+	Internal(op_t op_, const std::string & pattern,
+		 Xapian::termcount max_expansion, int max_type,
+		 Xapian::termpos term_pos_);
+
 	/** Destructor. */
 	~Internal();
 
@@ -500,6 +564,11 @@ class XAPIAN_VISIBILITY_DEFAULT Query::Internal : public Xapian::Internal::RefCn
 
 	Xapian::termcount get_wqf() const { return parameter; }
 
+	/// Get the wildcard_limit policy of an OP_WILDCARD query.
+	int get_wildcard_limit() const {
+	    return str_parameter.empty() ? 0 : str_parameter[0];
+	}
+
 	/** Get the length of the query, used by some ranking formulae.
 	 *  This value is calculated automatically - if you want to override
 	 *  it you can pass a different value to Enquire::set_query().
@@ -29,6 +29,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 namespace Xapian {
 
@@ -51,6 +52,13 @@ class XAPIAN_VISIBILITY_DEFAULT Stopper {
 class XAPIAN_VISIBILITY_DEFAULT SimpleStopper : public Stopper {
     std::set<std::string> stop_words;
 
+    /** Open-addressed hash table of the stop words, built by freeze().
+     *
+     *  Empty slots hold an empty string.  If this is empty, the stopper
+     *  isn't frozen and stop_words is searched instead.
+     */
+    std::vector<std::string> hash_table;
+
   public:
     /// Default constructor.
     SimpleStopper() { }
@@ -67,13 +75,29 @@ class XAPIAN_VISIBILITY_DEFAULT SimpleStopper : public Stopper {
     }
 #endif
 
-    /// Add a single stop word.
-    void add(const std::string & word) { stop_words.insert(word); }
+    /** Add a single stop word.
+     *
+     *  If the stopper has been frozen, this unfreezes it.
+     */
+    void add(const std::string & word) {
+	stop_words.insert(word);
+	hash_table.clear();
+    }
+
+    /** Build a hash table of the stop words to speed up lookups.
+     *
+     *  Checking a word against the stop words then usually takes a single
+     *  string comparison, rather than one for each level of a binary tree.
+     *  It's worth calling this once all the stop words have been added if
+     *  the stopper is going to be used to index or parse much text.
+     *
+     *  Calling add() afterwards discards the hash table, so you'll need to
+     *  call freeze() again to get the benefit.
+     */
+    void freeze();
 
     /// Is term a stop-word?
-    virtual bool operator()(const std::string & term) const {
-	return stop_words.find(term) != stop_words.end();
-    }
+    virtual bool operator()(const std::string & term) const;
 
     /// Return a string describing this object.
     virtual std::string get_description() const;
@@ -354,6 +378,17 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
 	 */
 	FLAG_AUTO_MULTIWORD_SYNONYMS = 1024 | FLAG_AUTO_SYNONYMS,
 
+	/** Defer expanding wildcards until the query is run.
+	 *
+	 *  When used with FLAG_WILDCARD or FLAG_PARTIAL, wildcarded terms
+	 *  are turned into Xapian::Query::OP_WILDCARD subqueries, which
+	 *  are expanded separately against each database searched when the
+	 *  match is run, instead of being expanded against the database
+	 *  passed to set_database() when the query is parsed.  This means
+	 *  set_database() doesn't need to be called for wildcards.
+	 */
+	FLAG_LAZY_WILDCARD = 2048,
+
 	/** The default flags.
 	 *
 	 *  Used if you don't explicitly pass any to @a parse_query().
@@ -428,6 +463,23 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
     /// Specify the database being searched.
     void set_database(const Database &db);
 
+    /** Limit the number of terms a wildcard can expand to.
+     *
+     *  This applies to FLAG_WILDCARD and FLAG_PARTIAL, and the limit is
+     *  applied to each term prefix separately.  With FLAG_LAZY_WILDCARD,
+     *  the limit is applied separately to each database searched.
+     *
+     *  @param max_expansion	The maximum number of terms a wildcard may
+     *				expand to, or 0 for no limit (which is the
+     *				default).
+     *  @param max_type		What to do if the limit is exceeded
+     *				(default: Xapian::Query::WILDCARD_LIMIT_ERROR,
+     *				which throws Xapian::WildcardError).
+     */
+    void set_max_wildcard_expansion(Xapian::termcount max_expansion,
+				    Query::wildcard_limit max_type =
+					Query::WILDCARD_LIMIT_ERROR);
+
     /** Parse a query.
      *
      *  @param query_string  A free-text query as entered by a user
@@ -553,6 +605,33 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
      */
     std::string get_corrected_query_string() const;
 
+    /** Set the maximum number of parsed queries to cache.
+     *
+     *  If the same query strings are parsed over and over again, caching
+     *  the results avoids redoing the work.  A cached parse is reused if
+     *  the query string, flags and default prefix passed to parse_query()
+     *  are the same and the database set with set_database() is still at
+     *  the same revision (uncommitted changes to a WritableDatabase aren't
+     *  noticed, and if the database can't report its revision, queries
+     *  aren't cached).  The stoplist, unstemmed forms and corrected query
+     *  string are restored from the cache too.
+     *
+     *  Any other change to the QueryParser's settings empties the cache.
+     *  When the cache is full, the least recently used parse is dropped.
+     *
+     *  By default no parses are cached.
+     *
+     *  @param max_queries	The maximum number of parses to cache, or 0 to
+     *				disable (and empty) the cache.
+     */
+    void set_parse_cache_size(unsigned max_queries);
+
+    /// Return the number of parses which were found in the cache.
+    unsigned long get_parse_cache_hits() const;
+
+    /// Return the number of parses which weren't found in the cache.
+    unsigned long get_parse_cache_misses() const;
+
     /// Return a string describing this object.
     std::string get_description() const;
 };
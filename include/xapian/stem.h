@@ -88,6 +88,36 @@ class XAPIAN_VISIBILITY_DEFAULT Stem {
      */
     std::string operator()(const std::string &word) const;
 
+    /** Stem a word, storing the result in a string supplied by the caller.
+     *
+     *  This gives the same result as operator(), but reuses the storage of
+     *  @a result, so avoids allocating a new string for each word stemmed.
+     *
+     *  @param word		a word to stem.
+     *  @param result	string to store the stem in.
+     */
+    void stem_word(const std::string &word, std::string &result) const;
+
+    /** Set the maximum number of words to cache stems for.
+     *
+     *  The same words occur over and over again in natural language text,
+     *  so caching the stems of words seen recently avoids most of the work
+     *  of stemming.  The cache is shared by copies of this Stem object.
+     *  If the cache fills up, it is emptied and refilled.
+     *
+     *  By default no stems are cached.
+     *
+     *  @param max_words	The maximum number of words to cache, or 0 to
+     *			disable (and empty) the cache.
+     */
+    void set_cache_size(unsigned max_words);
+
+    /// Return the number of stems which were found in the cache.
+    unsigned long get_cache_hits() const;
+
+    /// Return the number of stems which weren't found in the cache.
+    unsigned long get_cache_misses() const;
+
     /// Return a string describing this object.
     std::string get_description() const;
 
@@ -28,6 +28,9 @@
 
 #include <string>
 #include <set>
+#include <vector>
+
+class ValueSetPostList;
 
 namespace Xapian {
 
@@ -37,9 +40,19 @@ class Document;
  *  user-defined set.
  */
 class XAPIAN_VISIBILITY_DEFAULT ValueSetMatchDecider : public MatchDecider {
+    /// The matcher uses this to filter by value before calculating weights.
+    friend class ::ValueSetPostList;
+
     /** Set of values to test for. */
     std::set<std::string> testset;
 
+    /** Open-addressed hash table of the values in testset, built by freeze().
+     *
+     *  Empty slots hold an empty string.  If this is empty, the decider
+     *  isn't frozen and testset is searched instead.
+     */
+    std::vector<std::string> hash_table;
+
     /** The value slot to look in. */
     valueno valuenum;
 
@@ -50,6 +63,14 @@ class XAPIAN_VISIBILITY_DEFAULT ValueSetMatchDecider : public MatchDecider {
      */
     bool inclusive;
 
+    /** Whether the matcher may filter by value instead of calling
+     *  operator().
+     */
+    bool filterable;
+
+    /// Return true if @a value is in the test set.
+    bool contains(const std::string & value) const;
+
   public:
     /** Construct a ValueSetMatchDecider.
      *
@@ -59,34 +80,65 @@ class XAPIAN_VISIBILITY_DEFAULT ValueSetMatchDecider : public MatchDecider {
      *  value in the specified slot which is a member of the test set; if
      *  false, match decider accepts documents which do not have a value in the
      *  specified slot.
+     *
+     *  @param filterable_ If true, the matcher may filter the candidate
+     *  documents by iterating the values in the slot instead of calling
+     *  operator(), so documents are rejected before their weights are
+     *  calculated.  A subclass which overrides operator() shouldn't set
+     *  this, as its operator() might then not be called.  (default: false)
      */
-    ValueSetMatchDecider(Xapian::valueno slot, bool inclusive_)
-	: valuenum(slot), inclusive(inclusive_) { }
+    ValueSetMatchDecider(Xapian::valueno slot, bool inclusive_,
+			 bool filterable_ = false)
+	: valuenum(slot), inclusive(inclusive_), filterable(filterable_) { }
 
     /** Add a value to the test set.
+     *
+     *  If the decider has been frozen, this unfreezes it.
      *
      *  @param value The value to add to the test set.
      */
     void add_value(const std::string& value)
     {
 	testset.insert(value);
+	hash_table.clear();
     }
 
     /** Remove a value from the test set.
+     *
+     *  If the decider has been frozen, this unfreezes it.
      *
      *  @param value The value to remove from the test set.
      */
     void remove_value(const std::string& value)
     {
 	testset.erase(value);
+	hash_table.clear();
     }
 
+    /** Build a hash table of the test set to speed up lookups.
+     *
+     *  It's worth calling this once all the values have been added if the
+     *  test set is large.  Calling add_value() or remove_value() afterwards
+     *  discards the hash table, so you'll need to call freeze() again to get
+     *  the benefit.
+     */
+    void freeze();
+
     /** Decide whether we want this document to be in the MSet.
      *
      *  Return true if the document is acceptable, or false if the document
      *  should be excluded from the MSet.
+     *
+     *  If the decider was constructed with filterable_ set to true and
+     *  documents without a value in the slot would be rejected, the matcher
+     *  filters the candidate documents by iterating the values in the slot
+     *  instead of calling this method.
      */
     bool operator()(const Xapian::Document& doc) const;
+
+    /** Return this decider if it was constructed as filterable, else NULL.
+     */
+    const ValueSetMatchDecider * get_value_set_filter() const;
 };
 
 }
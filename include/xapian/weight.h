@@ -45,7 +45,8 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
 	DOC_LENGTH = 256,
 	DOC_LENGTH_MIN = 512,
 	DOC_LENGTH_MAX = 1024,
-	WDF_MAX = 2048
+	WDF_MAX = 2048,
+	DOC_LENGTH_APPROX = 4096
     } stat_flags;
 
     /** Tell Xapian that your subclass will want a particular statistic.
@@ -55,6 +56,12 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
      *  should call need_stat() from your constructor for each such
      *  statistic.
      *
+     *  If your get_sumpart() never increases as the document length
+     *  increases, you can also ask for DOC_LENGTH_APPROX along with
+     *  DOC_LENGTH, which allows the document length passed to it to be an
+     *  approximation which is no less than the actual length, where the
+     *  backend can supply one more cheaply.
+     *
      * @param flag  The stat_flags value for a required statistic.
      */
     void need_stat(stat_flags flag) {
@@ -238,6 +245,15 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
 	return stats_needed & DOC_LENGTH;
     }
 
+    /** @private @internal Return true if an approximate length will do.
+     *
+     *  If this method returns true, then the document length passed to
+     *  @a get_sumpart() may be rounded up.
+     */
+    bool get_sumpart_accepts_approx_doclength_() const {
+	return stats_needed & DOC_LENGTH_APPROX;
+    }
+
     /** @private @internal Return true if the WDF is needed.
      *
      *  If this method returns true, then the WDF will be fetched and passed to
@@ -395,7 +411,10 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
 	    need_stat(DOC_LENGTH_MIN);
 	    need_stat(AVERAGE_LENGTH);
 	}
-	if (param_k1 != 0 && param_b != 0) need_stat(DOC_LENGTH);
+	if (param_k1 != 0 && param_b != 0) {
+	    need_stat(DOC_LENGTH);
+	    need_stat(DOC_LENGTH_APPROX);
+	}
 	if (param_k2 != 0) need_stat(QUERY_LENGTH);
 	if (param_k3 != 0) need_stat(WQF);
     }
@@ -414,6 +433,7 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
 	need_stat(DOC_LENGTH_MIN);
 	need_stat(AVERAGE_LENGTH);
 	need_stat(DOC_LENGTH);
+	need_stat(DOC_LENGTH_APPROX);
 	need_stat(WQF);
     }
 
@@ -466,6 +486,7 @@ class XAPIAN_VISIBILITY_DEFAULT TradWeight : public Weight {
 	if (param_k != 0.0) {
 	    need_stat(AVERAGE_LENGTH);
 	    need_stat(DOC_LENGTH);
+	    need_stat(DOC_LENGTH_APPROX);
 	}
 	need_stat(COLLECTION_SIZE);
 	need_stat(RSET_SIZE);
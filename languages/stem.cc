@@ -177,6 +177,34 @@ Stem::operator()(const std::string &word) const
     return internal->operator()(word);
 }
 
+void
+Stem::stem_word(const std::string &word, std::string &result) const
+{
+    if (!internal.get() || word.empty()) {
+	result = word;
+	return;
+    }
+    internal->stem_word(word, result);
+}
+
+void
+Stem::set_cache_size(unsigned max_words)
+{
+    if (internal.get()) internal->set_cache_size(max_words);
+}
+
+unsigned long
+Stem::get_cache_hits() const
+{
+    return internal.get() ? internal->cache_hits : 0;
+}
+
+unsigned long
+Stem::get_cache_misses() const
+{
+    return internal.get() ? internal->cache_misses : 0;
+}
+
 string
 Stem::get_description() const
 {
@@ -62,6 +62,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <map>
 #include <string>
 
 using namespace std;
@@ -137,6 +138,24 @@ Stem::Internal::~Internal()
 string
 Stem::Internal::operator()(const string & word)
 {
+    string result;
+    stem_word(word, result);
+    return result;
+}
+
+void
+Stem::Internal::stem_word(const string & word, string & result)
+{
+    if (max_cache_size) {
+	map<string, string>::const_iterator i = cache.find(word);
+	if (i != cache.end()) {
+	    ++cache_hits;
+	    result.assign(i->second.data(), i->second.size());
+	    return;
+	}
+	++cache_misses;
+    }
+
     const symbol * s = reinterpret_cast<const symbol *>(word.data());
     replace_s(0, l, word.size(), s);
     c = 0;
@@ -144,7 +163,14 @@ Stem::Internal::operator()(const string & word)
 	// FIXME: Is there a better choice of exception class?
 	throw Xapian::InternalError("stemming exception!");
     }
-    return string(reinterpret_cast<const char *>(p), l);
+    result.assign(reinterpret_cast<const char *>(p), l);
+
+    if (max_cache_size) {
+	// Word frequencies are very skewed, so the common words will soon be
+	// back in the cache if we just start again when it fills up.
+	if (cache.size() >= max_cache_size) cache.clear();
+	cache.insert(make_pair(word, result));
+    }
 }
 
 /* Code for character groupings: utf8 cases */
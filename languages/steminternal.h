@@ -25,6 +25,7 @@
 #include <xapian/stem.h>
 
 #include <cstdlib>
+#include <map>
 #include <string>
 
 // FIXME: we might want to make Stem::Internal a virtual base class and have
@@ -87,6 +88,12 @@ namespace Xapian {
 class Stem::Internal : public Xapian::Internal::RefCntBase {
     int slice_check();
 
+    /// Cache mapping words to their stems.
+    std::map<std::string, std::string> cache;
+
+    /// The maximum number of entries in cache (0 means don't cache).
+    size_t max_cache_size;
+
   protected:
     symbol * p;
     int c, l, lb, bra, ket;
@@ -129,7 +136,9 @@ class Stem::Internal : public Xapian::Internal::RefCntBase {
 
   public:
     /// Perform initialisation common to all Snowball stemmers.
-    Internal() : p(create_s()), c(0), l(0), lb(0), bra(0), ket(0) { }
+    Internal()
+	: max_cache_size(0), p(create_s()), c(0), l(0), lb(0), bra(0), ket(0),
+	  cache_hits(0), cache_misses(0) { }
 
     /// Perform cleanup common to all Snowball stemmers.
     virtual ~Internal();
@@ -137,6 +146,21 @@ class Stem::Internal : public Xapian::Internal::RefCntBase {
     /// Stem the specified word.
     std::string operator()(const std::string & word);
 
+    /// Stem the specified word, storing the stem in @a result.
+    void stem_word(const std::string & word, std::string & result);
+
+    /// Set the maximum number of entries in the cache.
+    void set_cache_size(size_t max_words) {
+	max_cache_size = max_words;
+	if (max_words == 0 || cache.size() > max_words) cache.clear();
+    }
+
+    /// Number of stem_word() calls which found the stem in the cache.
+    unsigned long cache_hits;
+
+    /// Number of stem_word() calls which didn't find the stem in the cache.
+    unsigned long cache_misses;
+
     /// Virtual method implemented by the subclass to actually do the work.
     virtual int stem() = 0;
 
@@ -1,6 +1,7 @@
 noinst_HEADERS +=\
 	matcher/andmaybepostlist.h\
 	matcher/andnotpostlist.h\
+	matcher/boolorpostlist.h\
 	matcher/branchpostlist.h\
 	matcher/collapser.h\
 	matcher/exactphrasepostlist.h\
@@ -19,6 +20,7 @@ noinst_HEADERS +=\
 	matcher/synonympostlist.h\
 	matcher/valuegepostlist.h\
 	matcher/valuerangepostlist.h\
+	matcher/valuesetpostlist.h\
 	matcher/valuestreamdocument.h\
 	matcher/xorpostlist.h
 
@@ -37,6 +39,7 @@ EXTRA_DIST +=\
 lib_src +=\
 	matcher/andmaybepostlist.cc\
 	matcher/andnotpostlist.cc\
+	matcher/boolorpostlist.cc\
 	matcher/branchpostlist.cc\
 	matcher/collapser.cc\
 	matcher/exactphrasepostlist.cc\
@@ -55,5 +58,6 @@ lib_src +=\
 	matcher/synonympostlist.cc\
 	matcher/valuegepostlist.cc\
 	matcher/valuerangepostlist.cc\
+	matcher/valuesetpostlist.cc\
 	matcher/valuestreamdocument.cc\
 	matcher/xorpostlist.cc
@@ -0,0 +1,262 @@
+/** @file boolorpostlist.cc
+ * @brief N-way OR postlist for unweighted subqueries.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "boolorpostlist.h"
+
+#include "debuglog.h"
+#include "omassert.h"
+#include "weightinternal.h"
+
+#include <algorithm>
+
+using namespace std;
+
+BoolOrPostList::~BoolOrPostList()
+{
+    vector<PostListAndDocID>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	delete i->pl;
+    }
+}
+
+void
+BoolOrPostList::rebuild_heap()
+{
+    size_t i = 0;
+    while (i < plist.size()) {
+	if (plist[i].pl->at_end()) {
+	    delete plist[i].pl;
+	    plist[i] = plist.back();
+	    plist.pop_back();
+	} else {
+	    plist[i].did = plist[i].pl->get_docid();
+	    ++i;
+	}
+    }
+    make_heap(plist.begin(), plist.end(), CompareDocID());
+}
+
+Xapian::termcount
+BoolOrPostList::sum_matching(Xapian::termcount (PostList::*method)() const) const
+{
+    Assert(did);
+    // The sub-postlists at the current docid form a subtree at the top of the
+    // heap, so we only need to descend while the docid matches.
+    Xapian::termcount result = 0;
+    vector<size_t> todo(1, 0);
+    while (!todo.empty()) {
+	size_t i = todo.back();
+	todo.pop_back();
+	result += (plist[i].pl->*method)();
+	for (size_t c = i * 2 + 1; c <= i * 2 + 2 && c < plist.size(); ++c) {
+	    if (plist[c].did == did) todo.push_back(c);
+	}
+    }
+    return result;
+}
+
+Xapian::doccount
+BoolOrPostList::get_termfreq_min() const
+{
+    // The number of matching documents is minimised when the sub-postlists
+    // overlap as much as possible.
+    Xapian::doccount result = 0;
+    vector<PostListAndDocID>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	result = max(result, i->pl->get_termfreq_min());
+    }
+    return result;
+}
+
+Xapian::doccount
+BoolOrPostList::get_termfreq_max() const
+{
+    // The number of matching documents is maximised when the sub-postlists
+    // are disjoint, but can't exceed the size of the database.
+    Xapian::doccount result = 0;
+    vector<PostListAndDocID>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	Xapian::doccount tf = i->pl->get_termfreq_max();
+	if (tf >= db_size - result) return db_size;
+	result += tf;
+    }
+    return result;
+}
+
+Xapian::doccount
+BoolOrPostList::get_termfreq_est() const
+{
+    if (rare(db_size == 0)) return 0;
+    // Estimate assuming independence:
+    // P(a or b) = P(a) + P(b) - P(a) . P(b)
+    double est = 0.0;
+    vector<PostListAndDocID>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	double x = i->pl->get_termfreq_est();
+	est = est + x - est * x / db_size;
+    }
+    return static_cast<Xapian::doccount>(est + 0.5);
+}
+
+TermFreqs
+BoolOrPostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const
+{
+    LOGCALL(MATCH, TermFreqs,
+	    "BoolOrPostList::get_termfreq_est_using_stats", stats);
+    // Our caller should have ensured this.
+    Assert(stats.collection_size);
+
+    // Estimate assuming independence, as for get_termfreq_est().
+    double freqest = 0.0, relfreqest = 0.0;
+    vector<PostListAndDocID>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	TermFreqs freqs(i->pl->get_termfreq_est_using_stats(stats));
+	freqest = freqest + freqs.termfreq -
+		freqest * freqs.termfreq / stats.collection_size;
+	if (stats.rset_size != 0) {
+	    relfreqest = relfreqest + freqs.reltermfreq -
+		    relfreqest * freqs.reltermfreq / stats.rset_size;
+	}
+    }
+
+    RETURN(TermFreqs(static_cast<Xapian::doccount>(freqest + 0.5),
+		     static_cast<Xapian::doccount>(relfreqest + 0.5)));
+}
+
+Xapian::weight
+BoolOrPostList::get_maxweight() const
+{
+    return 0;
+}
+
+Xapian::docid
+BoolOrPostList::get_docid() const
+{
+    Assert(did);
+    return did;
+}
+
+Xapian::termcount
+BoolOrPostList::get_doclength() const
+{
+    Assert(did);
+    return plist[0].pl->get_doclength();
+}
+
+Xapian::weight
+BoolOrPostList::get_weight() const
+{
+    return 0;
+}
+
+bool
+BoolOrPostList::at_end() const
+{
+    return (did == 0);
+}
+
+Xapian::weight
+BoolOrPostList::recalc_maxweight()
+{
+    return 0;
+}
+
+void
+BoolOrPostList::reheap_top()
+{
+    pop_heap(plist.begin(), plist.end(), CompareDocID());
+    PostListAndDocID & moved = plist.back();
+    if (moved.pl->at_end()) {
+	delete moved.pl;
+	plist.pop_back();
+    } else {
+	moved.did = moved.pl->get_docid();
+	push_heap(plist.begin(), plist.end(), CompareDocID());
+    }
+}
+
+PostList *
+BoolOrPostList::next(Xapian::weight)
+{
+    LOGCALL(MATCH, PostList *, "BoolOrPostList::next", "");
+    if (did == 0) {
+	// This is the first call, so position all the sub-postlists.
+	for (size_t i = 0; i < plist.size(); ++i) {
+	    handle_prune(i, plist[i].pl->next(0));
+	}
+	rebuild_heap();
+    } else {
+	while (!plist.empty() && plist[0].did == did) {
+	    handle_prune(0, plist[0].pl->next(0));
+	    reheap_top();
+	}
+    }
+    did = plist.empty() ? 0 : plist[0].did;
+    RETURN(NULL);
+}
+
+PostList *
+BoolOrPostList::skip_to(Xapian::docid did_min, Xapian::weight)
+{
+    LOGCALL(MATCH, PostList *, "BoolOrPostList::skip_to", did_min);
+    if (did_min <= did) RETURN(NULL);
+    if (did == 0) {
+	// This is the first call, so position all the sub-postlists.
+	for (size_t i = 0; i < plist.size(); ++i) {
+	    handle_prune(i, plist[i].pl->skip_to(did_min, 0));
+	}
+	rebuild_heap();
+    } else {
+	// Only the sub-postlists before did_min need to move, and they're
+	// the ones at the top of the heap.
+	while (!plist.empty() && plist[0].did < did_min) {
+	    handle_prune(0, plist[0].pl->skip_to(did_min, 0));
+	    reheap_top();
+	}
+    }
+    did = plist.empty() ? 0 : plist[0].did;
+    RETURN(NULL);
+}
+
+string
+BoolOrPostList::get_description() const
+{
+    string desc("(");
+    vector<PostListAndDocID>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	if (i != plist.begin()) desc += " BoolOr ";
+	desc += i->pl->get_description();
+    }
+    desc += ')';
+    return desc;
+}
+
+Xapian::termcount
+BoolOrPostList::get_wdf() const
+{
+    return sum_matching(&PostList::get_wdf);
+}
+
+Xapian::termcount
+BoolOrPostList::count_matching_subqs() const
+{
+    return sum_matching(&PostList::count_matching_subqs);
+}
@@ -0,0 +1,151 @@
+/** @file boolorpostlist.h
+ * @brief N-way OR postlist for unweighted subqueries.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BOOLORPOSTLIST_H
+#define XAPIAN_INCLUDED_BOOLORPOSTLIST_H
+
+#include "postlist.h"
+
+#include <vector>
+
+/** N-way OR postlist for unweighted subqueries.
+ *
+ *  This is used for the terms an OP_WILDCARD expands to, where there can be
+ *  a very large number of sub-postlists.  Rather than a tree of binary
+ *  OrPostList objects, the sub-postlists are kept in a heap ordered by their
+ *  current docid, so advancing costs O(log n) per sub-postlist moved instead
+ *  of a virtual method call at every level of a tree.
+ *
+ *  The sub-postlists must be unweighted (i.e. built with a factor of 0), as
+ *  this postlist always returns a weight of 0.  When weights are wanted, it
+ *  should be wrapped in a SynonymPostList.
+ */
+class BoolOrPostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const BoolOrPostList &);
+
+    /// Don't allow copying.
+    BoolOrPostList(const BoolOrPostList &);
+
+    /// A sub-postlist and the docid it is currently at.
+    struct PostListAndDocID {
+	PostList * pl;
+	Xapian::docid did;
+
+	PostListAndDocID(PostList * pl_) : pl(pl_), did(0) { }
+    };
+
+    /// Comparison functor which puts the lowest docid at the top of a heap.
+    struct CompareDocID {
+	bool operator()(const PostListAndDocID & a,
+			const PostListAndDocID & b) const {
+	    return a.did > b.did;
+	}
+    };
+
+    /// The current docid, or zero if we haven't started or are at_end.
+    Xapian::docid did;
+
+    /** The sub-postlists.
+     *
+     *  Once we've started, these form a heap ordered by docid, and any
+     *  sub-postlist which reaches its end is removed.
+     */
+    std::vector<PostListAndDocID> plist;
+
+    /// The number of documents in the database.
+    Xapian::doccount db_size;
+
+    /// Replace sub-postlist @a i with @a res if it pruned itself.
+    void handle_prune(size_t i, PostList * res) {
+	if (res) {
+	    delete plist[i].pl;
+	    plist[i].pl = res;
+	}
+    }
+
+    /** Remove sub-postlists which are at_end, update the cached docids and
+     *  build the heap.
+     */
+    void rebuild_heap();
+
+    /** Restore the heap after the sub-postlist at the top has been moved,
+     *  removing it if it's now at_end.
+     */
+    void reheap_top();
+
+    /** Call @a method on each sub-postlist at the current docid, and return
+     *  the sum of the results.
+     */
+    Xapian::termcount sum_matching(Xapian::termcount (PostList::*method)() const) const;
+
+  public:
+    /** Construct from 2 random-access iterators to a container of PostList*
+     *  and the document collection size.
+     */
+    template <class RandomItor>
+    BoolOrPostList(RandomItor pl_begin, RandomItor pl_end,
+		   Xapian::doccount db_size_)
+	: did(0), db_size(db_size_)
+    {
+	plist.reserve(pl_end - pl_begin);
+	while (pl_begin != pl_end) {
+	    plist.push_back(PostListAndDocID(*pl_begin));
+	    ++pl_begin;
+	}
+    }
+
+    ~BoolOrPostList();
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const;
+
+    Xapian::weight get_maxweight() const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_doclength() const;
+
+    Xapian::weight get_weight() const;
+
+    bool at_end() const;
+
+    Xapian::weight recalc_maxweight();
+
+    Internal *next(Xapian::weight w_min);
+
+    Internal *skip_to(Xapian::docid, Xapian::weight w_min);
+
+    std::string get_description() const;
+
+    /** get_wdf() for BoolOrPostList returns the sum of the wdfs of the
+     *  sub postlists which are at the current document, as is wanted when
+     *  it is wrapped in a SynonymPostList.
+     */
+    Xapian::termcount get_wdf() const;
+
+    Xapian::termcount count_matching_subqs() const;
+};
+
+#endif // XAPIAN_INCLUDED_BOOLORPOSTLIST_H
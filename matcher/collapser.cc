@@ -35,7 +35,6 @@ CollapseData::add_item(const Xapian::Internal::MSetItem & item,
 {
     if (items.size() < collapse_max) {
 	items.push_back(item);
-	items.back().collapse_key = string();
 	return ADDED;
     }
 
@@ -66,6 +65,18 @@ CollapseData::add_item(const Xapian::Internal::MSetItem & item,
     return REPLACED;
 }
 
+/// Calculate a 64-bit fingerprint of @a s using the FNV-1a algorithm.
+static uint8
+fingerprint(const string & s)
+{
+    uint8 h = 14695981039346656037ULL;
+    for (string::const_iterator i = s.begin(); i != s.end(); ++i) {
+	h ^= static_cast<unsigned char>(*i);
+	h *= 1099511628211ULL;
+    }
+    return h;
+}
+
 collapse_result
 Collapser::process(Xapian::Internal::MSetItem & item,
 		   PostList * postlist,
@@ -75,53 +86,73 @@ Collapser::process(Xapian::Internal::MSetItem & item,
     ++docs_considered;
     // The postlist will supply the collapse key for a remote match.
     const string * key_ptr = postlist->get_collapse_key();
-    if (key_ptr) {
-	item.collapse_key = *key_ptr;
-    } else {
+    if (!key_ptr) {
 	// Otherwise use the Document object to get the value.
-	item.collapse_key = vsdoc.get_value(slot);
+	vsdoc.get_value(slot).swap(key);
+	key_ptr = &key;
     }
 
-    if (item.collapse_key.empty()) {
+    if (key_ptr->empty()) {
 	// We don't collapse items with an empty collapse key.
 	++no_collapse_key;
 	return EMPTY;
     }
 
-    map<string, CollapseData>::iterator oldkey;
-    oldkey = table.find(item.collapse_key);
-    if (oldkey == table.end()) {
-	// We've not seen this collapse key before.
-	table.insert(make_pair(item.collapse_key, CollapseData(item)));
-	++entry_count;
-	return ADDED;
+    // Keep the hash table at most half full.
+    if (values.size() * 2 >= table.size()) {
+	size_t size = table.empty() ? 256 : table.size() * 2;
+	vector<Xapian::doccount> new_table(size);
+	for (size_t i = 0; i != values.size(); ++i) {
+	    size_t j = values[i].fingerprint & (size - 1);
+	    while (new_table[j]) j = (j + 1) & (size - 1);
+	    new_table[j] = i + 1;
+	}
+	swap(table, new_table);
     }
 
-    collapse_result res;
-    CollapseData & collapse_data = oldkey->second;
-    res = collapse_data.add_item(item, collapse_max, mcmp, old_item);
-    if (res == ADDED) {
-	++entry_count;
-    } else if (res == REJECTED || res == REPLACED) {
-	++dups_ignored;
+    uint8 fp = fingerprint(*key_ptr);
+    size_t mask = table.size() - 1;
+    size_t j = fp & mask;
+    while (table[j]) {
+	CollapseEntry & entry = values[table[j] - 1];
+	if (entry.fingerprint == fp && entry.key == *key_ptr) {
+	    item.collapse_entry = table[j];
+	    collapse_result res;
+	    res = entry.data.add_item(item, collapse_max, mcmp, old_item);
+	    if (res == ADDED) {
+		++entry_count;
+	    } else if (res == REJECTED || res == REPLACED) {
+		++dups_ignored;
+	    }
+	    return res;
+	}
+	j = (j + 1) & mask;
     }
-    return res;
+
+    // We've not seen this collapse key before.
+    item.collapse_entry = values.size() + 1;
+    values.push_back(CollapseEntry(fp, *key_ptr, item, collapse_max));
+    table[j] = values.size();
+    ++entry_count;
+    return ADDED;
 }
 
-Xapian::doccount
-Collapser::get_collapse_count(const string & collapse_key, int percent_cutoff,
-			      Xapian::weight min_weight) const
+/** Calculate the collapse count to report for a collapse key value.
+ *
+ *  @param data			The information about the value.
+ *  @param percent_cutoff	The percentage cutoff in use.
+ *  @param min_weight		The minimum weight for the percentage cutoff.
+ */
+static Xapian::doccount
+get_collapse_count(const CollapseData & data, int percent_cutoff,
+		   Xapian::weight min_weight)
 {
-    map<string, CollapseData>::const_iterator key = table.find(collapse_key);
-    // If a collapse key is present in the MSet, it must be in our table.
-    Assert(key != table.end());
-
     if (!percent_cutoff) {
 	// The recorded collapse_count is correct.
-	return key->second.get_collapse_count();
+	return data.get_collapse_count();
     }
 
-    if (key->second.get_next_best_weight() < min_weight) {
+    if (data.get_next_best_weight() < min_weight) {
 	// We know for certain that all collapsed items would have failed the
 	// percentage cutoff, so collapse_count should be 0.
 	return 0;
@@ -134,6 +165,21 @@ Collapser::get_collapse_count(const string & collapse_key, int percent_cutoff,
     return 1;
 }
 
+void
+Collapser::finalise(vector<Xapian::Internal::MSetItem> & items,
+		    int percent_cutoff, Xapian::weight min_weight) const
+{
+    vector<Xapian::Internal::MSetItem>::iterator i;
+    for (i = items.begin(); i != items.end(); ++i) {
+	// Items without a collapse key are left alone.
+	if (!i->collapse_entry) continue;
+	const CollapseEntry & entry = values[i->collapse_entry - 1];
+	i->collapse_key = entry.key;
+	i->collapse_count = get_collapse_count(entry.data, percent_cutoff,
+					       min_weight);
+    }
+}
+
 Xapian::doccount
 Collapser::get_matches_lower_bound() const
 {
@@ -147,10 +193,10 @@ Collapser::get_matches_lower_bound() const
     // many documents.
 #if 0
     Xapian::doccount max_kept = 0;
-    map<string, CollapseData>::const_iterator i;
-    for (i = table.begin(); i != table.end(); ++i) {
-	if (i->second.get_collapse_count() > max_kept) {
-	    max_kept = i->second.get_collapse_count();
+    deque<CollapseEntry>::const_iterator i;
+    for (i = values.begin(); i != values.end(); ++i) {
+	if (i->data.get_collapse_count() > max_kept) {
+	    max_kept = i->data.get_collapse_count();
 	    if (max_kept == collapse_max) {
 		return matches_lower_bound;
 	    }
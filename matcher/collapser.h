@@ -22,11 +22,15 @@
 #define XAPIAN_INCLUDED_COLLAPSER_H
 
 #include "document.h"
+#include "internaltypes.h"
 #include "msetcmp.h"
 #include "omenquireinternal.h"
 #include "postlist.h"
 
-#include <map>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
 
 /// Enumeration reporting how a document was handled by the Collapser.
 typedef enum {
@@ -43,9 +47,8 @@ class CollapseData {
      *  If collapse_max > 1, then this is a min-heap once items.size()
      *  reaches collapse_max.
      *
-     *  FIXME: We expect collapse_max to be small, so perhaps we should
-     *  preallocate space for that many entries and/or allocate space in
-     *  larger blocks to divvy up?
+     *  We expect collapse_max to be small, so space for up to that many
+     *  entries is allocated up front (up to a limit).
      */
     vector<Xapian::Internal::MSetItem> items;
 
@@ -56,10 +59,16 @@ class CollapseData {
     Xapian::doccount collapse_count;
 
   public:
-    /// Construct with the given MSetItem @a item.
-    CollapseData(const Xapian::Internal::MSetItem & item)
-	: items(1, item), next_best_weight(0), collapse_count(0) {
-	items[0].collapse_key = string();
+    /** Construct with the given MSetItem @a item.
+     *
+     *  @param item		The first item.
+     *  @param collapse_max	Max no. of items for each collapse key value.
+     */
+    CollapseData(const Xapian::Internal::MSetItem & item,
+		 Xapian::doccount collapse_max)
+	: next_best_weight(0), collapse_count(0) {
+	items.reserve(std::min(collapse_max, Xapian::doccount(16)));
+	items.push_back(item);
     }
 
     /** Handle a new MSetItem with this collapse key value.
@@ -81,12 +90,47 @@ class CollapseData {
 
     /// The number of documents we've rejected.
     Xapian::doccount get_collapse_count() const { return collapse_count; }
+
+    /// The items currently kept.
+    const vector<Xapian::Internal::MSetItem> & get_items() const {
+	return items;
+    }
+};
+
+/// A collapse key value, and the information about it.
+struct CollapseEntry {
+    /// Fingerprint of the collapse key value.
+    uint8 fingerprint;
+
+    /// The collapse key value.
+    std::string key;
+
+    /// The items kept for this value, and the collapsing statistics.
+    CollapseData data;
+
+    CollapseEntry(uint8 fingerprint_, const std::string & key_,
+		  const Xapian::Internal::MSetItem & item,
+		  Xapian::doccount collapse_max)
+	: fingerprint(fingerprint_), key(key_), data(item, collapse_max) { }
 };
 
 /// The Collapser class tracks collapse keys and the documents they match.
 class Collapser {
-    /// Map from collapse key values to the items we're keeping for them.
-    std::map<std::string, CollapseData> table;
+    /** The collapse key values seen, and the items we're keeping for them.
+     *
+     *  This is a deque so that entries don't get copied as it grows.
+     */
+    std::deque<CollapseEntry> values;
+
+    /** Open-addressed hash table of values, keyed by fingerprint.
+     *
+     *  Each slot holds an index into values plus one, or 0 if the slot is
+     *  empty.
+     */
+    std::vector<Xapian::doccount> table;
+
+    /// The collapse key of the document being processed.
+    std::string key;
 
     /// How many items we're currently keeping in @a table.
     Xapian::doccount entry_count;
@@ -131,7 +175,7 @@ class Collapser {
 
     /** Handle a new MSetItem.
      *
-     *  @param item		The new item.
+     *  @param item		The new item (its collapse_entry is set).
      *  @param postlist		PostList to try to get collapse key from
      *				(this happens for a remote match).
      *  @param doc		Document for getting values.
@@ -144,9 +188,19 @@ class Collapser {
 			    Xapian::Document::Internal & vsdoc,
 			    const MSetCmp & mcmp);
 
-    Xapian::doccount get_collapse_count(const std::string & collapse_key,
-					int percent_cutoff,
-					Xapian::weight min_weight) const;
+    /** Set the collapse keys and counts of the items in the MSet.
+     *
+     *  During the match, items only record which of the Collapser's
+     *  entries their collapse key is in (in collapse_entry), so this must
+     *  be called to set collapse_key and collapse_count for the items which
+     *  made it into the MSet.
+     *
+     *  @param items		The MSet items.
+     *  @param percent_cutoff	The percentage cutoff in use.
+     *  @param min_weight	The minimum weight for the percentage cutoff.
+     */
+    void finalise(std::vector<Xapian::Internal::MSetItem> & items,
+		  int percent_cutoff, Xapian::weight min_weight) const;
 
     Xapian::doccount get_docs_considered() const { return docs_considered; }
 
@@ -156,7 +210,7 @@ class Collapser {
 
     Xapian::doccount get_matches_lower_bound() const;
 
-    bool empty() const { return table.empty(); }
+    bool empty() const { return values.empty(); }
 };
 
 #endif // XAPIAN_INCLUDED_COLLAPSER_H
@@ -28,13 +28,16 @@
 #include "omassert.h"
 #include "omdebug.h"
 
+#include <algorithm>
+
 using namespace std;
 
 ExternalPostList::ExternalPostList(const Xapian::Database & db,
 				   Xapian::PostingSource *source_,
 				   double factor_,
 				   MultiMatch * matcher)
-    : source(source_), source_is_owned(false), current(0), factor(factor_)
+    : source(source_), source_is_owned(false), current(0), factor(factor_),
+      batch_pos(0), batch_last(false), batch_max(0)
 {
     Assert(source);
     Xapian::PostingSource * newsource = source->clone();
@@ -44,6 +47,7 @@ ExternalPostList::ExternalPostList(const Xapian::Database & db,
     }
     source->register_matcher_(static_cast<void*>(matcher));
     source->init(db);
+    batch_size = source->get_batch_size();
 }
 
 ExternalPostList::~ExternalPostList()
@@ -81,7 +85,12 @@ ExternalPostList::get_maxweight() const
     // source will be NULL here if we've reached the end.
     if (source == NULL) RETURN(0.0);
     if (factor == 0.0) RETURN(0.0);
-    RETURN(factor * source->get_maxweight());
+    Xapian::weight maxweight = source->get_maxweight();
+    // The source may have lowered its upper bound since returning the
+    // current batch, but the batch's weights are yet to be used.
+    if (batch_pos < batch_docids.size() && batch_max > maxweight)
+	maxweight = batch_max;
+    RETURN(factor * maxweight);
 }
 
 Xapian::docid
@@ -98,6 +107,8 @@ ExternalPostList::get_weight() const
     DEBUGCALL(MATCH, Xapian::weight, "ExternalPostList::get_weight", "");
     Assert(source);
     if (factor == 0.0) RETURN(factor);
+    if (batch_pos < batch_docids.size())
+	RETURN(factor * batch_weights[batch_pos]);
     RETURN(factor * source->get_weight());
 }
 
@@ -131,20 +142,74 @@ ExternalPostList::update_after_advance() {
     DEBUGCALL(MATCH, PostList *, "ExternalPostList::update_after_advance", "");
     Assert(source);
     if (source->at_end()) {
-	LOGLINE(MATCH, "ExternalPostList now at end");
-	if (source_is_owned) delete source;
-	source = NULL;
+	set_at_end();
     } else {
 	current = source->get_docid();
     }
     RETURN(NULL);
 }
 
+void
+ExternalPostList::set_at_end()
+{
+    LOGLINE(MATCH, "ExternalPostList now at end");
+    if (source_is_owned) delete source;
+    source = NULL;
+    batch_docids.clear();
+    batch_weights.clear();
+    batch_pos = 0;
+}
+
+void
+ExternalPostList::next_batch(Xapian::weight w_min)
+{
+    DEBUGCALL(MATCH, void, "ExternalPostList::next_batch", w_min);
+    Assert(batch_size);
+    if (batch_last) {
+	set_at_end();
+	return;
+    }
+    batch_docids.resize(batch_size);
+    batch_weights.resize(batch_size);
+    Xapian::doccount n = source->next_batch(w_min, &batch_docids[0],
+					    &batch_weights[0], batch_size);
+    Assert(n <= batch_size);
+    if (n < batch_size) batch_last = true;
+    if (n == 0) {
+	set_at_end();
+	return;
+    }
+    batch_docids.resize(n);
+    batch_weights.resize(n);
+    batch_pos = 0;
+    batch_max = *max_element(batch_weights.begin(), batch_weights.end());
+    current = batch_docids[0];
+}
+
+bool
+ExternalPostList::skip_in_batch(Xapian::docid did)
+{
+    if (batch_docids.empty() || did > batch_docids.back()) return false;
+    vector<Xapian::docid>::const_iterator i;
+    i = lower_bound(batch_docids.begin() + batch_pos, batch_docids.end(), did);
+    batch_pos = i - batch_docids.begin();
+    current = *i;
+    return true;
+}
+
 PostList *
 ExternalPostList::next(Xapian::weight w_min)
 {
     DEBUGCALL(MATCH, PostList *, "ExternalPostList::next", w_min);
     Assert(source);
+    if (batch_size) {
+	if (batch_pos + 1 < batch_docids.size()) {
+	    current = batch_docids[++batch_pos];
+	} else {
+	    next_batch(w_min);
+	}
+	RETURN(NULL);
+    }
     source->next(w_min);
     RETURN(update_after_advance());
 }
@@ -156,6 +221,17 @@ ExternalPostList::skip_to(Xapian::docid did, Xapian::weight w_min)
 	      did << ", " << w_min);
     Assert(source);
     if (did <= current) RETURN(NULL);
+    if (batch_size) {
+	if (skip_in_batch(did)) RETURN(NULL);
+	if (batch_last) {
+	    set_at_end();
+	    RETURN(NULL);
+	}
+	// The target is after the batch, so the source needs to skip to it.
+	batch_docids.clear();
+	batch_weights.clear();
+	batch_pos = 0;
+    }
     source->skip_to(did, w_min);
     RETURN(update_after_advance());
 }
@@ -170,11 +246,24 @@ ExternalPostList::check(Xapian::docid did, Xapian::weight w_min, bool &valid)
 	valid = true;
 	RETURN(NULL);
     }
+    if (batch_size) {
+	// Within the batch, we can act like skip_to().
+	if (skip_in_batch(did)) {
+	    valid = true;
+	    RETURN(NULL);
+	}
+	if (batch_last) {
+	    set_at_end();
+	    valid = true;
+	    RETURN(NULL);
+	}
+	batch_docids.clear();
+	batch_weights.clear();
+	batch_pos = 0;
+    }
     valid = source->check(did, w_min);
     if (source->at_end()) {
-	LOGLINE(MATCH, "ExternalPostList now at end");
-	if (source_is_owned) delete source;
-	source = NULL;
+	set_at_end();
     } else {
 	current = valid ? source->get_docid() : current;
     }
@@ -24,6 +24,8 @@
 
 #include "postlist.h"
 
+#include <vector>
+
 namespace Xapian {
     class PostingSource;
 }
@@ -44,8 +46,46 @@ class ExternalPostList : public PostList {
 
     double factor;
 
+    /** The batch size the source asked for, or 0 if it isn't batched.
+     *
+     *  If this is non-zero, we read documents from the source with
+     *  next_batch() and step through them in batch_docids and batch_weights.
+     */
+    Xapian::doccount batch_size;
+
+    /// The docids in the current batch.
+    std::vector<Xapian::docid> batch_docids;
+
+    /// The weights of the documents in the current batch.
+    std::vector<Xapian::weight> batch_weights;
+
+    /** The index of the current document in the batch.
+     *
+     *  If this is batch_docids.size(), the source is positioned on the
+     *  current document.
+     */
+    size_t batch_pos;
+
+    /// True if the source has no documents after the current batch.
+    bool batch_last;
+
+    /// The highest weight in the current batch.
+    Xapian::weight batch_max;
+
     PostList * update_after_advance();
 
+    /// Finish with the source once we've reached the end.
+    void set_at_end();
+
+    /// Read the next batch of documents from the source.
+    void next_batch(Xapian::weight w_min);
+
+    /** Move to the first document >= @ did in the current batch.
+     *
+     *  @return false if @a did is after the last document in the batch.
+     */
+    bool skip_in_batch(Xapian::docid did);
+
   public:
     /** Constructor.
      *
@@ -26,6 +26,7 @@
 #include "localmatch.h"
 
 #include "autoptr.h"
+#include "expandwildcard.h"
 #include "extraweightpostlist.h"
 #include "leafpostlist.h"
 #include "omdebug.h"
@@ -70,6 +71,7 @@ LocalSubMatch::prepare_match(bool, Xapian::Weight::Internal & total_stats)
 	my_stats.set_termfreq(*titer, db->get_termfreq(*titer));
 	rset.will_want_reltermfreq(*titer);
     }
+    prepare_wildcards(&orig_query, my_stats);
     rset.contribute_stats(my_stats);
 
     // Contribute the calculated statistics.
@@ -77,6 +79,41 @@ LocalSubMatch::prepare_match(bool, Xapian::Weight::Internal & total_stats)
     RETURN(true);
 }
 
+void
+LocalSubMatch::prepare_wildcards(const Xapian::Query::Internal * query,
+				 Xapian::Weight::Internal & my_stats)
+{
+    if (query->op != Xapian::Query::OP_WILDCARD) {
+	Xapian::Query::Internal::subquery_list::const_iterator i;
+	for (i = query->subqs.begin(); i != query->subqs.end(); ++i) {
+	    if (*i) prepare_wildcards(*i, my_stats);
+	}
+	return;
+    }
+
+    vector<string> & terms = wildcard_terms[query];
+    terms.clear();
+    vector<Xapian::doccount> termfreqs;
+    Xapian::TermIterator t(db->open_allterms(query->tname));
+    expand_wildcard(t, query->tname, query->parameter,
+		    query->get_wildcard_limit(), terms, &termfreqs);
+    for (size_t i = 0; i != terms.size(); ++i) {
+	my_stats.set_termfreq(terms[i], termfreqs[i]);
+	rset.will_want_reltermfreq(terms[i]);
+    }
+}
+
+const vector<string> &
+LocalSubMatch::get_wildcard_terms(const Xapian::Query::Internal *query)
+{
+    AssertEq(query->op, Xapian::Query::OP_WILDCARD);
+    map<const Xapian::Query::Internal *, vector<string> >::const_iterator i;
+    i = wildcard_terms.find(query);
+    // prepare_match() should have expanded all the wildcards.
+    Assert(i != wildcard_terms.end());
+    return i->second;
+}
+
 void
 LocalSubMatch::start_match(Xapian::doccount, Xapian::doccount,
 			   Xapian::doccount,
@@ -29,6 +29,7 @@
 #include "xapian/weight.h"
 
 #include <map>
+#include <vector>
 
 class LocalSubMatch : public SubMatch {
     /// Don't allow assignment.
@@ -61,6 +62,20 @@ class LocalSubMatch : public SubMatch {
     /// The termfreqs and weights of terms used in orig_query, or NULL.
     std::map<string, Xapian::MSet::Internal::TermFreqAndWeight> * term_info;
 
+    /** The terms each OP_WILDCARD subquery of orig_query expands to in this
+     *  (sub-)Database.
+     *
+     *  These are filled in by prepare_match(), so that the expansion is
+     *  only performed once.
+     */
+    std::map<const Xapian::Query::Internal *, std::vector<string> > wildcard_terms;
+
+    /** Expand any OP_WILDCARD queries in @a query, and add the statistics for
+     *  the terms they expand to to @a stats.
+     */
+    void prepare_wildcards(const Xapian::Query::Internal * query,
+			   Xapian::Weight::Internal & stats);
+
   public:
     /// Constructor.
     LocalSubMatch(const Xapian::Database::Internal *db,
@@ -94,6 +109,13 @@ class LocalSubMatch : public SubMatch {
      */
     PostList * postlist_from_op_leaf_query(const Xapian::Query::Internal *query,
 					   double factor);
+
+    /** Get the terms an OP_WILDCARD query expands to in this (sub-)Database.
+     *
+     *  The terms are returned in ascending byte order.
+     */
+    const std::vector<string> &
+    get_wildcard_terms(const Xapian::Query::Internal *query);
 };
 
 #endif /* XAPIAN_INCLUDED_LOCALMATCH_H */
@@ -21,87 +21,6 @@
 #include <config.h>
 #include "msetcmp.h"
 
-/* We use templates to generate the 14 different comparison functions
- * which we need.  This avoids having to write them all out by hand.
- */
-
-// Order by did.  Helper comparison template function, which is used as the
-// last fallback by the others.
-template<bool FORWARD_DID, bool CHECK_DID_ZERO> inline bool
-msetcmp_by_did(const Xapian::Internal::MSetItem &a,
-	       const Xapian::Internal::MSetItem &b)
-{
-    if (FORWARD_DID) {
-	if (CHECK_DID_ZERO) {
-	    // We want dummy did 0 to compare worse than any other.
-	    if (a.did == 0) return false;
-	    if (b.did == 0) return true;
-	}
-	return (a.did < b.did);
-    } else {
-	return (a.did > b.did);
-    }
-}
-
-// Order by relevance, then docid.
-template<bool FORWARD_DID> bool
-msetcmp_by_relevance(const Xapian::Internal::MSetItem &a,
-		     const Xapian::Internal::MSetItem &b)
-{
-    if (a.wt > b.wt) return true;
-    if (a.wt < b.wt) return false;
-    return msetcmp_by_did<FORWARD_DID, true>(a, b);
-}
-
-// Order by value, then docid.
-template<bool FORWARD_VALUE, bool FORWARD_DID> bool
-msetcmp_by_value(const Xapian::Internal::MSetItem &a,
-		 const Xapian::Internal::MSetItem &b)
-{
-    if (!FORWARD_VALUE) {
-	// We want dummy did 0 to compare worse than any other.
-	if (a.did == 0) return false;
-	if (b.did == 0) return true;
-    }
-    if (a.sort_key > b.sort_key) return FORWARD_VALUE;
-    if (a.sort_key < b.sort_key) return !FORWARD_VALUE;
-    return msetcmp_by_did<FORWARD_DID, FORWARD_VALUE>(a, b);
-}
-
-// Order by value, then relevance, then docid.
-template<bool FORWARD_VALUE, bool FORWARD_DID> bool
-msetcmp_by_value_then_relevance(const Xapian::Internal::MSetItem &a,
-				const Xapian::Internal::MSetItem &b)
-{
-    if (!FORWARD_VALUE) {
-	// two special cases to make min_item compares work when did == 0
-	if (a.did == 0) return false;
-	if (b.did == 0) return true;
-    }
-    if (a.sort_key > b.sort_key) return FORWARD_VALUE;
-    if (a.sort_key < b.sort_key) return !FORWARD_VALUE;
-    if (a.wt > b.wt) return true;
-    if (a.wt < b.wt) return false;
-    return msetcmp_by_did<FORWARD_DID, FORWARD_VALUE>(a, b);
-}
-
-// Order by relevance, then value, then docid.
-template<bool FORWARD_VALUE, bool FORWARD_DID> bool
-msetcmp_by_relevance_then_value(const Xapian::Internal::MSetItem &a,
-				const Xapian::Internal::MSetItem &b)
-{
-    if (!FORWARD_VALUE) {
-	// two special cases to make min_item compares work when did == 0
-	if (a.did == 0) return false;
-	if (b.did == 0) return true;
-    }
-    if (a.wt > b.wt) return true;
-    if (a.wt < b.wt) return false;
-    if (a.sort_key > b.sort_key) return FORWARD_VALUE;
-    if (a.sort_key < b.sort_key) return !FORWARD_VALUE;
-    return msetcmp_by_did<FORWARD_DID, FORWARD_VALUE>(a, b);
-}
-
 static mset_cmp mset_cmp_table[] = {
     // Xapian::Enquire::Internal::REL
     msetcmp_by_relevance<false>,
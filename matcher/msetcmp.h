@@ -24,6 +24,104 @@
 
 #include "omenquireinternal.h"
 
+/* We use templates to generate the 14 different comparison functions
+ * which we need.  This avoids having to write them all out by hand.  They're
+ * defined here so that the matcher can instantiate its main loop for each of
+ * them with MSetCmpFn, which allows the comparison to be inlined.
+ */
+
+// Order by did.  Helper comparison template function, which is used as the
+// last fallback by the others.
+template<bool FORWARD_DID, bool CHECK_DID_ZERO> inline bool
+msetcmp_by_did(const Xapian::Internal::MSetItem &a,
+	       const Xapian::Internal::MSetItem &b)
+{
+    if (FORWARD_DID) {
+	if (CHECK_DID_ZERO) {
+	    // We want dummy did 0 to compare worse than any other.
+	    if (a.did == 0) return false;
+	    if (b.did == 0) return true;
+	}
+	return (a.did < b.did);
+    } else {
+	return (a.did > b.did);
+    }
+}
+
+// Compare the sort keys of two items, returning < 0, 0 or > 0 like memcmp.
+inline int
+cmp_sort_key(const Xapian::Internal::MSetItem &a,
+	     const Xapian::Internal::MSetItem &b)
+{
+    if (a.sort_key_head != b.sort_key_head)
+	return (a.sort_key_head > b.sort_key_head) ? 1 : -1;
+    // The heads are equal, so if the keys are short they're equal too.
+    if ((a.sort_key_head & 0xff) != 8) return 0;
+    return a.sort_key.compare(b.sort_key);
+}
+
+// Order by relevance, then docid.
+template<bool FORWARD_DID> bool
+msetcmp_by_relevance(const Xapian::Internal::MSetItem &a,
+		     const Xapian::Internal::MSetItem &b)
+{
+    if (a.wt > b.wt) return true;
+    if (a.wt < b.wt) return false;
+    return msetcmp_by_did<FORWARD_DID, true>(a, b);
+}
+
+// Order by value, then docid.
+template<bool FORWARD_VALUE, bool FORWARD_DID> bool
+msetcmp_by_value(const Xapian::Internal::MSetItem &a,
+		 const Xapian::Internal::MSetItem &b)
+{
+    if (!FORWARD_VALUE) {
+	// We want dummy did 0 to compare worse than any other.
+	if (a.did == 0) return false;
+	if (b.did == 0) return true;
+    }
+    int c = cmp_sort_key(a, b);
+    if (c > 0) return FORWARD_VALUE;
+    if (c < 0) return !FORWARD_VALUE;
+    return msetcmp_by_did<FORWARD_DID, FORWARD_VALUE>(a, b);
+}
+
+// Order by value, then relevance, then docid.
+template<bool FORWARD_VALUE, bool FORWARD_DID> bool
+msetcmp_by_value_then_relevance(const Xapian::Internal::MSetItem &a,
+				const Xapian::Internal::MSetItem &b)
+{
+    if (!FORWARD_VALUE) {
+	// two special cases to make min_item compares work when did == 0
+	if (a.did == 0) return false;
+	if (b.did == 0) return true;
+    }
+    int c = cmp_sort_key(a, b);
+    if (c > 0) return FORWARD_VALUE;
+    if (c < 0) return !FORWARD_VALUE;
+    if (a.wt > b.wt) return true;
+    if (a.wt < b.wt) return false;
+    return msetcmp_by_did<FORWARD_DID, FORWARD_VALUE>(a, b);
+}
+
+// Order by relevance, then value, then docid.
+template<bool FORWARD_VALUE, bool FORWARD_DID> bool
+msetcmp_by_relevance_then_value(const Xapian::Internal::MSetItem &a,
+				const Xapian::Internal::MSetItem &b)
+{
+    if (!FORWARD_VALUE) {
+	// two special cases to make min_item compares work when did == 0
+	if (a.did == 0) return false;
+	if (b.did == 0) return true;
+    }
+    if (a.wt > b.wt) return true;
+    if (a.wt < b.wt) return false;
+    int c = cmp_sort_key(a, b);
+    if (c > 0) return FORWARD_VALUE;
+    if (c < 0) return !FORWARD_VALUE;
+    return msetcmp_by_did<FORWARD_DID, FORWARD_VALUE>(a, b);
+}
+
 // typedef for MSetItem comparison function.
 typedef bool (* mset_cmp)(const Xapian::Internal::MSetItem &,
 			  const Xapian::Internal::MSetItem &);
@@ -43,4 +141,18 @@ class MSetCmp {
     }
 };
 
+/** MSetItem comparison functor for a comparison function known at compile
+ *  time.
+ *
+ *  Unlike with MSetCmp, calls to @a FN can be inlined.
+ */
+template<mset_cmp FN>
+struct MSetCmpFn {
+    /// Return true if MSetItem a should be ranked above MSetItem b.
+    bool operator()(const Xapian::Internal::MSetItem &a,
+		    const Xapian::Internal::MSetItem &b) const {
+	return FN(a, b);
+    }
+};
+
 #endif // XAPIAN_INCLUDED_MSETCMP_H
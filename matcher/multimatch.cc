@@ -36,6 +36,8 @@
 #include "emptypostlist.h"
 #include "branchpostlist.h"
 #include "mergepostlist.h"
+#include "multiandpostlist.h"
+#include "valuesetpostlist.h"
 
 #include "document.h"
 #include "omqueryinternal.h"
@@ -49,6 +51,7 @@
 
 #include <xapian/errorhandler.h>
 #include <xapian/matchspy.h>
+#include <xapian/valuesetmatchdecider.h>
 #include <xapian/version.h> // For XAPIAN_HAS_REMOTE_BACKEND
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
@@ -71,10 +74,8 @@ const Xapian::Enquire::Internal::sort_setting REL_VAL =
 	Xapian::Enquire::Internal::REL_VAL;
 const Xapian::Enquire::Internal::sort_setting VAL =
 	Xapian::Enquire::Internal::VAL;
-#if 0 // VAL_REL isn't currently used which causes a warning with SGI CC.
 const Xapian::Enquire::Internal::sort_setting VAL_REL =
 	Xapian::Enquire::Internal::VAL_REL;
-#endif
 
 /** Split an RSet into several sub rsets, one for each database.
  *
@@ -307,232 +308,153 @@ MultiMatch::getorrecalc_maxweight(PostList *pl)
     RETURN(wt);
 }
 
-void
-MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
-		     Xapian::doccount check_at_least,
-		     Xapian::MSet & mset,
-		     const Xapian::Weight::Internal & stats,
-		     const Xapian::MatchDecider *mdecider,
-		     const Xapian::MatchDecider *matchspy_legacy,
-		     const Xapian::KeyMaker *sorter)
-{
-    DEBUGCALL(MATCH, void, "MultiMatch::get_mset", first << ", " << maxitems
-	      << ", " << check_at_least << ", ...");
-    if (check_at_least < maxitems) check_at_least = maxitems;
-
-    if (!query) {
-	mset = Xapian::MSet(); // FIXME: mset.get_firstitem() will return 0 not first
-	return;
-    }
-
-    Assert(!leaves.empty());
-
+/** The state shared between get_mset() and the main match loop.
+ *
+ *  The first group of members are the objects the loop works on, the second
+ *  the settings for the match, and the third the variables the loop updates.
+ */
+struct MultiMatch::MatchState {
+    PostList *& pl;
+    ValueStreamDocument & vsdoc;
+    Xapian::Document & doc;
+    vector<Xapian::Internal::MSetItem> & items;
+    Collapser & collapser;
+    /// Comparison functor for the collapser, which is passed it at runtime.
+    const MSetCmp & collapse_cmp;
+
+    const Xapian::MatchDecider * mdecider;
+    const Xapian::MatchDecider * matchspy_legacy;
+    Xapian::MatchSpy * matchspy;
+    const Xapian::KeyMaker * sorter;
+    Xapian::doccount max_msize;
+    Xapian::doccount check_at_least;
+    Xapian::weight max_possible;
+    Xapian::weight percent_cutoff_factor;
+    bool sort_forward;
+
+    Xapian::Internal::MSetItem & min_item;
+    Xapian::weight & min_weight;
+    bool & is_heap;
+    Xapian::doccount & docs_matched;
+    Xapian::doccount & decider_considered;
+    Xapian::doccount & decider_denied;
+    Xapian::weight & greatest_wt;
+    Xapian::termcount & greatest_wt_subqs_matched;
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-    // If there's only one database and it's remote, we can just unserialise
-    // its MSet and return that.
-    if (leaves.size() == 1 && is_remote[0]) {
-	RemoteSubMatch * rem_match;
-	rem_match = static_cast<RemoteSubMatch*>(leaves[0].get());
-	rem_match->start_match(first, maxitems, check_at_least, stats);
-	rem_match->get_mset(mset);
-	return;
-    }
+    unsigned & greatest_wt_subqs_db_num;
 #endif
+};
 
-    // Start matchers.
-    {
-	vector<Xapian::Internal::RefCntPtr<SubMatch> >::iterator leaf;
-	for (leaf = leaves.begin(); leaf != leaves.end(); ++leaf) {
-	    if (!(*leaf).get()) continue;
-	    try {
-		(*leaf)->start_match(0, first + maxitems,
-				     first + check_at_least, stats);
-	    } catch (Xapian::Error & e) {
-		if (!errorhandler) throw;
-		LOGLINE(EXCEPTION, "Calling error handler for "
-				   "start_match() on a SubMatch.");
-		(*errorhandler)(e);
-		// Continue match without this sub-match.
-		*leaf = NULL;
+void
+MultiMatch::run_match_loop(MatchState & s)
+{
+    bool sort_forward = s.sort_forward;
+    switch (sort_by) {
+	case REL:
+	    // Pure relevance ordering is the commonest case, so has its own
+	    // instantiations for when there's no decider, spy or collapsing.
+	    if (s.mdecider || s.matchspy_legacy || s.matchspy || s.collapser) {
+		if (sort_forward)
+		    match_loop<msetcmp_by_relevance<true>, REL, false>(s);
+		else
+		    match_loop<msetcmp_by_relevance<false>, REL, false>(s);
+	    } else {
+		if (sort_forward)
+		    match_loop<msetcmp_by_relevance<true>, REL, true>(s);
+		else
+		    match_loop<msetcmp_by_relevance<false>, REL, true>(s);
 	    }
-	}
-    }
-
-    // Get postlists and term info
-    vector<PostList *> postlists;
-    map<string, Xapian::MSet::Internal::TermFreqAndWeight> termfreqandwts;
-    map<string, Xapian::MSet::Internal::TermFreqAndWeight> * termfreqandwts_ptr;
-    termfreqandwts_ptr = &termfreqandwts;
-
-    Xapian::termcount total_subqs = 0;
-    // Keep a count of matches which we know exist, but we won't see.  This
-    // occurs when a submatch is remote, and returns a lower bound on the
-    // number of matching documents which is higher than the number of
-    // documents it returns (because it wasn't asked for more documents).
-    Xapian::doccount definite_matches_not_seen = 0;
-    for (size_t i = 0; i != leaves.size(); ++i) {
-	PostList *pl;
-	try {
-	    pl = leaves[i]->get_postlist_and_term_info(this,
-						       termfreqandwts_ptr,
-						       &total_subqs);
-	    if (termfreqandwts_ptr && !termfreqandwts.empty())
-		termfreqandwts_ptr = NULL;
-	    if (is_remote[i]) {
-		if (pl->get_termfreq_min() > first + maxitems) {
-		    LOGLINE(MATCH, "Found " <<
-				   pl->get_termfreq_min() - (first + maxitems)
-				   << " definite matches in remote submatch "
-				   "which aren't passed to local match");
-		    definite_matches_not_seen += pl->get_termfreq_min();
-		    definite_matches_not_seen -= first + maxitems;
-		}
+	    break;
+	case VAL:
+	    if (sort_value_forward) {
+		if (sort_forward)
+		    match_loop<msetcmp_by_value<true, true>, VAL, false>(s);
+		else
+		    match_loop<msetcmp_by_value<true, false>, VAL, false>(s);
+	    } else {
+		if (sort_forward)
+		    match_loop<msetcmp_by_value<false, true>, VAL, false>(s);
+		else
+		    match_loop<msetcmp_by_value<false, false>, VAL, false>(s);
 	    }
-	} catch (Xapian::Error & e) {
-	    if (!errorhandler) throw;
-	    LOGLINE(EXCEPTION, "Calling error handler for "
-			       "get_term_info() on a SubMatch.");
-	    (*errorhandler)(e);
-	    // FIXME: check if *ALL* the remote servers have failed!
-	    // Continue match without this sub-match.
-	    leaves[i] = NULL;
-	    pl = new EmptyPostList;
-	}
-	postlists.push_back(pl);
-    }
-    Assert(!postlists.empty());
-
-    ValueStreamDocument vsdoc(db);
-    ++vsdoc.ref_count;
-    Xapian::Document doc(&vsdoc);
-
-    // Get a single combined postlist
-    PostList *pl;
-    if (postlists.size() == 1) {
-	pl = postlists.front();
-    } else {
-	pl = new MergePostList(postlists, this, vsdoc, errorhandler);
-    }
-
-    LOGLINE(MATCH, "pl = (" << pl->get_description() << ")");
-
-#ifdef XAPIAN_DEBUG_LOG
-    {
-	map<string, Xapian::MSet::Internal::TermFreqAndWeight>::const_iterator tfwi;
-	for (tfwi = termfreqandwts.begin(); tfwi != termfreqandwts.end(); ++tfwi) {
-	    LOGLINE(MATCH, "termfreqandwts[" << tfwi->first << "] = " << tfwi->second.termfreq << ", " << tfwi->second.termweight);
-	}
+	    break;
+	case VAL_REL:
+	    if (sort_value_forward) {
+		if (sort_forward)
+		    match_loop<msetcmp_by_value_then_relevance<true, true>,
+			       VAL_REL, false>(s);
+		else
+		    match_loop<msetcmp_by_value_then_relevance<true, false>,
+			       VAL_REL, false>(s);
+	    } else {
+		if (sort_forward)
+		    match_loop<msetcmp_by_value_then_relevance<false, true>,
+			       VAL_REL, false>(s);
+		else
+		    match_loop<msetcmp_by_value_then_relevance<false, false>,
+			       VAL_REL, false>(s);
+	    }
+	    break;
+	case REL_VAL:
+	    // The sense of both directions is inverted for REL_VAL (see the
+	    // table in msetcmp.cc).
+	    if (sort_value_forward) {
+		if (sort_forward)
+		    match_loop<msetcmp_by_relevance_then_value<false, false>,
+			       REL_VAL, false>(s);
+		else
+		    match_loop<msetcmp_by_relevance_then_value<false, true>,
+			       REL_VAL, false>(s);
+	    } else {
+		if (sort_forward)
+		    match_loop<msetcmp_by_relevance_then_value<true, false>,
+			       REL_VAL, false>(s);
+		else
+		    match_loop<msetcmp_by_relevance_then_value<true, true>,
+			       REL_VAL, false>(s);
+	    }
+	    break;
     }
-#endif
+}
 
-    // Empty result set
-    Xapian::doccount docs_matched = 0;
-    Xapian::weight greatest_wt = 0;
-    Xapian::termcount greatest_wt_subqs_matched = 0;
+template<mset_cmp CMP, Xapian::Enquire::Internal::sort_setting SORT_BY,
+	 bool SIMPLE>
+void
+MultiMatch::match_loop(MatchState & s)
+{
+    DEBUGCALL(MATCH, void, "MultiMatch::match_loop", "[s]");
+    // Comparison functor for sorting MSet.
+    MSetCmpFn<CMP> mcmp;
+
+    PostList *& pl = s.pl;
+    ValueStreamDocument & vsdoc = s.vsdoc;
+    Xapian::Document & doc = s.doc;
+    vector<Xapian::Internal::MSetItem> & items = s.items;
+    Collapser & collapser = s.collapser;
+
+    const Xapian::MatchDecider * mdecider = s.mdecider;
+    const Xapian::MatchDecider * matchspy_legacy = s.matchspy_legacy;
+    Xapian::MatchSpy * matchspy = s.matchspy;
+    const Xapian::KeyMaker * sorter = s.sorter;
+    const Xapian::doccount max_msize = s.max_msize;
+    const Xapian::doccount check_at_least = s.check_at_least;
+    const Xapian::weight max_possible = s.max_possible;
+    const Xapian::weight percent_cutoff_factor = s.percent_cutoff_factor;
+    const bool sort_forward = s.sort_forward;
+
+    // Work on local copies of the variables we update so that the compiler
+    // can keep them in registers, and write them back at the end.
+    Xapian::Internal::MSetItem & min_item = s.min_item;
+    Xapian::weight min_weight = s.min_weight;
+    bool is_heap = s.is_heap;
+    Xapian::doccount docs_matched = s.docs_matched;
+    Xapian::doccount decider_considered = s.decider_considered;
+    Xapian::doccount decider_denied = s.decider_denied;
+    Xapian::weight greatest_wt = s.greatest_wt;
+    Xapian::termcount greatest_wt_subqs_matched = s.greatest_wt_subqs_matched;
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-    unsigned greatest_wt_subqs_db_num = UINT_MAX;
+    unsigned greatest_wt_subqs_db_num = s.greatest_wt_subqs_db_num;
 #endif
-    vector<Xapian::Internal::MSetItem> items;
-
-    // maximum weight a document could possibly have
-    const Xapian::weight max_possible = pl->recalc_maxweight();
-
-    LOGLINE(MATCH, "pl = (" << pl->get_description() << ")");
-    recalculate_w_max = false;
-
-    Xapian::doccount matches_upper_bound = pl->get_termfreq_max();
-    Xapian::doccount matches_lower_bound = 0;
-    Xapian::doccount matches_estimated   = pl->get_termfreq_est();
-
-    if (mdecider == NULL && matchspy_legacy == NULL) {
-	// If we have a matcher decider or match spy, the lower bound must be
-	// set to 0 as we could discard all hits.  Otherwise set it to the
-	// minimum number of entries which the postlist could return.
-	matches_lower_bound = pl->get_termfreq_min();
-    }
-
-    // Prepare the matchspy
-    Xapian::MatchSpy *matchspy = NULL;
-    MultipleMatchSpy multispy(matchspies);
-    if (!matchspies.empty()) {
-	if (matchspies.size() == 1) {
-	    matchspy = matchspies[0];
-	} else {
-	    matchspy = &multispy;
-	}
-    }
-
-    // Check if any results have been asked for (might just be wanting
-    // maxweight).
-    if (check_at_least == 0) {
-	delete pl;
-	Xapian::doccount uncollapsed_lower_bound = matches_lower_bound;
-	if (collapse_max) {
-	    // Lower bound must be set to no more than collapse_max, since it's
-	    // possible that all matching documents have the same collapse_key
-	    // value and so are collapsed together.
-	    if (matches_lower_bound > collapse_max)
-		matches_lower_bound = collapse_max;
-	}
-
-	mset = Xapian::MSet(new Xapian::MSet::Internal(
-					   first,
-					   matches_upper_bound,
-					   matches_lower_bound,
-					   matches_estimated,
-					   matches_upper_bound,
-					   uncollapsed_lower_bound,
-					   matches_estimated,
-					   max_possible, greatest_wt, items,
-					   termfreqandwts,
-					   0));
-	return;
-    }
-
-    // Number of documents considered by a decider or matchspy_legacy.
-    Xapian::doccount decider_considered = 0;
-    // Number of documents denied by the decider or matchspy_legacy.
-    Xapian::doccount decider_denied = 0;
-
-    // Set max number of results that we want - this is used to decide
-    // when to throw away unwanted items.
-    Xapian::doccount max_msize = first + maxitems;
-    items.reserve(max_msize + 1);
-
-    // Tracks the minimum item currently eligible for the MSet - we compare
-    // candidate items against this.
-    Xapian::Internal::MSetItem min_item(0.0, 0);
-
-    // Minimum weight an item must have to be worth considering.
-    Xapian::weight min_weight = weight_cutoff;
-
-    // Factor to multiply maximum weight seen by to get the cutoff weight.
-    Xapian::weight percent_cutoff_factor = percent_cutoff / 100.0;
-    // Corresponding correction to that in omenquire.cc to account for excess
-    // precision on x86.
-    percent_cutoff_factor -= DBL_EPSILON;
-
-    // Object to handle collapsing.
-    Collapser collapser(collapse_key, collapse_max);
-
-    /// Comparison functor for sorting MSet
-    bool sort_forward = (order != Xapian::Enquire::DESCENDING);
-    MSetCmp mcmp(get_msetcmp_function(sort_by, sort_forward, sort_value_forward));
-
-    // Perform query
-
-    // We form the mset in two stages.  In the first we fill up our working
-    // mset.  Adding a new document does not remove another.
-    //
-    // In the second, we consider documents which rank higher than the current
-    // lowest ranking document in the mset.  Each document added expels the
-    // current lowest ranking document.
-    //
-    // If a percentage cutoff is in effect, it can cause the matcher to return
-    // from the second stage from the first.
-
-    // Is the mset a valid heap?
-    bool is_heap = false;
 
     while (true) {
 	bool pushback;
@@ -570,7 +492,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	// below if we haven't already rejected this candidate.
 	Xapian::weight wt = 0.0;
 	bool calculated_weight = false;
-	if (sort_by != VAL || min_weight > 0.0) {
+	if (SORT_BY != VAL || min_weight > 0.0) {
 	    wt = pl->get_weight();
 	    if (wt < min_weight) {
 		LOGLINE(MATCH, "Rejecting potential match due to insufficient weight");
@@ -583,19 +505,22 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	vsdoc.set_document(did);
 	LOGLINE(MATCH, "Candidate document id " << did << " wt " << wt);
 	Xapian::Internal::MSetItem new_item(wt, did);
-	if (sort_by != REL) {
+	if (SORT_BY != REL) {
 	    if (sorter) {
-		new_item.sort_key = (*sorter)(doc);
+		string key = (*sorter)(doc);
+		new_item.set_sort_key(key);
 	    } else {
-		new_item.sort_key = vsdoc.get_value(sort_key);
+		string key = vsdoc.get_value(sort_key);
+		new_item.set_sort_key(key);
 	    }
 
 	    // We're sorting by value (in part at least), so compare the item
-	    // against the lowest currently in the proto-mset.  If sort_by is
+	    // against the lowest currently in the proto-mset.  If SORT_BY is
 	    // VAL, then new_item.wt won't yet be set, but that doesn't
 	    // matter since it's not used by the sort function.
 	    if (!mcmp(new_item, min_item)) {
-		if (mdecider == NULL && !collapser && matchspy_legacy == NULL) {
+		if (SIMPLE ||
+		    (mdecider == NULL && !collapser && matchspy_legacy == NULL)) {
 		    // Document was definitely suitable for mset - no more
 		    // processing needed.
 		    LOGLINE(MATCH, "Making note of match item which sorts lower than min_item");
@@ -623,7 +548,8 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	}
 
 	// Use the match spy and/or decision functors (if specified).
-	if (matchspy != NULL || mdecider != NULL || matchspy_legacy != NULL) {
+	if (!SIMPLE &&
+	    (matchspy != NULL || mdecider != NULL || matchspy_legacy != NULL)) {
 	    const unsigned int multiplier = db.internal.size();
 	    Assert(multiplier != 0);
 	    Xapian::doccount n = (did - 1) % multiplier; // which actual database
@@ -659,13 +585,13 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	pushback = true;
 
 	// Perform collapsing on key if requested.
-	if (collapser) {
+	if (!SIMPLE && collapser) {
 	    collapse_result res;
-	    res = collapser.process(new_item, pl, vsdoc, mcmp);
+	    res = collapser.process(new_item, pl, vsdoc, s.collapse_cmp);
 	    if (res == REJECTED) {
 		// If we're sorting by relevance primarily, then we throw away
 		// the lower weighted document anyway.
-		if (sort_by != REL && sort_by != REL_VAL) {
+		if (SORT_BY != REL && SORT_BY != REL_VAL) {
 		    if (wt > greatest_wt) goto new_greatest_weight;
 		}
 		continue;
@@ -691,9 +617,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		    vector<Xapian::Internal::MSetItem>::iterator i;
 		    for (i = items.begin(); i != items.end(); ++i) {
 			if (i->did == olddid) {
-			    LOGLINE(MATCH, "collapse: removing " <<
-					   olddid << ": " <<
-					   new_item.collapse_key);
+			    LOGLINE(MATCH, "collapse: removing " << olddid);
 			    // We can replace an arbitrary element in O(log N)
 			    // but have to do it by hand (in this case the new
 			    // elt is bigger, so we just swap down the tree).
@@ -718,17 +642,15 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		    is_heap = true;
 		    make_heap(items.begin(), items.end(), mcmp);
 		} else {
-		    push_heap<vector<Xapian::Internal::MSetItem>::iterator,
-			      MSetCmp>(items.begin(), items.end(), mcmp);
+		    push_heap(items.begin(), items.end(), mcmp);
 		}
-		pop_heap<vector<Xapian::Internal::MSetItem>::iterator,
-			 MSetCmp>(items.begin(), items.end(), mcmp);
+		pop_heap(items.begin(), items.end(), mcmp);
 		items.pop_back();
 
 		min_item = items.front();
-		if (sort_by == REL || sort_by == REL_VAL) {
+		if (SORT_BY == REL || SORT_BY == REL_VAL) {
 		    if (docs_matched >= check_at_least) {
-			if (sort_by == REL) {
+			if (SORT_BY == REL) {
 			    // We're done if this is a forward boolean match
 			    // with only one database (bodgetastic, FIXME
 			    // better if we can!)
@@ -755,7 +677,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	    } else {
 		items.push_back(new_item);
 		is_heap = false;
-		if (sort_by == REL && items.size() == max_msize) {
+		if (SORT_BY == REL && items.size() == max_msize) {
 		    if (docs_matched >= check_at_least) {
 			// We're done if this is a forward boolean match
 			// with only one database (bodgetastic, FIXME
@@ -798,12 +720,10 @@ new_greatest_weight:
 		    min_weight = w;
 		    if (!is_heap) {
 			is_heap = true;
-			make_heap<vector<Xapian::Internal::MSetItem>::iterator,
-				  MSetCmp>(items.begin(), items.end(), mcmp);
+			make_heap(items.begin(), items.end(), mcmp);
 		    }
 		    while (!items.empty() && items.front().wt < min_weight) {
-			pop_heap<vector<Xapian::Internal::MSetItem>::iterator,
-				 MSetCmp>(items.begin(), items.end(), mcmp);
+			pop_heap(items.begin(), items.end(), mcmp);
 			Assert(items.back().wt < min_weight);
 			items.pop_back();
 		    }
@@ -818,6 +738,284 @@ new_greatest_weight:
 	}
     }
 
+    s.min_weight = min_weight;
+    s.is_heap = is_heap;
+    s.docs_matched = docs_matched;
+    s.decider_considered = decider_considered;
+    s.decider_denied = decider_denied;
+    s.greatest_wt = greatest_wt;
+    s.greatest_wt_subqs_matched = greatest_wt_subqs_matched;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    s.greatest_wt_subqs_db_num = greatest_wt_subqs_db_num;
+#endif
+}
+
+void
+MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
+		     Xapian::doccount check_at_least,
+		     Xapian::MSet & mset,
+		     const Xapian::Weight::Internal & stats,
+		     const Xapian::MatchDecider *mdecider,
+		     const Xapian::MatchDecider *matchspy_legacy,
+		     const Xapian::KeyMaker *sorter)
+{
+    DEBUGCALL(MATCH, void, "MultiMatch::get_mset", first << ", " << maxitems
+	      << ", " << check_at_least << ", ...");
+    if (check_at_least < maxitems) check_at_least = maxitems;
+
+    if (!query) {
+	mset = Xapian::MSet(); // FIXME: mset.get_firstitem() will return 0 not first
+	return;
+    }
+
+    Assert(!leaves.empty());
+
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    // If there's only one database and it's remote, we can just unserialise
+    // its MSet and return that.
+    if (leaves.size() == 1 && is_remote[0]) {
+	RemoteSubMatch * rem_match;
+	rem_match = static_cast<RemoteSubMatch*>(leaves[0].get());
+	rem_match->start_match(first, maxitems, check_at_least, stats);
+	rem_match->get_mset(mset);
+	return;
+    }
+#endif
+
+    // Start matchers.
+    {
+	vector<Xapian::Internal::RefCntPtr<SubMatch> >::iterator leaf;
+	for (leaf = leaves.begin(); leaf != leaves.end(); ++leaf) {
+	    if (!(*leaf).get()) continue;
+	    try {
+		(*leaf)->start_match(0, first + maxitems,
+				     first + check_at_least, stats);
+	    } catch (Xapian::Error & e) {
+		if (!errorhandler) throw;
+		LOGLINE(EXCEPTION, "Calling error handler for "
+				   "start_match() on a SubMatch.");
+		(*errorhandler)(e);
+		// Continue match without this sub-match.
+		*leaf = NULL;
+	    }
+	}
+    }
+
+    // If the match decider is equivalent to a ValueSetMatchDecider, we can
+    // usually filter by it in the postlist tree instead, so that rejected
+    // documents are skipped before their weights are calculated.  We don't
+    // do this if there's a legacy matchspy, as that sees every candidate
+    // before the match decider.
+    const Xapian::ValueSetMatchDecider * vs_filter = NULL;
+    if (mdecider && !matchspy_legacy) {
+	vs_filter = mdecider->get_value_set_filter();
+	if (vs_filter && ValueSetPostList::can_filter(*vs_filter)) {
+	    mdecider = NULL;
+	} else {
+	    vs_filter = NULL;
+	}
+    }
+
+    // Get postlists and term info
+    vector<PostList *> postlists;
+    map<string, Xapian::MSet::Internal::TermFreqAndWeight> termfreqandwts;
+    map<string, Xapian::MSet::Internal::TermFreqAndWeight> * termfreqandwts_ptr;
+    termfreqandwts_ptr = &termfreqandwts;
+
+    Xapian::termcount total_subqs = 0;
+    // Keep a count of matches which we know exist, but we won't see.  This
+    // occurs when a submatch is remote, and returns a lower bound on the
+    // number of matching documents which is higher than the number of
+    // documents it returns (because it wasn't asked for more documents).
+    Xapian::doccount definite_matches_not_seen = 0;
+    for (size_t i = 0; i != leaves.size(); ++i) {
+	PostList *pl;
+	try {
+	    pl = leaves[i]->get_postlist_and_term_info(this,
+						       termfreqandwts_ptr,
+						       &total_subqs);
+	    if (termfreqandwts_ptr && !termfreqandwts.empty())
+		termfreqandwts_ptr = NULL;
+	    if (vs_filter) {
+		// The remote backend doesn't support match deciders, so this
+		// is a local sub-database.
+		Assert(!is_remote[i]);
+		const Xapian::Database::Internal * subdb = db.internal[i].get();
+		PostList * filter_pl = new ValueSetPostList(subdb, *vs_filter);
+		pl = new MultiAndPostList(pl, filter_pl,
+					  pl->get_maxweight(), 0.0,
+					  this, subdb->get_doccount(), true);
+	    }
+	    if (is_remote[i]) {
+		if (pl->get_termfreq_min() > first + maxitems) {
+		    LOGLINE(MATCH, "Found " <<
+				   pl->get_termfreq_min() - (first + maxitems)
+				   << " definite matches in remote submatch "
+				   "which aren't passed to local match");
+		    definite_matches_not_seen += pl->get_termfreq_min();
+		    definite_matches_not_seen -= first + maxitems;
+		}
+	    }
+	} catch (Xapian::Error & e) {
+	    if (!errorhandler) throw;
+	    LOGLINE(EXCEPTION, "Calling error handler for "
+			       "get_term_info() on a SubMatch.");
+	    (*errorhandler)(e);
+	    // FIXME: check if *ALL* the remote servers have failed!
+	    // Continue match without this sub-match.
+	    leaves[i] = NULL;
+	    pl = new EmptyPostList;
+	}
+	postlists.push_back(pl);
+    }
+    Assert(!postlists.empty());
+
+    ValueStreamDocument vsdoc(db);
+    ++vsdoc.ref_count;
+    Xapian::Document doc(&vsdoc);
+
+    // Get a single combined postlist
+    PostList *pl;
+    if (postlists.size() == 1) {
+	pl = postlists.front();
+    } else {
+	pl = new MergePostList(postlists, this, vsdoc, errorhandler);
+    }
+
+    LOGLINE(MATCH, "pl = (" << pl->get_description() << ")");
+
+#ifdef XAPIAN_DEBUG_LOG
+    {
+	map<string, Xapian::MSet::Internal::TermFreqAndWeight>::const_iterator tfwi;
+	for (tfwi = termfreqandwts.begin(); tfwi != termfreqandwts.end(); ++tfwi) {
+	    LOGLINE(MATCH, "termfreqandwts[" << tfwi->first << "] = " << tfwi->second.termfreq << ", " << tfwi->second.termweight);
+	}
+    }
+#endif
+
+    // Empty result set
+    Xapian::doccount docs_matched = 0;
+    Xapian::weight greatest_wt = 0;
+    Xapian::termcount greatest_wt_subqs_matched = 0;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    unsigned greatest_wt_subqs_db_num = UINT_MAX;
+#endif
+    vector<Xapian::Internal::MSetItem> items;
+
+    // maximum weight a document could possibly have
+    const Xapian::weight max_possible = pl->recalc_maxweight();
+
+    LOGLINE(MATCH, "pl = (" << pl->get_description() << ")");
+    recalculate_w_max = false;
+
+    Xapian::doccount matches_upper_bound = pl->get_termfreq_max();
+    Xapian::doccount matches_lower_bound = 0;
+    Xapian::doccount matches_estimated   = pl->get_termfreq_est();
+
+    if (mdecider == NULL && matchspy_legacy == NULL) {
+	// If we have a matcher decider or match spy, the lower bound must be
+	// set to 0 as we could discard all hits.  Otherwise set it to the
+	// minimum number of entries which the postlist could return.
+	matches_lower_bound = pl->get_termfreq_min();
+    }
+
+    // Prepare the matchspy
+    Xapian::MatchSpy *matchspy = NULL;
+    MultipleMatchSpy multispy(matchspies);
+    if (!matchspies.empty()) {
+	if (matchspies.size() == 1) {
+	    matchspy = matchspies[0];
+	} else {
+	    matchspy = &multispy;
+	}
+    }
+
+    // Check if any results have been asked for (might just be wanting
+    // maxweight).
+    if (check_at_least == 0) {
+	delete pl;
+	Xapian::doccount uncollapsed_lower_bound = matches_lower_bound;
+	if (collapse_max) {
+	    // Lower bound must be set to no more than collapse_max, since it's
+	    // possible that all matching documents have the same collapse_key
+	    // value and so are collapsed together.
+	    if (matches_lower_bound > collapse_max)
+		matches_lower_bound = collapse_max;
+	}
+
+	mset = Xapian::MSet(new Xapian::MSet::Internal(
+					   first,
+					   matches_upper_bound,
+					   matches_lower_bound,
+					   matches_estimated,
+					   matches_upper_bound,
+					   uncollapsed_lower_bound,
+					   matches_estimated,
+					   max_possible, greatest_wt, items,
+					   termfreqandwts,
+					   0));
+	return;
+    }
+
+    // Number of documents considered by a decider or matchspy_legacy.
+    Xapian::doccount decider_considered = 0;
+    // Number of documents denied by the decider or matchspy_legacy.
+    Xapian::doccount decider_denied = 0;
+
+    // Set max number of results that we want - this is used to decide
+    // when to throw away unwanted items.
+    Xapian::doccount max_msize = first + maxitems;
+    items.reserve(max_msize + 1);
+
+    // Tracks the minimum item currently eligible for the MSet - we compare
+    // candidate items against this.
+    Xapian::Internal::MSetItem min_item(0.0, 0);
+
+    // Minimum weight an item must have to be worth considering.
+    Xapian::weight min_weight = weight_cutoff;
+
+    // Factor to multiply maximum weight seen by to get the cutoff weight.
+    Xapian::weight percent_cutoff_factor = percent_cutoff / 100.0;
+    // Corresponding correction to that in omenquire.cc to account for excess
+    // precision on x86.
+    percent_cutoff_factor -= DBL_EPSILON;
+
+    // Object to handle collapsing.
+    Collapser collapser(collapse_key, collapse_max);
+
+    /// Comparison functor for sorting MSet
+    bool sort_forward = (order != Xapian::Enquire::DESCENDING);
+    MSetCmp mcmp(get_msetcmp_function(sort_by, sort_forward, sort_value_forward));
+
+    // Perform query
+
+    // We form the mset in two stages.  In the first we fill up our working
+    // mset.  Adding a new document does not remove another.
+    //
+    // In the second, we consider documents which rank higher than the current
+    // lowest ranking document in the mset.  Each document added expels the
+    // current lowest ranking document.
+    //
+    // If a percentage cutoff is in effect, it can cause the matcher to return
+    // from the second stage from the first.
+
+    // Is the mset a valid heap?
+    bool is_heap = false;
+
+    MatchState state = {
+	pl, vsdoc, doc, items, collapser, mcmp,
+	mdecider, matchspy_legacy, matchspy, sorter,
+	max_msize, check_at_least, max_possible, percent_cutoff_factor,
+	sort_forward,
+	min_item, min_weight, is_heap, docs_matched,
+	decider_considered, decider_denied,
+	greatest_wt, greatest_wt_subqs_matched,
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+	greatest_wt_subqs_db_num
+#endif
+    };
+    run_match_loop(state);
+
     // done with posting list tree
     delete pl;
 
@@ -1086,19 +1284,7 @@ new_greatest_weight:
 	// Nicked this formula from above, but for some reason percent_scale
 	// has since been multiplied by 100 so we take that into account
 	Xapian::weight min_wt = percent_cutoff_factor / (percent_scale / 100);
-	Xapian::doccount entries = collapser.entries();
-	vector<Xapian::Internal::MSetItem>::iterator i;
-	for (i = items.begin(); i != items.end(); ++i) {
-	    // Skip entries without a collapse key.
-	    if (i->collapse_key.empty()) continue;
-
-	    // Set collapse_count appropriately.
-	    i->collapse_count = collapser.get_collapse_count(i->collapse_key, percent_cutoff, min_wt);
-	    if (--entries == 0) {
-		// Stop once we've processed all items with collapse keys.
-		break;
-	    }
-	}
+	collapser.finalise(items, percent_cutoff, min_wt);
     }
 
     mset = Xapian::MSet(new Xapian::MSet::Internal(
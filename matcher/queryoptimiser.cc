@@ -25,6 +25,7 @@
 
 #include "andmaybepostlist.h"
 #include "andnotpostlist.h"
+#include "boolorpostlist.h"
 #include "const_database_wrapper.h"
 #include "emptypostlist.h"
 #include "exactphrasepostlist.h"
@@ -48,6 +49,61 @@
 
 using namespace std;
 
+/** The largest fraction of the values in a slot which a value range can be
+ *  estimated to match for a value index to be used for it.
+ *
+ *  A value index has to be read for every document in the range before the
+ *  match can start, while iterating the values can stop early, and can skip
+ *  to the documents matching the rest of the query.
+ */
+static const double VALUE_INDEX_MAX_FRACTION = 0.1;
+
+/// Map a value to a number in [0, 1), preserving order (approximately).
+static double
+value_position(const string & value)
+{
+    double pos = 0.0, scale = 1.0;
+    for (size_t i = 0; i != value.size() && i != 8; ++i) {
+	scale /= 256.0;
+	pos += static_cast<unsigned char>(value[i]) * scale;
+    }
+    return pos;
+}
+
+PostList *
+QueryOptimiser::open_value_index(Xapian::valueno valno, const string & begin,
+				 const string & end)
+{
+    DEBUGCALL(MATCH, PostList *, "QueryOptimiser::open_value_index",
+	      valno << ", " << begin << ", " << end);
+    // Documents without a value in the slot match a range which starts with
+    // an empty string, and aren't in the value index.
+    if (begin.empty() || !db.has_value_index(valno)) RETURN(NULL);
+
+    if (db.get_value_freq(valno)) {
+	// Estimate the fraction of the values which are in the range by
+	// interpolating between the bounds.  If the range and the bounds don't
+	// overlap, the value index will quickly find there are no matches.
+	string lower = db.get_value_lower_bound(valno);
+	string upper = db.get_value_upper_bound(valno);
+	const string & lo = max(begin, lower);
+	const string & hi = (!end.empty() && end < upper) ? end : upper;
+	if (lo <= hi) {
+	    double lower_pos = value_position(lower);
+	    double upper_pos = value_position(upper);
+	    double fraction = 1.0;
+	    if (upper_pos > lower_pos) {
+		fraction = (value_position(hi) - value_position(lo)) /
+			   (upper_pos - lower_pos);
+	    }
+	    LOGLINE(MATCH, "Estimated fraction of values in range: " << fraction);
+	    if (fraction > VALUE_INDEX_MAX_FRACTION) RETURN(NULL);
+	}
+    }
+
+    RETURN(db.open_value_index_post_list(valno, begin, end));
+}
+
 PostList *
 QueryOptimiser::do_subquery(const Xapian::Query::Internal * query, double factor)
 {
@@ -97,6 +153,11 @@ QueryOptimiser::do_subquery(const Xapian::Query::Internal * query, double factor
 	    RETURN(pl);
 	}
 
+	case Xapian::Query::OP_WILDCARD:
+	    if (factor != 0.0)
+		++total_subqs;
+	    RETURN(do_wildcard(query, factor));
+
 	case Xapian::Query::OP_AND_NOT: {
 	    AssertEq(query->subqs.size(), 2);
 	    PostList * l = do_subquery(query->subqs[0], factor);
@@ -117,6 +178,12 @@ QueryOptimiser::do_subquery(const Xapian::Query::Internal * query, double factor
 	    Xapian::valueno valno(query->parameter);
 	    const string & range_begin = query->tname;
 	    const string & range_end = query->str_parameter;
+	    // An empty end means an empty range here, but no upper bound to
+	    // open_value_index().
+	    if (!range_end.empty()) {
+		PostList * pl = open_value_index(valno, range_begin, range_end);
+		if (pl) RETURN(pl);
+	    }
 	    RETURN(new ValueRangePostList(&db, valno, range_begin, range_end));
 	}
 
@@ -125,6 +192,8 @@ QueryOptimiser::do_subquery(const Xapian::Query::Internal * query, double factor
 		++total_subqs;
 	    Xapian::valueno valno(query->parameter);
 	    const string & range_begin = query->tname;
+	    PostList * pl = open_value_index(valno, range_begin, string());
+	    if (pl) RETURN(pl);
 	    RETURN(new ValueGePostList(&db, valno, range_begin));
 	}
 
@@ -426,3 +495,37 @@ QueryOptimiser::do_synonym(const Xapian::Query::Internal *query, double factor)
     RETURN(localsubmatch.make_synonym_postlist(do_or_like(query, 0.0),
 					       matcher, factor));
 }
+
+PostList *
+QueryOptimiser::do_wildcard(const Xapian::Query::Internal *query, double factor)
+{
+    DEBUGCALL(MATCH, PostList *, "QueryOptimiser::do_wildcard",
+	      query << ", " << factor);
+    const vector<string> & terms = localsubmatch.get_wildcard_terms(query);
+    if (terms.empty()) RETURN(new EmptyPostList);
+
+    // The expanded terms are treated as synonyms, so the leaf postlists are
+    // unweighted and a SynonymPostList supplies the weight (if we want one).
+    vector<PostList *> postlists;
+    postlists.reserve(terms.size());
+    try {
+	vector<string>::const_iterator t;
+	for (t = terms.begin(); t != terms.end(); ++t) {
+	    Xapian::Query::Internal leaf(*t, 1, query->term_pos);
+	    postlists.push_back(localsubmatch.postlist_from_op_leaf_query(&leaf, 0.0));
+	}
+    } catch (...) {
+	for_each(postlists.begin(), postlists.end(), delete_ptr<PostList>());
+	throw;
+    }
+
+    PostList * pl;
+    if (postlists.size() == 1) {
+	pl = postlists[0];
+    } else {
+	pl = new BoolOrPostList(postlists.begin(), postlists.end(), db_size);
+    }
+
+    if (factor == 0.0) RETURN(pl);
+    RETURN(localsubmatch.make_synonym_postlist(pl, matcher, factor));
+}
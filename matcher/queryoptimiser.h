@@ -104,6 +104,36 @@ class QueryOptimiser {
      */
     PostList * do_synonym(const Xapian::Query::Internal *query, double factor);
 
+    /** Optimise an OP_WILDCARD Xapian::Query::Internal into a PostList.
+     *
+     *  The terms the wildcard expands to in this (sub-)Database are combined
+     *  with a BoolOrPostList, which is wrapped in a SynonymPostList if
+     *  weights are wanted.
+     *
+     *  @param query	The OP_WILDCARD query.
+     *  @param factor	How much to scale weights for this subtree by.
+     *
+     *  @return		A PostList subtree.
+     */
+    PostList * do_wildcard(const Xapian::Query::Internal *query, double factor);
+
+    /** Use a value index for a value range if it's likely to be quicker.
+     *
+     *  The value index is used if the database has one for the slot and the
+     *  value statistics suggest that the range matches only a small fraction
+     *  of the values in the slot.
+     *
+     *  @param valno	The value slot.
+     *  @param begin	The start of the range.
+     *  @param end	The end of the range, or empty for no upper bound.
+     *
+     *  @return		A PostList from the value index, or NULL to iterate
+     *			the values instead.
+     */
+    PostList * open_value_index(Xapian::valueno valno,
+				const std::string & begin,
+				const std::string & end);
+
   public:
     QueryOptimiser(const Xapian::Database::Internal & db_,
 		   LocalSubMatch & localsubmatch_,
@@ -35,6 +35,7 @@ PostList *
 ValueGePostList::next(Xapian::weight)
 {
     Assert(db);
+    if (use_numeric_values(false)) return next_numeric(false);
     if (!alldocs_pl) alldocs_pl = db->open_post_list(string());
     alldocs_pl->skip_to(current + 1);
     while (!alldocs_pl->at_end()) {
@@ -66,6 +67,10 @@ ValueGePostList::check(Xapian::docid did, Xapian::weight, bool &valid)
 	return NULL;
     }
     AssertRelParanoid(did, <=, db->get_lastdocid());
+    if (use_numeric_values(false)) {
+	check_numeric(did, false, valid);
+	return NULL;
+    }
     current = did;
     AutoPtr<Xapian::Document::Internal> doc(db->open_document(current, true));
     string v = doc->get_value(valno);
@@ -29,11 +29,96 @@
 #include "leafpostlist.h"
 #include "utils.h"
 
+#include <xapian/queryparser.h> // For sortable_serialise().
+
+#include <cmath> // For HUGE_VAL.
+
 using namespace std;
 
+/// Return true if @a s is a number as encoded by sortable_serialise().
+static bool
+is_serialised_number(const string & s)
+{
+    return Xapian::sortable_serialise(Xapian::sortable_unserialise(s)) == s;
+}
+
 ValueRangePostList::~ValueRangePostList()
 {
     delete alldocs_pl;
+    delete numeric_values;
+}
+
+bool
+ValueRangePostList::use_numeric_values(bool has_end)
+{
+    if (!numeric_checked) {
+	numeric_checked = true;
+	// Values which aren't canonically encoded numbers don't necessarily
+	// compare the same way as strings and as doubles.  An empty begin
+	// means there's no lower bound, but then we need an upper bound.
+	if (begin.empty() ? !has_end : !is_serialised_number(begin))
+	    return false;
+	if (has_end && !is_serialised_number(end)) return false;
+	AutoPtr<ValueList> values(db->open_value_list(valno));
+	if (!values->stores_doubles()) return false;
+	numeric_begin = begin.empty() ? -HUGE_VAL :
+					Xapian::sortable_unserialise(begin);
+	if (has_end) numeric_end = Xapian::sortable_unserialise(end);
+	numeric_values = values.release();
+    }
+    return numeric_values != NULL;
+}
+
+bool
+ValueRangePostList::numeric_value_matches(Xapian::docid did, bool has_end)
+{
+    if (!numeric_values->check(did) || numeric_values->at_end() ||
+	numeric_values->get_docid() != did) {
+	// Documents without a value have an empty one, which is only in range
+	// if begin is empty.
+	return begin.empty();
+    }
+    double v = numeric_values->get_value_as_double();
+    return (v >= numeric_begin && (!has_end || v <= numeric_end));
+}
+
+PostList *
+ValueRangePostList::next_numeric(bool has_end)
+{
+    if (begin.empty()) {
+	// Documents without a value match too, and numeric_values doesn't
+	// list them, so we have to run through all the documents, but can
+	// still look up the values in numeric_values.
+	if (!alldocs_pl) alldocs_pl = db->open_post_list(string());
+	alldocs_pl->skip_to(current + 1);
+	while (!alldocs_pl->at_end()) {
+	    current = alldocs_pl->get_docid();
+	    if (numeric_value_matches(current, has_end)) return NULL;
+	    alldocs_pl->next();
+	}
+	db = NULL;
+	return NULL;
+    }
+
+    numeric_values->skip_to(current + 1);
+    while (!numeric_values->at_end()) {
+	double v = numeric_values->get_value_as_double();
+	if (v >= numeric_begin && (!has_end || v <= numeric_end)) {
+	    current = numeric_values->get_docid();
+	    return NULL;
+	}
+	numeric_values->next();
+    }
+    db = NULL;
+    return NULL;
+}
+
+void
+ValueRangePostList::check_numeric(Xapian::docid did, bool has_end,
+				  bool &valid)
+{
+    current = did;
+    valid = numeric_value_matches(did, has_end);
 }
 
 Xapian::doccount
@@ -122,6 +207,7 @@ PostList *
 ValueRangePostList::next(Xapian::weight)
 {
     Assert(db);
+    if (use_numeric_values(true)) return next_numeric(true);
     if (!alldocs_pl) alldocs_pl = db->open_post_list(string());
     alldocs_pl->skip_to(current + 1);
     while (!alldocs_pl->at_end()) {
@@ -153,6 +239,10 @@ ValueRangePostList::check(Xapian::docid did, Xapian::weight, bool &valid)
 	return NULL;
     }
     AssertRelParanoid(did, <=, db->get_lastdocid());
+    if (use_numeric_values(true)) {
+	check_numeric(did, true, valid);
+	return NULL;
+    }
     current = did;
     AutoPtr<Xapian::Document::Internal> doc(db->open_document(current, true));
     string v = doc->get_value(valno);
@@ -24,6 +24,7 @@
 
 #include "database.h"
 #include "postlist.h"
+#include "valuelist.h"
 
 class ValueRangePostList : public PostList {
   protected:
@@ -39,6 +40,37 @@ class ValueRangePostList : public PostList {
 
     LeafPostList * alldocs_pl;
 
+    /** The values in the slot as doubles, if the database stores them so.
+     *
+     *  NULL if it doesn't, or if begin and end aren't both numbers encoded by
+     *  sortable_serialise() (or begin empty), in which case we test the
+     *  values as strings.
+     */
+    ValueList * numeric_values;
+
+    /// Set once we've decided whether to use numeric_values.
+    bool numeric_checked;
+
+    /// begin and end decoded by sortable_unserialise().
+    double numeric_begin, numeric_end;
+
+    /** Open numeric_values if we can use it, the first time we're called.
+     *
+     *  @param has_end	Whether there's an upper bound to test.
+     *
+     *  @return true if numeric_values should be used.
+     */
+    bool use_numeric_values(bool has_end);
+
+    /// Return true if the value of @a did in numeric_values is in range.
+    bool numeric_value_matches(Xapian::docid did, bool has_end);
+
+    /// Advance to the next match after current using numeric_values.
+    PostList * next_numeric(bool has_end);
+
+    /// Check if @a did matches using numeric_values.
+    void check_numeric(Xapian::docid did, bool has_end, bool &valid);
+
     /// Disallow copying.
     ValueRangePostList(const ValueRangePostList &);
 
@@ -50,7 +82,8 @@ class ValueRangePostList : public PostList {
 		       Xapian::valueno valno_,
 		       const std::string &begin_, const std::string &end_)
 	: db(db_), valno(valno_), begin(begin_), end(end_), current(0),
-	  db_size(db->get_doccount()), alldocs_pl(0) { }
+	  db_size(db->get_doccount()), alldocs_pl(0), numeric_values(0),
+	  numeric_checked(false), numeric_begin(0), numeric_end(0) { }
 
     ~ValueRangePostList();
 
@@ -0,0 +1,211 @@
+/** @file valuesetpostlist.cc
+ * @brief Return document ids accepted by a ValueSetMatchDecider.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "valuesetpostlist.h"
+
+#include <xapian/error.h>
+
+#include "omassert.h"
+#include "omdebug.h"
+#include "utils.h"
+#include "weightinternal.h"
+
+using namespace std;
+
+ValueSetPostList::ValueSetPostList(const Xapian::Database::Internal *db_,
+				   const Xapian::ValueSetMatchDecider & decider_)
+    : db(db_), decider(decider_), values(NULL), current(0)
+{
+    try {
+	value_freq = db->get_value_freq(decider.valuenum);
+    } catch (const Xapian::UnimplementedError &) {
+	// Not all backends track how many documents have a value in each slot.
+	value_freq = db->get_doccount();
+    }
+}
+
+ValueSetPostList::~ValueSetPostList()
+{
+    delete values;
+}
+
+bool
+ValueSetPostList::can_filter(const Xapian::ValueSetMatchDecider & decider)
+{
+    // Documents without a value have an empty one, which the decider accepts
+    // if it's in the set and inclusive, or not in the set and exclusive.
+    return decider.contains(string()) != decider.inclusive;
+}
+
+void
+ValueSetPostList::find_match()
+{
+    while (!values->at_end()) {
+	if (decider.contains(values->get_value()) == decider.inclusive) {
+	    current = values->get_docid();
+	    return;
+	}
+	values->next();
+    }
+    db = NULL;
+}
+
+Xapian::doccount
+ValueSetPostList::get_termfreq_min() const
+{
+    return 0;
+}
+
+Xapian::doccount
+ValueSetPostList::get_termfreq_est() const
+{
+    // FIXME: It's hard to estimate well without knowing how the values are
+    // distributed.
+    return value_freq / 2;
+}
+
+TermFreqs
+ValueSetPostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const
+{
+    LOGCALL(MATCH, TermFreqs,
+	    "ValueSetPostList::get_termfreq_est_using_stats", stats);
+    RETURN(TermFreqs(stats.collection_size / 2, stats.rset_size / 2));
+}
+
+Xapian::doccount
+ValueSetPostList::get_termfreq_max() const
+{
+    return value_freq;
+}
+
+Xapian::weight
+ValueSetPostList::get_maxweight() const
+{
+    return 0;
+}
+
+Xapian::docid
+ValueSetPostList::get_docid() const
+{
+    Assert(current);
+    Assert(db);
+    return current;
+}
+
+Xapian::weight
+ValueSetPostList::get_weight() const
+{
+    Assert(db);
+    return 0;
+}
+
+Xapian::termcount
+ValueSetPostList::get_doclength() const
+{
+    Assert(db);
+    return 0;
+}
+
+Xapian::weight
+ValueSetPostList::recalc_maxweight()
+{
+    Assert(db);
+    return 0;
+}
+
+PositionList *
+ValueSetPostList::read_position_list()
+{
+    Assert(db);
+    return NULL;
+}
+
+PositionList *
+ValueSetPostList::open_position_list() const
+{
+    Assert(db);
+    return NULL;
+}
+
+PostList *
+ValueSetPostList::next(Xapian::weight)
+{
+    Assert(db);
+    if (!values) values = db->open_value_list(decider.valuenum);
+    values->skip_to(current + 1);
+    find_match();
+    return NULL;
+}
+
+PostList *
+ValueSetPostList::skip_to(Xapian::docid did, Xapian::weight)
+{
+    Assert(db);
+    if (did <= current) return NULL;
+    if (!values) values = db->open_value_list(decider.valuenum);
+    values->skip_to(did);
+    find_match();
+    return NULL;
+}
+
+PostList *
+ValueSetPostList::check(Xapian::docid did, Xapian::weight, bool &valid)
+{
+    Assert(db);
+    // A failed check() leaves current on a document which wasn't accepted,
+    // so we can't just assume we're on a valid entry if did == current.
+    if (did < current) {
+	valid = true;
+	return NULL;
+    }
+    if (!values) values = db->open_value_list(decider.valuenum);
+    // If there's no value for did, leave current there so that next() moves
+    // to the first document after it with an accepted value.
+    current = did;
+    if (!values->check(did) || values->at_end() ||
+	values->get_docid() != did) {
+	valid = false;
+	return NULL;
+    }
+    valid = (decider.contains(values->get_value()) == decider.inclusive);
+    return NULL;
+}
+
+bool
+ValueSetPostList::at_end() const
+{
+    return (db == NULL);
+}
+
+Xapian::termcount
+ValueSetPostList::count_matching_subqs() const
+{
+    return 1;
+}
+
+string
+ValueSetPostList::get_description() const
+{
+    string desc = "ValueSetPostList(";
+    desc += om_tostring(decider.valuenum);
+    desc += decider.inclusive ? ", inclusive)" : ", exclusive)";
+    return desc;
+}
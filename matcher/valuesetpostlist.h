@@ -0,0 +1,106 @@
+/** @file valuesetpostlist.h
+ * @brief Return document ids accepted by a ValueSetMatchDecider.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_VALUESETPOSTLIST_H
+#define XAPIAN_INCLUDED_VALUESETPOSTLIST_H
+
+#include "database.h"
+#include "postlist.h"
+#include "valuelist.h"
+
+#include <xapian/valuesetmatchdecider.h>
+
+/** Return the documents a ValueSetMatchDecider accepts.
+ *
+ *  This iterates the values in the decider's slot, so it only works if
+ *  documents without a value are rejected - see can_filter().  The matcher
+ *  uses it as a boolean filter on the query, so documents are rejected
+ *  before their weights are calculated.
+ */
+class ValueSetPostList : public PostList {
+    const Xapian::Database::Internal *db;
+
+    const Xapian::ValueSetMatchDecider & decider;
+
+    /// The values in the decider's slot (opened on first use).
+    ValueList * values;
+
+    Xapian::docid current;
+
+    /// The number of documents with a value in the decider's slot.
+    Xapian::doccount value_freq;
+
+    /// Advance values to the first accepted document, and set current to it.
+    void find_match();
+
+    /// Disallow copying.
+    ValueSetPostList(const ValueSetPostList &);
+
+    /// Disallow assignment.
+    void operator=(const ValueSetPostList &);
+
+  public:
+    ValueSetPostList(const Xapian::Database::Internal *db_,
+		     const Xapian::ValueSetMatchDecider & decider_);
+
+    ~ValueSetPostList();
+
+    /** Return true if @a decider can be replaced by a ValueSetPostList.
+     *
+     *  This is the case if the decider rejects documents without a value in
+     *  its slot.
+     */
+    static bool can_filter(const Xapian::ValueSetMatchDecider & decider);
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const;
+
+    Xapian::weight get_maxweight() const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::weight get_weight() const;
+
+    Xapian::termcount get_doclength() const;
+
+    Xapian::weight recalc_maxweight();
+
+    PositionList * read_position_list();
+
+    PositionList * open_position_list() const;
+
+    PostList * next(Xapian::weight w_min);
+
+    PostList * skip_to(Xapian::docid, Xapian::weight w_min);
+
+    PostList * check(Xapian::docid did, Xapian::weight w_min, bool &valid);
+
+    bool at_end() const;
+
+    Xapian::termcount count_matching_subqs() const;
+
+    string get_description() const;
+};
+
+#endif /* XAPIAN_INCLUDED_VALUESETPOSTLIST_H */
@@ -49,41 +49,43 @@ ValueStreamDocument::new_subdb(int n)
     current = unsigned(n);
     database = db.internal[n];
     clear_valuelists(valuelists);
+    batch_slots.clear();
+    batch_lists.clear();
 }
 
-string
-ValueStreamDocument::do_get_value(Xapian::valueno slot) const
+Xapian::docid
+ValueStreamDocument::get_sub_docid() const
 {
-#ifdef XAPIAN_ASSERTIONS_PARANOID
-    if (!doc)
-	doc = db.get_document_lazily(did);
-#endif
+    size_t multiplier = db.internal.size();
+    Xapian::docid sub_did = (did - current - 2 + multiplier) / multiplier + 1;
+    AssertEq((sub_did - 1) * multiplier + current + 1, did);
+    return sub_did;
+}
 
+ValueList **
+ValueStreamDocument::get_valuelist(Xapian::valueno slot) const
+{
     pair<map<Xapian::valueno, ValueList *>::iterator, bool> ret;
     ret = valuelists.insert(make_pair(slot, static_cast<ValueList*>(NULL)));
-    ValueList * vl;
     if (ret.second) {
 	// Entry didn't already exist, so open a value list for slot.
-	vl = database->open_value_list(slot);
-	ret.first->second = vl;
-    } else {
-	vl = ret.first->second;
-	if (!vl) {
-	    AssertEqParanoid(string(), doc->get_value(slot));
-	    return string();
-	}
+	ret.first->second = database->open_value_list(slot);
     }
+    return &(ret.first->second);
+}
 
-    size_t multiplier = db.internal.size();
-    Xapian::docid sub_did = (did - current - 2 + multiplier) / multiplier + 1;
-    AssertEq((sub_did - 1) * multiplier + current + 1, did);
-    if (vl->check(sub_did)) {
-	if (vl->at_end()) {
-	    delete vl;
-	    ret.first->second = NULL;
-	} else if (vl->get_docid() == sub_did) {
-	    Assert(vl);
-	    string v = vl->get_value();
+string
+ValueStreamDocument::read_value(ValueList ** vl, Xapian::docid sub_did,
+				Xapian::valueno slot) const
+{
+    (void)slot;
+    // A NULL entry means we've already reached the end of the value list.
+    if (*vl && (*vl)->check(sub_did)) {
+	if ((*vl)->at_end()) {
+	    delete *vl;
+	    *vl = NULL;
+	} else if ((*vl)->get_docid() == sub_did) {
+	    string v = (*vl)->get_value();
 	    AssertEq(v, doc->get_value(slot));
 	    return v;
 	}
@@ -92,6 +94,43 @@ ValueStreamDocument::do_get_value(Xapian::valueno slot) const
     return string();
 }
 
+string
+ValueStreamDocument::do_get_value(Xapian::valueno slot) const
+{
+#ifdef XAPIAN_ASSERTIONS_PARANOID
+    if (!doc)
+	doc = db.get_document_lazily(did);
+#endif
+
+    return read_value(get_valuelist(slot), get_sub_docid(), slot);
+}
+
+void
+ValueStreamDocument::do_get_values(const vector<Xapian::valueno> & slots,
+				   vector<string> & values_) const
+{
+#ifdef XAPIAN_ASSERTIONS_PARANOID
+    if (!doc)
+	doc = db.get_document_lazily(did);
+#endif
+
+    // Callers usually ask for the same slots for each document, so remember
+    // where their value lists are rather than looking each one up every time.
+    if (slots != batch_slots) {
+	batch_slots = slots;
+	batch_lists.clear();
+	for (size_t i = 0; i != slots.size(); ++i) {
+	    batch_lists.push_back(get_valuelist(slots[i]));
+	}
+    }
+
+    Xapian::docid sub_did = get_sub_docid();
+    values_.resize(slots.size());
+    for (size_t i = 0; i != slots.size(); ++i) {
+	values_[i] = read_value(batch_lists[i], sub_did, slots[i]);
+    }
+}
+
 void
 ValueStreamDocument::do_get_all_values(map<Xapian::valueno, string> & v) const
 {
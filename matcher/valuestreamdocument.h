@@ -26,6 +26,7 @@
 #include "xapian/types.h"
 
 #include <map>
+#include <vector>
 
 /// A document which gets its values from a ValueStreamManager.
 class ValueStreamDocument : public Xapian::Document::Internal {
@@ -37,6 +38,12 @@ class ValueStreamDocument : public Xapian::Document::Internal {
 
     mutable std::map<Xapian::valueno, ValueList *> valuelists;
 
+    /// The slots passed to the last call to do_get_values().
+    mutable std::vector<Xapian::valueno> batch_slots;
+
+    /// Pointers to the entries in valuelists for each of batch_slots.
+    mutable std::vector<ValueList **> batch_lists;
+
     Xapian::Database db;
 
     size_t current;
@@ -63,8 +70,23 @@ class ValueStreamDocument : public Xapian::Document::Internal {
     }
 
   private:
+    /// Get the docid in the current subdatabase.
+    Xapian::docid get_sub_docid() const;
+
+    /** Find the entry in valuelists for @a slot.
+     *
+     *  Opens a value list for @a slot if there isn't one yet.
+     */
+    ValueList ** get_valuelist(Xapian::valueno slot) const;
+
+    /// Read the value for the current document from a value list.
+    string read_value(ValueList ** vl, Xapian::docid sub_did,
+		      Xapian::valueno slot) const;
+
     /** Implementation of virtual methods @{ */
     string do_get_value(Xapian::valueno slot) const;
+    void do_get_values(const vector<Xapian::valueno> & slots,
+		       vector<string> & values_) const;
     void do_get_all_values(map<Xapian::valueno, string> & values_) const;
     string do_get_data() const;
     /** @} */
@@ -4,6 +4,7 @@ EXTRA_DIST +=\
 
 if BUILD_BACKEND_REMOTE
 lib_src +=\
+	net/changesetcompress.cc\
 	net/progclient.cc\
 	net/remoteconnection.cc\
 	net/remoteserver.cc\
@@ -11,6 +12,7 @@ lib_src +=\
 	net/remotetcpserver.cc\
 	net/replicatetcpclient.cc\
 	net/replicatetcpserver.cc\
+	net/replicationdelta.cc\
 	net/serialise.cc\
 	net/tcpclient.cc\
 	net/tcpserver.cc
@@ -0,0 +1,270 @@
+/** @file changesetcompress.cc
+ *  @brief Compress changesets for sending to a replica.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "changesetcompress.h"
+
+#include <xapian/error.h>
+
+#include "internaltypes.h"
+#include "omdebug.h"
+#include "omtime.h"
+#include "pack.h"
+#include "remoteconnection.h"
+#include "replicationprotocol.h"
+#include "safeerrno.h"
+#include "safefcntl.h"
+#include "safesysstat.h"
+#include "safeunistd.h"
+#include "serialise.h"
+#include "utils.h"
+
+#ifdef __WIN32__
+# include "msvc_posix_wrapper.h"
+#endif
+
+#include <zlib.h>
+
+#include <string>
+
+using namespace std;
+
+/// Size of the buffers used when compressing and decompressing.
+#define COMPRESS_BUFSIZE 65536
+
+static int
+open_for_reading(const string & path)
+{
+#ifdef __WIN32__
+    return msvc_posix_open(path.c_str(), O_RDONLY | O_BINARY);
+#else
+    return open(path.c_str(), O_RDONLY | O_BINARY);
+#endif
+}
+
+static int
+open_for_writing(const string & path)
+{
+#ifdef __WIN32__
+    return msvc_posix_open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY);
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+#endif
+}
+
+/** Read up to n bytes from fd, only returning less at the end of the file. */
+static size_t
+read_some(int fd, char * p, size_t n, const string & path)
+{
+    size_t total = 0;
+    while (total < n) {
+	ssize_t c = read(fd, p + total, n - total);
+	if (c == 0) break;
+	if (c < 0) {
+	    if (errno == EINTR) continue;
+	    throw Xapian::DatabaseError("Error reading from " + path, errno);
+	}
+	total += c;
+    }
+    return total;
+}
+
+/** Write n bytes from block pointed to by p to file descriptor fd. */
+static void
+write_all(int fd, const char * p, size_t n, const string & path)
+{
+    while (n) {
+	ssize_t c = write(fd, p, n);
+	if (c < 0) {
+	    if (errno == EINTR) continue;
+	    throw Xapian::DatabaseError("Error writing to " + path, errno);
+	}
+	p += c;
+	n -= c;
+    }
+}
+
+/// Remove a temporary file when it goes out of scope.
+class TempFileRemover {
+    string path;
+  public:
+    TempFileRemover(const string & path_) : path(path_) { }
+    ~TempFileRemover() { (void)unlink(path); }
+};
+
+void
+send_compressed_changeset(RemoteConnection & conn, const string & path,
+			  const OmTime & end_time)
+{
+    DEBUGCALL_STATIC(REMOTE, void, "send_compressed_changeset",
+		     path << ", " << end_time);
+    int fd = open_for_reading(path);
+    if (fd == -1) throw Xapian::NetworkError("File not found: " + path, errno);
+    fdcloser closer(fd);
+
+    off_t size;
+    {
+	struct stat sb;
+	if (fstat(fd, &sb) == -1)
+	    throw Xapian::NetworkError("Couldn't stat file: " + path, errno);
+	size = sb.st_size;
+    }
+
+    // The pid makes the temporary file unique, as the replication server
+    // forks a process for each replica.
+    string tmp_path = path + ".z" + om_tostring(getpid());
+    int out = open_for_writing(tmp_path);
+    if (out == -1)
+	throw Xapian::DatabaseError("Couldn't open file for writing: " + tmp_path, errno);
+    TempFileRemover remover(tmp_path);
+    {
+	fdcloser out_closer(out);
+
+	string header;
+	pack_uint(header, uint8(size));
+	write_all(out, header.data(), header.size(), tmp_path);
+
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+	    string msg = "Failed to initialise deflate stream";
+	    if (zs.msg) {
+		msg += ": ";
+		msg += zs.msg;
+	    }
+	    throw Xapian::DatabaseError(msg);
+	}
+
+	try {
+	    char inbuf[COMPRESS_BUFSIZE];
+	    char outbuf[COMPRESS_BUFSIZE];
+	    int flush;
+	    do {
+		size_t len = read_some(fd, inbuf, sizeof(inbuf), path);
+		flush = (len < sizeof(inbuf)) ? Z_FINISH : Z_NO_FLUSH;
+		zs.next_in = reinterpret_cast<Bytef *>(inbuf);
+		zs.avail_in = uInt(len);
+		do {
+		    zs.next_out = reinterpret_cast<Bytef *>(outbuf);
+		    zs.avail_out = uInt(sizeof(outbuf));
+		    int zerr = deflate(&zs, flush);
+		    if (zerr == Z_STREAM_ERROR)
+			throw Xapian::DatabaseError("Deflate failed compressing " + path);
+		    write_all(out, outbuf, sizeof(outbuf) - zs.avail_out,
+			      tmp_path);
+		} while (zs.avail_out == 0);
+	    } while (flush != Z_FINISH);
+	} catch (...) {
+	    (void)deflateEnd(&zs);
+	    throw;
+	}
+	(void)deflateEnd(&zs);
+    }
+
+    conn.send_file(REPL_REPLY_CHANGESET_COMPRESSED, tmp_path, end_time);
+}
+
+void
+decompress_changeset(const string & in_path, const string & out_path)
+{
+    DEBUGCALL_STATIC(REMOTE, void, "decompress_changeset",
+		     in_path << ", " << out_path);
+    int fd = open_for_reading(in_path);
+    if (fd == -1)
+	throw Xapian::DatabaseError("Couldn't open " + in_path, errno);
+    fdcloser closer(fd);
+
+    char inbuf[COMPRESS_BUFSIZE];
+    size_t len = read_some(fd, inbuf, sizeof(inbuf), in_path);
+    const char * p = inbuf;
+    const char * end = p + len;
+    uint8 size;
+    if (!unpack_uint(&p, end, &size))
+	throw Xapian::NetworkError("Bad compressed changeset header");
+
+    int out = open_for_writing(out_path);
+    if (out == -1)
+	throw Xapian::DatabaseError("Couldn't open file for writing: " + out_path, errno);
+    fdcloser out_closer(out);
+
+    // Write the header of a REPL_REPLY_CHANGESET message, as if it had come
+    // straight from the master.
+    string header(1, char(REPL_REPLY_CHANGESET));
+    header += encode_length(size_t(size));
+    write_all(out, header.data(), header.size(), out_path);
+
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    zs.next_in = Z_NULL;
+    zs.avail_in = 0;
+    if (inflateInit(&zs) != Z_OK) {
+	string msg = "Failed to initialise inflate stream";
+	if (zs.msg) {
+	    msg += ": ";
+	    msg += zs.msg;
+	}
+	throw Xapian::DatabaseError(msg);
+    }
+
+    uint8 total = 0;
+    try {
+	char outbuf[COMPRESS_BUFSIZE];
+	zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(p));
+	zs.avail_in = uInt(end - p);
+	int zerr = Z_OK;
+	while (true) {
+	    zs.next_out = reinterpret_cast<Bytef *>(outbuf);
+	    zs.avail_out = uInt(sizeof(outbuf));
+	    zerr = inflate(&zs, Z_NO_FLUSH);
+	    if (zerr != Z_OK && zerr != Z_STREAM_END && zerr != Z_BUF_ERROR) {
+		string msg = "Bad compressed changeset";
+		if (zs.msg) {
+		    msg += ": ";
+		    msg += zs.msg;
+		}
+		throw Xapian::NetworkError(msg);
+	    }
+	    size_t out_len = sizeof(outbuf) - zs.avail_out;
+	    total += out_len;
+	    if (total > size)
+		throw Xapian::NetworkError("Compressed changeset is longer than its header says");
+	    write_all(out, outbuf, out_len, out_path);
+	    if (zerr == Z_STREAM_END) break;
+	    if (zs.avail_in == 0 && zs.avail_out != 0) {
+		// Need more input.
+		len = read_some(fd, inbuf, sizeof(inbuf), in_path);
+		if (len == 0)
+		    throw Xapian::NetworkError("Unexpected end of compressed changeset");
+		zs.next_in = reinterpret_cast<Bytef *>(inbuf);
+		zs.avail_in = uInt(len);
+	    }
+	}
+    } catch (...) {
+	(void)inflateEnd(&zs);
+	throw;
+    }
+    (void)inflateEnd(&zs);
+
+    if (total != size)
+	throw Xapian::NetworkError("Compressed changeset is shorter than its header says");
+}
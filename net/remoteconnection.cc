@@ -44,10 +44,22 @@
 # include "msvc_posix_wrapper.h"
 #endif
 
+#if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+# define USE_SENDFILE
+#endif
+
 using namespace std;
 
 #define CHUNKSIZE 4096
 
+/** Maximum number of bytes to ask sendfile() or splice() to move at once.
+ *
+ *  For splice() this needs to fit in a pipe's buffer, which is 64KB by
+ *  default on Linux.
+ */
+#define ZEROCOPY_CHUNKSIZE 65536
+
 #ifdef __WIN32__
 inline void
 update_overlapped_offset(WSAOVERLAPPED & overlapped, DWORD n)
@@ -60,7 +72,7 @@ update_overlapped_offset(WSAOVERLAPPED & overlapped, DWORD n)
 
 RemoteConnection::RemoteConnection(int fdin_, int fdout_,
 				   const string & context_)
-    : fdin(fdin_), fdout(fdout_), context(context_)
+    : fdin(fdin_), fdout(fdout_), bytes_transferred(0), context(context_)
 {
 #ifdef __WIN32__
     memset(&overlapped, 0, sizeof(overlapped));
@@ -115,6 +127,7 @@ RemoteConnection::read_at_least(size_t min_len, const OmTime & end_time)
 	    throw Xapian::NetworkError("Received EOF", context);
 
 	buffer.append(buf, received);
+	bytes_transferred += received;
 
 	// We must update the offset in the OVERLAPPED structure manually.
 	update_overlapped_offset(overlapped, received);
@@ -132,6 +145,7 @@ RemoteConnection::read_at_least(size_t min_len, const OmTime & end_time)
 
 	if (received > 0) {
 	    buffer.append(buf, received);
+	    bytes_transferred += received;
 	    if (buffer.length() >= min_len) return;
 	    continue;
 	}
@@ -145,38 +159,48 @@ RemoteConnection::read_at_least(size_t min_len, const OmTime & end_time)
 	if (errno != EAGAIN)
 	    throw Xapian::NetworkError("read failed", context, errno);
 
-	Assert(end_time.is_set());
-	while (true) {
-	    // Calculate how far in the future end_time is.
-	    OmTime time_diff = end_time - OmTime::now();
-	    // Check if the timeout has expired.
-	    if (time_diff.sec < 0) {
-		LOGLINE(REMOTE, "read: timeout has expired");
-		throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
-	    }
+	wait_for_input(end_time);
+    }
+#endif
+}
 
-	    struct timeval tv;
-	    tv.tv_sec = time_diff.sec;
-	    tv.tv_usec = time_diff.usec;
+#ifndef __WIN32__
+void
+RemoteConnection::wait_for_input(const OmTime & end_time)
+{
+    DEBUGCALL(REMOTE, void, "RemoteConnection::wait_for_input", end_time);
 
-	    // Use select to wait until there is data or the timeout is reached.
-	    fd_set fdset;
-	    FD_ZERO(&fdset);
-	    FD_SET(fdin, &fdset);
+    Assert(end_time.is_set());
+    while (true) {
+	// Calculate how far in the future end_time is.
+	OmTime time_diff = end_time - OmTime::now();
+	// Check if the timeout has expired.
+	if (time_diff.sec < 0) {
+	    LOGLINE(REMOTE, "read: timeout has expired");
+	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
+	}
 
-	    int select_result = select(fdin + 1, &fdset, 0, &fdset, &tv);
-	    if (select_result > 0) break;
+	struct timeval tv;
+	tv.tv_sec = time_diff.sec;
+	tv.tv_usec = time_diff.usec;
 
-	    if (select_result == 0)
-		throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
+	// Use select to wait until there is data or the timeout is reached.
+	fd_set fdset;
+	FD_ZERO(&fdset);
+	FD_SET(fdin, &fdset);
 
-	    // EINTR means select was interrupted by a signal.
-	    if (errno != EINTR)
-		throw Xapian::NetworkError("select failed during read", context, errno);
-	}
+	int select_result = select(fdin + 1, &fdset, 0, &fdset, &tv);
+	if (select_result > 0) return;
+
+	if (select_result == 0)
+	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
+
+	// EINTR means select was interrupted by a signal.
+	if (errno != EINTR)
+	    throw Xapian::NetworkError("select failed during read", context, errno);
     }
-#endif
 }
+#endif
 
 bool
 RemoteConnection::ready_to_read() const
@@ -241,6 +265,7 @@ RemoteConnection::send_message(char type, const string &message, const OmTime &
 	}
 
 	count += n;
+	bytes_transferred += n;
 
 	// We must update the offset in the OVERLAPPED structure manually.
 	update_overlapped_offset(overlapped, n);
@@ -269,6 +294,7 @@ RemoteConnection::send_message(char type, const string &message, const OmTime &
 
 	if (n >= 0) {
 	    count += n;
+	    bytes_transferred += n;
 	    if (count == str->size()) {
 		if (str == &message || message.empty()) return;
 		str = &message;
@@ -375,6 +401,7 @@ RemoteConnection::send_file(char type, const string &file, const OmTime & end_ti
 	}
 
 	count += n;
+	bytes_transferred += n;
 
 	// We must update the offset in the OVERLAPPED structure manually.
 	update_overlapped_offset(overlapped, n);
@@ -402,15 +429,47 @@ RemoteConnection::send_file(char type, const string &file, const OmTime & end_ti
 
     fd_set fdset;
     size_t count = 0;
+#ifdef USE_SENDFILE
+    // Once the header has been written, try to get the kernel to copy the
+    // file contents directly to fdout.  If sendfile() doesn't support this
+    // combination of file descriptors we fall back to read() and write().
+    bool use_sendfile = true;
+#endif
     while (true) {
+	ssize_t n;
+#ifdef USE_SENDFILE
+	if (use_sendfile && count == c) {
+	    if (size == 0) return;
+	    n = sendfile(fdout, fd, NULL,
+			 size_t(min(size, off_t(ZEROCOPY_CHUNKSIZE))));
+	    if (n > 0) {
+		size -= n;
+		bytes_transferred += n;
+		continue;
+	    }
+	    if (n == 0)
+		throw Xapian::NetworkError("File shrank while sending: " + file);
+	    if (errno == EINVAL || errno == ENOSYS) {
+		// sendfile() uses and updates the file offset, so read() will
+		// carry on from where it stopped.
+		LOGLINE(REMOTE, "sendfile unusable, errno = " << strerror(errno));
+		use_sendfile = false;
+		continue;
+	    }
+	} else
+#endif
 	// We've set write to non-blocking, so just try writing as there
 	// will usually be space.
-	ssize_t n = write(fdout, buf + count, c - count);
+	n = write(fdout, buf + count, c - count);
 
 	if (n >= 0) {
 	    count += n;
+	    bytes_transferred += n;
 	    if (count == c) {
 		if (size == 0) return;
+#ifdef USE_SENDFILE
+		if (use_sendfile) continue;
+#endif
 
 		ssize_t res;
 		do {
@@ -645,6 +704,12 @@ RemoteConnection::receive_file(const string &file, const OmTime & end_time)
     len -= remainlen;
     char type = buffer[0];
     buffer.erase(0, header_len + remainlen);
+#ifdef HAVE_SPLICE
+    // The buffer is now empty, so the rest of the message can be moved
+    // straight from fdin to the file.
+    if (len > 0 && splice_to_file(fd, off_t(len), end_time))
+	RETURN(type);
+#endif
     while (len > 0) {
 	read_at_least(min(len, size_t(CHUNKSIZE)), end_time);
 	remainlen = min(buffer.size(), len);
@@ -655,6 +720,62 @@ RemoteConnection::receive_file(const string &file, const OmTime & end_time)
     RETURN(type);
 }
 
+#ifdef HAVE_SPLICE
+bool
+RemoteConnection::splice_to_file(int fd, off_t len, const OmTime & end_time)
+{
+    DEBUGCALL(REMOTE, bool, "RemoteConnection::splice_to_file",
+	      fd << ", " << len << ", " << end_time);
+    Assert(buffer.empty());
+
+    // If there's no end_time, just use blocking I/O.
+    if (fcntl(fdin, F_SETFL, end_time.is_set() ? O_NONBLOCK : 0) < 0) {
+	throw Xapian::NetworkError("Failed to set fdin non-blocking-ness",
+				   context, errno);
+    }
+
+    // splice() needs a pipe at one end, so we move the data from fdin into
+    // a pipe, and from there into the file.
+    int pipefds[2];
+    if (pipe(pipefds) < 0) RETURN(false);
+    fdcloser close_pipe_in(pipefds[0]);
+    fdcloser close_pipe_out(pipefds[1]);
+
+    bool first = true;
+    while (len > 0) {
+	size_t chunk = size_t(min(len, off_t(ZEROCOPY_CHUNKSIZE)));
+	ssize_t received = splice(fdin, NULL, pipefds[1], NULL, chunk,
+				  SPLICE_F_MOVE | SPLICE_F_MORE);
+	if (received == 0)
+	    throw Xapian::NetworkError("Received EOF", context);
+	if (received < 0) {
+	    LOGLINE(REMOTE, "splice gave errno = " << strerror(errno));
+	    if (errno == EINTR) continue;
+	    if (first && (errno == EINVAL || errno == ENOSYS)) RETURN(false);
+	    if (errno != EAGAIN)
+		throw Xapian::NetworkError("splice failed", context, errno);
+	    wait_for_input(end_time);
+	    continue;
+	}
+	first = false;
+	bytes_transferred += received;
+	len -= received;
+
+	// Drain the pipe into the file.
+	while (received > 0) {
+	    ssize_t c = splice(pipefds[0], NULL, fd, NULL, size_t(received),
+			       SPLICE_F_MOVE | SPLICE_F_MORE);
+	    if (c < 0) {
+		if (errno == EINTR) continue;
+		throw Xapian::NetworkError("Error writing to file", errno);
+	    }
+	    received -= c;
+	}
+    }
+    RETURN(true);
+}
+#endif
+
 void
 RemoteConnection::do_close(bool wait)
 {
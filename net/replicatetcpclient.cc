@@ -25,6 +25,8 @@
 #include "replication.h"
 
 #include "omtime.h"
+#include "pack.h"
+#include "replicationprotocol.h"
 #include "tcpclient.h"
 #include "utils.h"
 
@@ -47,10 +49,21 @@ ReplicateTcpClient::open_socket(const string & hostname, int port,
 void
 ReplicateTcpClient::update_from_master(const std::string & path,
 				       const std::string & masterdb,
-				       Xapian::ReplicationInfo & info)
+				       Xapian::ReplicationInfo & info,
+				       bool send_checksums,
+				       bool compress)
 {
     Xapian::DatabaseReplica replica(path);
-    remconn.send_message('R', replica.get_revision_info(), OmTime());
+    string revision = replica.get_revision_info();
+    if (send_checksums) {
+	// Rather than checksumming the replica on every update, advertise
+	// that we can, and the master will ask if it needs to send a full
+	// copy.  Older masters ignore this, and never ask.
+	pack_uint(revision, unsigned(REPL_CAP_CHECKSUMS));
+    }
+    remconn.send_message('R', revision, OmTime());
+    if (compress)
+	remconn.send_message('Z', string(), OmTime());
     remconn.send_message('D', masterdb, OmTime());
     replica.set_read_fd(socket);
     info.clear();
@@ -59,11 +72,15 @@ ReplicateTcpClient::update_from_master(const std::string & path,
 	sleep(30);
 	info.changeset_count += subinfo.changeset_count;
 	info.fullcopy_count += subinfo.fullcopy_count;
+	info.bytes_transferred += subinfo.bytes_transferred;
+	info.transfer_seconds += subinfo.transfer_seconds;
 	if (subinfo.changed)
 	    info.changed = true;
     }
     info.changeset_count += subinfo.changeset_count;
     info.fullcopy_count += subinfo.fullcopy_count;
+    info.bytes_transferred += subinfo.bytes_transferred;
+    info.transfer_seconds += subinfo.transfer_seconds;
     if (subinfo.changed)
 	info.changed = true;
 }
@@ -25,19 +25,49 @@
 #include <xapian/error.h>
 #include "replication.h"
 
+#include "internaltypes.h"
 #include "omtime.h"
+#include "pack.h"
+#include "replicationprotocol.h"
+#include "serialise.h"
+
+#include <iostream>
 
 using namespace std;
 
 ReplicateTcpServer::ReplicateTcpServer(const string & host, int port,
-				       const string & path_)
-    : TcpServer(host, port, false, false), path(path_)
+				       const string & path_, bool verbose_)
+    : TcpServer(host, port, false, verbose_), path(path_)
 {
 }
 
 ReplicateTcpServer::~ReplicateTcpServer() {
 }
 
+/** Remove the capabilities a client appended to its revision.
+ *
+ *  The revision is the database UUID followed by the revision number, as
+ *  sent by DatabaseReplica::get_revision_info().
+ *
+ *  @return The REPL_CAP_* capabilities the client advertised.
+ */
+static unsigned
+remove_client_capabilities(string & start_revision)
+{
+    if (start_revision.empty()) return 0;
+    const char * p = start_revision.data();
+    const char * end = p + start_revision.size();
+    p += decode_length(&p, end, true);
+    if (!unpack_uint(&p, end, static_cast<uint4 *>(NULL)) || p == end)
+	return 0;
+    string::size_type revision_len = p - start_revision.data();
+    unsigned caps;
+    if (!unpack_uint(&p, end, &caps) || p != end)
+	throw Xapian::NetworkError("Bad replication client capabilities");
+    start_revision.resize(revision_len);
+    return caps;
+}
+
 void
 ReplicateTcpServer::handle_one_connection(int socket)
 {
@@ -48,10 +78,17 @@ ReplicateTcpServer::handle_one_connection(int socket)
 	if (client.get_message(start_revision, OmTime()) != 'R') {
 	    throw Xapian::NetworkError("Bad replication client message");
 	}
+	unsigned caps = remove_client_capabilities(start_revision);
 
-	// Read dbname from the client.
+	// Read the optional compression request, then dbname from the client.
+	bool compress_changesets = false;
 	string dbname;
-	if (client.get_message(dbname, OmTime()) != 'D') {
+	char type = client.get_message(dbname, OmTime());
+	if (type == 'Z') {
+	    compress_changesets = true;
+	    type = client.get_message(dbname, OmTime());
+	}
+	if (type != 'D') {
 	    throw Xapian::NetworkError("Bad replication client message (2)");
 	}
 	if (dbname.find("..") != string::npos) {
@@ -62,7 +99,26 @@ ReplicateTcpServer::handle_one_connection(int socket)
 	dbpath += '/';
 	dbpath += dbname;
 	Xapian::DatabaseMaster master(dbpath);
-	master.write_changesets_to_fd(socket, start_revision, NULL);
+	Xapian::ReplicationInfo info;
+	if (caps & REPL_CAP_CHECKSUMS) {
+	    master.write_changesets_to_socket(socket, start_revision, &info,
+					      compress_changesets);
+	} else {
+	    master.write_changesets_to_fd(socket, start_revision, &info,
+					  string(), compress_changesets);
+	}
+	if (verbose) {
+	    cout << "Replicated " << dbname << ": ";
+	    if (info.revision_lag < 0) {
+		cout << "replica revision unknown";
+	    } else {
+		cout << "replica " << info.revision_lag << " revisions behind";
+	    }
+	    cout << ", " << info.changeset_count << " changesets, "
+		 << info.fullcopy_count << " copies, "
+		 << info.bytes_transferred << " bytes in "
+		 << info.transfer_seconds << " seconds" << endl;
+	}
     } catch (...) {
 	// Ignore exceptions.
     }
@@ -0,0 +1,397 @@
+/** @file replicationdelta.cc
+ *  @brief Send database files to a replica as deltas against its own copy.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "replicationdelta.h"
+
+#include <xapian/error.h>
+
+#include "internaltypes.h"
+#include "md5.h"
+#include "omassert.h"
+#include "omdebug.h"
+#include "omtime.h"
+#include "pack.h"
+#include "remoteconnection.h"
+#include "replicationprotocol.h"
+#include "safedirent.h"
+#include "safeerrno.h"
+#include "safefcntl.h"
+#include "safesysstat.h"
+#include "stringutils.h"
+#include "utils.h"
+
+#ifdef __WIN32__
+# include "msvc_posix_wrapper.h"
+#endif
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+/// Send changed blocks in messages of around this size.
+#define DELTA_MESSAGE_SIZE (1024 * 1024)
+
+/// Store a 32 bit value at p, most significant byte first.
+static inline void
+store_uint32(char * p, unsigned long v)
+{
+    p[0] = char((v >> 24) & 0xff);
+    p[1] = char((v >> 16) & 0xff);
+    p[2] = char((v >> 8) & 0xff);
+    p[3] = char(v & 0xff);
+}
+
+/** Calculate the checksum of a block.
+ *
+ *  We use both the Adler-32 and CRC-32 of the block, which makes accidental
+ *  collisions very unlikely without needing a cryptographic hash.
+ */
+static void
+calc_checksum(const char * p, size_t len, char * out)
+{
+    const Bytef * data = reinterpret_cast<const Bytef *>(p);
+    store_uint32(out, adler32(adler32(0, Z_NULL, 0), data, uInt(len)));
+    store_uint32(out + 4, crc32(crc32(0, Z_NULL, 0), data, uInt(len)));
+}
+
+static int
+open_for_reading(const string & path)
+{
+#ifdef __WIN32__
+    return msvc_posix_open(path.c_str(), O_RDONLY | O_BINARY);
+#else
+    return open(path.c_str(), O_RDONLY | O_BINARY);
+#endif
+}
+
+/// Close a directory when it goes out of scope.
+class DirCloser {
+    DIR * dir;
+  public:
+    DirCloser(DIR * dir_) : dir(dir_) { }
+    ~DirCloser() { closedir(dir); }
+};
+
+/** Read up to n bytes from fd, only returning less at the end of the file. */
+static size_t
+read_block(int fd, char * p, size_t n, const string & path)
+{
+    size_t total = 0;
+    while (total < n) {
+	ssize_t c = read(fd, p + total, n - total);
+	if (c == 0) break;
+	if (c < 0) {
+	    if (errno == EINTR) continue;
+	    throw Xapian::DatabaseError("Error reading from " + path, errno);
+	}
+	total += c;
+    }
+    return total;
+}
+
+/** Write n bytes from block pointed to by p to file descriptor fd. */
+static void
+write_block(int fd, const char * p, size_t n, const string & path)
+{
+    while (n) {
+	ssize_t c = write(fd, p, n);
+	if (c < 0) {
+	    if (errno == EINTR) continue;
+	    throw Xapian::DatabaseError("Error writing to " + path, errno);
+	}
+	p += c;
+	n -= c;
+    }
+}
+
+void
+BlockChecksums::calculate(const string & db_dir, unsigned block_size_)
+{
+    DEBUGCALL(REMOTE, void, "BlockChecksums::calculate",
+	      db_dir << ", " << block_size_);
+    Assert(block_size_ > 0);
+    block_size = block_size_;
+    files.clear();
+
+    DIR * dir = opendir(db_dir.c_str());
+    if (dir == NULL) {
+	throw Xapian::DatabaseError("Cannot open directory '" + db_dir + "'",
+				    errno);
+    }
+    DirCloser dc(dir);
+
+    string buf(block_size, '\0');
+    char sum[CHECKSUM_SIZE];
+    while (true) {
+	errno = 0;
+	struct dirent * entry = readdir(dir);
+	if (entry == NULL) {
+	    if (errno == 0) break;
+	    throw Xapian::DatabaseError("Cannot read entry from directory at '" + db_dir + "'", errno);
+	}
+	string leaf(entry->d_name);
+	if (!endswith(leaf, ".DB")) continue;
+
+	string path = db_dir + "/" + leaf;
+	int fd = open_for_reading(path);
+	if (fd == -1) {
+	    // The file may have been removed - just skip it.
+	    if (errno == ENOENT) continue;
+	    throw Xapian::DatabaseError("Couldn't open " + path, errno);
+	}
+	fdcloser closer(fd);
+
+	string & sums = files[leaf];
+	while (true) {
+	    size_t len = read_block(fd, &buf[0], block_size, path);
+	    if (len == 0) break;
+	    calc_checksum(buf.data(), len, sum);
+	    sums.append(sum, CHECKSUM_SIZE);
+	    if (len < block_size) break;
+	}
+    }
+}
+
+string
+BlockChecksums::serialise() const
+{
+    string result;
+    pack_uint(result, block_size);
+    map<string, string>::const_iterator i;
+    for (i = files.begin(); i != files.end(); ++i) {
+	pack_string(result, i->first);
+	pack_string(result, i->second);
+    }
+    return result;
+}
+
+void
+BlockChecksums::unserialise(const string & s)
+{
+    files.clear();
+    const char * p = s.data();
+    const char * end = p + s.size();
+    if (!unpack_uint(&p, end, &block_size) || block_size == 0)
+	throw Xapian::NetworkError("Bad block size in block checksums");
+    while (p != end) {
+	string leaf, sums;
+	if (!unpack_string(&p, end, leaf) || !unpack_string(&p, end, sums))
+	    throw Xapian::NetworkError("Bad file entry in block checksums");
+	if (sums.size() % CHECKSUM_SIZE != 0)
+	    throw Xapian::NetworkError("Bad checksum list in block checksums");
+	files[leaf].swap(sums);
+    }
+}
+
+bool
+BlockChecksums::block_matches(const string & leaf, off_t n,
+			      const char * p, size_t len) const
+{
+    map<string, string>::const_iterator i = files.find(leaf);
+    if (i == files.end()) return false;
+    const string & sums = i->second;
+    if (n < 0 || off_t(sums.size() / CHECKSUM_SIZE) <= n) return false;
+    char sum[CHECKSUM_SIZE];
+    calc_checksum(p, len, sum);
+    return memcmp(sums.data() + size_t(n) * CHECKSUM_SIZE, sum,
+		  CHECKSUM_SIZE) == 0;
+}
+
+BlockChecksumsSource::~BlockChecksumsSource() { }
+
+const BlockChecksums *
+StoredBlockChecksums::get(RemoteConnection &, const OmTime &)
+{
+    return checksums.empty() ? NULL : &checksums;
+}
+
+const BlockChecksums *
+RequestedBlockChecksums::get(RemoteConnection & conn, const OmTime & end_time)
+{
+    DEBUGCALL(REMOTE, const BlockChecksums *, "RequestedBlockChecksums::get",
+	      "conn, " << end_time);
+    conn.send_message(REPL_REPLY_NEED_CHECKSUMS, string(), end_time);
+    RemoteConnection replica_conn(fd, -1, string());
+    string msg;
+    if (replica_conn.get_message(msg, end_time) != 'C')
+	throw Xapian::NetworkError("Expected block checksums from replica");
+    // An empty message means the replica has nothing to checksum.
+    if (msg.empty()) RETURN(NULL);
+    checksums.unserialise(msg);
+    RETURN(checksums.empty() ? NULL : &checksums);
+}
+
+/// Calculate the MD5 digest of the first @a size bytes of the file at path.
+static string
+digest_file(const string & path, off_t size)
+{
+    int fd = open_for_reading(path);
+    if (fd == -1)
+	throw Xapian::DatabaseError("Couldn't open " + path, errno);
+    fdcloser closer(fd);
+    MD5 md5;
+    string buf(DELTA_MESSAGE_SIZE, '\0');
+    while (size > 0) {
+	size_t len = read_block(fd, &buf[0],
+				size_t(min(size, off_t(buf.size()))), path);
+	if (len == 0) break;
+	md5.update(buf.data(), len);
+	size -= len;
+    }
+    return md5.digest();
+}
+
+void
+send_file_delta(RemoteConnection & conn, const BlockChecksums & checksums,
+		const string & leaf, const string & path,
+		const OmTime & end_time)
+{
+    DEBUGCALL_STATIC(REMOTE, void, "send_file_delta",
+		     "checksums, " << leaf << ", " << path << ", " << end_time);
+    int fd = open_for_reading(path);
+    if (fd == -1) throw Xapian::NetworkError("File not found: " + path, errno);
+    fdcloser closer(fd);
+
+    off_t size;
+    {
+	struct stat sb;
+	if (fstat(fd, &sb) == -1)
+	    throw Xapian::NetworkError("Couldn't stat file: " + path, errno);
+	size = sb.st_size;
+    }
+
+    unsigned block_size = checksums.get_block_size();
+    string msg;
+    pack_uint(msg, uint8(size));
+    pack_uint(msg, block_size);
+    conn.send_message(REPL_REPLY_DB_FILEDELTA, msg, end_time);
+
+    msg.resize(0);
+    string buf(block_size, '\0');
+    MD5 md5;
+    for (off_t n = 0; n * off_t(block_size) < size; ++n) {
+	size_t len = read_block(fd, &buf[0], block_size, path);
+	if (len == 0) break;
+	md5.update(buf.data(), len);
+	if (!checksums.block_matches(leaf, n, buf.data(), len)) {
+	    pack_uint(msg, uint8(n));
+	    msg.append(buf.data(), len);
+	    if (msg.size() >= DELTA_MESSAGE_SIZE) {
+		conn.send_message(REPL_REPLY_DB_BLOCKS, msg, end_time);
+		msg.resize(0);
+	    }
+	}
+	if (len < block_size) break;
+    }
+    if (!msg.empty())
+	conn.send_message(REPL_REPLY_DB_BLOCKS, msg, end_time);
+
+    // Let the replica check the file it builds is exactly what we read.
+    conn.send_message(REPL_REPLY_DB_FILEHASH, md5.digest(), end_time);
+}
+
+void
+receive_file_delta(RemoteConnection & conn, const string & old_path,
+		   const string & new_path, const OmTime & end_time)
+{
+    DEBUGCALL_STATIC(REMOTE, void, "receive_file_delta",
+		     old_path << ", " << new_path << ", " << end_time);
+    string msg;
+    char type = conn.get_message(msg, end_time);
+    if (type != REPL_REPLY_DB_FILEDELTA)
+	throw Xapian::NetworkError("Expected a file delta");
+    const char * p = msg.data();
+    const char * end = p + msg.size();
+    uint8 file_size;
+    unsigned block_size;
+    if (!unpack_uint(&p, end, &file_size) ||
+	!unpack_uint(&p, end, &block_size) || block_size == 0)
+	throw Xapian::NetworkError("Bad file delta header");
+    off_t size = off_t(file_size);
+
+#ifdef __WIN32__
+    int fd = msvc_posix_open(new_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY);
+#else
+    int fd = open(new_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+#endif
+    if (fd == -1)
+	throw Xapian::DatabaseError("Couldn't open file for writing: " + new_path, errno);
+    fdcloser closer(fd);
+
+    // Start with a copy of the replica's existing version of the file.
+    {
+	int old_fd = open_for_reading(old_path);
+	if (old_fd == -1)
+	    throw Xapian::DatabaseError("Couldn't open " + old_path, errno);
+	fdcloser old_closer(old_fd);
+	string buf(DELTA_MESSAGE_SIZE, '\0');
+	off_t left = size;
+	while (left > 0) {
+	    size_t len = read_block(old_fd, &buf[0],
+				    size_t(min(left, off_t(buf.size()))),
+				    old_path);
+	    if (len == 0) break;
+	    write_block(fd, buf.data(), len, new_path);
+	    left -= len;
+	}
+    }
+    if (ftruncate(fd, size) == -1)
+	throw Xapian::DatabaseError("Couldn't set size of " + new_path, errno);
+
+    // Now overwrite the blocks which differ.
+    while (conn.sniff_next_message_type(end_time) == REPL_REPLY_DB_BLOCKS) {
+	(void)conn.get_message(msg, end_time);
+	p = msg.data();
+	end = p + msg.size();
+	while (p != end) {
+	    uint8 n;
+	    if (!unpack_uint(&p, end, &n))
+		throw Xapian::NetworkError("Bad block number in file delta");
+	    if (n >= uint8(size) / block_size + 1)
+		throw Xapian::NetworkError("Block number out of range in file delta");
+	    off_t offset = off_t(n) * off_t(block_size);
+	    if (offset >= size)
+		throw Xapian::NetworkError("Block number out of range in file delta");
+	    size_t len = size_t(min(off_t(block_size), size - offset));
+	    if (size_t(end - p) < len)
+		throw Xapian::NetworkError("Incomplete block in file delta");
+	    if (lseek(fd, offset, SEEK_SET) == -1) {
+		throw Xapian::DatabaseError("Failed to seek to block " +
+					    om_tostring(n), errno);
+	    }
+	    write_block(fd, p, len, new_path);
+	    p += len;
+	}
+    }
+
+    // Check the file we've built matches the master's before it can be
+    // used.
+    type = conn.get_message(msg, end_time);
+    if (type != REPL_REPLY_DB_FILEHASH || msg.size() != MD5::DIGEST_SIZE)
+	throw Xapian::NetworkError("Expected a file digest");
+    if (digest_file(new_path, size) != msg) {
+	throw Xapian::NetworkError("File rebuilt from delta doesn't match "
+				   "master's copy: " + new_path);
+    }
+}
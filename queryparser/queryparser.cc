@@ -24,8 +24,11 @@
 #include <xapian/queryparser.h>
 #include <xapian/termiterator.h>
 
+#include "database.h"
 #include "omdebug.h"
+#include "pack.h"
 #include "queryparser_internal.h"
+#include "stringutils.h"
 #include "vectortermlist.h"
 
 #include <cstring>
@@ -41,6 +44,38 @@ Stopper::get_description() const
     return "Xapian::Stopper subclass";
 }
 
+void
+SimpleStopper::freeze()
+{
+    // Keep the table at most half full so that probe sequences are short.
+    size_t size = 2;
+    while (size < stop_words.size() * 2) size <<= 1;
+    vector<string> table(size);
+    set<string>::const_iterator i;
+    for (i = stop_words.begin(); i != stop_words.end(); ++i) {
+	// The empty string marks an empty slot, so isn't put in the table.
+	if (i->empty()) continue;
+	size_t j = hash_string(*i) & (size - 1);
+	while (!table[j].empty()) j = (j + 1) & (size - 1);
+	table[j] = *i;
+    }
+    swap(hash_table, table);
+}
+
+bool
+SimpleStopper::operator()(const string & term) const
+{
+    if (hash_table.empty() || term.empty())
+	return stop_words.find(term) != stop_words.end();
+    size_t mask = hash_table.size() - 1;
+    size_t j = hash_string(term) & mask;
+    while (!hash_table[j].empty()) {
+	if (hash_table[j] == term) return true;
+	j = (j + 1) & mask;
+    }
+    return false;
+}
+
 string
 SimpleStopper::get_description() const
 {
@@ -73,24 +108,28 @@ void
 QueryParser::set_stemmer(const Xapian::Stem & stemmer)
 {
     internal->stemmer = stemmer;
+    internal->trim_parse_cache(0);
 }
 
 void
 QueryParser::set_stemming_strategy(stem_strategy strategy)
 {
     internal->stem_action = strategy;
+    internal->trim_parse_cache(0);
 }
 
 void
 QueryParser::set_stopper(const Stopper * stopper)
 {
     internal->stopper = stopper;
+    internal->trim_parse_cache(0);
 }
 
 void
 QueryParser::set_default_op(Query::op default_op)
 {
     internal->default_op = default_op;
+    internal->trim_parse_cache(0);
 }
 
 Query::op
@@ -102,6 +141,16 @@ QueryParser::get_default_op() const
 void
 QueryParser::set_database(const Database &db) {
     internal->db = db;
+    internal->trim_parse_cache(0);
+}
+
+void
+QueryParser::set_max_wildcard_expansion(Xapian::termcount max_expansion,
+					Query::wildcard_limit max_type)
+{
+    internal->max_wildcard_expansion = max_expansion;
+    internal->max_wildcard_type = max_type;
+    internal->trim_parse_cache(0);
 }
 
 Query
@@ -114,12 +163,32 @@ QueryParser::parse_query(const string &query_string, unsigned flags,
 
     if (query_string.empty()) return Query();
 
+    string cache_key;
+    if (internal->max_cached_parses &&
+	internal->get_parse_cache_key(query_string, flags, default_prefix,
+				      cache_key)) {
+	map<string, Internal::CachedParse>::iterator c;
+	c = internal->parse_cache.find(cache_key);
+	if (c != internal->parse_cache.end()) {
+	    ++internal->parse_cache_hits;
+	    // Move the entry to the front of the LRU list.
+	    list<string> & lru = internal->parse_cache_lru;
+	    lru.splice(lru.begin(), lru, c->second.lru_pos);
+	    internal->stoplist = c->second.stoplist;
+	    internal->unstem = c->second.unstem;
+	    internal->corrected_query = c->second.corrected_query;
+	    return c->second.query;
+	}
+	++internal->parse_cache_misses;
+    }
+
     Query result = internal->parse_query(query_string, flags, default_prefix);
     if (internal->errmsg && strcmp(internal->errmsg, "parse error") == 0) {
 	result = internal->parse_query(query_string, 0, default_prefix);
     }
 
     if (internal->errmsg) throw Xapian::QueryParserError(internal->errmsg);
+    if (!cache_key.empty()) internal->add_to_parse_cache(cache_key, result);
     return result;
 }
 
@@ -128,6 +197,7 @@ QueryParser::add_prefix(const string &field, const string &prefix)
 {
     Assert(internal.get());
     internal->add_prefix(field, prefix, false);
+    internal->trim_parse_cache(0);
 }
 
 void
@@ -139,6 +209,7 @@ QueryParser::add_boolean_prefix(const string &field, const string &prefix)
     if (field.empty())
 	throw Xapian::UnimplementedError("Can't set the empty prefix to be a boolean filter");
     internal->add_prefix(field, prefix, true);
+    internal->trim_parse_cache(0);
 }
 
 TermIterator
@@ -168,6 +239,7 @@ QueryParser::add_valuerangeprocessor(Xapian::ValueRangeProcessor * vrproc)
 {
     Assert(internal.get());
     internal->valrangeprocs.push_back(vrproc);
+    internal->trim_parse_cache(0);
 }
 
 string
@@ -176,9 +248,102 @@ QueryParser::get_corrected_query_string() const
     return internal->corrected_query;
 }
 
+void
+QueryParser::set_parse_cache_size(unsigned max_queries)
+{
+    internal->max_cached_parses = max_queries;
+    internal->trim_parse_cache(max_queries);
+}
+
+unsigned long
+QueryParser::get_parse_cache_hits() const
+{
+    return internal->parse_cache_hits;
+}
+
+unsigned long
+QueryParser::get_parse_cache_misses() const
+{
+    return internal->parse_cache_misses;
+}
+
 string
 QueryParser::get_description() const
 {
     // FIXME : describe better!
     return "Xapian::QueryParser()";
 }
+
+void
+QueryParser::Internal::build_prefix_table()
+{
+    size_t size = 2;
+    while (size < prefixmap.size() * 2) size <<= 1;
+    vector<const map<string, PrefixInfo>::value_type *> table(size);
+    map<string, PrefixInfo>::const_iterator i;
+    for (i = prefixmap.begin(); i != prefixmap.end(); ++i) {
+	size_t j = hash_string(i->first) & (size - 1);
+	while (table[j]) j = (j + 1) & (size - 1);
+	table[j] = &*i;
+    }
+    swap(prefix_table, table);
+}
+
+const PrefixInfo *
+QueryParser::Internal::find_prefix(const string & field) const
+{
+    if (prefix_table.empty()) return NULL;
+    size_t mask = prefix_table.size() - 1;
+    size_t j = hash_string(field) & mask;
+    while (prefix_table[j]) {
+	if (prefix_table[j]->first == field) return &prefix_table[j]->second;
+	j = (j + 1) & mask;
+    }
+    return NULL;
+}
+
+bool
+QueryParser::Internal::get_parse_cache_key(const string & query_string,
+					   unsigned flags,
+					   const string & default_prefix,
+					   string & key) const
+{
+    key.resize(0);
+    pack_uint(key, flags);
+    pack_string(key, default_prefix);
+    // Even without any flags set, the parse can depend on the database (for
+    // example, to decide if "C++" is a term) so include the revision of each
+    // database in the key.
+    for (size_t i = 0; i < db.internal.size(); ++i) {
+	try {
+	    pack_string(key, db.internal[i]->get_revision_info());
+	} catch (const Xapian::UnimplementedError &) {
+	    return false;
+	}
+    }
+    key += query_string;
+    return true;
+}
+
+void
+QueryParser::Internal::add_to_parse_cache(const string & key,
+					  const Query & query)
+{
+    trim_parse_cache(max_cached_parses - 1);
+    parse_cache_lru.push_front(key);
+    CachedParse & entry = parse_cache[key];
+    entry.query = query;
+    entry.corrected_query = corrected_query;
+    entry.stoplist = stoplist;
+    entry.unstem = unstem;
+    entry.lru_pos = parse_cache_lru.begin();
+}
+
+void
+QueryParser::Internal::trim_parse_cache(unsigned n)
+{
+    while (parse_cache.size() > n) {
+	parse_cache.erase(parse_cache_lru.back());
+	parse_cache_lru.pop_back();
+    }
+}
@@ -31,6 +31,7 @@
 
 #include <config.h>
 
+#include "expandwildcard.h"
 #include "omassert.h"
 #include "queryparser_internal.h"
 #include <xapian/error.h>
@@ -45,6 +46,7 @@
 #include <algorithm>
 #include <list>
 #include <string>
+#include <vector>
 
 #include <string.h>
 
@@ -245,6 +247,28 @@ class State {
     Database get_database() const {
 	return qpi->db;
     }
+
+    /** Add a query for the terms starting with @a root to @a subqs.
+     *
+     *  With FLAG_LAZY_WILDCARD this is a single OP_WILDCARD subquery,
+     *  otherwise the wildcard is expanded here using the database.
+     */
+    void add_wildcard(const string & root, termpos pos, vector<Query> & subqs) {
+	if (flags & QueryParser::FLAG_LAZY_WILDCARD) {
+	    subqs.push_back(Query(Query::OP_WILDCARD, root,
+				  qpi->max_wildcard_expansion,
+				  qpi->max_wildcard_type, pos));
+	    return;
+	}
+	vector<string> terms;
+	expand_wildcard(qpi->db.allterms_begin(root), root,
+			qpi->max_wildcard_expansion, qpi->max_wildcard_type,
+			terms);
+	vector<string>::const_iterator t;
+	for (t = terms.begin(); t != terms.end(); ++t) {
+	    subqs.push_back(Query(*t, 1, pos));
+	}
+    }
 };
 
 string
@@ -351,17 +375,12 @@ Term::get_query() const
 Query *
 Term::as_wildcarded_query(State * state_) const
 {
-    Database db = state_->get_database();
     vector<Query> subqs;
     list<string>::const_iterator piter;
     for (piter = prefixes.begin(); piter != prefixes.end(); ++piter) {
 	string root = *piter;
 	root += name;
-	TermIterator t = db.allterms_begin(root);
-	while (t != db.allterms_end(root)) {
-	    subqs.push_back(Query(*t, 1, pos));
-	    ++t;
-	}
+	state_->add_wildcard(root, pos, subqs);
     }
     delete this;
     return new Query(Query::OP_SYNONYM, subqs.begin(), subqs.end());
@@ -370,18 +389,13 @@ Term::as_wildcarded_query(State * state_) const
 Query *
 Term::as_partial_query(State * state_) const
 {
-    Database db = state_->get_database();
     vector<Query> subqs_partial; // A synonym of all the partial terms.
     vector<Query> subqs_full; // A synonym of all the full terms.
     list<string>::const_iterator piter;
     for (piter = prefixes.begin(); piter != prefixes.end(); ++piter) {
 	string root = *piter;
 	root += name;
-	TermIterator t = db.allterms_begin(root);
-	while (t != db.allterms_end(root)) {
-	    subqs_partial.push_back(Query(*t, 1, pos));
-	    ++t;
-	}
+	state_->add_wildcard(root, pos, subqs_partial);
 	// Add the term, as it would normally be handled, as an alternative.
 	subqs_full.push_back(Query(make_term(*piter), 1, pos));
     }
@@ -474,6 +488,7 @@ void
 QueryParser::Internal::add_prefix(const string &field, const string &prefix,
 				  bool filter)
 {
+    prefix_table.clear();
     map<string, PrefixInfo>::iterator p = prefixmap.find(field);
     if (p == prefixmap.end()) {
        prefixmap.insert(make_pair(field, PrefixInfo(filter, prefix)));
@@ -578,6 +593,8 @@ QueryParser::Internal::parse_query(const string &qs, unsigned flags,
 {
     yyParser * pParser = ParseAlloc();
 
+    if (prefix_table.empty() && !prefixmap.empty()) build_prefix_table();
+
     // Set value_ranges if we may have to handle value ranges in the query.
     bool value_ranges;
     value_ranges = !valrangeprocs.empty() && (qs.find("..") != string::npos);
@@ -601,8 +618,8 @@ QueryParser::Internal::parse_query(const string &qs, unsigned flags,
     {
 	const PrefixInfo * default_prefixinfo = &def_pfx;
 	if (default_prefix.empty()) {
-	    map<string, PrefixInfo>::const_iterator f = prefixmap.find("");
-	    if (f != prefixmap.end()) default_prefixinfo = &(f->second);
+	    const PrefixInfo * f = find_prefix(string());
+	    if (f) default_prefixinfo = f;
 	}
 
 	// We always have the current prefix on the top of the stack.
@@ -806,13 +823,11 @@ just_had_synonym_operator:
 		p = it;
 		while (*p != ':')
 		    Unicode::append_utf8(field, *p++);
-		map<string, PrefixInfo>::const_iterator f;
-		f = prefixmap.find(field);
-		if (f != prefixmap.end()) {
+		prefixinfo = find_prefix(field);
+		if (prefixinfo) {
 		    // Special handling for prefixed fields, depending on the
 		    // type of the prefix.
 		    unsigned ch = *++p;
-		    prefixinfo = &(f->second);
 
 		    if (prefixinfo->filter) {
 			// Drop out of IN_GROUP if we're in it.
@@ -1393,7 +1408,7 @@ class TermList {
 	delete B;\
     } while (0)
 
-#line 1394 "queryparser/queryparser_internal.cc"
+#line 1409 "queryparser/queryparser_internal.cc"
 /* Next is all token values, in a form suitable for use by makeheaders.
 ** This section will be null unless lemon is run with the -m switch.
 */
@@ -1839,9 +1854,9 @@ static void yy_destructor(
     case 21: /* BRA */
     case 22: /* KET */
 {
-#line 1387 "queryparser/queryparser.lemony"
+#line 1402 "queryparser/queryparser.lemony"
 delete (yypminor->yy0);
-#line 1842 "queryparser/queryparser_internal.cc"
+#line 1857 "queryparser/queryparser_internal.cc"
 }
       break;
     case 25: /* expr */
@@ -1851,17 +1866,17 @@ delete (yypminor->yy0);
     case 31: /* stop_term */
     case 32: /* compound_term */
 {
-#line 1462 "queryparser/queryparser.lemony"
+#line 1477 "queryparser/queryparser.lemony"
 delete (yypminor->yy73);
-#line 1854 "queryparser/queryparser_internal.cc"
+#line 1869 "queryparser/queryparser_internal.cc"
 }
       break;
     case 28: /* prob */
     case 30: /* stop_prob */
 {
-#line 1558 "queryparser/queryparser.lemony"
+#line 1573 "queryparser/queryparser.lemony"
 delete (yypminor->yy12);
-#line 1862 "queryparser/queryparser_internal.cc"
+#line 1877 "queryparser/queryparser_internal.cc"
 }
       break;
     case 33: /* phrase */
@@ -1869,16 +1884,16 @@ delete (yypminor->yy12);
     case 36: /* near_expr */
     case 37: /* adj_expr */
 {
-#line 1771 "queryparser/queryparser.lemony"
+#line 1786 "queryparser/queryparser.lemony"
 (yypminor->yy27)->destroy();
-#line 1872 "queryparser/queryparser_internal.cc"
+#line 1887 "queryparser/queryparser_internal.cc"
 }
       break;
     case 35: /* group */
 {
-#line 1805 "queryparser/queryparser.lemony"
+#line 1820 "queryparser/queryparser.lemony"
 (yypminor->yy76)->destroy();
-#line 1879 "queryparser/queryparser_internal.cc"
+#line 1894 "queryparser/queryparser_internal.cc"
 }
       break;
     default:  break;   /* If no destructor action specified: do nothing */
@@ -2146,7 +2161,7 @@ static void yy_reduce(
   **     break;
   */
       case 0: /* query ::= expr */
-#line 1444 "queryparser/queryparser.lemony"
+#line 1459 "queryparser/queryparser.lemony"
 {
     // Save the parsed query in the State structure so we can return it.
     if (yymsp[0].minor.yy73) {
@@ -2156,30 +2171,30 @@ static void yy_reduce(
 	state->query = Query();
     }
 }
-#line 2157 "queryparser/queryparser_internal.cc"
+#line 2172 "queryparser/queryparser_internal.cc"
         break;
       case 1: /* query ::= */
-#line 1454 "queryparser/queryparser.lemony"
+#line 1469 "queryparser/queryparser.lemony"
 {
     // Handle a query string with no terms in.
     state->query = Query();
 }
-#line 2165 "queryparser/queryparser_internal.cc"
+#line 2180 "queryparser/queryparser_internal.cc"
         break;
       case 2: /* expr ::= prob_expr */
       case 9: /* bool_arg ::= expr */ yytestcase(yyruleno==9);
-#line 1465 "queryparser/queryparser.lemony"
+#line 1480 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[0].minor.yy73; }
-#line 2171 "queryparser/queryparser_internal.cc"
+#line 2186 "queryparser/queryparser_internal.cc"
         break;
       case 3: /* expr ::= bool_arg AND bool_arg */
-#line 1468 "queryparser/queryparser.lemony"
+#line 1483 "queryparser/queryparser.lemony"
 { BOOL_OP_TO_QUERY(yygotominor.yy73, yymsp[-2].minor.yy73, Query::OP_AND, yymsp[0].minor.yy73, "AND");   yy_destructor(yypParser,4,&yymsp[-1].minor);
 }
-#line 2177 "queryparser/queryparser_internal.cc"
+#line 2192 "queryparser/queryparser_internal.cc"
         break;
       case 4: /* expr ::= bool_arg NOT bool_arg */
-#line 1470 "queryparser/queryparser.lemony"
+#line 1485 "queryparser/queryparser.lemony"
 {
     // 'NOT foo' -> '<alldocuments> NOT foo'
     if (!yymsp[-2].minor.yy73 && (state->flags & QueryParser::FLAG_PURE_NOT)) {
@@ -2188,46 +2203,46 @@ static void yy_reduce(
     BOOL_OP_TO_QUERY(yygotominor.yy73, yymsp[-2].minor.yy73, Query::OP_AND_NOT, yymsp[0].minor.yy73, "NOT");
   yy_destructor(yypParser,5,&yymsp[-1].minor);
 }
-#line 2189 "queryparser/queryparser_internal.cc"
+#line 2204 "queryparser/queryparser_internal.cc"
         break;
       case 5: /* expr ::= bool_arg AND NOT bool_arg */
-#line 1479 "queryparser/queryparser.lemony"
+#line 1494 "queryparser/queryparser.lemony"
 { BOOL_OP_TO_QUERY(yygotominor.yy73, yymsp[-3].minor.yy73, Query::OP_AND_NOT, yymsp[0].minor.yy73, "AND NOT");   yy_destructor(yypParser,4,&yymsp[-2].minor);
   yy_destructor(yypParser,5,&yymsp[-1].minor);
 }
-#line 2196 "queryparser/queryparser_internal.cc"
+#line 2211 "queryparser/queryparser_internal.cc"
         break;
       case 6: /* expr ::= bool_arg AND HATE_AFTER_AND bool_arg */
-#line 1482 "queryparser/queryparser.lemony"
+#line 1497 "queryparser/queryparser.lemony"
 { BOOL_OP_TO_QUERY(yygotominor.yy73, yymsp[-3].minor.yy73, Query::OP_AND_NOT, yymsp[0].minor.yy73, "AND");   yy_destructor(yypParser,4,&yymsp[-2].minor);
   yy_destructor(yypParser,10,&yymsp[-1].minor);
 }
-#line 2203 "queryparser/queryparser_internal.cc"
+#line 2218 "queryparser/queryparser_internal.cc"
         break;
       case 7: /* expr ::= bool_arg OR bool_arg */
-#line 1485 "queryparser/queryparser.lemony"
+#line 1500 "queryparser/queryparser.lemony"
 { BOOL_OP_TO_QUERY(yygotominor.yy73, yymsp[-2].minor.yy73, Query::OP_OR, yymsp[0].minor.yy73, "OR");   yy_destructor(yypParser,2,&yymsp[-1].minor);
 }
-#line 2209 "queryparser/queryparser_internal.cc"
+#line 2224 "queryparser/queryparser_internal.cc"
         break;
       case 8: /* expr ::= bool_arg XOR bool_arg */
-#line 1488 "queryparser/queryparser.lemony"
+#line 1503 "queryparser/queryparser.lemony"
 { BOOL_OP_TO_QUERY(yygotominor.yy73, yymsp[-2].minor.yy73, Query::OP_XOR, yymsp[0].minor.yy73, "XOR");   yy_destructor(yypParser,3,&yymsp[-1].minor);
 }
-#line 2215 "queryparser/queryparser_internal.cc"
+#line 2230 "queryparser/queryparser_internal.cc"
         break;
       case 10: /* bool_arg ::= */
-#line 1497 "queryparser/queryparser.lemony"
+#line 1512 "queryparser/queryparser.lemony"
 {
     // Set the argument to NULL, which enables the bool_arg-using rules in
     // expr above to report uses of AND, OR, etc which don't have two
     // arguments.
     yygotominor.yy73 = NULL;
 }
-#line 2225 "queryparser/queryparser_internal.cc"
+#line 2240 "queryparser/queryparser_internal.cc"
         break;
       case 11: /* prob_expr ::= prob */
-#line 1509 "queryparser/queryparser.lemony"
+#line 1524 "queryparser/queryparser.lemony"
 {
     yygotominor.yy73 = yymsp[0].minor.yy12->query;
     yymsp[0].minor.yy12->query = NULL;
@@ -2266,19 +2281,19 @@ static void yy_reduce(
     // FIXME what if yygotominor.yy73 && yygotominor.yy73->empty() (all terms are stopwords)?
     delete yymsp[0].minor.yy12;
 }
-#line 2267 "queryparser/queryparser_internal.cc"
+#line 2282 "queryparser/queryparser_internal.cc"
         break;
       case 12: /* prob_expr ::= term */
       case 30: /* stop_term ::= compound_term */ yytestcase(yyruleno==30);
       case 32: /* term ::= compound_term */ yytestcase(yyruleno==32);
-#line 1548 "queryparser/queryparser.lemony"
+#line 1563 "queryparser/queryparser.lemony"
 {
     yygotominor.yy73 = yymsp[0].minor.yy73;
 }
-#line 2276 "queryparser/queryparser_internal.cc"
+#line 2291 "queryparser/queryparser_internal.cc"
         break;
       case 13: /* prob ::= RANGE_START RANGE_END */
-#line 1560 "queryparser/queryparser.lemony"
+#line 1575 "queryparser/queryparser.lemony"
 {
     Query range;
     Xapian::valueno valno = state->value_range(range, yymsp[-1].minor.yy0, yymsp[0].minor.yy0);
@@ -2289,10 +2304,10 @@ static void yy_reduce(
     yygotominor.yy12 = new ProbQuery;
     yygotominor.yy12->filter[filter_group_id(valno)] = range;
 }
-#line 2290 "queryparser/queryparser_internal.cc"
+#line 2305 "queryparser/queryparser_internal.cc"
         break;
       case 14: /* prob ::= stop_prob RANGE_START RANGE_END */
-#line 1571 "queryparser/queryparser.lemony"
+#line 1586 "queryparser/queryparser.lemony"
 {
     Query range;
     Xapian::valueno valno = state->value_range(range, yymsp[-1].minor.yy0, yymsp[0].minor.yy0);
@@ -2304,10 +2319,10 @@ static void yy_reduce(
     Query & q = yygotominor.yy12->filter[filter_group_id(valno)];
     q = Query(Query::OP_OR, q, range);
 }
-#line 2305 "queryparser/queryparser_internal.cc"
+#line 2320 "queryparser/queryparser_internal.cc"
         break;
       case 15: /* prob ::= stop_term stop_term */
-#line 1583 "queryparser/queryparser.lemony"
+#line 1598 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = new ProbQuery;
     yygotominor.yy12->query = yymsp[-1].minor.yy73;
@@ -2325,19 +2340,19 @@ static void yy_reduce(
 	}
     }
 }
-#line 2326 "queryparser/queryparser_internal.cc"
+#line 2341 "queryparser/queryparser_internal.cc"
         break;
       case 16: /* prob ::= prob stop_term */
-#line 1601 "queryparser/queryparser.lemony"
+#line 1616 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = yymsp[-1].minor.yy12;
     // If yymsp[0].minor.yy73 is a stopword, there's nothing to do here.
     if (yymsp[0].minor.yy73) add_to_query(yygotominor.yy12->query, state->default_op(), yymsp[0].minor.yy73);
 }
-#line 2335 "queryparser/queryparser_internal.cc"
+#line 2350 "queryparser/queryparser_internal.cc"
         break;
       case 17: /* prob ::= LOVE term */
-#line 1607 "queryparser/queryparser.lemony"
+#line 1622 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = new ProbQuery;
     if (state->default_op() == Query::OP_AND) {
@@ -2347,10 +2362,10 @@ static void yy_reduce(
     }
   yy_destructor(yypParser,8,&yymsp[-1].minor);
 }
-#line 2348 "queryparser/queryparser_internal.cc"
+#line 2363 "queryparser/queryparser_internal.cc"
         break;
       case 18: /* prob ::= stop_prob LOVE term */
-#line 1616 "queryparser/queryparser.lemony"
+#line 1631 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = yymsp[-2].minor.yy12;
     if (state->default_op() == Query::OP_AND) {
@@ -2363,57 +2378,57 @@ static void yy_reduce(
     }
   yy_destructor(yypParser,8,&yymsp[-1].minor);
 }
-#line 2364 "queryparser/queryparser_internal.cc"
+#line 2379 "queryparser/queryparser_internal.cc"
         break;
       case 19: /* prob ::= HATE term */
-#line 1628 "queryparser/queryparser.lemony"
+#line 1643 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = new ProbQuery;
     yygotominor.yy12->hate = yymsp[0].minor.yy73;
   yy_destructor(yypParser,9,&yymsp[-1].minor);
 }
-#line 2373 "queryparser/queryparser_internal.cc"
+#line 2388 "queryparser/queryparser_internal.cc"
         break;
       case 20: /* prob ::= stop_prob HATE term */
-#line 1633 "queryparser/queryparser.lemony"
+#line 1648 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = yymsp[-2].minor.yy12;
     add_to_query(yygotominor.yy12->hate, Query::OP_OR, yymsp[0].minor.yy73);
   yy_destructor(yypParser,9,&yymsp[-1].minor);
 }
-#line 2382 "queryparser/queryparser_internal.cc"
+#line 2397 "queryparser/queryparser_internal.cc"
         break;
       case 21: /* prob ::= HATE BOOLEAN_FILTER */
-#line 1638 "queryparser/queryparser.lemony"
+#line 1653 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = new ProbQuery;
     yygotominor.yy12->hate = new Query(yymsp[0].minor.yy0->get_query());
     delete yymsp[0].minor.yy0;
   yy_destructor(yypParser,9,&yymsp[-1].minor);
 }
-#line 2392 "queryparser/queryparser_internal.cc"
+#line 2407 "queryparser/queryparser_internal.cc"
         break;
       case 22: /* prob ::= stop_prob HATE BOOLEAN_FILTER */
-#line 1644 "queryparser/queryparser.lemony"
+#line 1659 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = yymsp[-2].minor.yy12;
     add_to_query(yygotominor.yy12->hate, Query::OP_OR, yymsp[0].minor.yy0->get_query());
     delete yymsp[0].minor.yy0;
   yy_destructor(yypParser,9,&yymsp[-1].minor);
 }
-#line 2402 "queryparser/queryparser_internal.cc"
+#line 2417 "queryparser/queryparser_internal.cc"
         break;
       case 23: /* prob ::= BOOLEAN_FILTER */
-#line 1650 "queryparser/queryparser.lemony"
+#line 1665 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = new ProbQuery;
     yygotominor.yy12->filter[yymsp[0].minor.yy0->get_filter_group_id()] = yymsp[0].minor.yy0->get_query();
     delete yymsp[0].minor.yy0;
 }
-#line 2411 "queryparser/queryparser_internal.cc"
+#line 2426 "queryparser/queryparser_internal.cc"
         break;
       case 24: /* prob ::= stop_prob BOOLEAN_FILTER */
-#line 1656 "queryparser/queryparser.lemony"
+#line 1671 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = yymsp[-1].minor.yy12;
     // We OR filters with the same prefix...
@@ -2421,10 +2436,10 @@ static void yy_reduce(
     q = Query(Query::OP_OR, q, yymsp[0].minor.yy0->get_query());
     delete yymsp[0].minor.yy0;
 }
-#line 2422 "queryparser/queryparser_internal.cc"
+#line 2437 "queryparser/queryparser_internal.cc"
         break;
       case 25: /* prob ::= LOVE BOOLEAN_FILTER */
-#line 1664 "queryparser/queryparser.lemony"
+#line 1679 "queryparser/queryparser.lemony"
 {
     // LOVE BOOLEAN_FILTER(yymsp[0].minor.yy0) is just the same as BOOLEAN_FILTER
     yygotominor.yy12 = new ProbQuery;
@@ -2432,10 +2447,10 @@ static void yy_reduce(
     delete yymsp[0].minor.yy0;
   yy_destructor(yypParser,8,&yymsp[-1].minor);
 }
-#line 2433 "queryparser/queryparser_internal.cc"
+#line 2448 "queryparser/queryparser_internal.cc"
         break;
       case 26: /* prob ::= stop_prob LOVE BOOLEAN_FILTER */
-#line 1671 "queryparser/queryparser.lemony"
+#line 1686 "queryparser/queryparser.lemony"
 {
     // LOVE BOOLEAN_FILTER(yymsp[0].minor.yy0) is just the same as BOOLEAN_FILTER
     yygotominor.yy12 = yymsp[-2].minor.yy12;
@@ -2445,23 +2460,23 @@ static void yy_reduce(
     delete yymsp[0].minor.yy0;
   yy_destructor(yypParser,8,&yymsp[-1].minor);
 }
-#line 2446 "queryparser/queryparser_internal.cc"
+#line 2461 "queryparser/queryparser_internal.cc"
         break;
       case 27: /* stop_prob ::= prob */
-#line 1686 "queryparser/queryparser.lemony"
+#line 1701 "queryparser/queryparser.lemony"
 { yygotominor.yy12 = yymsp[0].minor.yy12; }
-#line 2451 "queryparser/queryparser_internal.cc"
+#line 2466 "queryparser/queryparser_internal.cc"
         break;
       case 28: /* stop_prob ::= stop_term */
-#line 1688 "queryparser/queryparser.lemony"
+#line 1703 "queryparser/queryparser.lemony"
 {
     yygotominor.yy12 = new ProbQuery;
     yygotominor.yy12->query = yymsp[0].minor.yy73;
 }
-#line 2459 "queryparser/queryparser_internal.cc"
+#line 2474 "queryparser/queryparser_internal.cc"
         break;
       case 29: /* stop_term ::= TERM */
-#line 1702 "queryparser/queryparser.lemony"
+#line 1717 "queryparser/queryparser.lemony"
 {
     if (state->is_stopword(yymsp[0].minor.yy0)) {
 	yygotominor.yy73 = NULL;
@@ -2471,117 +2486,117 @@ static void yy_reduce(
     }
     delete yymsp[0].minor.yy0;
 }
-#line 2472 "queryparser/queryparser_internal.cc"
+#line 2487 "queryparser/queryparser_internal.cc"
         break;
       case 31: /* term ::= TERM */
-#line 1721 "queryparser/queryparser.lemony"
+#line 1736 "queryparser/queryparser.lemony"
 {
     yygotominor.yy73 = new Query(yymsp[0].minor.yy0->get_query_with_auto_synonyms());
     delete yymsp[0].minor.yy0;
 }
-#line 2480 "queryparser/queryparser_internal.cc"
+#line 2495 "queryparser/queryparser_internal.cc"
         break;
       case 33: /* compound_term ::= WILD_TERM */
-#line 1738 "queryparser/queryparser.lemony"
+#line 1753 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[0].minor.yy0->as_wildcarded_query(state); }
-#line 2485 "queryparser/queryparser_internal.cc"
+#line 2500 "queryparser/queryparser_internal.cc"
         break;
       case 34: /* compound_term ::= PARTIAL_TERM */
-#line 1741 "queryparser/queryparser.lemony"
+#line 1756 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[0].minor.yy0->as_partial_query(state); }
-#line 2490 "queryparser/queryparser_internal.cc"
+#line 2505 "queryparser/queryparser_internal.cc"
         break;
       case 35: /* compound_term ::= QUOTE phrase QUOTE */
-#line 1744 "queryparser/queryparser.lemony"
+#line 1759 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[-1].minor.yy27->as_phrase_query();   yy_destructor(yypParser,20,&yymsp[-2].minor);
   yy_destructor(yypParser,20,&yymsp[0].minor);
 }
-#line 2497 "queryparser/queryparser_internal.cc"
+#line 2512 "queryparser/queryparser_internal.cc"
         break;
       case 36: /* compound_term ::= phrased_term */
-#line 1747 "queryparser/queryparser.lemony"
+#line 1762 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[0].minor.yy27->as_phrase_query(); }
-#line 2502 "queryparser/queryparser_internal.cc"
+#line 2517 "queryparser/queryparser_internal.cc"
         break;
       case 37: /* compound_term ::= group */
-#line 1749 "queryparser/queryparser.lemony"
+#line 1764 "queryparser/queryparser.lemony"
 {
     yygotominor.yy73 = yymsp[0].minor.yy76->as_group(state);
 }
-#line 2509 "queryparser/queryparser_internal.cc"
+#line 2524 "queryparser/queryparser_internal.cc"
         break;
       case 38: /* compound_term ::= near_expr */
-#line 1754 "queryparser/queryparser.lemony"
+#line 1769 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[0].minor.yy27->as_near_query(); }
-#line 2514 "queryparser/queryparser_internal.cc"
+#line 2529 "queryparser/queryparser_internal.cc"
         break;
       case 39: /* compound_term ::= adj_expr */
-#line 1757 "queryparser/queryparser.lemony"
+#line 1772 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[0].minor.yy27->as_adj_query(); }
-#line 2519 "queryparser/queryparser_internal.cc"
+#line 2534 "queryparser/queryparser_internal.cc"
         break;
       case 40: /* compound_term ::= BRA expr KET */
-#line 1760 "queryparser/queryparser.lemony"
+#line 1775 "queryparser/queryparser.lemony"
 { yygotominor.yy73 = yymsp[-1].minor.yy73;   yy_destructor(yypParser,21,&yymsp[-2].minor);
   yy_destructor(yypParser,22,&yymsp[0].minor);
 }
-#line 2526 "queryparser/queryparser_internal.cc"
+#line 2541 "queryparser/queryparser_internal.cc"
         break;
       case 41: /* compound_term ::= SYNONYM TERM */
-#line 1762 "queryparser/queryparser.lemony"
+#line 1777 "queryparser/queryparser.lemony"
 {
     yygotominor.yy73 = new Query(yymsp[0].minor.yy0->get_query_with_synonyms());
     delete yymsp[0].minor.yy0;
   yy_destructor(yypParser,11,&yymsp[-1].minor);
 }
-#line 2535 "queryparser/queryparser_internal.cc"
+#line 2550 "queryparser/queryparser_internal.cc"
         break;
       case 42: /* phrase ::= TERM */
-#line 1773 "queryparser/queryparser.lemony"
+#line 1788 "queryparser/queryparser.lemony"
 {
     yygotominor.yy27 = new TermList;
     yygotominor.yy27->add_positional_term(yymsp[0].minor.yy0);
 }
-#line 2543 "queryparser/queryparser_internal.cc"
+#line 2558 "queryparser/queryparser_internal.cc"
         break;
       case 43: /* phrase ::= phrase TERM */
       case 45: /* phrased_term ::= phrased_term PHR_TERM */ yytestcase(yyruleno==45);
-#line 1778 "queryparser/queryparser.lemony"
+#line 1793 "queryparser/queryparser.lemony"
 {
     yygotominor.yy27 = yymsp[-1].minor.yy27;
     yygotominor.yy27->add_positional_term(yymsp[0].minor.yy0);
 }
-#line 2552 "queryparser/queryparser_internal.cc"
+#line 2567 "queryparser/queryparser_internal.cc"
         break;
       case 44: /* phrased_term ::= TERM PHR_TERM */
-#line 1790 "queryparser/queryparser.lemony"
+#line 1805 "queryparser/queryparser.lemony"
 {
     yygotominor.yy27 = new TermList;
     yygotominor.yy27->add_positional_term(yymsp[-1].minor.yy0);
     yygotominor.yy27->add_positional_term(yymsp[0].minor.yy0);
 }
-#line 2561 "queryparser/queryparser_internal.cc"
+#line 2576 "queryparser/queryparser_internal.cc"
         break;
       case 46: /* group ::= TERM GROUP_TERM */
-#line 1807 "queryparser/queryparser.lemony"
+#line 1822 "queryparser/queryparser.lemony"
 {
     yygotominor.yy76 = new TermGroup;
     yygotominor.yy76->add_term(yymsp[-1].minor.yy0);
     yygotominor.yy76->add_term(yymsp[0].minor.yy0);
 }
-#line 2570 "queryparser/queryparser_internal.cc"
+#line 2585 "queryparser/queryparser_internal.cc"
         break;
       case 47: /* group ::= group GROUP_TERM */
-#line 1813 "queryparser/queryparser.lemony"
+#line 1828 "queryparser/queryparser.lemony"
 {
     yygotominor.yy76 = yymsp[-1].minor.yy76;
     yygotominor.yy76->add_term(yymsp[0].minor.yy0);
 }
-#line 2578 "queryparser/queryparser_internal.cc"
+#line 2593 "queryparser/queryparser_internal.cc"
         break;
       case 48: /* near_expr ::= TERM NEAR TERM */
       case 50: /* adj_expr ::= TERM ADJ TERM */ yytestcase(yyruleno==50);
-#line 1824 "queryparser/queryparser.lemony"
+#line 1839 "queryparser/queryparser.lemony"
 {
     yygotominor.yy27 = new TermList;
     yygotominor.yy27->add_positional_term(yymsp[-2].minor.yy0);
@@ -2591,11 +2606,11 @@ static void yy_reduce(
 	delete yymsp[-1].minor.yy0;
     }
 }
-#line 2592 "queryparser/queryparser_internal.cc"
+#line 2607 "queryparser/queryparser_internal.cc"
         break;
       case 49: /* near_expr ::= near_expr NEAR TERM */
       case 51: /* adj_expr ::= adj_expr ADJ TERM */ yytestcase(yyruleno==51);
-#line 1834 "queryparser/queryparser.lemony"
+#line 1849 "queryparser/queryparser.lemony"
 {
     yygotominor.yy27 = yymsp[-2].minor.yy27;
     yygotominor.yy27->add_positional_term(yymsp[0].minor.yy0);
@@ -2604,7 +2619,7 @@ static void yy_reduce(
 	delete yymsp[-1].minor.yy0;
     }
 }
-#line 2605 "queryparser/queryparser_internal.cc"
+#line 2620 "queryparser/queryparser_internal.cc"
         break;
       default:
         break;
@@ -2633,11 +2648,11 @@ static void yy_parse_failed(
   while( !yypParser->yystack.empty() ) yy_pop_parser_stack(yypParser);
   /* Here code is inserted which will be executed whenever the
   ** parser fails */
-#line 1391 "queryparser/queryparser.lemony"
+#line 1406 "queryparser/queryparser.lemony"
 
     // If we've not already set an error message, set a default one.
     if (!state->error) state->error = "parse error";
-#line 2638 "queryparser/queryparser_internal.cc"
+#line 2653 "queryparser/queryparser_internal.cc"
   ParseARG_STORE; /* Suppress warning about unused %extra_argument variable */
 }
 #endif /* YYNOERRORRECOVERY */
@@ -2654,10 +2669,10 @@ static void yy_syntax_error(
   (void)yymajor;
   (void)yyminor;
 #define TOKEN (yyminor.yy0)
-#line 1396 "queryparser/queryparser.lemony"
+#line 1411 "queryparser/queryparser.lemony"
 
     yy_parse_failed(yypParser);
-#line 2658 "queryparser/queryparser_internal.cc"
+#line 2673 "queryparser/queryparser_internal.cc"
   ParseARG_STORE; /* Suppress warning about unused %extra_argument variable */
 }
 
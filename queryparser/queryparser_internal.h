@@ -30,6 +30,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 using namespace std;
 
@@ -63,6 +64,8 @@ class QueryParser::Internal : public Xapian::Internal::RefCntBase {
     Query::op default_op;
     const char * errmsg;
     Database db;
+    Xapian::termcount max_wildcard_expansion;
+    Query::wildcard_limit max_wildcard_type;
     list<string> stoplist;
     multimap<string, string> unstem;
 
@@ -70,18 +73,68 @@ class QueryParser::Internal : public Xapian::Internal::RefCntBase {
     // "foobar" -> "XFOO". FIXME: it does more than this now!
     map<string, PrefixInfo> prefixmap;
 
+    /** Open-addressed hash table of the entries in prefixmap.
+     *
+     *  Empty slots are NULL.  This is cleared whenever prefixmap changes,
+     *  and rebuilt by build_prefix_table() at the start of the next parse.
+     */
+    vector<const map<string, PrefixInfo>::value_type *> prefix_table;
+
     list<ValueRangeProcessor *> valrangeprocs;
 
     string corrected_query;
 
+    /// A parse in the parse cache.
+    struct CachedParse {
+	Query query;
+	string corrected_query;
+	list<string> stoplist;
+	multimap<string, string> unstem;
+	/// Position of this entry's key in parse_cache_lru.
+	list<string>::iterator lru_pos;
+    };
+
+    /// The maximum number of parses to cache (0 for no caching).
+    unsigned max_cached_parses;
+
+    /// Cached parses, keyed as described for get_parse_cache_key().
+    map<string, CachedParse> parse_cache;
+
+    /// Keys of parse_cache, with the most recently used first.
+    list<string> parse_cache_lru;
+
+    unsigned long parse_cache_hits, parse_cache_misses;
+
     void add_prefix(const string &field, const string &prefix, bool filter);
 
+    /// Build prefix_table from prefixmap.
+    void build_prefix_table();
+
+    /// Look up @a field in prefix_table, returning NULL if it's not there.
+    const PrefixInfo * find_prefix(const string & field) const;
+
+    /** Build the parse cache key for a call to parse_query().
+     *
+     *  @return false if the parse can't be cached.
+     */
+    bool get_parse_cache_key(const string & query_string, unsigned flags,
+			     const string & default_prefix,
+			     string & key) const;
+
+    /// Add the results of the last parse to the parse cache.
+    void add_to_parse_cache(const string & key, const Query & query);
+
+    /// Remove entries from the parse cache until there are at most @a n.
+    void trim_parse_cache(unsigned n);
+
     std::string parse_term(Utf8Iterator &it, const Utf8Iterator &end,
 			   bool &was_acronym);
 
   public:
     Internal() : stem_action(STEM_NONE), stopper(NULL),
-	default_op(Query::OP_OR), errmsg(NULL) { }
+	default_op(Query::OP_OR), errmsg(NULL), max_wildcard_expansion(0),
+	max_wildcard_type(Query::WILDCARD_LIMIT_ERROR), max_cached_parses(0),
+	parse_cache_hits(0), parse_cache_misses(0) { }
     Query parse_query(const string & query_string, unsigned int flags, const string & default_prefix);
 };
 
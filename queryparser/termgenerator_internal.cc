@@ -26,12 +26,17 @@
 #include <xapian/queryparser.h>
 #include <xapian/unicode.h>
 
+#include "document.h"
 #include "stringutils.h"
 
 #include "omdebug.h"
 
 #include <string>
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 using namespace std;
 
 namespace Xapian {
@@ -49,11 +54,124 @@ U_isupper(unsigned ch) {
     return (ch < 128 && C_isupper((unsigned char)ch));
 }
 
+/// Is ASCII character @a ch a word character?
+inline bool
+is_ascii_wordchar(unsigned char ch) {
+    // These are the only ASCII characters in the Unicode categories which
+    // Unicode::is_wordchar() accepts.
+    return C_isalnum(ch) || ch == '_';
+}
+
 inline unsigned check_wordchar(unsigned ch) {
+    if (ch < 128) {
+	// Avoid looking up the Unicode tables for ASCII characters.
+	return is_ascii_wordchar(ch) ? C_tolower(ch) : 0;
+    }
     if (Unicode::is_wordchar(ch)) return Unicode::tolower(ch);
     return 0;
 }
 
+#ifdef __SSE2__
+/** Classify 16 bytes at once.
+ *
+ *  @param v	The bytes to classify.
+ *  @param upper	Set to a mask of the bytes which are ASCII upper case
+ *			letters.
+ *
+ *  @return A mask of the bytes which are ASCII word characters.  Bytes
+ *	    with the top bit set compare as negative, so are never included.
+ */
+inline __m128i
+sse2_ascii_wordchars(__m128i v, __m128i & upper)
+{
+    upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+			  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+				  _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+				  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(upper, lower),
+			_mm_or_si128(digit, underscore));
+}
+
+/// Return the number of trailing one bits in @a mask.
+inline size_t
+count_trailing_ones(unsigned mask)
+{
+    size_t n = 0;
+    while (mask & 1) {
+	mask >>= 1;
+	++n;
+    }
+    return n;
+}
+#endif
+
+/** Append the run of ASCII word characters starting at @a p to @a term,
+ *  converted to lower case.
+ *
+ *  @return The number of bytes appended.
+ */
+static size_t
+append_ascii_word(string & term, const char * p, size_t len)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    while (len - i >= 16) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+	__m128i upper;
+	unsigned mask = _mm_movemask_epi8(sse2_ascii_wordchars(v, upper));
+	// Convert upper case letters to lower case by setting bit 5.
+	v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+	char buf[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(buf), v);
+	if (mask != 0xffff) {
+	    size_t n = count_trailing_ones(mask);
+	    term.append(buf, n);
+	    return i + n;
+	}
+	term.append(buf, 16);
+	i += 16;
+    }
+#endif
+    size_t start = i;
+    while (i < len && is_ascii_wordchar(p[i])) ++i;
+    size_t old_size = term.size();
+    term.append(p + start, i - start);
+    for (string::iterator j = term.begin() + old_size; j != term.end(); ++j)
+	*j = C_tolower(*j);
+    return i;
+}
+
+/** Return the length of the run of ASCII characters which aren't word
+ *  characters starting at @a p.
+ */
+static size_t
+skip_ascii_nonword(const char * p, size_t len)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    while (len - i >= 16) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+	__m128i upper;
+	// Bytes we stop at are word characters or have the top bit set.
+	unsigned mask = _mm_movemask_epi8(sse2_ascii_wordchars(v, upper)) |
+			_mm_movemask_epi8(v);
+	if (mask) {
+	    return i + count_trailing_ones(~mask);
+	}
+	i += 16;
+    }
+#endif
+    while (i < len) {
+	unsigned char ch = p[i];
+	if (ch >= 128 || is_ascii_wordchar(ch)) break;
+	++i;
+    }
+    return i;
+}
+
 inline bool
 should_stem(const std::string & term)
 {
@@ -133,17 +251,25 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount weight,
 
     if (!stopper) stop_mode = STOPWORDS_NONE;
 
+    // Reuse the same strings for each term to avoid reallocating them.
+    string term, stemmed, stem;
     while (true) {
 	// Advance to the start of the next term.
         unsigned ch;
         while (true) {
             if (itor == Utf8Iterator()) return;
+            // Skip runs of ASCII non-word characters in bulk.
+            size_t skip = skip_ascii_nonword(itor.raw(), itor.left());
+            if (skip) {
+                itor.assign(itor.raw() + skip, itor.left() - skip);
+                continue;
+            }
             ch = check_wordchar(*itor);
             if (ch) break;
             ++itor;
         }
 
-        string term;
+        term.resize(0);
         // Look for initials separated by '.' (e.g. P.T.O., U.N.C.L.E).
         // Don't worry if there's a trailing '.' or not.
         if (U_isupper(*itor)) {
@@ -168,9 +294,19 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount weight,
         while (true) {
             unsigned prevch;
             do {
-                Unicode::append_utf8(term, ch);
-                prevch = ch;
-                if (++itor == Utf8Iterator()) goto endofterm;
+                if (static_cast<unsigned char>(*itor.raw()) < 128) {
+                    // Handle a run of ASCII word characters in one go.
+                    const char * p = itor.raw();
+                    size_t left = itor.left();
+                    size_t n = append_ascii_word(term, p, left);
+                    prevch = static_cast<unsigned char>(term[term.size() - 1]);
+                    itor.assign(p + n, left - n);
+                    if (itor == Utf8Iterator()) goto endofterm;
+                } else {
+                    Unicode::append_utf8(term, ch);
+                    prevch = ch;
+                    if (++itor == Utf8Iterator()) goto endofterm;
+                }
                 ch = check_wordchar(*itor);
             } while (ch);
             
@@ -215,12 +351,14 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount weight,
         
         if (stop_mode == STOPWORDS_IGNORE && (*stopper)(term)) continue;
         
+        // Queue the postings rather than adding them one at a time - the
+        // document sorts and merges them in one go when they're needed.
         if (with_positions) {
             LOGLINE(DB, "add term to post list");
-            doc.add_posting(prefix + term, ++termpos, weight);
+            doc.internal->queue_posting(prefix, term, ++termpos, weight);
         } else {
             LOGLINE(DB, "add term to term list");
-            doc.add_term(prefix + term, weight);
+            doc.internal->queue_posting(prefix, term, 0, weight);
         }
         if ((flags & FLAG_SPELLING) && prefix.empty()) db.add_spelling(term);
         
@@ -234,11 +372,12 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount weight,
         if (!should_stem(term)) continue;
         
         // Add stemmed form without positional information.
-        string stem("Z");
+        stemmer.stem_word(term, stemmed);
+        stem.assign(1, 'Z');
         stem += prefix;
-        stem += stemmer(term);
+        stem += stemmed;
         LOGLINE(DB, "Add stem: " << stem << " to doc");
-        doc.add_term(stem, weight);
+        doc.internal->queue_posting(stem, 0, weight);
     }
 }
     
@@ -1,4 +1,4 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 #include "api_anydb.h"
 #include "api_backend.h"
 #include "api_closedb.h"
@@ -11,6 +11,7 @@
 #include "api_nodb.h"
 #include "api_none.h"
 #include "api_opsynonym.h"
+#include "api_opwildcard.h"
 #include "api_percentages.h"
 #include "api_posdb.h"
 #include "api_postingsource.h"
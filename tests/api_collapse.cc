@@ -24,7 +24,10 @@
 
 #include <xapian.h>
 
+#include <map>
+
 #include "apitest.h"
+#include "str.h"
 #include "testutils.h"
 
 using namespace std;
@@ -81,3 +84,49 @@ DEFINE_TESTCASE(collapsekey5,backend) {
 
     return true;
 }
+
+/// Test collapsing with many distinct collapse key values.
+DEFINE_TESTCASE(collapsekey6,writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (Xapian::docid did = 1; did <= 1000; ++did) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	// Give the documents differing weights.
+	doc.add_term("some", did % 7 + 1);
+	doc.add_value(0, str(did % 300));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("all"),
+				    Xapian::Query("some")));
+    enquire.set_collapse_key(0, 2);
+    Xapian::MSet mset = enquire.get_mset(0, 1000);
+    // Keys 1 to 100 have four documents, and the others three.
+    TEST_EQUAL(mset.size(), 600);
+    TEST_EQUAL(mset.get_matches_estimated(), 600);
+
+    map<string, Xapian::doccount> seen;
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	const string & key = i.get_collapse_key();
+	TEST_STRINGS_EQUAL(key, str(*i % 300));
+	TEST_EQUAL(i.get_collapse_count(), (*i % 300 <= 100 && *i % 300) ? 2 : 1);
+	++seen[key];
+    }
+    TEST_EQUAL(seen.size(), 300);
+    map<string, Xapian::doccount>::const_iterator j;
+    for (j = seen.begin(); j != seen.end(); ++j) {
+	TEST_EQUAL(j->second, 2);
+    }
+
+    // Check the collapse keys are set when the MSet is a subset.
+    mset = enquire.get_mset(10, 20);
+    TEST_EQUAL(mset.size(), 20);
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	TEST_STRINGS_EQUAL(i.get_collapse_key(), str(*i % 300));
+    }
+
+    return true;
+}
@@ -1,2 +1,3 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_collapsekey5();
+extern bool test_collapsekey6();
@@ -1,4 +1,4 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 
     if (!backend) {
 	static const test_desc tests[] = {
@@ -31,6 +31,7 @@
 	    { "emptymset1", test_emptymset1 },
 	    { "nosubdatabases1", test_nosubdatabases1 },
 	    { "document1", test_document1 },
+	    { "wildcard3", test_wildcard3 },
 	    { "queryterms1", test_queryterms1 },
 	    { "matchnothing1", test_matchnothing1 },
 	    { "nearsubqueries1", test_nearsubqueries1 },
@@ -44,6 +45,7 @@
 	    { "registry2", test_registry2 },
 	    { "registry3", test_registry3 },
 	    { "multivaluekeymaker1", test_multivaluekeymaker1 },
+	    { "fixedwidthkeymaker1", test_fixedwidthkeymaker1 },
 	    { "utf8iterator1", test_utf8iterator1 },
 	    { "utf8iterator2", test_utf8iterator2 },
 	    { "unicode1", test_unicode1 },
@@ -163,6 +165,7 @@
 	    { "synonym2", test_synonym2 },
 	    { "synonym3", test_synonym3 },
 	    { "synonym4", test_synonym4 },
+	    { "wildcard1", test_wildcard1 },
 	    { "consistency3", test_consistency3 },
 	    { "pctcutoff5", test_pctcutoff5 },
 	    { "topercent4", test_topercent4 },
@@ -197,6 +200,7 @@
 	    { "uuid1", test_uuid1 },
 	    { "rsetmultidb2", test_rsetmultidb2 },
 	    { "multiexpand1", test_multiexpand1 },
+	    { "wildcard2", test_wildcard2 },
 	    { "valuestream1", test_valuestream1 },
 	    { "valuemapsource2", test_valuemapsource2 },
 	    { "decvalwtsource4", test_decvalwtsource4 },
@@ -212,6 +216,8 @@
 	    { "consistency1", test_consistency1 },
 	    { "userweight1", test_userweight1 },
 	    { "valuesetmatchdecider2", test_valuesetmatchdecider2 },
+	    { "valuesetmatchdecider3", test_valuesetmatchdecider3 },
+	    { "valuesetmatchdecider4", test_valuesetmatchdecider4 },
 	    { "matchspy1", test_matchspy1 },
 	    { "externalsource4", test_externalsource4 },
 	    { "sortfunctor1", test_sortfunctor1 },
@@ -230,11 +236,27 @@
 	    { "externalsource1", test_externalsource1 },
 	    { "externalsource3", test_externalsource3 },
 	    { "changemaxweightsource1", test_changemaxweightsource1 },
+	    { "batchedsource1", test_batchedsource1 },
 	    { "emptyvalwtsource1", test_emptyvalwtsource1 },
 	    { 0, 0 }
 	};
 	result = max(result, test_driver::run(tests));
     }
+    if (brass) {
+	static const test_desc tests[] = {
+	    { "compacttermdict1", test_compacttermdict1 },
+	    { "compactspellingindex1", test_compactspellingindex1 },
+	    { "compactnumericcolumn1", test_compactnumericcolumn1 },
+	    { "compactreorder1", test_compactreorder1 },
+	    { "compactinlinedoclens1", test_compactinlinedoclens1 },
+	    { "replicate5", test_replicate5 },
+	    { "synonymcache1", test_synonymcache1 },
+	    { "valueindex1", test_valueindex1 },
+	    { "doclencache1", test_doclencache1 },
+	    { 0, 0 }
+	};
+	result = max(result, test_driver::run(tests));
+    }
     if (brass||chert||flint) {
 	static const test_desc tests[] = {
 	    { "lockfileumask1", test_lockfileumask1 },
@@ -320,6 +342,9 @@
     if (replicas) {
 	static const test_desc tests[] = {
 	    { "replicate1", test_replicate1 },
+	    { "replicate2", test_replicate2 },
+	    { "replicate3", test_replicate3 },
+	    { "replicate4", test_replicate4 },
 	    { 0, 0 }
 	};
 	result = max(result, test_driver::run(tests));
@@ -393,12 +418,16 @@
 	    { "doclenaftercommit1", test_doclenaftercommit1 },
 	    { "valuesaftercommit1", test_valuesaftercommit1 },
 	    { "replacedoc8", test_replacedoc8 },
+	    { "collapsekey6", test_collapsekey6 },
 	    { "matchspy2", test_matchspy2 },
 	    { "matchspy4", test_matchspy4 },
+	    { "matchspy7", test_matchspy7 },
+	    { "matchspy8", test_matchspy8 },
 	    { "metadata1", test_metadata1 },
 	    { "modtermwdf1", test_modtermwdf1 },
 	    { "bigoaddvalue1", test_bigoaddvalue1 },
 	    { "serialise_document2", test_serialise_document2 },
+	    { "sortfixedwidth1", test_sortfixedwidth1 },
 	    { "decvalwtsource1", test_decvalwtsource1 },
 	    { "decvalwtsource2", test_decvalwtsource2 },
 	    { "decvalwtsource3", test_decvalwtsource3 },
@@ -32,7 +32,9 @@
 
 #include <xapian.h>
 
+#include <cmath> // For HUGE_VAL.
 #include <cstdlib>
+#include <map>
 #include "safesyswait.h"
 
 #include "str.h"
@@ -169,27 +171,27 @@ DEFINE_TESTCASE(compactnorenumber1, brass || chert || flint) {
     // Should fail.
     rm_rf(out);
     status = system(cmd + a + b + out);
-    TEST_NOT_EQUAL(WEXITSTATUS(status), 0);
+    TEST(WEXITSTATUS(status) != 0);
  
     // Should fail.
     rm_rf(out);
     status = system(cmd + b + a + out);
-    TEST_NOT_EQUAL(WEXITSTATUS(status), 0);
+    TEST(WEXITSTATUS(status) != 0);
 
     // Should fail.
     rm_rf(out);
     status = system(cmd + a + b + d + out);
-    TEST_NOT_EQUAL(WEXITSTATUS(status), 0);
+    TEST(WEXITSTATUS(status) != 0);
  
     // Should fail.
     rm_rf(out);
     status = system(cmd + d + b + a + out);
-    TEST_NOT_EQUAL(WEXITSTATUS(status), 0);
+    TEST(WEXITSTATUS(status) != 0);
 
     // Should fail.
     rm_rf(out);
     status = system(cmd + b + a + d + out);
-    TEST_NOT_EQUAL(WEXITSTATUS(status), 0);
+    TEST(WEXITSTATUS(status) != 0);
 
     return true;
 }
@@ -252,3 +254,574 @@ DEFINE_TESTCASE(compactmultichunks1, brass || chert || flint) {
 
     return true;
 }
+
+/// Check the term frequencies and allterms of @a db match those of @a ref.
+static void
+check_same_terms(const Xapian::Database & ref, const Xapian::Database & db,
+		 const string & prefix)
+{
+    Xapian::TermIterator i = ref.allterms_begin(prefix);
+    Xapian::TermIterator j = db.allterms_begin(prefix);
+    while (i != ref.allterms_end(prefix)) {
+	TEST(j != db.allterms_end(prefix));
+	TEST_EQUAL(*i, *j);
+	TEST_EQUAL(i.get_termfreq(), j.get_termfreq());
+	TEST_EQUAL(ref.get_collection_freq(*i), db.get_collection_freq(*j));
+	TEST_EQUAL(ref.get_termfreq(*i), db.get_termfreq(*j));
+	TEST(db.term_exists(*j));
+	// Check the terms which follow are also found, but not matched exactly.
+	string after = *i + '\0';
+	TEST(!db.term_exists(after));
+	TEST_EQUAL(db.get_termfreq(after), 0);
+	TEST_EQUAL(db.get_collection_freq(after), 0);
+	++i;
+	++j;
+    }
+    TEST(j == db.allterms_end(prefix));
+}
+
+// Test xapian-compact --term-dictionary.
+DEFINE_TESTCASE(compacttermdict1, brass) {
+    int status;
+
+    string cmd = XAPIAN_COMPACT" "SILENT" --term-dictionary ";
+    string indbpath = get_database_path("etext") + ' ';
+    string outdbpath = get_named_writable_database_path("compacttermdict1out");
+    rm_rf(outdbpath);
+
+    status = system(cmd + indbpath + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/termdict"));
+
+    Xapian::Database indb(get_database("etext"));
+    Xapian::Database outdb(outdbpath);
+
+    const char * prefixes[] = { "", "t", "th", "the", "zzzzz", "\xff" };
+    for (size_t p = 0; p != sizeof(prefixes) / sizeof(prefixes[0]); ++p) {
+	check_same_terms(indb, outdb, prefixes[p]);
+    }
+    TEST(!outdb.term_exists("zzzzz"));
+    TEST(!outdb.term_exists("\x01"));
+
+    // Check skip_to().
+    Xapian::TermIterator t = outdb.allterms_begin();
+    t.skip_to("th");
+    TEST(t != outdb.allterms_end());
+    TEST_STRINGS_EQUAL(*t, *indb.allterms_begin("th"));
+    t.skip_to("a");
+    TEST_STRINGS_EQUAL(*t, *indb.allterms_begin("th"));
+    t.skip_to("zzzzz");
+    TEST(t == outdb.allterms_end());
+    t = outdb.allterms_begin("t");
+    t.skip_to("a");
+    TEST_STRINGS_EQUAL(*t, *indb.allterms_begin("t"));
+    t.skip_to("u");
+    TEST(t == outdb.allterms_end("t"));
+
+    // Once the database is modified, the term dictionary is out of date and
+    // should be ignored.
+    {
+	Xapian::WritableDatabase wdb(outdbpath, Xapian::DB_OPEN);
+	Xapian::Document doc;
+	doc.add_term("thzzz");
+	wdb.add_document(doc);
+	wdb.commit();
+    }
+    outdb.reopen();
+    TEST(outdb.term_exists("thzzz"));
+    TEST_EQUAL(outdb.get_termfreq("thzzz"), 1);
+    Xapian::Database db2(outdbpath);
+    TEST(db2.term_exists("thzzz"));
+    TEST_EQUAL(db2.get_termfreq("thzzz"), 1);
+
+    // Compacting a different database into the same directory without the
+    // option leaves the old term dictionary behind, possibly with a matching
+    // revision, so it should be ignored as it's for a different database.
+    string otherdbpath = get_database_path("apitest_simpledata");
+    status = system(XAPIAN_COMPACT" "SILENT" " + otherdbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/termdict"));
+    Xapian::Database otherdb(get_database("apitest_simpledata"));
+    Xapian::Database db3(outdbpath);
+    for (size_t p = 0; p != sizeof(prefixes) / sizeof(prefixes[0]); ++p) {
+	check_same_terms(otherdb, db3, prefixes[p]);
+    }
+
+    return true;
+}
+
+static void
+make_spelling_db(Xapian::WritableDatabase &db, const string &)
+{
+    db.add_spelling("hello");
+    db.add_spelling("cell", 2);
+    db.add_spelling("zig");
+    db.add_spelling("mathematics");
+    db.add_spelling("mathematical");
+    db.add_spelling("caf\xc3\xa9");
+    db.add_spelling("spelling");
+    db.add_spelling("spellings");
+    db.commit();
+}
+
+static void
+make_other_spelling_db(Xapian::WritableDatabase &db, const string &)
+{
+    db.add_spelling("spelunking");
+    db.add_spelling("elephant");
+    db.commit();
+}
+
+// Test the spelling index which compact can write.
+DEFINE_TESTCASE(compactspellingindex1, brass) {
+    int status;
+
+    string cmd = XAPIAN_COMPACT" "SILENT" --spelling-index ";
+    string indbpath = get_database_path("compactspellingindex1in",
+					make_spelling_db, "");
+    string outdbpath = get_named_writable_database_path("compactspellingindex1out");
+    rm_rf(outdbpath);
+
+    status = system(cmd + indbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/spelldel.DB"));
+
+    Xapian::Database indb(indbpath);
+    Xapian::Database outdb(outdbpath);
+
+    static const struct { const char * word; unsigned dist; const char * result; } tests[] = {
+	{ "hell", 2, "cell" },
+	{ "izg", 2, "zig" },
+	{ "mathmatics", 2, "mathematics" },
+	{ "mathematicak", 1, "mathematical" },
+	{ "cafe", 2, "caf\xc3\xa9" },
+	{ "speling", 2, "spelling" },
+	{ "spelinq", 2, "spelling" },
+	{ "spelinq", 1, "" },
+	{ "speling", 3, "spelling" },
+	{ "hello", 2, "" },
+	{ "xyzzy", 2, "" }
+    };
+    for (size_t i = 0; i != sizeof(tests) / sizeof(tests[0]); ++i) {
+	tout << tests[i].word << ' ' << tests[i].dist << '\n';
+	TEST_STRINGS_EQUAL(outdb.get_spelling_suggestion(tests[i].word,
+							 tests[i].dist),
+			   tests[i].result);
+	TEST_STRINGS_EQUAL(indb.get_spelling_suggestion(tests[i].word,
+							tests[i].dist),
+			   tests[i].result);
+    }
+
+    // With a sub-database without an index, the trigram lists are used for
+    // all of them.
+    Xapian::Database multidb(outdbpath);
+    multidb.add_database(indb);
+    TEST_STRINGS_EQUAL(multidb.get_spelling_suggestion("speling"), "spelling");
+
+    // Once the database is modified, the index is out of date and should be
+    // ignored.
+    {
+	Xapian::WritableDatabase wdb(outdbpath, Xapian::DB_OPEN);
+	wdb.add_spelling("zzzzz");
+	wdb.remove_spelling("spelling");
+	wdb.commit();
+    }
+    outdb.reopen();
+    TEST_STRINGS_EQUAL(outdb.get_spelling_suggestion("zzzzy"), "zzzzz");
+    TEST_STRINGS_EQUAL(outdb.get_spelling_suggestion("speling"), "spellings");
+    Xapian::Database db2(outdbpath);
+    TEST_STRINGS_EQUAL(db2.get_spelling_suggestion("zzzzy"), "zzzzz");
+
+    // Compacting a different database into the same directory without the
+    // option leaves the old index behind with a matching revision, so it
+    // should be ignored as it's for a different database.
+    rm_rf(outdbpath);
+    status = system(cmd + indbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    string otherdbpath = get_database_path("compactspellingindex1other",
+					   make_other_spelling_db, "");
+    status = system(XAPIAN_COMPACT" "SILENT" " + otherdbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/spelldel.DB"));
+    Xapian::Database db3(outdbpath);
+    TEST_STRINGS_EQUAL(db3.get_spelling_suggestion("speling"), "");
+    TEST_STRINGS_EQUAL(db3.get_spelling_suggestion("elepant"), "elephant");
+
+    return true;
+}
+
+static void
+make_numeric_db(Xapian::WritableDatabase &db, const string &)
+{
+    for (int i = 1; i <= 200; ++i) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	// Leave some documents without a value in slot 0.
+	if (i % 7 != 0)
+	    doc.add_value(0, Xapian::sortable_serialise((i * 37) % 101 - 50.5));
+	doc.add_value(1, "v" + str(i));
+	db.add_document(doc);
+    }
+    db.commit();
+}
+
+static void
+check_same_matches(Xapian::Database &db1, Xapian::Database &db2,
+		   const Xapian::Query &query)
+{
+    tout << query.get_description() << '\n';
+    Xapian::Enquire enq1(db1);
+    enq1.set_query(query);
+    Xapian::MSet mset1 = enq1.get_mset(0, 1000);
+    Xapian::Enquire enq2(db2);
+    enq2.set_query(query);
+    Xapian::MSet mset2 = enq2.get_mset(0, 1000);
+    TEST_EQUAL(mset1.size(), mset2.size());
+    Xapian::MSetIterator i1 = mset1.begin(), i2 = mset2.begin();
+    for ( ; i1 != mset1.end(); ++i1, ++i2) {
+	TEST_EQUAL(*i1, *i2);
+	TEST_EQUAL_DOUBLE(i1.get_weight(), i2.get_weight());
+    }
+}
+
+// Test the numeric value columns which compact can write.
+DEFINE_TESTCASE(compactnumericcolumn1, brass) {
+    int status;
+
+    string cmd = XAPIAN_COMPACT" "SILENT" --numeric-column=0 ";
+    string indbpath = get_database_path("compactnumericcolumn1in",
+					make_numeric_db, "");
+    string outdbpath = get_named_writable_database_path("compactnumericcolumn1out");
+    rm_rf(outdbpath);
+
+    status = system(cmd + indbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/column0"));
+
+    Xapian::Database indb(indbpath);
+    Xapian::Database outdb(outdbpath);
+
+    Xapian::ValueIterator v1 = indb.valuestream_begin(0);
+    Xapian::ValueIterator v2 = outdb.valuestream_begin(0);
+    for ( ; v1 != indb.valuestream_end(0); ++v1, ++v2) {
+	TEST(v2 != outdb.valuestream_end(0));
+	TEST_EQUAL(v1.get_docid(), v2.get_docid());
+	TEST_STRINGS_EQUAL(*v1, *v2);
+    }
+    TEST(v2 == outdb.valuestream_end(0));
+    v2 = outdb.valuestream_begin(0);
+    v2.skip_to(7);
+    TEST_EQUAL(v2.get_docid(), 8);
+    TEST(!v2.check(14));
+    // Checking the same document again should give the same answer.
+    TEST(!v2.check(14));
+    TEST(v2.check(15));
+    TEST_EQUAL(v2.get_docid(), 15);
+
+    using Xapian::Query;
+    using Xapian::sortable_serialise;
+    const Query all("all");
+    check_same_matches(indb, outdb,
+		       Query(Query::OP_VALUE_RANGE, 0, sortable_serialise(-10),
+			     sortable_serialise(20.5)));
+    check_same_matches(indb, outdb,
+		       Query(Query::OP_VALUE_GE, 0, sortable_serialise(30)));
+    check_same_matches(indb, outdb,
+		       Query(Query::OP_VALUE_LE, 0, sortable_serialise(-30)));
+    // A bound which isn't a serialised number is compared as a string.
+    check_same_matches(indb, outdb, Query(Query::OP_VALUE_GE, 0, "\xa0"));
+    check_same_matches(indb, outdb,
+		       Query(Query::OP_FILTER, all,
+			     Query(Query::OP_VALUE_RANGE, 0,
+				   sortable_serialise(0),
+				   sortable_serialise(50))));
+    Xapian::ValueWeightPostingSource source(0);
+    check_same_matches(indb, outdb, Query(&source));
+
+    // Compacting fails if a value isn't a serialised number.
+    string badoutdbpath = get_named_writable_database_path("compactnumericcolumn1bad");
+    rm_rf(badoutdbpath);
+    cmd = XAPIAN_COMPACT" "SILENT" --numeric-column=1 ";
+    status = system(cmd + indbpath + ' ' + badoutdbpath);
+    TEST(WEXITSTATUS(status) != 0);
+
+    // Once the database is modified, the column is out of date and should be
+    // ignored.
+    {
+	Xapian::WritableDatabase wdb(outdbpath, Xapian::DB_OPEN);
+	Xapian::Document doc;
+	doc.add_value(0, sortable_serialise(1000));
+	wdb.replace_document(1, doc);
+	wdb.commit();
+    }
+    Xapian::Database db2(outdbpath);
+    Xapian::Enquire enq(db2);
+    enq.set_query(Query(Query::OP_VALUE_GE, 0, sortable_serialise(999)));
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset.begin(), 1);
+
+    // Compacting a different database into the same directory without the
+    // option leaves the old column behind, possibly with a matching
+    // revision, so it should be ignored as it's for a different database.
+    string otherdbpath = get_database_path("apitest_simpledata");
+    status = system(XAPIAN_COMPACT" "SILENT" " + otherdbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/column0"));
+    Xapian::Database otherdb(get_database("apitest_simpledata"));
+    Xapian::Database db3(outdbpath);
+    check_same_matches(otherdb, db3,
+		       Query(Query::OP_VALUE_GE, 0, sortable_serialise(30)));
+    check_same_matches(otherdb, db3,
+		       Query(Query::OP_VALUE_LE, 0, sortable_serialise(30)));
+
+    return true;
+}
+
+static void
+make_prior_db(Xapian::WritableDatabase &db, const string &)
+{
+    for (int i = 1; i <= 1000; ++i) {
+	Xapian::Document doc;
+	doc.set_data(str(i));
+	doc.add_term("all");
+	if (i % 2 == 0) doc.add_term("even");
+	// Give each document a different prior, except for a few which have
+	// none.
+	if (i % 97 != 0)
+	    doc.add_value(0, Xapian::sortable_serialise((i * 7919) % 1000 + 0.5));
+	db.add_document(doc);
+    }
+    db.add_synonym("every", "all");
+    db.set_metadata("key", "value");
+    db.commit();
+}
+
+/// Check the top documents in two databases match, by their data.
+static void
+check_same_top_documents(Xapian::Database &db1, Xapian::Database &db2,
+			 const Xapian::Query &query)
+{
+    tout << query.get_description() << '\n';
+    Xapian::Enquire enq1(db1);
+    enq1.set_query(query);
+    Xapian::MSet mset1 = enq1.get_mset(0, 10);
+    Xapian::Enquire enq2(db2);
+    enq2.set_query(query);
+    Xapian::MSet mset2 = enq2.get_mset(0, 10);
+    TEST_EQUAL(mset1.size(), mset2.size());
+    Xapian::MSetIterator i1 = mset1.begin(), i2 = mset2.begin();
+    for ( ; i1 != mset1.end(); ++i1, ++i2) {
+	TEST_STRINGS_EQUAL(i1.get_document().get_data(),
+			   i2.get_document().get_data());
+	TEST_EQUAL_DOUBLE(i1.get_weight(), i2.get_weight());
+    }
+}
+
+// Test reordering documents by a value when compacting.
+DEFINE_TESTCASE(compactreorder1, brass) {
+    int status;
+
+    string cmd = XAPIAN_COMPACT" "SILENT" --numeric-column=0 --reorder-by-value=0 ";
+    string indbpath = get_database_path("compactreorder1in",
+					make_prior_db, "");
+    string outdbpath = get_named_writable_database_path("compactreorder1out");
+    rm_rf(outdbpath);
+
+    status = system(cmd + indbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(outdbpath + "/column0"));
+    TEST(!dir_exists(outdbpath + "/reorder.tmp"));
+
+    Xapian::Database indb(indbpath);
+    Xapian::Database outdb(outdbpath);
+    TEST_EQUAL(indb.get_doccount(), outdb.get_doccount());
+    TEST_EQUAL(outdb.get_lastdocid(), outdb.get_doccount());
+    TEST_EQUAL(indb.get_termfreq("even"), outdb.get_termfreq("even"));
+    TEST_STRINGS_EQUAL(outdb.get_metadata("key"), "value");
+    TEST(outdb.synonyms_begin("every") != outdb.synonyms_end("every"));
+
+    // The values should be in descending order, followed by the documents
+    // without one.
+    Xapian::ValueIterator v = outdb.valuestream_begin(0);
+    Xapian::docid did = 0;
+    double prev = HUGE_VAL;
+    for ( ; v != outdb.valuestream_end(0); ++v) {
+	TEST_EQUAL(v.get_docid(), ++did);
+	double d = Xapian::sortable_unserialise(*v);
+	TEST_REL(d,<,prev);
+	prev = d;
+    }
+    TEST_EQUAL(did, outdb.get_value_freq(0));
+    TEST_EQUAL(indb.get_value_freq(0), outdb.get_value_freq(0));
+
+    using Xapian::Query;
+    Xapian::ValueWeightPostingSource source(0);
+    check_same_top_documents(indb, outdb, Query(&source));
+    check_same_top_documents(indb, outdb,
+			     Query(Query::OP_AND, Query("even"), Query(&source)));
+    check_same_top_documents(indb, outdb,
+			     Query(Query::OP_OR, Query("even"), Query(&source)));
+    // The values now decrease with docid, so DecreasingValueWeightPostingSource
+    // should give the same results.
+    Xapian::DecreasingValueWeightPostingSource dsource(0);
+    Xapian::Enquire enq(outdb);
+    enq.set_query(Query(&source));
+    Xapian::MSet mset1 = enq.get_mset(0, 10);
+    enq.set_query(Query(&dsource));
+    Xapian::MSet mset2 = enq.get_mset(0, 10);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, 10));
+
+    // Reordering isn't supported with --no-renumber.
+    string badoutdbpath = get_named_writable_database_path("compactreorder1bad");
+    rm_rf(badoutdbpath);
+    cmd = XAPIAN_COMPACT" "SILENT" --no-renumber --reorder-by-value=0 ";
+    status = system(cmd + indbpath + ' ' + badoutdbpath);
+    TEST(WEXITSTATUS(status) != 0);
+
+    // If compaction fails after reordering, the temporary copy of the
+    // documents shouldn't be left in the output directory.  A file in the
+    // way of the donor database makes compaction fail at that point.
+    rm_rf(badoutdbpath);
+    mkdir(badoutdbpath.c_str(), 0755);
+    touch(badoutdbpath + "/donor.tmp");
+    cmd = XAPIAN_COMPACT" "SILENT" --reorder-by-value=0 ";
+    status = system(cmd + indbpath + ' ' + badoutdbpath);
+    TEST(WEXITSTATUS(status) != 0);
+    TEST(!dir_exists(badoutdbpath + "/reorder.tmp"));
+
+    return true;
+}
+
+static void
+make_doclens_db(Xapian::WritableDatabase &db, const string &)
+{
+    for (int i = 1; i <= 1000; ++i) {
+	Xapian::Document doc;
+	doc.set_data(str(i));
+	doc.add_term("all");
+	// Give the documents a wide range of lengths.
+	doc.add_term("filler", (i * 37) % 1000 + 1);
+	if (i % 3 == 0) doc.add_term("three", i % 7 + 1);
+	db.add_document(doc);
+    }
+    db.delete_document(500);
+    db.commit();
+}
+
+/// Run xapian-check on the database at @a path and check it passes.
+static void
+check_database(const string & path)
+{
+    string cmd = XAPIAN_BIN_PATH"xapian-check ";
+    cmd += path;
+    cmd += " "SILENT;
+    TEST_EQUAL(system(cmd.c_str()), 0);
+}
+
+/** Check the weights from @a db are close to the weights from @a ref.
+ *
+ *  @return true if any weight is different.
+ */
+static bool
+check_approx_weights(Xapian::Database & ref, Xapian::Database & db,
+		     const Xapian::Weight & wt)
+{
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("all"), Xapian::Query("three"));
+    Xapian::Enquire enq1(ref);
+    enq1.set_weighting_scheme(wt);
+    enq1.set_query(query);
+    Xapian::MSet mset1 = enq1.get_mset(0, ref.get_doccount());
+    Xapian::Enquire enq2(db);
+    enq2.set_weighting_scheme(wt);
+    enq2.set_query(query);
+    Xapian::MSet mset2 = enq2.get_mset(0, db.get_doccount());
+    TEST_EQUAL(mset1.size(), mset2.size());
+
+    map<string, Xapian::weight> weights;
+    Xapian::MSetIterator i;
+    for (i = mset1.begin(); i != mset1.end(); ++i) {
+	weights[i.get_document().get_data()] = i.get_weight();
+    }
+    bool differ = false;
+    for (i = mset2.begin(); i != mset2.end(); ++i) {
+	Xapian::weight w = weights[i.get_document().get_data()];
+	// The quantised lengths are rounded up, so the weights shouldn't be
+	// any higher.
+	TEST_REL(i.get_weight(),<=,w + 1e-9);
+	TEST_REL(i.get_weight(),>=,w * 0.95);
+	if (i.get_weight() != w) differ = true;
+    }
+    return differ;
+}
+
+// Test storing quantised document lengths in the postlists when compacting.
+DEFINE_TESTCASE(compactinlinedoclens1, brass) {
+    int status;
+
+    string cmd = XAPIAN_COMPACT" "SILENT" --inline-doclengths ";
+    string indbpath = get_database_path("compactinlinedoclens1in",
+					make_doclens_db, "");
+    string outdbpath = get_named_writable_database_path("compactinlinedoclens1out");
+    rm_rf(outdbpath);
+
+    status = system(cmd + indbpath + ' ' + outdbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    check_database(outdbpath);
+
+    Xapian::Database indb(indbpath);
+    {
+	Xapian::Database outdb(outdbpath);
+	TEST_EQUAL(indb.get_doccount(), outdb.get_doccount());
+	dbcheck(outdb, outdb.get_doccount(), outdb.get_lastdocid());
+	TEST(check_approx_weights(indb, outdb, Xapian::BM25Weight()));
+	TEST(check_approx_weights(indb, outdb, Xapian::TradWeight()));
+	// BoolWeight doesn't use the document length at all.
+	TEST(!check_approx_weights(indb, outdb, Xapian::BoolWeight()));
+    }
+
+    // Compacting again without the option should remove the lengths.
+    string out2dbpath = get_named_writable_database_path("compactinlinedoclens1out2");
+    rm_rf(out2dbpath);
+    status = system(XAPIAN_COMPACT" "SILENT" " + outdbpath + ' ' + out2dbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    check_database(out2dbpath);
+    {
+	Xapian::Database out2db(out2dbpath);
+	TEST(!check_approx_weights(indb, out2db, Xapian::BM25Weight()));
+    }
+
+    // Updating the compacted database should keep the lengths in step.
+    {
+	Xapian::WritableDatabase db(outdbpath, Xapian::DB_OPEN);
+	Xapian::Document doc;
+	doc.set_data("new");
+	doc.add_term("all");
+	doc.add_term("filler", 5000);
+	db.add_document(doc);
+	// Change the length of a document without changing its wdf for "all".
+	doc = db.get_document(1);
+	doc.add_term("extra", 400);
+	db.replace_document(1, doc);
+	db.delete_document(2);
+	db.commit();
+    }
+    check_database(outdbpath);
+
+    // The new document is longer than any the lengths were quantised for, so
+    // its exact length should be used.  Compare against a compacted copy
+    // without the lengths.
+    string out3dbpath = get_named_writable_database_path("compactinlinedoclens1out3");
+    rm_rf(out3dbpath);
+    status = system(XAPIAN_COMPACT" "SILENT" " + outdbpath + ' ' + out3dbpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    {
+	Xapian::Database outdb(outdbpath);
+	Xapian::Database out3db(out3dbpath);
+	(void)check_approx_weights(out3db, outdb, Xapian::BM25Weight());
+	(void)check_approx_weights(out3db, outdb, Xapian::TradWeight());
+    }
+
+    return true;
+}
@@ -1,4 +1,9 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_compactnorenumber1();
 extern bool test_compactmerge1();
 extern bool test_compactmultichunks1();
+extern bool test_compacttermdict1();
+extern bool test_compactspellingindex1();
+extern bool test_compactnumericcolumn1();
+extern bool test_compactreorder1();
+extern bool test_compactinlinedoclens1();
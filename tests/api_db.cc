@@ -1978,3 +1978,139 @@ DEFINE_TESTCASE(valuesetmatchdecider2, backend && !remote) {
 
     return true;
 }
+
+/// Calls another MatchDecider, so the matcher can't tell what it does.
+class WrappedMatchDecider : public Xapian::MatchDecider {
+    const Xapian::MatchDecider & decider;
+
+  public:
+    WrappedMatchDecider(const Xapian::MatchDecider & decider_)
+	: decider(decider_) { }
+
+    bool operator()(const Xapian::Document & doc) const {
+	return decider(doc);
+    }
+};
+
+/// Counts the calls to a ValueSetMatchDecider, but lets it filter by value.
+class CountingValueSetMatchDecider : public Xapian::MatchDecider {
+    const Xapian::ValueSetMatchDecider & decider;
+
+  public:
+    mutable unsigned calls;
+
+    CountingValueSetMatchDecider(const Xapian::ValueSetMatchDecider & decider_)
+	: decider(decider_), calls(0) { }
+
+    bool operator()(const Xapian::Document & doc) const {
+	++calls;
+	return decider(doc);
+    }
+
+    const Xapian::ValueSetMatchDecider * get_value_set_filter() const {
+	return &decider;
+    }
+};
+
+// Test that filtering by a ValueSetMatchDecider in the matcher gives the
+// same results as calling it for each document.
+DEFINE_TESTCASE(valuesetmatchdecider3, backend && !remote) {
+    Xapian::Database db(get_database("apitest_phrase"));
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("leav"));
+
+    Xapian::ValueSetMatchDecider vsmd1(1, true, true);
+    vsmd1.add_value("n");
+    vsmd1.add_value("i");
+    // Documents without a value are rejected by this one too.
+    Xapian::ValueSetMatchDecider vsmd2(1, false, true);
+    vsmd2.add_value("n");
+    vsmd2.add_value(string());
+    // But not by these.
+    Xapian::ValueSetMatchDecider vsmd3(1, false, true);
+    vsmd3.add_value("n");
+    Xapian::ValueSetMatchDecider vsmd4(1, true, true);
+    vsmd4.add_value("n");
+    vsmd4.add_value(string());
+
+    Xapian::ValueSetMatchDecider * deciders[] = {
+	&vsmd1, &vsmd2, &vsmd3, &vsmd4
+    };
+    for (size_t i = 0; i != sizeof(deciders) / sizeof(deciders[0]); ++i) {
+	tout << "decider " << i << endl;
+	for (int frozen = 0; frozen != 2; ++frozen) {
+	    if (frozen) deciders[i]->freeze();
+	    WrappedMatchDecider wrapped(*deciders[i]);
+	    Xapian::MSet mset1 = enq.get_mset(0, 20, 0, NULL, &wrapped);
+	    Xapian::MSet mset2 = enq.get_mset(0, 20, 0, NULL, deciders[i]);
+	    TEST_EQUAL(mset1.size(), mset2.size());
+	    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+	    TEST_REL(mset2.get_matches_lower_bound(),<=,mset2.size());
+	    TEST_REL(mset2.get_matches_upper_bound(),>=,mset2.size());
+	}
+    }
+    TEST_EQUAL(enq.get_mset(0, 20, 0, NULL, &vsmd1).size(), 2);
+
+    // Adding a value after freezing must still be noticed.
+    vsmd1.add_value("x");
+    WrappedMatchDecider wrapped(vsmd1);
+    Xapian::MSet mset1 = enq.get_mset(0, 20, 0, NULL, &wrapped);
+    Xapian::MSet mset2 = enq.get_mset(0, 20, 0, NULL, &vsmd1);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+
+    // The matcher should use get_value_set_filter() to filter by value rather
+    // than calling the decider, but only if it rejects documents without a
+    // value.
+    CountingValueSetMatchDecider counting(vsmd1);
+    mset2 = enq.get_mset(0, 20, 0, NULL, &counting);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+    TEST_EQUAL(counting.calls, 0);
+    CountingValueSetMatchDecider counting3(vsmd3);
+    WrappedMatchDecider wrapped3(vsmd3);
+    mset1 = enq.get_mset(0, 20, 0, NULL, &wrapped3);
+    mset2 = enq.get_mset(0, 20, 0, NULL, &counting3);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+    TEST_REL(counting3.calls,>,0);
+
+    return true;
+}
+
+/// Overrides operator() to accept every document, and counts the calls.
+class AcceptAllValueSetMatchDecider : public Xapian::ValueSetMatchDecider {
+  public:
+    mutable unsigned calls;
+
+    AcceptAllValueSetMatchDecider()
+	: Xapian::ValueSetMatchDecider(1, true), calls(0) {
+	add_value("n");
+	add_value("i");
+    }
+
+    bool operator()(const Xapian::Document &) const {
+	++calls;
+	return true;
+    }
+};
+
+// Test that the matcher still calls operator() of a subclass of
+// ValueSetMatchDecider rather than filtering by its values.
+DEFINE_TESTCASE(valuesetmatchdecider4, backend && !remote) {
+    Xapian::Database db(get_database("apitest_phrase"));
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("leav"));
+
+    Xapian::MSet mset1 = enq.get_mset(0, 20);
+    AcceptAllValueSetMatchDecider decider;
+    Xapian::MSet mset2 = enq.get_mset(0, 20, 0, NULL, &decider);
+    TEST_REL(decider.calls,>,0);
+    TEST_EQUAL(mset1.size(), mset2.size());
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+
+    decider.freeze();
+    decider.calls = 0;
+    mset2 = enq.get_mset(0, 20, 0, NULL, &decider);
+    TEST_REL(decider.calls,>,0);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+
+    return true;
+}
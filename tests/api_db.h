@@ -1,4 +1,4 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_termstats();
 extern bool test_stubdb1();
 extern bool test_stubdb2();
@@ -50,3 +50,5 @@ extern bool test_netstats1();
 extern bool test_userweight1();
 extern bool test_matchall1();
 extern bool test_valuesetmatchdecider2();
+extern bool test_valuesetmatchdecider3();
+extern bool test_valuesetmatchdecider4();
@@ -332,6 +332,139 @@ DEFINE_TESTCASE(matchspy5, backend)
     return true;
 }
 
+// Test ValueCountMatchSpy with many distinct values, and reused for a second
+// match after its results have been read.
+DEFINE_TESTCASE(matchspy7, writable)
+{
+    Xapian::WritableDatabase db = get_writable_database();
+    map<string, Xapian::doccount> expected_freqs;
+    for (int c = 1; c <= 200; ++c) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	// 100 values which occur once each, and 4 which occur 25 times each.
+	string value = (c <= 100) ? "u" + str(c) : "v" + str(c % 4);
+	doc.add_value(0, value);
+	++expected_freqs[value];
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("all"));
+    Xapian::ValueCountMatchSpy spy(0);
+    enquire.add_matchspy(&spy);
+    (void)enquire.get_mset(0, 10);
+    TEST_EQUAL(spy.get_total(), 200);
+
+    string top;
+    for (Xapian::TermIterator i = spy.top_values_begin(5);
+	 i != spy.top_values_end(5); ++i) {
+	top += *i;
+	top += ':';
+	top += str(i.get_termfreq());
+	top += '|';
+    }
+    TEST_STRINGS_EQUAL(top, "v0:25|v1:25|v2:25|v3:25|u1:1|");
+
+    string expect = "|";
+    map<string, Xapian::doccount>::const_iterator j;
+    for (j = expected_freqs.begin(); j != expected_freqs.end(); ++j) {
+	expect += j->first + ':' + str(j->second) + '|';
+    }
+    TEST_STRINGS_EQUAL(values_to_repr(spy), expect);
+
+    // Run the match again, so the new counts have to be combined with those
+    // already read.
+    (void)enquire.get_mset(0, 10);
+    TEST_EQUAL(spy.get_total(), 400);
+    Xapian::TermIterator i = spy.top_values_begin(1);
+    TEST(i != spy.top_values_end(1));
+    TEST_STRINGS_EQUAL(*i, "v0");
+    TEST_EQUAL(i.get_termfreq(), 50);
+
+    return true;
+}
+
+static string
+top_values_to_repr(Xapian::TermIterator i, const Xapian::TermIterator & end)
+{
+    string resultrepr("|");
+    for ( ; i != end; ++i) {
+	resultrepr += *i;
+	resultrepr += ':';
+	resultrepr += str(i.get_termfreq());
+	resultrepr += '|';
+    }
+    return resultrepr;
+}
+
+// Test MultiValueCountMatchSpy gives the same results as ValueCountMatchSpy,
+// and test its sampling.
+DEFINE_TESTCASE(matchspy8, writable)
+{
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int c = 1; c <= 25; ++c) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	doc.add_value(0, str(c % 3));
+	doc.add_value(1, str(c % 10));
+	doc.add_value(2, "fish");
+	if (c % 2) doc.add_value(3, str(c % 7));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("all"));
+
+    vector<Xapian::valueno> slots;
+    slots.push_back(3);
+    slots.push_back(0);
+    slots.push_back(1);
+    slots.push_back(2);
+    Xapian::MultiValueCountMatchSpy multi(slots.begin(), slots.end());
+    enquire.add_matchspy(&multi);
+    vector<Xapian::ValueCountMatchSpy *> singles;
+    for (size_t i = 0; i != slots.size(); ++i) {
+	singles.push_back(new Xapian::ValueCountMatchSpy(slots[i]));
+	enquire.add_matchspy(singles.back());
+    }
+    (void)enquire.get_mset(0, 10);
+
+    TEST_EQUAL(multi.get_total(), 25);
+    TEST_EQUAL(multi.get_counted(), 25);
+    for (size_t i = 0; i != slots.size(); ++i) {
+	Xapian::valueno slot = slots[i];
+	tout << "slot " << slot << endl;
+	TEST_STRINGS_EQUAL(top_values_to_repr(multi.values_begin(slot),
+					      multi.values_end(slot)),
+			   values_to_repr(*singles[i]));
+	TEST_STRINGS_EQUAL(top_values_to_repr(multi.top_values_begin(slot, 3),
+					      multi.top_values_end(slot, 3)),
+			   top_values_to_repr(singles[i]->top_values_begin(3),
+					      singles[i]->top_values_end(3)));
+	delete singles[i];
+    }
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, multi.values_begin(4));
+
+    // Only count the first 10 documents seen, and check the frequencies are
+    // scaled up to estimate the totals.
+    Xapian::MultiValueCountMatchSpy sampled;
+    sampled.add_slot(2);
+    sampled.add_slot(2);
+    sampled.set_sample_size(10);
+    enquire.clear_matchspies();
+    enquire.add_matchspy(&sampled);
+    (void)enquire.get_mset(0, 10);
+    TEST_EQUAL(sampled.get_total(), 25);
+    TEST_EQUAL(sampled.get_counted(), 10);
+    TEST_STRINGS_EQUAL(top_values_to_repr(sampled.values_begin(2),
+					  sampled.values_end(2)),
+		       "|fish:25|");
+
+    return true;
+}
+
 class MySpy : public Xapian::MatchSpy {
     void operator()(const Xapian::Document &, Xapian::weight) {
     }
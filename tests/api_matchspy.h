@@ -1,6 +1,8 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_matchspy1();
 extern bool test_matchspy2();
 extern bool test_matchspy4();
 extern bool test_matchspy5();
+extern bool test_matchspy7();
+extern bool test_matchspy8();
 extern bool test_matchspy6();
@@ -465,6 +465,21 @@ DEFINE_TESTCASE(valuesetmatchdecider1, !backend) {
     TEST(!vsmd2(doc));
     TEST(vsmd3(doc));
 
+    // Check that freezing doesn't change the results.
+    vsmd1.freeze();
+    vsmd2.freeze();
+    vsmd3.freeze();
+    TEST(vsmd1(doc));
+    TEST(!vsmd2(doc));
+    TEST(vsmd3(doc));
+    doc.add_value(0, "blah");
+    TEST(!vsmd1(doc));
+    TEST(vsmd2(doc));
+    TEST(!vsmd3(doc));
+    // Adding a value should unfreeze the decider.
+    vsmd3.add_value("blah");
+    TEST(vsmd3(doc));
+
     return true;
 }
 
@@ -0,0 +1,199 @@
+/** @file api_opwildcard.cc
+ * @brief tests of OP_WILDCARD.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "api_opwildcard.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include <xapian.h>
+
+#include "backendmanager.h"
+#include "testsuite.h"
+#include "testutils.h"
+
+#include "apitest.h"
+
+using namespace std;
+
+/// Build an OP_SYNONYM query of @a terms.
+static Xapian::Query
+synonym_of(const vector<string> & terms)
+{
+    return Xapian::Query(Xapian::Query::OP_SYNONYM, terms.begin(), terms.end());
+}
+
+/// Check two MSets contain the same documents, ignoring order.
+static void
+check_same_docs(const Xapian::MSet & mset1, const Xapian::MSet & mset2)
+{
+    TEST_EQUAL(mset1.size(), mset2.size());
+    set<Xapian::docid> docids;
+    for (Xapian::MSetIterator i = mset1.begin(); i != mset1.end(); ++i) {
+	docids.insert(*i);
+    }
+    for (Xapian::MSetIterator j = mset2.begin(); j != mset2.end(); ++j) {
+	TEST(docids.erase(*j));
+    }
+}
+
+/// Run @a query and the OP_SYNONYM of @a terms and check they match the same.
+static void
+check_matches_synonym(Xapian::Enquire & enquire, const Xapian::Query & query,
+		      const vector<string> & terms)
+{
+    Xapian::doccount n = enquire.get_mset(0, 0).get_matches_upper_bound();
+    n += 10;
+
+    enquire.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, n);
+    tout << query << '\n' << mset << '\n';
+    enquire.set_query(synonym_of(terms));
+    Xapian::MSet expected = enquire.get_mset(0, n);
+    tout << synonym_of(terms) << '\n' << expected << '\n';
+    check_same_docs(mset, expected);
+
+    // Weighted, the term frequency estimates are combined in a different
+    // order, so the weights can differ slightly, but unweighted the results
+    // should be identical.
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_SCALE_WEIGHT, query, 0));
+    mset = enquire.get_mset(0, n);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_SCALE_WEIGHT,
+				    synonym_of(terms), 0));
+    expected = enquire.get_mset(0, n);
+    TEST(mset_range_is_same(mset, 0, expected, 0, mset.size()));
+}
+
+// Check OP_WILDCARD matches the same as the OP_SYNONYM of its expansion.
+DEFINE_TESTCASE(wildcard1, backend) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::Enquire enquire(db);
+
+    const char * patterns[] = { "ho", "wa", "zzz", "t" };
+    for (size_t p = 0; p != sizeof(patterns) / sizeof(patterns[0]); ++p) {
+	vector<string> terms(db.allterms_begin(patterns[p]),
+			     db.allterms_end(patterns[p]));
+	Xapian::Query query(Xapian::Query::OP_WILDCARD, patterns[p]);
+	enquire.set_query(query);
+	if (terms.empty()) {
+	    TEST(enquire.get_mset(0, 10).empty());
+	    continue;
+	}
+	check_matches_synonym(enquire, query, terms);
+    }
+
+    // Check that OP_WILDCARD works as a subquery of OP_SYNONYM and OP_AND.
+    vector<string> terms(db.allterms_begin("ho"), db.allterms_end("ho"));
+    terms.insert(terms.end(), db.allterms_begin("wa"), db.allterms_end("wa"));
+    sort(terms.begin(), terms.end());
+    check_matches_synonym(enquire,
+			  Xapian::Query(Xapian::Query::OP_SYNONYM,
+					Xapian::Query(Xapian::Query::OP_WILDCARD, "ho"),
+					Xapian::Query(Xapian::Query::OP_WILDCARD, "wa")),
+			  terms);
+
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_AND,
+				    Xapian::Query(Xapian::Query::OP_WILDCARD, "ho"),
+				    Xapian::Query("the")));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST(!mset.empty());
+
+    return true;
+}
+
+// Check the expansion limits of OP_WILDCARD.  With multiple databases, the
+// limit applies to each one separately, so the results differ.
+DEFINE_TESTCASE(wildcard2, backend && !multi) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::Enquire enquire(db);
+
+    vector<string> all_terms(db.allterms_begin("t"), db.allterms_end("t"));
+    TEST_REL(all_terms.size(), >, 5);
+
+    // WILDCARD_LIMIT_FIRST should pick the first terms.
+    vector<string> terms(all_terms.begin(), all_terms.begin() + 5);
+    check_matches_synonym(enquire,
+			  Xapian::Query(Xapian::Query::OP_WILDCARD, "t", 5,
+					Xapian::Query::WILDCARD_LIMIT_FIRST),
+			  terms);
+
+    // WILDCARD_LIMIT_MOST_FREQUENT should pick the most frequent terms.
+    vector<pair<Xapian::doccount, string> > by_freq;
+    for (Xapian::TermIterator t = db.allterms_begin("t");
+	 t != db.allterms_end("t"); ++t) {
+	// Negate the frequency so that ties are broken by the term.
+	by_freq.push_back(make_pair(Xapian::doccount(-t.get_termfreq()), *t));
+    }
+    sort(by_freq.begin(), by_freq.end());
+    terms.clear();
+    for (size_t i = 0; i != 5; ++i) terms.push_back(by_freq[i].second);
+    sort(terms.begin(), terms.end());
+    check_matches_synonym(enquire,
+			  Xapian::Query(Xapian::Query::OP_WILDCARD, "t", 5,
+					Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT),
+			  terms);
+
+    // A limit which isn't exceeded shouldn't have any effect.
+    Xapian::termcount n = all_terms.size();
+    check_matches_synonym(enquire,
+			  Xapian::Query(Xapian::Query::OP_WILDCARD, "t", n),
+			  all_terms);
+
+    // WILDCARD_LIMIT_ERROR should throw WildcardError if the limit is
+    // exceeded.
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_WILDCARD, "t", n - 1));
+    TEST_EXCEPTION(Xapian::WildcardError, enquire.get_mset(0, 10));
+
+    return true;
+}
+
+// Check the description and serialisation of OP_WILDCARD.
+DEFINE_TESTCASE(wildcard3, !backend) {
+    Xapian::Query q(Xapian::Query::OP_WILDCARD, "foo");
+    TEST_STRINGS_EQUAL(q.get_description(), "Xapian::Query(WILDCARD foo)");
+    TEST_EQUAL(q.get_length(), 1);
+    TEST(q.get_terms_begin() == q.get_terms_end());
+
+    q = Xapian::Query(Xapian::Query::OP_WILDCARD, "foo", 10,
+		      Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT, 2);
+    TEST_STRINGS_EQUAL(q.get_description(),
+		       "Xapian::Query(WILDCARD 10 MOST_FREQUENT foo:(pos=2))");
+
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    q = Xapian::Query(Xapian::Query::OP_OR, q,
+		      Xapian::Query(Xapian::Query::OP_WILDCARD, "bar", 3,
+				    Xapian::Query::WILDCARD_LIMIT_FIRST));
+    Xapian::Query q2 = Xapian::Query::unserialise(q.serialise());
+    TEST_STRINGS_EQUAL(q.get_description(), q2.get_description());
+    TEST_STRINGS_EQUAL(q.serialise(), q2.serialise());
+#endif
+
+    // OP_WILDCARD can't be used within a phrase.
+    vector<Xapian::Query> subqs;
+    subqs.push_back(Xapian::Query("a"));
+    subqs.push_back(Xapian::Query(Xapian::Query::OP_WILDCARD, "b"));
+    TEST_EXCEPTION(Xapian::UnimplementedError,
+		   Xapian::Query(Xapian::Query::OP_PHRASE,
+				 subqs.begin(), subqs.end()));
+
+    return true;
+}
@@ -0,0 +1,4 @@
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
+extern bool test_wildcard1();
+extern bool test_wildcard2();
+extern bool test_wildcard3();
@@ -547,6 +547,107 @@ DEFINE_TESTCASE(changemaxweightsource1, backend && !remote && !multi) {
     return true;
 }
 
+/// A posting source which weights documents by their docid modulo 5.
+class ModWeightPostingSource : public Xapian::PostingSource {
+  protected:
+    Xapian::docid last_docid;
+
+    Xapian::docid did;
+
+    Xapian::weight calc_weight(Xapian::docid d) const { return d % 5 + 1; }
+
+  public:
+    ModWeightPostingSource() : last_docid(0), did(0) { }
+
+    void init(const Xapian::Database & db) {
+	last_docid = db.get_lastdocid();
+	did = 0;
+	set_maxweight(5);
+    }
+
+    Xapian::doccount get_termfreq_min() const { return last_docid; }
+
+    Xapian::doccount get_termfreq_est() const { return last_docid; }
+
+    Xapian::doccount get_termfreq_max() const { return last_docid; }
+
+    Xapian::weight get_weight() const { return calc_weight(did); }
+
+    void next(Xapian::weight) { ++did; }
+
+    void skip_to(Xapian::docid to_did, Xapian::weight) {
+	if (to_did > did) did = to_did;
+    }
+
+    bool at_end() const { return did > last_docid; }
+
+    Xapian::docid get_docid() const { return did; }
+
+    string get_description() const { return "ModWeightPostingSource"; }
+};
+
+/// ModWeightPostingSource, returning documents in batches.
+class BatchedModWeightPostingSource : public ModWeightPostingSource {
+  public:
+    Xapian::doccount get_batch_size() const { return 3; }
+
+    Xapian::doccount next_batch(Xapian::weight,
+				Xapian::docid * docids,
+				Xapian::weight * weights,
+				Xapian::doccount n) {
+	Xapian::doccount i = 0;
+	while (i != n && did < last_docid) {
+	    ++did;
+	    docids[i] = did;
+	    weights[i] = calc_weight(did);
+	    ++i;
+	}
+	return i;
+    }
+
+    void next(Xapian::weight) {
+	FAIL_TEST("next() called on a batched PostingSource");
+    }
+};
+
+/// Check that a batched PostingSource gives the same results as an unbatched one.
+DEFINE_TESTCASE(batchedsource1, backend && !remote && !multi) {
+    Xapian::Database db(get_database("apitest_phrase"));
+    Xapian::Enquire enq(db);
+    ModWeightPostingSource src;
+    BatchedModWeightPostingSource batched_src;
+
+    Xapian::Query::op ops[] = {
+	Xapian::Query::OP_OR,
+	Xapian::Query::OP_AND,
+	Xapian::Query::OP_AND_MAYBE,
+	Xapian::Query::OP_FILTER
+    };
+    for (size_t i = 0; i != sizeof(ops) / sizeof(ops[0]); ++i) {
+	tout << "op " << ops[i] << endl;
+	enq.set_query(Xapian::Query(ops[i], Xapian::Query("leav"),
+				    Xapian::Query(&src)));
+	Xapian::MSet mset1 = enq.get_mset(0, 5);
+	enq.set_query(Xapian::Query(ops[i], Xapian::Query("leav"),
+				    Xapian::Query(&batched_src)));
+	Xapian::MSet mset2 = enq.get_mset(0, 5);
+	TEST(!mset1.empty());
+	TEST_EQUAL(mset1.size(), mset2.size());
+	TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+	TEST_EQUAL_DOUBLE(mset1.get_max_possible(), mset2.get_max_possible());
+    }
+
+    enq.set_query(Xapian::Query(&src));
+    Xapian::MSet mset1 = enq.get_mset(0, 10);
+    enq.set_query(Xapian::Query(&batched_src));
+    Xapian::MSet mset2 = enq.get_mset(0, 10);
+    TEST_EQUAL(mset1.size(), 10);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, 10));
+    TEST_EQUAL(mset1.get_matches_estimated(), mset2.get_matches_estimated());
+
+    return true;
+}
+
 // Test using a valueweightpostingsource which has no entries.
 DEFINE_TESTCASE(emptyvalwtsource1, backend && !remote && !multi) {
     Xapian::Database db(get_database("apitest_phrase"));
@@ -1,4 +1,4 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_externalsource1();
 extern bool test_externalsource2();
 extern bool test_externalsource3();
@@ -8,4 +8,5 @@ extern bool test_valueweightsource2();
 extern bool test_valueweightsource3();
 extern bool test_fixedweightsource1();
 extern bool test_changemaxweightsource1();
+extern bool test_batchedsource1();
 extern bool test_emptyvalwtsource1();
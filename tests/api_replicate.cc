@@ -26,9 +26,14 @@
 #include <xapian.h>
 
 #include "apitest.h"
+#include "backendmanager.h" // For XAPIAN_BIN_PATH.
+#include "safedirent.h"
 #include "safeerrno.h"
 #include "safefcntl.h"
 #include "safesysstat.h"
+#include "safesyswait.h"
+#include "safeunistd.h"
+#include "stringutils.h"
 #include "testsuite.h"
 #include "testutils.h"
 #include "utils.h"
@@ -37,6 +42,18 @@
 #include <cstdlib>
 #include <string>
 
+#ifndef __WIN32__
+# include <sys/socket.h>
+#endif
+
+#define XAPIAN_COMPACT XAPIAN_BIN_PATH"xapian-compact"
+
+#ifndef __WIN32__
+# define SILENT ">/dev/null 2>&1"
+#else
+# define SILENT ">nul 2>nul"
+#endif
+
 using namespace std;
 
 static void rmtmpdir(const string & path) {
@@ -50,6 +67,21 @@ static void mktmpdir(const string & path) {
     }
 }
 
+// Count the directories of changeset links in a master database directory.
+static int
+count_links_dirs(const string & path)
+{
+    DIR * dir = opendir(path.c_str());
+    if (dir == NULL) FAIL_TEST("Can't open directory '" + path + "'");
+    int count = 0;
+    struct dirent * entry;
+    while ((entry = readdir(dir)) != NULL) {
+	if (startswith(entry->d_name, "replicate.")) ++count;
+    }
+    closedir(dir);
+    return count;
+}
+
 // Replicate from the master to the replica.
 // Returns the number of changsets which were applied.
 static int
@@ -58,7 +90,9 @@ replicate(Xapian::DatabaseMaster & master,
 	  const string & tempdir,
 	  int expected_changesets,
 	  int expected_fullcopies,
-	  bool expected_changed)
+	  bool expected_changed,
+	  const string & block_checksums = string(),
+	  bool compress = false)
 {
     string changesetpath = tempdir + "/changeset";
     int fd = open(changesetpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
@@ -67,14 +101,25 @@ replicate(Xapian::DatabaseMaster & master,
 		  + changesetpath + "')");
     }
     Xapian::ReplicationInfo info1;
-    master.write_changesets_to_fd(fd, replica.get_revision_info(), &info1);
+    master.write_changesets_to_fd(fd, replica.get_revision_info(), &info1,
+				  block_checksums, compress);
 
     TEST_EQUAL(info1.changeset_count, expected_changesets);
     TEST_EQUAL(info1.fullcopy_count, expected_fullcopies);
     TEST_EQUAL(info1.changed, expected_changed);
+    if (expected_fullcopies == 0) {
+	// Each commit in these tests produces a single changeset.
+	TEST_EQUAL(info1.revision_lag, expected_changesets);
+    }
 
     close(fd);
 
+    // Check that every byte written was accounted for.
+    struct stat sb;
+    TEST(stat(changesetpath.c_str(), &sb) == 0);
+    TEST_EQUAL(info1.bytes_transferred, sb.st_size);
+    off_t bytes_received = 0;
+
     fd = open(changesetpath.c_str(), O_RDONLY);
     if (fd == -1) {
 	FAIL_TEST("Open failed (when reading changeset file at '"
@@ -89,21 +134,66 @@ replicate(Xapian::DatabaseMaster & master,
 	++count;
 	info1.changeset_count -= info2.changeset_count;
 	info1.fullcopy_count -= info2.fullcopy_count;
+	bytes_received += info2.bytes_transferred;
 	if (info2.changed)
 	    client_changed = true;
     }
     info1.changeset_count -= info2.changeset_count;
     info1.fullcopy_count -= info2.fullcopy_count;
+    bytes_received += info2.bytes_transferred;
     if (info2.changed)
 	client_changed = true;
     close(fd);
 
+    TEST_EQUAL(bytes_received, sb.st_size);
     TEST_EQUAL(info1.changeset_count, 0);
     TEST_EQUAL(info1.fullcopy_count, 0);
     TEST_EQUAL(info1.changed, client_changed);
     return count;
 }
 
+#ifndef __WIN32__
+// Replicate from the master to the replica over a socket, so the master can
+// ask the replica for block checksums if it needs to send a full copy.
+static Xapian::ReplicationInfo
+replicate_over_socket(Xapian::DatabaseMaster & master,
+		      Xapian::DatabaseReplica & replica)
+{
+    int fds[2];
+    TEST(socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, fds) == 0);
+    string revision = replica.get_revision_info();
+    pid_t child = fork();
+    if (child == 0) {
+	close(fds[0]);
+	try {
+	    master.write_changesets_to_socket(fds[1], revision, NULL);
+	} catch (...) {
+	    _exit(1);
+	}
+	_exit(0);
+    }
+    close(fds[1]);
+    TEST(child != -1);
+
+    replica.set_read_fd(fds[0]);
+    Xapian::ReplicationInfo info;
+    Xapian::ReplicationInfo subinfo;
+    bool more;
+    do {
+	more = replica.apply_next_changeset(&subinfo);
+	info.changeset_count += subinfo.changeset_count;
+	info.fullcopy_count += subinfo.fullcopy_count;
+	info.bytes_transferred += subinfo.bytes_transferred;
+    } while (more);
+    close(fds[0]);
+
+    int status;
+    TEST_EQUAL(waitpid(child, &status, 0), child);
+    TEST(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    return info;
+}
+#endif
+
 // Check that the databases held at the given path are identical.
 static void
 check_equal_dbs(const string & path1, const string & path2)
@@ -185,9 +275,347 @@ DEFINE_TESTCASE(replicate1, replicas) {
 
     check_equal_dbs(masterpath, replicapath);
 
+    // The links made to pin the changesets while sending them should have
+    // been removed.
+    TEST_EQUAL(count_links_dirs(masterpath), 0);
+
+#ifndef __WIN32__
+    // A links directory left behind by a process which died should be
+    // removed the next time changesets are sent.
+    pid_t child = fork();
+    if (child == 0) _exit(0);
+    TEST(child != -1);
+    TEST_EQUAL(waitpid(child, NULL, 0), child);
+    string stale_dir = masterpath + "/replicate." + om_tostring(child) + ".x";
+    TEST(mkdir(stale_dir, 0700) == 0);
+    touch(stale_dir + "/changes1");
+
+    orig.add_document(doc1);
+    orig.commit();
+    count = replicate(master, replica, tempdir, 1, 0, 1);
+    TEST_EQUAL(count, 2);
+    TEST_EQUAL(count_links_dirs(masterpath), 0);
+#endif
+
     // Need to close the replica before we remove the temporary directory on
     // Windows.
     replica.close();
     rmtmpdir(tempdir);
     return true;
 }
+
+// Test that a full copy using block checksums only sends changed blocks.
+DEFINE_TESTCASE(replicate2, replicas) {
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    // Don't keep changesets, so every update needs a full copy.
+#ifdef __WIN32__
+    _putenv("XAPIAN_MAX_CHANGESETS=0");
+#else
+    setenv("XAPIAN_MAX_CHANGESETS", "0", 1);
+#endif
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+
+    for (int i = 0; i < 1000; ++i) {
+	Xapian::Document doc;
+	doc.set_data(string(100, 'x') + om_tostring(i));
+	doc.add_posting("term" + om_tostring(i), 1);
+	doc.add_posting("common", 1);
+	orig.add_document(doc);
+    }
+    orig.commit();
+
+    int count = replicate(master, replica, tempdir, 0, 1, 1);
+    TEST_EQUAL(count, 1);
+    check_equal_dbs(masterpath, replicapath);
+
+    Xapian::Document doc;
+    doc.set_data("extra");
+    doc.add_posting("extra", 1);
+    orig.add_document(doc);
+    orig.commit();
+
+    // Find out how much a full copy without checksums would send.
+    off_t full_size;
+    {
+	string fullpath = tempdir + "/full";
+	int fd = open(fullpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	TEST(fd != -1);
+	Xapian::ReplicationInfo info;
+	master.write_changesets_to_fd(fd, replica.get_revision_info(), &info);
+	close(fd);
+	TEST_EQUAL(info.fullcopy_count, 1);
+	full_size = info.bytes_transferred;
+    }
+
+    string checksums = replica.get_block_checksums();
+    TEST(!checksums.empty());
+    string changesetpath = tempdir + "/changeset";
+    count = replicate(master, replica, tempdir, 0, 1, 1, checksums);
+    TEST_EQUAL(count, 1);
+    struct stat sb;
+    TEST(stat(changesetpath.c_str(), &sb) == 0);
+    tout << "full copy " << full_size << " bytes, delta copy "
+	 << sb.st_size << " bytes" << endl;
+    TEST_REL(sb.st_size, <, full_size / 2);
+
+    check_equal_dbs(masterpath, replicapath);
+    {
+	Xapian::Database dbcopy(replicapath);
+	TEST_EQUAL(orig.get_uuid(), dbcopy.get_uuid());
+	TEST_EQUAL(dbcopy.get_termfreq("common"), 1000);
+	TEST_EQUAL(dbcopy.get_termfreq("extra"), 1);
+	TEST_EQUAL(dbcopy.get_document(1001).get_data(), "extra");
+    }
+
+    // The checksums are now stale, so the replica should refuse a delta
+    // against them.
+    orig.add_document(doc);
+    orig.commit();
+    TEST_EXCEPTION(Xapian::NetworkError,
+		   replicate(master, replica, tempdir, 0, 1, 1, checksums));
+
+    // Need to close the replica before we remove the temporary directory on
+    // Windows.
+    replica.close();
+    rmtmpdir(tempdir);
+    return true;
+}
+
+// Test replication with compressed changesets.
+DEFINE_TESTCASE(replicate3, replicas) {
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+#ifdef __WIN32__
+    _putenv("XAPIAN_MAX_CHANGESETS=10");
+#else
+    setenv("XAPIAN_MAX_CHANGESETS", "10", 1);
+#endif
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+
+    Xapian::Document doc;
+    doc.set_data("doc");
+    doc.add_posting("doc", 1);
+    orig.add_document(doc);
+    orig.commit();
+
+    int count = replicate(master, replica, tempdir, 0, 1, 1, string(), true);
+    TEST_EQUAL(count, 1);
+
+    for (int i = 0; i < 100; ++i) {
+	doc.set_data(string(100, 'x') + om_tostring(i));
+	doc.add_posting("term" + om_tostring(i), 1);
+	orig.add_document(doc);
+    }
+    orig.commit();
+    orig.add_document(doc);
+    orig.commit();
+
+    // Find out how much sending the changesets uncompressed would take.
+    off_t raw_size;
+    {
+	string rawpath = tempdir + "/raw";
+	int fd = open(rawpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	TEST(fd != -1);
+	Xapian::ReplicationInfo info;
+	master.write_changesets_to_fd(fd, replica.get_revision_info(), &info);
+	close(fd);
+	TEST_EQUAL(info.changeset_count, 2);
+	raw_size = info.bytes_transferred;
+    }
+
+    count = replicate(master, replica, tempdir, 2, 0, 1, string(), true);
+    TEST_EQUAL(count, 3);
+    string changesetpath = tempdir + "/changeset";
+    struct stat sb;
+    TEST(stat(changesetpath.c_str(), &sb) == 0);
+    tout << "raw changesets " << raw_size << " bytes, compressed "
+	 << sb.st_size << " bytes" << endl;
+    TEST_REL(sb.st_size, <, raw_size / 2);
+
+    check_equal_dbs(masterpath, replicapath);
+    {
+	Xapian::Database dbcopy(replicapath);
+	TEST_EQUAL(orig.get_uuid(), dbcopy.get_uuid());
+	TEST_EQUAL(dbcopy.get_doccount(), 102);
+	TEST_EQUAL(dbcopy.get_termfreq("term99"), 2);
+	TEST_EQUAL(dbcopy.get_document(101).get_data(), string(100, 'x') + "99");
+    }
+
+    // The temporary files used to decompress should have been removed.
+    TEST(!file_exists(replicapath + "/changeset.z"));
+    TEST(!file_exists(replicapath + "/changeset"));
+
+    // Need to close the replica before we remove the temporary directory on
+    // Windows.
+    replica.close();
+    rmtmpdir(tempdir);
+    return true;
+}
+
+// Test that block checksums are only requested when a full copy is needed.
+DEFINE_TESTCASE(replicate4, replicas) {
+#ifdef __WIN32__
+    SKIP_TEST("Test needs fork() and socketpair()");
+#else
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    setenv("XAPIAN_MAX_CHANGESETS", "10", 1);
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+
+    for (int i = 0; i < 1000; ++i) {
+	Xapian::Document doc;
+	doc.set_data(string(100, 'x') + om_tostring(i));
+	doc.add_posting("term" + om_tostring(i), 1);
+	doc.add_posting("common", 1);
+	orig.add_document(doc);
+    }
+    orig.commit();
+
+    Xapian::ReplicationInfo info = replicate_over_socket(master, replica);
+    TEST_EQUAL(info.fullcopy_count, 1);
+    check_equal_dbs(masterpath, replicapath);
+
+    // A changeset is available, so no checksums should be needed.
+    Xapian::Document doc;
+    doc.set_data("extra");
+    doc.add_posting("extra", 1);
+    orig.add_document(doc);
+    orig.commit();
+    info = replicate_over_socket(master, replica);
+    TEST_EQUAL(info.changeset_count, 1);
+    TEST_EQUAL(info.fullcopy_count, 0);
+    check_equal_dbs(masterpath, replicapath);
+
+    // Remove the changesets, so a full copy is needed, which should only
+    // send the blocks which differ.
+    orig.add_document(doc);
+    orig.commit();
+    for (int rev = 0; rev < 10; ++rev) {
+	string changes_name = masterpath + "/changes" + om_tostring(rev);
+	(void)unlink(changes_name.c_str());
+    }
+
+    off_t full_size;
+    {
+	string fullpath = tempdir + "/full";
+	int fd = open(fullpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	TEST(fd != -1);
+	Xapian::ReplicationInfo full_info;
+	master.write_changesets_to_fd(fd, replica.get_revision_info(),
+				      &full_info);
+	close(fd);
+	TEST_EQUAL(full_info.fullcopy_count, 1);
+	full_size = full_info.bytes_transferred;
+    }
+
+    info = replicate_over_socket(master, replica);
+    TEST_EQUAL(info.changeset_count, 0);
+    TEST_EQUAL(info.fullcopy_count, 1);
+    tout << "full copy " << full_size << " bytes, delta copy "
+	 << info.bytes_transferred << " bytes" << endl;
+    TEST_REL(info.bytes_transferred, <, full_size / 2);
+
+    check_equal_dbs(masterpath, replicapath);
+    {
+	Xapian::Database dbcopy(replicapath);
+	TEST_EQUAL(orig.get_uuid(), dbcopy.get_uuid());
+	TEST_EQUAL(dbcopy.get_termfreq("common"), 1000);
+	TEST_EQUAL(dbcopy.get_termfreq("extra"), 2);
+    }
+
+    replica.close();
+    rmtmpdir(tempdir);
+    return true;
+#endif
+}
+
+/// Return the path of the live copy of the database in a replica.
+static string
+get_live_replica_path(const string & replicapath)
+{
+    DIR * dir = opendir(replicapath.c_str());
+    if (dir == NULL) FAIL_TEST("Can't open directory '" + replicapath + "'");
+    string result;
+    struct dirent * entry;
+    while ((entry = readdir(dir)) != NULL) {
+	if (startswith(entry->d_name, "replica_")) {
+	    // Only the live copy is left once replication has finished.
+	    TEST(result.empty());
+	    result = replicapath + "/" + entry->d_name;
+	}
+    }
+    closedir(dir);
+    TEST(!result.empty());
+    return result;
+}
+
+// Test that the extra files xapian-compact can write are replicated.
+DEFINE_TESTCASE(replicate5, brass) {
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    {
+	Xapian::WritableDatabase src(get_named_writable_database("replicate5src"));
+	for (int i = 1; i <= 100; ++i) {
+	    Xapian::Document doc;
+	    doc.add_term("all");
+	    doc.add_term("term" + om_tostring(i % 7));
+	    doc.add_value(0, Xapian::sortable_serialise(i % 13));
+	    src.add_document(doc);
+	}
+	src.add_spelling("spelling");
+	src.add_spelling("elephant");
+	src.commit();
+    }
+    string srcpath = get_named_writable_database_path("replicate5src");
+    string masterpath = tempdir + "/master";
+    string cmd = XAPIAN_COMPACT" "SILENT" --term-dictionary --spelling-index "
+		 "--numeric-column=0 ";
+    int status = system(cmd + srcpath + ' ' + masterpath);
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+    TEST(file_exists(masterpath + "/termdict"));
+    TEST(file_exists(masterpath + "/spelldel.DB"));
+    TEST(file_exists(masterpath + "/column0"));
+
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+    replicate(master, replica, tempdir, 0, 1, true);
+    replica.close();
+
+    string livepath = get_live_replica_path(replicapath);
+    TEST(file_exists(livepath + "/termdict"));
+    TEST(file_exists(livepath + "/spelldel.DB"));
+    TEST(file_exists(livepath + "/column0"));
+
+    Xapian::Database db(masterpath);
+    Xapian::Database dbcopy(replicapath);
+    TEST_EQUAL(db.get_uuid(), dbcopy.get_uuid());
+    TEST_EQUAL(dbcopy.get_termfreq("term3"), db.get_termfreq("term3"));
+    TEST_STRINGS_EQUAL(dbcopy.get_spelling_suggestion("elepant"), "elephant");
+    Xapian::Enquire enq(dbcopy);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_VALUE_LE, 0,
+				Xapian::sortable_serialise(3)));
+    TEST_EQUAL(enq.get_mset(0, 200).size(), 31);
+
+    rmtmpdir(tempdir);
+    return true;
+}
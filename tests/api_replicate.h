@@ -1,2 +1,6 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_replicate1();
+extern bool test_replicate2();
+extern bool test_replicate3();
+extern bool test_replicate4();
+extern bool test_replicate5();
@@ -224,6 +224,68 @@ DEFINE_TESTCASE(multivaluekeymaker1,!backend) {
     return true;
 }
 
+DEFINE_TESTCASE(fixedwidthkeymaker1,!backend) {
+    Xapian::FixedWidthKeyMaker sorter;
+    TEST_EQUAL(sorter.get_width(), 0);
+    sorter.add_value(0, 2);
+    sorter.add_value(1, 3, true);
+    TEST_EQUAL(sorter.get_width(), 5);
+
+    Xapian::Document doc;
+    TEST_EQUAL(sorter(doc), string("\0\0\xff\xff\xff", 5));
+
+    doc.add_value(0, "x");
+    doc.add_value(1, string("a\0", 2));
+    TEST_EQUAL(sorter(doc), string("x\0\x9e\xff\xff", 5));
+
+    // Values longer than their width are truncated.
+    doc.add_value(0, "xyz");
+    doc.add_value(1, "abcd");
+    TEST_EQUAL(sorter(doc), string("xy\x9e\x9d\x9c", 5));
+
+    return true;
+}
+
+/// Test sorting by fixed width keys stored in a value slot.
+DEFINE_TESTCASE(sortfixedwidth1,writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::FixedWidthKeyMaker short_key;
+    short_key.add_value(0, 1);
+    short_key.add_value(1, 2, true);
+    Xapian::FixedWidthKeyMaker long_key;
+    long_key.add_value(0, 8);
+    long_key.add_value(1, 2, true);
+    const char * values[][2] = {
+	{ "b", "aa" },
+	{ "a", "ab" },
+	{ "b", "ab" },
+	{ "a", "aa" },
+	{ "a", "b" },
+	{ "", "zz" }
+    };
+    for (size_t i = 0; i != sizeof(values) / sizeof(values[0]); ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_value(0, values[i][0]);
+	doc.add_value(1, values[i][1]);
+	doc.add_value(2, short_key(doc));
+	doc.add_value(3, long_key(doc));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    for (Xapian::valueno slot = 2; slot <= 3; ++slot) {
+	enquire.set_sort_by_value(slot, false);
+	mset_expect_order(enquire.get_mset(0, 10), 6, 5, 2, 4, 3, 1);
+	enquire.set_sort_by_value(slot, true);
+	mset_expect_order(enquire.get_mset(0, 10), 1, 3, 4, 2, 5, 6);
+    }
+
+    return true;
+}
+
 DEFINE_TESTCASE(sortfunctorremote1,remote) {
     Xapian::Enquire enquire(get_database(string()));
     NeverUseMeKeyMaker sorter;
@@ -1,7 +1,9 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_sortfunctor1();
 extern bool test_sortfunctor2();
 extern bool test_changesorter1();
 extern bool test_sortfunctorempty1();
 extern bool test_multivaluekeymaker1();
+extern bool test_fixedwidthkeymaker1();
+extern bool test_sortfixedwidth1();
 extern bool test_sortfunctorremote1();
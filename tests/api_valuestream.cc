@@ -238,6 +238,22 @@ DEFINE_TESTCASE(valuemapsource1, backend) {
     TEST(mset.size() == 5);
     mset_expect_order(mset, 5, 4, 6, 7, 8);
 
+    // and when frozen
+    src.freeze();
+    enq.set_query(Xapian::Query(&src));
+    mset = enq.get_mset(0, 5);
+
+    TEST(mset.size() == 5);
+    mset_expect_order(mset, 5, 4, 6, 7, 8);
+
+    // adding a mapping should unfreeze it
+    src.add_mapping("Ins", 6.0);
+    enq.set_query(Xapian::Query(&src));
+    mset = enq.get_mset(0, 5);
+
+    TEST(mset.size() == 5);
+    mset_expect_order(mset, 6, 5, 4, 7, 8);
+
     return true;
 }
 
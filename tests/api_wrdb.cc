@@ -41,6 +41,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <map>
+#include <set>
 #include <string>
 
 using namespace std;
@@ -1677,6 +1678,346 @@ DEFINE_TESTCASE(synonymitor1, writable && synonyms) {
     return true;
 }
 
+/// Join the terms from @a t to @a end separated by '|'.
+static string
+join_terms(Xapian::TermIterator t, const Xapian::TermIterator & end)
+{
+    string s = "|";
+    while (t != end) {
+	s += *t++;
+	s += '|';
+    }
+    return s;
+}
+
+// Test the in-memory synonym cache for read-only databases.
+DEFINE_TESTCASE(synonymcache1, brass) {
+    Xapian::WritableDatabase wdb = get_writable_database();
+    wdb.add_synonym("hello", "howdy");
+    wdb.add_synonym("hello", "hi");
+    wdb.add_synonym("goodbye", "bye");
+    wdb.add_synonym("hello world", "greeting");
+    wdb.commit();
+
+#ifdef __WIN32__
+    _putenv("XAPIAN_CACHE_SYNONYMS=1");
+#else
+    setenv("XAPIAN_CACHE_SYNONYMS", "1", 1);
+#endif
+    Xapian::Database db(get_writable_database_as_database());
+
+    TEST(db.synonyms_begin("abc") == db.synonyms_end("abc"));
+    TEST_STRINGS_EQUAL(join_terms(db.synonyms_begin("hello"),
+				  db.synonyms_end("hello")), "|hi|howdy|");
+    TEST_STRINGS_EQUAL(join_terms(db.synonym_keys_begin(),
+				  db.synonym_keys_end()),
+		       "|goodbye|hello|hello world|");
+    TEST_STRINGS_EQUAL(join_terms(db.synonym_keys_begin("hello"),
+				  db.synonym_keys_end("hello")),
+		       "|hello|hello world|");
+    TEST(db.synonym_keys_begin("z") == db.synonym_keys_end("z"));
+    Xapian::TermIterator t = db.synonym_keys_begin();
+    t.skip_to("h");
+    TEST(t != db.synonym_keys_end());
+    TEST_STRINGS_EQUAL(*t, "hello");
+    t.skip_to("i");
+    TEST(t == db.synonym_keys_end());
+
+    // Multi-word synonyms should work in the QueryParser.
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    Xapian::Query q = qp.parse_query("hello world",
+				     Xapian::QueryParser::FLAG_AUTO_MULTIWORD_SYNONYMS);
+    TEST_STRINGS_EQUAL(q.get_description(),
+		       "Xapian::Query(((hello:(pos=1) OR world:(pos=2)) "
+		       "SYNONYM greeting:(pos=1)))");
+
+    // The cache should only be updated by reopen().
+    wdb.add_synonym("hello", "hey");
+    wdb.commit();
+    TEST_STRINGS_EQUAL(join_terms(db.synonyms_begin("hello"),
+				  db.synonyms_end("hello")), "|hi|howdy|");
+    db.reopen();
+    TEST_STRINGS_EQUAL(join_terms(db.synonyms_begin("hello"),
+				  db.synonyms_end("hello")), "|hey|hi|howdy|");
+
+    // Check skip_to() doesn't go beyond the terms with the prefix, including
+    // when the prefix ends with '\xff'.
+    wdb.add_synonym("help", "aid");
+    wdb.add_synonym("hello\xff", "x");
+    wdb.add_synonym("hello\xff\xff", "y");
+    wdb.add_synonym("\xff", "z");
+    wdb.commit();
+    db.reopen();
+    t = db.synonym_keys_begin("hello");
+    t.skip_to("hello w");
+    TEST(t != db.synonym_keys_end("hello"));
+    TEST_STRINGS_EQUAL(*t, "hello world");
+    t.skip_to("i");
+    TEST(t == db.synonym_keys_end("hello"));
+    TEST_STRINGS_EQUAL(join_terms(db.synonym_keys_begin("hello\xff"),
+				  db.synonym_keys_end("hello\xff")),
+		       "|hello\xff|hello\xff\xff|");
+    t = db.synonym_keys_begin("hello\xff");
+    t.skip_to("hello\xff\x01");
+    TEST(t != db.synonym_keys_end("hello\xff"));
+    TEST_STRINGS_EQUAL(*t, "hello\xff\xff");
+    TEST_STRINGS_EQUAL(join_terms(db.synonym_keys_begin("\xff"),
+				  db.synonym_keys_end("\xff")), "|\xff|");
+    t = db.synonym_keys_begin();
+    t.skip_to("helm");
+    TEST(t != db.synonym_keys_end());
+    TEST_STRINGS_EQUAL(*t, "help");
+
+#ifdef __WIN32__
+    _putenv("XAPIAN_CACHE_SYNONYMS=");
+#else
+    unsetenv("XAPIAN_CACHE_SYNONYMS");
+#endif
+
+    return true;
+}
+
+/// Check OP_VALUE_RANGE (or OP_VALUE_GE if @a end is empty) against the values.
+static void
+check_value_range(const Xapian::Database & db, Xapian::valueno slot,
+		  const string & begin, const string & end,
+		  bool expect_exact_estimate)
+{
+    set<Xapian::docid> expected;
+    for (Xapian::PostingIterator p = db.postlist_begin(string());
+	 p != db.postlist_end(string()); ++p) {
+	string v = db.get_document(*p).get_value(slot);
+	if (v >= begin && (end.empty() || v <= end)) expected.insert(*p);
+    }
+    Xapian::Query query;
+    if (end.empty()) {
+	query = Xapian::Query(Xapian::Query::OP_VALUE_GE, slot, begin);
+    } else {
+	query = Xapian::Query(Xapian::Query::OP_VALUE_RANGE, slot, begin, end);
+    }
+    tout << query.get_description() << '\n';
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+    TEST_EQUAL(mset.size(), expected.size());
+    set<Xapian::docid> got;
+    for (Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m) {
+	got.insert(*m);
+    }
+    TEST(got == expected);
+    // Postlists from a value index know exactly how many documents match.
+    if (expect_exact_estimate) {
+	mset = enquire.get_mset(0, 1);
+	TEST_EQUAL(mset.get_matches_estimated(), expected.size());
+    }
+}
+
+static string
+long_value(unsigned n)
+{
+    // Values longer than the part stored in a value index key, which only
+    // differ at the end.
+    string v(250, 'x');
+    v[100] = '\0';
+    v += char('a' + n % 26);
+    return v;
+}
+
+// Test value indexes, which brass creates for the slots listed in
+// XAPIAN_VALUE_INDEXES.
+DEFINE_TESTCASE(valueindex1, brass) {
+    using Xapian::sortable_serialise;
+    // Create the index for slot 0 before there are any values.
+#ifdef __WIN32__
+    _putenv("XAPIAN_VALUE_INDEXES=0");
+#else
+    setenv("XAPIAN_VALUE_INDEXES", "0", 1);
+#endif
+    Xapian::WritableDatabase db = get_named_writable_database("valueindex1");
+    for (unsigned i = 1; i <= 300; ++i) {
+	Xapian::Document doc;
+	if (i % 5) doc.add_value(0, sortable_serialise(i % 100));
+	doc.add_value(1, long_value(i));
+	db.add_document(doc);
+    }
+
+    // Check the index is used for uncommitted changes.
+    check_value_range(db, 0, sortable_serialise(10), sortable_serialise(12),
+		      true);
+    check_value_range(db, 0, sortable_serialise(97), string(), true);
+    check_value_range(db, 0, sortable_serialise(1000), string(), true);
+    check_value_range(db, 0, sortable_serialise(20), sortable_serialise(10),
+		      true);
+    // This range isn't selective, so the values are iterated instead.
+    check_value_range(db, 0, sortable_serialise(0), sortable_serialise(80),
+		      false);
+
+    // Check the index is updated when values change.
+    for (unsigned i = 1; i <= 300; i += 7) {
+	Xapian::Document doc;
+	doc.add_value(0, sortable_serialise(i % 3 + 10));
+	db.replace_document(i, doc);
+    }
+    for (unsigned i = 2; i <= 300; i += 11) {
+	db.delete_document(i);
+    }
+    Xapian::Document doc;
+    doc.add_value(1, "no value in slot 0");
+    db.replace_document(11, doc);
+    db.commit();
+    check_value_range(db, 0, sortable_serialise(10), sortable_serialise(12),
+		      true);
+    check_value_range(db, 0, sortable_serialise(11), string(), false);
+
+    // Create an index for slot 1, which already has values.
+#ifdef __WIN32__
+    _putenv("XAPIAN_VALUE_INDEXES=1");
+#else
+    setenv("XAPIAN_VALUE_INDEXES", "1", 1);
+#endif
+    string path = get_named_writable_database_path("valueindex1");
+    db = Xapian::WritableDatabase();
+    db = Xapian::WritableDatabase(path, Xapian::DB_OPEN);
+    db.commit();
+#ifdef __WIN32__
+    _putenv("XAPIAN_VALUE_INDEXES=");
+#else
+    unsetenv("XAPIAN_VALUE_INDEXES");
+#endif
+
+    Xapian::Database rdb(path);
+    check_value_range(rdb, 0, sortable_serialise(10), sortable_serialise(12),
+		      true);
+    check_value_range(rdb, 1, long_value(2), long_value(2), true);
+    check_value_range(rdb, 1, long_value(24), string(), true);
+    check_value_range(rdb, 1, long_value(3).substr(0, 240), long_value(4),
+		      true);
+
+    // The index is still updated when the slot isn't listed.
+    doc.clear_values();
+    doc.add_value(0, sortable_serialise(11.5));
+    doc.add_value(1, long_value(2));
+    db.replace_document(1, doc);
+    db.commit();
+    rdb.reopen();
+    check_value_range(rdb, 0, sortable_serialise(10), sortable_serialise(12),
+		      true);
+    check_value_range(rdb, 1, long_value(2), long_value(2), true);
+
+    string cmd = XAPIAN_BIN_PATH"xapian-check ";
+    cmd += path;
+#ifdef __WIN32__
+    cmd += " >nul";
+#else
+    cmd += " >/dev/null";
+#endif
+    TEST_EQUAL(system(cmd.c_str()), 0);
+
+    return true;
+}
+
+// Test the in-memory document length array for read-only databases.
+DEFINE_TESTCASE(doclencache1, brass) {
+    Xapian::WritableDatabase wdb = get_writable_database();
+    map<Xapian::docid, Xapian::termcount> lengths;
+    for (Xapian::docid did = 1; did <= 20; ++did) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	// Make some documents too long for a byte.
+	doc.add_term(did % 2 ? "odd" : "even", did * did * 7);
+	wdb.add_document(doc);
+	lengths[did] = did * did * 7 + 1;
+    }
+    wdb.delete_document(5);
+    lengths.erase(5);
+    wdb.commit();
+
+    Xapian::Database db(get_writable_database_as_database());
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("odd"), Xapian::Query("all")));
+    Xapian::MSet mset1 = enquire.get_mset(0, 20);
+
+#ifdef __WIN32__
+    _putenv("XAPIAN_CACHE_DOCLENGTHS=1");
+#else
+    setenv("XAPIAN_CACHE_DOCLENGTHS", "1", 1);
+#endif
+    db = get_writable_database_as_database();
+    map<Xapian::docid, Xapian::termcount>::const_iterator i;
+    for (i = lengths.begin(); i != lengths.end(); ++i) {
+	TEST_EQUAL(db.get_doclength(i->first), i->second);
+    }
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(5));
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(21));
+    enquire = Xapian::Enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("odd"), Xapian::Query("all")));
+    Xapian::MSet mset2 = enquire.get_mset(0, 20);
+    TEST_EQUAL(mset1.size(), mset2.size());
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+
+    // The array should only be updated by reopen().
+    Xapian::Document doc;
+    doc.add_term("all", 3);
+    wdb.replace_document(5, doc);
+    wdb.commit();
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(5));
+    db.reopen();
+    TEST_EQUAL(db.get_doclength(5), 3);
+    lengths[5] = 3;
+    enquire = Xapian::Enquire(db);
+    enquire.set_query(Xapian::Query("all"));
+    Xapian::MSet exact = enquire.get_mset(0, 20);
+
+    // Quantised lengths are only used for weighting by schemes which accept
+    // approximate lengths.
+#ifdef __WIN32__
+    _putenv("XAPIAN_CACHE_DOCLENGTHS=quantised");
+#else
+    setenv("XAPIAN_CACHE_DOCLENGTHS", "quantised", 1);
+#endif
+    db = get_writable_database_as_database();
+    for (i = lengths.begin(); i != lengths.end(); ++i) {
+	TEST_EQUAL(db.get_doclength(i->first), i->second);
+    }
+    Xapian::PostingIterator p;
+    for (p = db.postlist_begin("all"); p != db.postlist_end("all"); ++p) {
+	TEST_EQUAL(p.get_doclength(), lengths[*p]);
+    }
+    enquire = Xapian::Enquire(db);
+    enquire.set_query(Xapian::Query("all"));
+    Xapian::MSet mset3 = enquire.get_mset(0, 20);
+    TEST_EQUAL(mset3.size(), exact.size());
+    map<Xapian::docid, Xapian::weight> weights;
+    Xapian::MSetIterator m;
+    for (m = exact.begin(); m != exact.end(); ++m) {
+	weights[*m] = m.get_weight();
+    }
+    for (m = mset3.begin(); m != mset3.end(); ++m) {
+	Xapian::termcount len = lengths[*m];
+	Xapian::weight w = weights[*m];
+	tout << *m << ": " << len << " " << w << " ~ " << m.get_weight() << endl;
+	if (len < 32) {
+	    TEST_EQUAL_DOUBLE(m.get_weight(), w);
+	} else {
+	    // The lengths are rounded up, so the weights can only be lower.
+	    TEST_REL(m.get_weight(),<=,w + 1e-9);
+	    TEST_REL(m.get_weight(),>=,w * 0.95);
+	}
+    }
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(21));
+
+#ifdef __WIN32__
+    _putenv("XAPIAN_CACHE_DOCLENGTHS=");
+#else
+    unsetenv("XAPIAN_CACHE_DOCLENGTHS");
+#endif
+
+    return true;
+}
+
 // Test that adding a document with a really long term gives an error on
 // add_document() rather than on commit().
 DEFINE_TESTCASE(termtoolong1, writable) {
@@ -1,4 +1,4 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 extern bool test_adddoc1();
 extern bool test_adddoc2();
 extern bool test_adddoc3();
@@ -28,6 +28,9 @@ extern bool test_consistency2();
 extern bool test_crashrecovery1();
 extern bool test_nomoredocids1();
 extern bool test_synonymitor1();
+extern bool test_synonymcache1();
+extern bool test_valueindex1();
+extern bool test_doclencache1();
 extern bool test_termtoolong1();
 extern bool test_postlist7();
 extern bool test_lazytablebug1();
@@ -25,14 +25,17 @@
 
 #include <xapian.h>
 
+#include <algorithm>
 #include <cfloat>
 #include "safeerrno.h"
 
 #include <string>
+#include <vector>
 
 using namespace std;
 
 #include "autoptr.h"
+#include "editdistance.h"
 #include "testsuite.h"
 #include "testutils.h"
 
@@ -602,6 +605,137 @@ static bool test_pack_uint_preserving_sort1()
     return true;
 }
 
+static vector<unsigned>
+to_utf32(const string & s)
+{
+    return vector<unsigned>((Xapian::Utf8Iterator(s)), Xapian::Utf8Iterator());
+}
+
+/** The edit distance between @a a and @a b, counting a transposition of
+ *  adjacent characters as one edit, calculated the simple way.
+ */
+static int
+simple_edit_distance(const vector<unsigned> & a, const vector<unsigned> & b)
+{
+    size_t m = a.size(), n = b.size();
+    vector<vector<int> > d(m + 1, vector<int>(n + 1));
+    for (size_t i = 0; i <= m; ++i) d[i][0] = int(i);
+    for (size_t j = 0; j <= n; ++j) d[0][j] = int(j);
+    for (size_t i = 1; i <= m; ++i) {
+	for (size_t j = 1; j <= n; ++j) {
+	    int cost = (a[i - 1] == b[j - 1]) ? 0 : 1;
+	    d[i][j] = min(min(d[i - 1][j] + 1, d[i][j - 1] + 1),
+			  d[i - 1][j - 1] + cost);
+	    if (i > 1 && j > 1 &&
+		a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+		d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1);
+	    }
+	}
+    }
+    return d[m][n];
+}
+
+/// Check both edit distance implementations for @a a and @a b.
+static void
+check_edit_distance(const string & a, const string & b, int expected)
+{
+    vector<unsigned> a32 = to_utf32(a);
+    vector<unsigned> b32 = to_utf32(b);
+    tout << a << " -> " << b << endl;
+    TEST_EQUAL(simple_edit_distance(a32, b32), expected);
+    // Pad so that taking &v[0] is OK for an empty string.
+    a32.push_back(0);
+    b32.push_back(0);
+    int len_a = int(a32.size()) - 1;
+    int len_b = int(b32.size()) - 1;
+    EditDistanceCalculator calc(&a32[0], len_a);
+    for (int max_distance = 0; max_distance <= expected + 1; ++max_distance) {
+	int d1 = edit_distance_unsigned(&a32[0], len_a, &b32[0], len_b,
+					max_distance);
+	int d2 = calc(&b32[0], len_b, max_distance);
+	if (expected <= max_distance) {
+	    TEST_EQUAL(d1, expected);
+	    TEST_EQUAL(d2, expected);
+	} else {
+	    // Any value above max_distance may be returned.
+	    TEST_REL(d1,>,max_distance);
+	    TEST_REL(d2,>,max_distance);
+	}
+    }
+}
+
+/// Test the edit distance calculations used for spelling correction.
+static bool test_editdistance1()
+{
+    static const struct { const char * a; const char * b; int d; } tests[] = {
+	{ "", "", 0 },
+	{ "", "abc", 3 },
+	{ "abc", "", 3 },
+	{ "abc", "abc", 0 },
+	{ "abc", "abd", 1 },
+	{ "abc", "abcd", 1 },
+	{ "abcd", "acd", 1 },
+	// Transpositions.
+	{ "abcd", "bacd", 1 },
+	{ "abcd", "abdc", 1 },
+	{ "abcdef", "badcfe", 3 },
+	{ "ca", "abc", 3 },
+	{ "spelling", "speling", 1 },
+	{ "spelling", "sepllnig", 2 },
+	{ "kitten", "sitting", 3 },
+	{ "mathematics", "mathmatcis", 2 },
+	// Non-ASCII characters, including ones which share low bits with
+	// ASCII characters.
+	{ "caf\xc3\xa9", "cafe", 1 },
+	{ "caf\xc3\xa9", "ca\xc3\xa9" "f", 1 },
+	{ "\xc3\xa9\xc3\xa8", "\xc3\xa8\xc3\xa9", 1 },
+	{ "\xe2\x98\xba" "a", "a\xe2\x98\xba", 1 },
+	{ "\xc5\xa1" "a", "aa", 1 },
+	{ "\xc4\xa1\xc5\xa1x", "xax", 2 },
+	{ "\xf0\x9d\x84\x9e\xe2\x98\xba", "\xe2\x98\xba", 1 }
+    };
+    for (size_t i = 0; i != sizeof(tests) / sizeof(tests[0]); ++i) {
+	check_edit_distance(tests[i].a, tests[i].b, tests[i].d);
+	check_edit_distance(tests[i].b, tests[i].a, tests[i].d);
+    }
+
+    // Words of exactly 64 characters use the bit-parallel algorithm, and
+    // longer ones fall back to edit_distance_unsigned().
+    for (size_t len = 63; len <= 66; ++len) {
+	string word;
+	for (size_t i = 0; i != len; ++i) word += char('a' + i % 26);
+	string other = word;
+	swap(other[0], other[1]);
+	other[len - 1] = 'Z';
+	check_edit_distance(word, other, 2);
+	check_edit_distance(word, word.substr(1), 1);
+	check_edit_distance(word, word + "xyz", 3);
+	check_edit_distance(word, "abc", int(len) - 3);
+    }
+
+    // Compare with the simple calculation for pseudo-random words with
+    // repeated characters, some of them non-ASCII.
+    static const char * const chars[] = {
+	"a", "b", "c", "\xc3\xa9", "\xe2\x98\xba"
+    };
+    unsigned seed = 1;
+    for (int n = 0; n != 500; ++n) {
+	string words[2];
+	for (int w = 0; w != 2; ++w) {
+	    seed = seed * 1103515245 + 12345;
+	    size_t len = (seed >> 16) % 9;
+	    for (size_t i = 0; i != len; ++i) {
+		seed = seed * 1103515245 + 12345;
+		words[w] += chars[(seed >> 16) % 5];
+	    }
+	}
+	check_edit_distance(words[0], words[1],
+			    simple_edit_distance(to_utf32(words[0]),
+						 to_utf32(words[1])));
+    }
+    return true;
+}
+
 // ##################################################################
 // # End of actual tests					    #
 // ##################################################################
@@ -627,6 +761,7 @@ static const test_desc tests[] = {
     {"static_assert1",		test_static_assert1},
     {"strbool1",		test_strbool1},
     {"pack1",			test_pack_uint_preserving_sort1},
+    {"editdistance1",		test_editdistance1},
     {0, 0}
 };
 
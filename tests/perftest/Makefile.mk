@@ -19,7 +19,8 @@ noinst_HEADERS += perftest/perftest.h
 
 collated_perftest_sources = \
  perftest/perftest_matchdecider.cc \
- perftest/perftest_randomidx.cc
+ perftest/perftest_randomidx.cc \
+ perftest/perftest_spelling.cc
 
 perftest_perftest_SOURCES = perftest/perftest.cc $(collated_perftest_sources) \
  perftest/perftest_all.h perftest/perftest_collated.h \
@@ -27,7 +28,7 @@ perftest_perftest_SOURCES = perftest/perftest.cc $(collated_perftest_sources) \
  perftest/runprocess.cc perftest/runprocess.h \
  $(testharness_sources)
 perftest_perftest_LDFLAGS = -no-install $(ldflags)
-perftest_perftest_LDADD = ../libgetopt.la ../$(libxapian_la)
+perftest_perftest_LDADD = ../libgetopt.la ../libeditdistance.la ../$(libxapian_la)
 
 if MAINTAINER_MODE
 BUILT_SOURCES += perftest/perftest_all.h perftest/perftest_collated.h \
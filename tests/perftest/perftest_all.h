@@ -1,3 +1,4 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 #include "perftest/perftest_matchdecider.h"
 #include "perftest/perftest_randomidx.h"
+#include "perftest/perftest_spelling.h"
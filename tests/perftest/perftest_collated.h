@@ -1,5 +1,19 @@
-/* Warning: This file is generated by /data/home/olly/tmp/xapian-svn-snapshot/tags/1.1.4/xapian/xapian-core/tests/collate-test - do not modify directly! */
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
 
+    if (!backend) {
+	static const test_desc tests[] = {
+	    { "editdistance1", test_editdistance1 },
+	    { 0, 0 }
+	};
+	result = max(result, test_driver::run(tests));
+    }
+    if (spelling&&!remote) {
+	static const test_desc tests[] = {
+	    { "spelling1", test_spelling1 },
+	    { 0, 0 }
+	};
+	result = max(result, test_driver::run(tests));
+    }
     if (writable&&!inmemory) {
 	static const test_desc tests[] = {
 	    { "randomidx1", test_randomidx1 },
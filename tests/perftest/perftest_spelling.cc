@@ -0,0 +1,183 @@
+/** @file perftest_spelling.cc
+ * @brief performance tests for spelling correction.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_spelling.h"
+
+#include <xapian.h>
+
+#include "backendmanager.h"
+#include "editdistance.h"
+#include "perftest.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+#include "utils.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+/** Generate a pseudo-random word.
+ *
+ *  We want the same words on every run, so use our own simple generator
+ *  rather than rand().
+ */
+static string
+make_word(unsigned & seed)
+{
+    seed = seed * 1103515245 + 12345;
+    size_t len = 4 + (seed >> 16) % 9;
+    string word;
+    for (size_t i = 0; i != len; ++i) {
+	seed = seed * 1103515245 + 12345;
+	word += char('a' + (seed >> 16) % 13);
+    }
+    return word;
+}
+
+/// Make a copy of @a word with @a n random edits.
+static string
+misspell(string word, unsigned n, unsigned & seed)
+{
+    while (n--) {
+	seed = seed * 1103515245 + 12345;
+	size_t pos = (seed >> 16) % word.size();
+	switch ((seed >> 8) % 4) {
+	    case 0:
+		word.insert(pos, 1, 'z');
+		break;
+	    case 1:
+		if (word.size() > 1) word.erase(pos, 1);
+		break;
+	    case 2:
+		word[pos] = 'y';
+		break;
+	    case 3:
+		if (pos + 1 < word.size()) swap(word[pos], word[pos + 1]);
+		break;
+	}
+    }
+    return word;
+}
+
+static vector<unsigned>
+to_utf32(const string & s)
+{
+    return vector<unsigned>((Xapian::Utf8Iterator(s)), Xapian::Utf8Iterator());
+}
+
+// Time the edit distance algorithms used for spelling correction.  Their
+// results are checked by internaltest.
+DEFINE_TESTCASE(editdistance1, !backend) {
+    const unsigned num_candidates = 100000;
+    const int max_distance = 2;
+
+    logger.testcase_begin("editdistance1");
+
+    unsigned seed = 1;
+    vector<vector<unsigned> > candidates;
+    candidates.reserve(num_candidates);
+    for (unsigned i = 0; i != num_candidates; ++i) {
+	candidates.push_back(to_utf32(make_word(seed)));
+    }
+
+    const char * words[] = { "abcdefg", "hijklm", "mabcde", "dfhjlbc" };
+    for (size_t w = 0; w != sizeof(words) / sizeof(words[0]); ++w) {
+	vector<unsigned> word(to_utf32(words[w]));
+
+	logger.searching_start(string("edit_distance_unsigned() from ") +
+			       words[w]);
+	logger.search_start();
+	vector<vector<unsigned> >::const_iterator i;
+	for (i = candidates.begin(); i != candidates.end(); ++i) {
+	    (void)edit_distance_unsigned(&(*i)[0], int(i->size()),
+					 &word[0], int(word.size()),
+					 max_distance);
+	}
+	logger.search_end(Xapian::Query(), Xapian::MSet());
+	logger.searching_end();
+
+	logger.searching_start(string("EditDistanceCalculator from ") +
+			       words[w]);
+	logger.search_start();
+	EditDistanceCalculator edit_distance(&word[0], int(word.size()));
+	for (i = candidates.begin(); i != candidates.end(); ++i) {
+	    (void)edit_distance(&(*i)[0], int(i->size()), max_distance);
+	}
+	logger.search_end(Xapian::Query(), Xapian::MSet());
+	logger.searching_end();
+    }
+
+    logger.testcase_end();
+    return true;
+}
+
+static void
+builddb_spelling1(Xapian::WritableDatabase &db, const string & dbname)
+{
+    logger.testcase_begin(dbname);
+    unsigned int runsize = 100000;
+
+    std::map<std::string, std::string> params;
+    params["runsize"] = om_tostring(runsize);
+    logger.indexing_begin(dbname, params);
+    unsigned seed = 1;
+    for (unsigned int i = 0; i < runsize; ++i) {
+	db.add_spelling(make_word(seed));
+	logger.indexing_add();
+    }
+    db.commit();
+    logger.indexing_end();
+    logger.testcase_end();
+}
+
+// Test the performance of Database::get_spelling_suggestion().
+DEFINE_TESTCASE(spelling1, spelling && !remote) {
+    Xapian::Database db;
+    db = backendmanager->get_database("spelling1", builddb_spelling1,
+				      "spelling1");
+
+    logger.testcase_begin("spelling1");
+
+    unsigned seed = 1;
+    vector<string> words;
+    for (unsigned i = 0; i != 1000; ++i) {
+	words.push_back(make_word(seed));
+    }
+
+    for (unsigned edits = 1; edits <= 2; ++edits) {
+	logger.searching_start("get_spelling_suggestion() with " +
+			       om_tostring(edits) + " edits");
+	logger.search_start();
+	unsigned seed2 = 2;
+	vector<string>::const_iterator i;
+	for (i = words.begin(); i != words.end(); ++i) {
+	    string bad = misspell(*i, edits, seed2);
+	    (void)db.get_spelling_suggestion(bad, edits);
+	}
+	logger.search_end(Xapian::Query(), Xapian::MSet());
+	logger.searching_end();
+    }
+
+    logger.testcase_end();
+    return true;
+}
@@ -0,0 +1,3 @@
+/* Warning: This file is generated by ./collate-test - do not modify directly! */
+extern bool test_editdistance1();
+extern bool test_spelling1();
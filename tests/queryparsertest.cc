@@ -912,6 +912,59 @@ static bool test_qp_flag_wildcard2()
 #endif
 }
 
+// Test limits on wildcard expansion, and lazy wildcard expansion.
+static bool test_qp_flag_wildcard3()
+{
+#ifndef XAPIAN_HAS_INMEMORY_BACKEND
+    SKIP_TEST("Testcase requires the InMemory backend which is disabled");
+#else
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::Document doc;
+    doc.add_term("muscat");
+    doc.add_term("muscle");
+    doc.add_term("musclebound");
+    doc.add_term("muscular");
+    db.add_document(doc);
+    doc.remove_term("muscat");
+    db.add_document(doc);
+    doc.remove_term("muscle");
+    db.add_document(doc);
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    const unsigned flags = Xapian::QueryParser::FLAG_WILDCARD;
+    Xapian::Query qobj;
+
+    qp.set_max_wildcard_expansion(4);
+    qobj = qp.parse_query("mu*", flags);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Xapian::Query((muscat:(pos=1) SYNONYM muscle:(pos=1) SYNONYM musclebound:(pos=1) SYNONYM muscular:(pos=1)))");
+
+    qp.set_max_wildcard_expansion(3);
+    TEST_EXCEPTION(Xapian::WildcardError, qp.parse_query("mu*", flags));
+    qobj = qp.parse_query("muscl*", flags);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Xapian::Query((muscle:(pos=1) SYNONYM musclebound:(pos=1)))");
+
+    qp.set_max_wildcard_expansion(2, Xapian::Query::WILDCARD_LIMIT_FIRST);
+    qobj = qp.parse_query("mu*", flags);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Xapian::Query((muscat:(pos=1) SYNONYM muscle:(pos=1)))");
+
+    qp.set_max_wildcard_expansion(2, Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT);
+    qobj = qp.parse_query("mu*", flags);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Xapian::Query((musclebound:(pos=1) SYNONYM muscular:(pos=1)))");
+
+    // With FLAG_LAZY_WILDCARD, expansion is left until the match.
+    const unsigned lazy = flags | Xapian::QueryParser::FLAG_LAZY_WILDCARD;
+    qobj = qp.parse_query("mu*", lazy);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Xapian::Query(WILDCARD 2 MOST_FREQUENT mu:(pos=1))");
+    qp.set_max_wildcard_expansion(0);
+    qobj = qp.parse_query("mu* test", lazy);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Xapian::Query((WILDCARD mu:(pos=1) OR test:(pos=2)))");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(qp.parse_query("muscle*", lazy));
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), 3);
+    return true;
+#endif
+}
+
 // Test partial queries.
 static bool test_qp_flag_partial1()
 {
@@ -2200,6 +2253,152 @@ static bool test_qp_stopword_group1()
 #endif
 }
 
+// Test the parse cache.
+static bool test_qp_parse_cache1()
+{
+    const char * stopwords[] = { "a", "an", "the" };
+    Xapian::SimpleStopper stop(stopwords, stopwords + 3);
+
+    Xapian::QueryParser qp;
+    qp.set_stopper(&stop);
+    qp.set_stemmer(Xapian::Stem("english"));
+    qp.set_stemming_strategy(Xapian::QueryParser::STEM_SOME);
+    qp.set_parse_cache_size(2);
+
+    string desc = qp.parse_query("the cats").get_description();
+    TEST_EQUAL(qp.get_parse_cache_hits(), 0);
+    TEST_EQUAL(qp.get_parse_cache_misses(), 1);
+    (void)qp.parse_query("mice");
+    TEST_STRINGS_EQUAL(qp.parse_query("the cats").get_description(), desc);
+    TEST_EQUAL(qp.get_parse_cache_hits(), 1);
+    TEST_EQUAL(qp.get_parse_cache_misses(), 2);
+
+    // Check the stoplist and unstemmed forms were restored.
+    Xapian::TermIterator i = qp.stoplist_begin();
+    TEST(i != qp.stoplist_end());
+    TEST_EQUAL(*i, "the");
+    ++i;
+    TEST(i == qp.stoplist_end());
+    i = qp.unstem_begin("Zcat");
+    TEST(i != qp.unstem_end("Zcat"));
+    TEST_EQUAL(*i, "cats");
+
+    // Different flags or default prefix need a different cache entry.
+    TEST_STRINGS_EQUAL(qp.parse_query("the cats", 0).get_description(), desc);
+    TEST_EQUAL(qp.get_parse_cache_misses(), 3);
+    TEST_STRINGS_EQUAL(qp.parse_query("cats", Xapian::QueryParser::FLAG_DEFAULT,
+				      "XA").get_description(),
+		       "Xapian::Query(ZXAcat:(pos=1))");
+    TEST_EQUAL(qp.get_parse_cache_misses(), 4);
+
+    // The cache holds 2 entries, so "mice" should have been dropped as the
+    // least recently used.
+    TEST_STRINGS_EQUAL(qp.parse_query("the cats", 0).get_description(), desc);
+    TEST_EQUAL(qp.get_parse_cache_hits(), 2);
+    (void)qp.parse_query("mice");
+    TEST_EQUAL(qp.get_parse_cache_misses(), 5);
+
+    // Changing the settings should empty the cache.
+    qp.set_default_op(Xapian::Query::OP_AND);
+    TEST_STRINGS_EQUAL(qp.parse_query("the cats mice").get_description(),
+		       "Xapian::Query((Zcat:(pos=2) AND Zmice:(pos=3)))");
+    TEST_EQUAL(qp.get_parse_cache_hits(), 2);
+    TEST_EQUAL(qp.get_parse_cache_misses(), 6);
+
+    // Parse errors aren't cached.
+    TEST_EXCEPTION(Xapian::QueryParserError,
+		   qp.parse_query("foo AND", Xapian::QueryParser::FLAG_BOOLEAN |
+				  Xapian::QueryParser::FLAG_PURE_NOT));
+
+    // Check that a change to the database is noticed.
+    mkdir(".flint", 0755);
+    string dbdir = ".flint/qp_parse_cache1";
+    Xapian::WritableDatabase db(dbdir, Xapian::DB_CREATE_OR_OVERWRITE);
+    db.add_spelling("document");
+    db.commit();
+
+    qp.set_database(db);
+    unsigned flags = Xapian::QueryParser::FLAG_SPELLING_CORRECTION;
+    (void)qp.parse_query("documant", flags);
+    TEST_STRINGS_EQUAL(qp.get_corrected_query_string(), "document");
+    (void)qp.parse_query("mice", flags);
+    TEST_STRINGS_EQUAL(qp.get_corrected_query_string(), "");
+    unsigned long hits = qp.get_parse_cache_hits();
+    (void)qp.parse_query("documant", flags);
+    TEST_STRINGS_EQUAL(qp.get_corrected_query_string(), "document");
+    TEST_EQUAL(qp.get_parse_cache_hits(), hits + 1);
+
+    Xapian::Document doc;
+    doc.add_term("documant");
+    db.add_document(doc);
+    db.commit();
+    (void)qp.parse_query("documant", flags);
+    TEST_STRINGS_EQUAL(qp.get_corrected_query_string(), "");
+    TEST_EQUAL(qp.get_parse_cache_hits(), hits + 1);
+
+    // Disabling the cache should empty it.
+    qp.set_parse_cache_size(0);
+    qp.set_parse_cache_size(2);
+    (void)qp.parse_query("documant", flags);
+    TEST_EQUAL(qp.get_parse_cache_hits(), hits + 1);
+
+    return true;
+}
+
+// Test SimpleStopper::freeze().
+static bool test_qp_stopper_freeze1()
+{
+    const char * stopwords[] = {
+	"a", "an", "and", "at", "be", "by", "for", "in", "is", "it", "of",
+	"on", "or", "the", "to", "was", "with"
+    };
+    const size_t n = sizeof(stopwords) / sizeof(stopwords[0]);
+    Xapian::SimpleStopper stop(stopwords, stopwords + n);
+    stop.freeze();
+    for (size_t i = 0; i != n; ++i) {
+	TEST(stop(stopwords[i]));
+	TEST(!stop(string(stopwords[i]) + "x"));
+    }
+    TEST(!stop(""));
+    TEST(!stop("ab"));
+
+    // Adding a word should unfreeze the stopper, so it's still found.
+    stop.add("");
+    stop.add("zebra");
+    TEST(stop(""));
+    TEST(stop("zebra"));
+    stop.freeze();
+    TEST(stop(""));
+    TEST(stop("zebra"));
+    TEST(stop("the"));
+
+    Xapian::QueryParser qp;
+    qp.set_stopper(&stop);
+    TEST_STRINGS_EQUAL(qp.parse_query("the zebra crossing").get_description(),
+		       "Xapian::Query(crossing:(pos=3))");
+
+    return true;
+}
+
+// Test that prefixes added between parses are used.
+static bool test_qp_prefix_table1()
+{
+    Xapian::QueryParser qp;
+    TEST_STRINGS_EQUAL(qp.parse_query("title:foo").get_description(),
+		       "Xapian::Query((title:(pos=1) PHRASE 2 foo:(pos=2)))");
+    qp.add_prefix("title", "S");
+    TEST_STRINGS_EQUAL(qp.parse_query("title:foo").get_description(),
+		       "Xapian::Query(Sfoo:(pos=1))");
+    qp.add_boolean_prefix("site", "H");
+    TEST_STRINGS_EQUAL(qp.parse_query("title:foo site:example.org").get_description(),
+		       "Xapian::Query((Sfoo:(pos=1) FILTER Hexample.org))");
+    qp.add_prefix("", "X");
+    TEST_STRINGS_EQUAL(qp.parse_query("bar").get_description(),
+		       "Xapian::Query(Xbar:(pos=1))");
+
+    return true;
+}
+
 /// Test cases for the QueryParser.
 static const test_desc tests[] = {
     TESTCASE(queryparser1),
@@ -2207,6 +2406,7 @@ static const test_desc tests[] = {
     TESTCASE(qp_odd_chars1),
     TESTCASE(qp_flag_wildcard1),
     TESTCASE(qp_flag_wildcard2),
+    TESTCASE(qp_flag_wildcard3),
     TESTCASE(qp_flag_partial1),
     TESTCASE(qp_flag_bool_any_case1),
     TESTCASE(qp_stopper1),
@@ -2234,6 +2434,9 @@ static const test_desc tests[] = {
     TESTCASE(qp_scale1),
     TESTCASE(qp_near1),
     TESTCASE(qp_stopword_group1),
+    TESTCASE(qp_parse_cache1),
+    TESTCASE(qp_stopper_freeze1),
+    TESTCASE(qp_prefix_table1),
     END_OF_TESTCASES
 };
 
@@ -27,6 +27,7 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include <xapian/stem.h>
 #include "testsuite.h"
@@ -162,6 +163,63 @@ test_stemdict()
     return true;
 }
 
+// test the stem cache gives the same results as stemming directly
+static bool
+test_stemcache()
+{
+    static const char wordchars[] = "abcdefghijklmnopqrstuvwxyz";
+
+    tout << "Stemming with cache... (seed " << seed << ")" << endl;
+    srand(seed);
+
+    // A small vocabulary, so words repeat.
+    vector<string> words;
+    for (int i = 0; i < 500; ++i) {
+	string word;
+	int len = 1 + (rand() >> 8) % 12;
+	while (len--) word += wordchars[(rand() >> 8) % (sizeof wordchars - 1)];
+	words.push_back(word);
+    }
+
+    Xapian::Stem cached(language);
+    cached.set_cache_size(200);
+    TEST_EQUAL(cached.get_cache_hits(), 0);
+    TEST_EQUAL(cached.get_cache_misses(), 0);
+
+    string result;
+    unsigned long calls = 0;
+    for (int c = 0; c < 20000; ++c) {
+	// Favour words near the start of the list, like natural language.
+	size_t n = (rand() >> 8) % words.size();
+	n = n * n / words.size() * n / words.size();
+	const string & word = words[n];
+	string expect = stemmer(word);
+	if (c & 1) {
+	    TEST_EQUAL(cached(word), expect);
+	} else {
+	    cached.stem_word(word, result);
+	    TEST_EQUAL(result, expect);
+	}
+	++calls;
+    }
+
+    tout << "Hits " << cached.get_cache_hits() << ", misses "
+	 << cached.get_cache_misses() << endl;
+    if (language != "none") {
+	TEST_EQUAL(cached.get_cache_hits() + cached.get_cache_misses(), calls);
+	TEST_REL(cached.get_cache_hits(), >, cached.get_cache_misses());
+    }
+
+    // Disabling the cache stops it being used.
+    cached.set_cache_size(0);
+    unsigned long hits = cached.get_cache_hits();
+    (void)cached(words[0]);
+    (void)cached(words[0]);
+    TEST_EQUAL(cached.get_cache_hits(), hits);
+
+    return true;
+}
+
 // ##################################################################
 // # End of actual tests                                            #
 // ##################################################################
@@ -171,6 +229,7 @@ static const test_desc tests[] = {
     {"stemrandom",		test_stemrandom},
     {"stemjunk",		test_stemjunk},
     {"stemdict",		test_stemdict},
+    {"stemcache",		test_stemcache},
     {0, 0}
 };
 
@@ -103,6 +103,17 @@ static const test test_simple[] = {
     { "", "\xe1\x80\x9d\xe1\x80\xae\xe2\x80\x8b\xe1\x80\x80\xe1\x80\xae\xe2\x80\x8b\xe1\x80\x95\xe1\x80\xad\xe2\x80\x8b\xe1\x80\x9e\xe1\x80\xaf\xe1\x80\xb6\xe1\x80\xb8\xe2\x80\x8b\xe1\x80\x85\xe1\x80\xbd\xe1\x80\xb2\xe2\x80\x8b\xe1\x80\x9e\xe1\x80\xb0\xe2\x80\x8b\xe1\x80\x99\xe1\x80\xbb\xe1\x80\xac\xe1\x80\xb8\xe1\x80\x80",
       "Z\xe1\x80\x9d\xe1\x80\xae\xe1\x80\x80\xe1\x80\xae\xe1\x80\x95\xe1\x80\xad\xe1\x80\x9e\xe1\x80\xaf\xe1\x80\xb6\xe1\x80\xb8\xe1\x80\x85\xe1\x80\xbd\xe1\x80\xb2\xe1\x80\x9e\xe1\x80\xb0\xe1\x80\x99\xe1\x80\xbb\xe1\x80\xac\xe1\x80\xb8\xe1\x80\x80:1 \xe1\x80\x9d\xe1\x80\xae\xe1\x80\x80\xe1\x80\xae\xe1\x80\x95\xe1\x80\xad\xe1\x80\x9e\xe1\x80\xaf\xe1\x80\xb6\xe1\x80\xb8\xe1\x80\x85\xe1\x80\xbd\xe1\x80\xb2\xe1\x80\x9e\xe1\x80\xb0\xe1\x80\x99\xe1\x80\xbb\xe1\x80\xac\xe1\x80\xb8\xe1\x80\x80[1]" },
 
+    // Test runs of ASCII characters longer than the 16 bytes handled at once
+    // by the vectorised code, and how they interact with non-ASCII.
+    { "stem=none", "ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz_0123456789", "abcdefghijklmnopqrstuvwxyz_abcdefghijklmnopqrstuvwxyz_0123456789[1]" },
+    { "", "0123456789012345678901234567890123456789012345678901234567890123X short", "short[1]" },
+    { "", "abcdefghijklmno\xc3\xa9pqrstuvwxyzABCDEFGH\xc3\x89ijk", "abcdefghijklmno\xc3\xa9pqrstuvwxyzabcdefgh\xc3\xa9ijk[1]" },
+    { "", "one!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!two\xc2\xa0\xc2\xa0three", "one[1] three[3] two[2]" },
+    { "", "AAAAAAAAAAAAAAAAAAAA&BBBBBBBBBBBBBBBBBBBB", "aaaaaaaaaaaaaaaaaaaa&bbbbbbbbbbbbbbbbbbbb[1]" },
+    { "", "12345678901234567,890.5", "12345678901234567,890.5[1]" },
+    { "", "ABCDEFGHIJKLMNOPQ++ X.Y.Z.W.V.U.T.S.R.Q.P.O.N.M.L", "abcdefghijklmnopq++[1] xyzwvutsrqponml[2]" },
+    { "stem=en", "Internationalisation", "Zinternationalis:1 internationalisation[1]" },
+
     { "", "fish+chips", "Zchip:1 Zfish:1 chips[2] fish[1]" },
     // All following tests are for things which we probably don't really want to
     // behave as they currently do, but we haven't found a sufficiently general
@@ -716,6 +727,61 @@ static bool test_termgen1()
     return true;
 }
 
+/// Check the ASCII fast path classifies characters like the Unicode tables.
+static bool test_tg_ascii1()
+{
+    Xapian::TermGenerator termgen;
+
+    for (unsigned ch = 1; ch < 128; ++ch) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	// Surround the character with spaces, and repeat it so the run is long
+	// enough to be handled by the vectorised code too.
+	string text = " ";
+	text += string(40, char(ch));
+	text += " ";
+	termgen.index_text(text);
+	string expect;
+	if (Xapian::Unicode::is_wordchar(ch)) {
+	    string term;
+	    Xapian::Unicode::append_utf8(term, Xapian::Unicode::tolower(ch));
+	    for (int i = 0; i < 40; ++i) expect += term;
+	    expect += "[1]";
+	}
+	tout << "Character: " << ch << '\n';
+	TEST_STRINGS_EQUAL(format_doc_termlist(doc), expect);
+    }
+    return true;
+}
+
+/// Check postings batched by TermGenerator mix with the per-term API.
+static bool test_tg_batch1()
+{
+    Xapian::TermGenerator termgen;
+    Xapian::Document doc;
+    termgen.set_document(doc);
+
+    termgen.index_text("b a b");
+    TEST_EQUAL(doc.termlist_count(), 2);
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc), "a[2] b[1,3]");
+
+    doc.add_posting("a", 7);
+    doc.add_term("c");
+    termgen.index_text("a c");
+    termgen.index_text_without_positions("d b", 2, "X");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc),
+		       "Xb:2 Xd:2 a[2,4,7] b[1,3] c:2[5]");
+
+    termgen.index_text("e");
+    doc.remove_term("e");
+    termgen.index_text("e");
+    doc.clear_terms();
+    termgen.index_text("f");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc), "f[8]");
+
+    return true;
+}
+
 /// Test spelling data generation.
 static bool test_tg_spell1()
 {
@@ -761,6 +827,8 @@ static bool test_tg_spell2()
 /// Test cases for the TermGenerator.
 static const test_desc tests[] = {
     TESTCASE(termgen1),
+    TESTCASE(tg_ascii1),
+    TESTCASE(tg_batch1),
     TESTCASE(tg_spell1),
     TESTCASE(tg_spell2),
     END_OF_TESTCASES